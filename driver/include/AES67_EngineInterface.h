@@ -51,8 +51,12 @@ public:
     /// Set callbacks
     virtual void SetCallbacks(const EngineCallbacks& callbacks) = 0;
     
-    /// Get ring buffer for input stream (network → driver)
-    virtual AudioRingBuffer* GetInputRingBuffer(uint32_t streamIdx) = 0;
+    /// Pull input audio (network → driver) for one I/O cycle
+    /// ptpTimeNs: PTP time the first frame is due at the device
+    /// buffer: frames x 8 interleaved samples, concealed where packets are missing
+    /// Returns: number of frames that came from received packets
+    virtual uint32_t ReadInputFrames(uint32_t streamIdx, uint64_t ptpTimeNs,
+                                     int32_t* buffer, uint32_t frames) = 0;
     
     /// Get ring buffer for output stream (driver → network)
     virtual AudioRingBuffer* GetOutputRingBuffer(uint32_t streamIdx) = 0;
@@ -159,6 +159,11 @@ public:
 
     size_t Capacity() const noexcept { return capacity_; }
 
+    /// Current read/write positions (masked, in samples)
+    /// Lets the engine map ring contents onto the device timeline
+    size_t ReadIndex() const noexcept { return readIndex_.load(std::memory_order_acquire); }
+    size_t WriteIndex() const noexcept { return writeIndex_.load(std::memory_order_acquire); }
+
 private:
     static size_t NextPowerOfTwo(size_t n) {
         if (n == 0) return 1;
@@ -53,13 +53,13 @@ public:
     bool IsOutput() const { return direction_ == StreamDirection::Output; }
     
 private:
-    void ReadFromEngine(void* buffer, UInt32 frames);
+    void ReadFromEngine(void* buffer, UInt32 frames, uint64_t ptpTimeNs);
     void WriteToEngine(const void* buffer, UInt32 frames);
     
     StreamDirection direction_;
     INetworkEngine* engine_;
     
-    // Per-stream ring buffers (one per 8-channel block)
+    // Per-stream output ring buffers (one per 8-channel block, unused for input)
     std::array<AudioRingBuffer*, kTotalStreams> ringBuffers_;
     
     // Format
@@ -17,7 +17,7 @@ public:
     double GetPTPOffset() const override { return 0.0; }
     double GetRateScalar() const override { return 1.0; }
     void SetCallbacks(const EngineCallbacks&) override {}
-    AudioRingBuffer* GetInputRingBuffer(uint32_t) override { return nullptr; }
+    uint32_t ReadInputFrames(uint32_t, uint64_t, int32_t*, uint32_t) override { return 0; }
     AudioRingBuffer* GetOutputRingBuffer(uint32_t) override { return nullptr; }
     void NotifyIOCycle(uint64_t, uint64_t) override {}
 };
@@ -12,13 +12,9 @@ Stream::Stream(StreamDirection direction, INetworkEngine* engine)
     : direction_(direction)
     , engine_(engine)
 {
-    // Get ring buffers from engine
+    // Get output ring buffers from engine (input is pulled per I/O cycle)
     for (uint32_t i = 0; i < kTotalStreams; ++i) {
-        if (IsInput()) {
-            ringBuffers_[i] = engine_->GetInputRingBuffer(i);
-        } else {
-            ringBuffers_[i] = engine_->GetOutputRingBuffer(i);
-        }
+        ringBuffers_[i] = IsOutput() ? engine_->GetOutputRingBuffer(i) : nullptr;
     }
 }
 
@@ -30,7 +26,6 @@ OSStatus Stream::DoIO(
     void* ioMainBuffer,
     void* ioSecondaryBuffer)
 {
-    (void)ioCycleInfo;
     (void)ioSecondaryBuffer;
     
     if (!ioMainBuffer) {
@@ -38,7 +33,11 @@ OSStatus Stream::DoIO(
     }
     
     if (IsInput()) {
-        ReadFromEngine(ioMainBuffer, ioBufferFrameSize);
+        // Input time of this cycle on the PTP timeline
+        const uint64_t ptpTimeNs = ioCycleInfo 
+            ? engine_->HostTimeToPTP(ioCycleInfo->mInputTime.mHostTime)
+            : engine_->GetPTPTimeNs();
+        ReadFromEngine(ioMainBuffer, ioBufferFrameSize, ptpTimeNs);
     } else {
         WriteToEngine(ioMainBuffer, ioBufferFrameSize);
     }
@@ -46,35 +45,22 @@ OSStatus Stream::DoIO(
     return kAudioHardwareNoError;
 }
 
-void Stream::ReadFromEngine(void* buffer, UInt32 frames) {
+void Stream::ReadFromEngine(void* buffer, UInt32 frames, uint64_t ptpTimeNs) {
     auto* output = static_cast<int32_t*>(buffer);
     
-    // Read from each 8-channel ring buffer
+    // Pull each 8-channel stream from the engine (concealment/silence filled in there)
     for (uint32_t streamIdx = 0; streamIdx < kTotalStreams; ++streamIdx) {
-        auto* ring = ringBuffers_[streamIdx];
-        if (!ring) continue;
-        
-        // Temporary buffer for this stream's channels (max 64 frames * 8 channels)
+        // Temporary buffer for this stream's channels
         std::vector<int32_t> temp(kChannelsPerStream * frames);
-        size_t framesRead = ring->Read(temp.data(), frames);
+        engine_->ReadInputFrames(streamIdx, ptpTimeNs, temp.data(), frames);
         
         // Deinterleave into main buffer
-        for (size_t f = 0; f < framesRead; ++f) {
+        for (size_t f = 0; f < frames; ++f) {
             for (uint32_t c = 0; c < kChannelsPerStream; ++c) {
                 uint32_t globalChannel = streamIdx * kChannelsPerStream + c;
                 output[f * kTotalChannels + globalChannel] = temp[f * kChannelsPerStream + c];
             }
         }
-        
-        // Fill remaining with silence
-        if (framesRead < frames) {
-            for (size_t f = framesRead; f < frames; ++f) {
-                for (uint32_t c = 0; c < kChannelsPerStream; ++c) {
-                    uint32_t globalChannel = streamIdx * kChannelsPerStream + c;
-                    output[f * kTotalChannels + globalChannel] = 0;
-                }
-            }
-        }
     }
 }
 
@@ -97,7 +83,7 @@ void Stream::WriteToEngine(const void* buffer, UInt32 frames) {
             }
         }
         
-        ring->Write(temp.data(), frames);
+        ring->Write(temp.data(), frames * kChannelsPerStream);
     }
 }
 
@@ -0,0 +1,73 @@
+// AffineTimeMap.h - Seqlock-published host <-> PTP affine mapping
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace AES67 {
+
+// ptp = anchorPTP + slope * (host - anchorHost)
+// One writer (the servo) publishes a new set of coefficients; any number of
+// readers convert times lock-free and always see a consistent set.
+class AffineTimeMap {
+public:
+    struct Coefficients {
+        double slope = 1.0;
+        uint64_t anchorHost = 0;
+        uint64_t anchorPTP = 0;
+    };
+
+    // Writer side (single thread)
+    void Publish(const Coefficients& coeffs) {
+        const uint32_t seq = seq_.load(std::memory_order_relaxed);
+        seq_.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slope_.store(coeffs.slope, std::memory_order_relaxed);
+        anchorHost_.store(coeffs.anchorHost, std::memory_order_relaxed);
+        anchorPTP_.store(coeffs.anchorPTP, std::memory_order_relaxed);
+        seq_.store(seq + 2, std::memory_order_release);
+    }
+
+    // Reader side: retry while a publish is in progress
+    Coefficients Load() const {
+        Coefficients coeffs;
+        for (;;) {
+            const uint32_t seq1 = seq_.load(std::memory_order_acquire);
+            if (seq1 & 1) {
+                continue;
+            }
+            coeffs.slope = slope_.load(std::memory_order_relaxed);
+            coeffs.anchorHost = anchorHost_.load(std::memory_order_relaxed);
+            coeffs.anchorPTP = anchorPTP_.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (seq_.load(std::memory_order_relaxed) == seq1) {
+                return coeffs;
+            }
+        }
+    }
+
+    uint64_t HostToPTP(uint64_t hostNs) const {
+        return HostToPTP(Load(), hostNs);
+    }
+
+    uint64_t PTPToHost(uint64_t ptpNs) const {
+        const Coefficients c = Load();
+        const int64_t ptpDelta = static_cast<int64_t>(ptpNs - c.anchorPTP);
+        return c.anchorHost + static_cast<int64_t>(ptpDelta / c.slope);
+    }
+
+    static uint64_t HostToPTP(const Coefficients& c, uint64_t hostNs) {
+        const int64_t hostDelta = static_cast<int64_t>(hostNs - c.anchorHost);
+        return c.anchorPTP + static_cast<int64_t>(c.slope * hostDelta);
+    }
+
+private:
+    std::atomic<uint32_t> seq_{0};
+    std::atomic<double> slope_{1.0};
+    std::atomic<uint64_t> anchorHost_{0};
+    std::atomic<uint64_t> anchorPTP_{0};
+};
+
+} // namespace AES67
@@ -0,0 +1,82 @@
+// AsyncResampler.h - Drift-correcting asynchronous sample-rate converter
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace AES67 {
+
+// Polyphase windowed-sinc ASRC for interleaved int32 audio.
+// Ratio stays within a few hundred ppm of 1.0, so a short filter is enough.
+// Cost per output frame is fixed: kTaps coefficient interpolations plus
+// kTaps x channels multiply-adds (inner loop runs across channels and vectorizes).
+class AsyncResampler {
+public:
+    static constexpr uint32_t kTaps = 16;
+    static constexpr uint32_t kPhases = 64;
+
+    AsyncResampler(uint32_t channels, uint32_t maxInputFrames);
+
+    // Input frames consumed per output frame (>1.0 drains a fast sender)
+    void SetRatio(double ratio);
+    double GetRatio() const { return ratio_; }
+
+    // Push inputFrames, emit up to maxOutputFrames resampled frames
+    // Returns number of frames written to output
+    uint32_t Process(const int32_t* input, uint32_t inputFrames,
+                     int32_t* output, uint32_t maxOutputFrames);
+
+    // Filter group delay in input frames
+    static constexpr uint32_t GetLatencyFrames() { return kTaps / 2; }
+
+    void Reset();
+
+private:
+    void BuildFilterTable();
+
+    uint32_t channels_;
+    double ratio_ = 1.0;
+    double position_ = 0.0;         // Fractional read position into history_
+    uint32_t historyFrames_ = 0;    // Valid frames in history_
+
+    std::vector<float> table_;      // (kPhases + 1) x kTaps coefficients
+    std::vector<float> history_;    // Interleaved float samples
+    std::vector<float> accum_;      // Per-channel accumulator
+};
+
+// Steers an AsyncResampler: long-term sender rate from RTP timestamps vs PTP
+// arrival times, plus a slow PI loop holding buffered audio at its target.
+class DriftController {
+public:
+    explicit DriftController(uint32_t sampleRate);
+
+    // Feed every played packet (RTP timestamp and PTP arrival time)
+    void OnPacket(uint32_t rtpTimestamp, uint64_t arrivalTimeNs);
+
+    // Returns resampling ratio for the current buffer fill (frames)
+    double Update(double fillFrames, double targetFrames);
+
+    // Sender clock relative to ours (1.0 = locked, >1.0 = sender fast)
+    double GetRateEstimate() const { return rateEstimate_; }
+
+    void Reset();
+
+private:
+    uint32_t sampleRate_;
+
+    // Arrival rate estimation
+    bool haveAnchor_ = false;
+    uint32_t lastRtp_ = 0;
+    uint64_t rtpElapsed_ = 0;       // Unwrapped RTP frames since anchor
+    uint64_t anchorTimeNs_ = 0;
+    uint64_t lastEstimateNs_ = 0;
+    double rateEstimate_ = 1.0;
+
+    // Fill-level PI loop
+    double smoothedFill_ = -1.0;
+    double integrator_ = 0.0;
+};
+
+} // namespace AES67
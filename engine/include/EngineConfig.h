@@ -0,0 +1,75 @@
+// EngineConfig.h - engine.json / qos.json loading
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "RxSubscription.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace AES67 {
+
+// One qos.json profile. Defaults are the engine's built-in settings.
+struct QoSProfile {
+    std::string name;
+    std::string description;
+    uint32_t ioBufferFrames = 64;           // Device I/O buffer, 1 to 4096 frames
+    uint32_t txSafetyOffsetFrames = 0;      // TX stamps this far ahead of the device (0 = auto)
+    uint32_t packetTimeUs = 250;            // TX; 1 to 64 frames at 48 kHz
+    uint32_t jitterBufferPacketsMin = 3;
+    uint32_t jitterBufferPacketsMax = 6;
+    uint8_t ptpDomain = 0;                  // Construction only
+    int8_t ptpLogSyncInterval = -3;         // Applied at Start
+    uint8_t rtpDscp = 46;                   // EF
+    uint8_t ptpDscp = 0;                    // 0 = socket default
+
+    bool operator==(const QoSProfile& other) const = default;
+
+    // False (with the reason) unless the engine can run it
+    bool Validate(std::string& error) const;
+
+    // TX stamping offset. Unless set, the I/O buffer plus one packet: a
+    // frame the device writes can wait a whole buffer in the ring and then
+    // up to one packet for the packetizer, so the buffer alone would stamp
+    // the end of each cycle too late.
+    uint32_t TxSafetyOffsetFrames() const;
+};
+
+// qos.json "network": socket settings shared by every profile
+struct NetworkQoS {
+    int udpRecvBufferSize = 1024 * 1024;
+    int udpSendBufferSize = 256 * 1024;
+    int multicastTtl = 32;
+    bool multicastLoop = true;
+
+    bool operator==(const NetworkQoS& other) const = default;
+};
+
+struct EngineFileConfig {
+    std::string interface;                  // Empty = keep the engine's
+    bool havePtpDomain = false;
+    uint8_t ptpDomain = 0;
+    std::string qosProfile;                 // Profile to start with, empty = built-in
+    std::string qosPath;                    // qos.json; relative to engine.json
+    std::vector<std::pair<uint32_t, RxSubscription>> inputs;   // RX slot -> stream
+
+    std::vector<QoSProfile> profiles;       // From qos.json
+    NetworkQoS network;
+    bool sapEnabled = true;
+    uint32_t sapIntervalSeconds = 30;
+
+    const QoSProfile* FindProfile(const std::string& name) const;
+};
+
+// Parse the documents; false (with the reason) on malformed JSON or values
+// out of range. Keys not present keep their defaults.
+bool ParseEngineConfig(std::string_view json, EngineFileConfig& out, std::string& error);
+bool ParseQoSConfig(std::string_view json, EngineFileConfig& out, std::string& error);
+
+// engine.json, then its qos.json ("qos_file", default: qos.json next to it)
+bool LoadEngineConfig(const std::string& path, EngineFileConfig& out, std::string& error);
+
+} // namespace AES67
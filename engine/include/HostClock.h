@@ -0,0 +1,39 @@
+// HostClock.h - Monotonic host timebase for the PTP affine mapping
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <cstdint>
+#include <time.h>
+#if defined(__APPLE__)
+#include <mach/mach_time.h>
+#endif
+
+namespace AES67 {
+
+// Host time is a raw (never slewed or stepped) monotonic clock in nanoseconds:
+// CLOCK_MONOTONIC_RAW on Linux (vDSO, TSC-backed where available), and
+// mach_absolute_time() scaled to nanoseconds on macOS. Only the PTP servo
+// steers time, so NTP adjustments cannot show up as PTP offset.
+class HostClock {
+public:
+    static uint64_t NowNs() {
+#if defined(__APPLE__)
+        return TicksToNs(mach_absolute_time());
+#else
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+        return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<uint64_t>(ts.tv_nsec);
+#endif
+    }
+
+    // Driver host times (mach_absolute_time ticks) <-> host nanoseconds
+    static uint64_t TicksToNs(uint64_t ticks);
+    static uint64_t NsToTicks(uint64_t ns);
+
+    // Kernel timestamps are CLOCK_REALTIME; convert them onto the host timebase
+    static uint64_t RealtimeToHostNs(uint64_t realtimeNs);
+    static uint64_t RealtimeNowNs();
+};
+
+} // namespace AES67
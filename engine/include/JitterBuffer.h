@@ -3,55 +3,147 @@
 
 #pragma once
 
+#include <array>
+#include <atomic>
 #include <cstdint>
-#include <deque>
-#include <vector>
+#include <memory>
 
 namespace AES67 {
 
-struct JitterBufferPacket {
-    uint32_t timestamp;     // RTP timestamp
-    uint64_t arrivalTime;   // PTP nanoseconds
-    uint32_t frameCount;
-    std::vector<int32_t> samples;
-};
-
+// Playout buffer between one inserting (RX) thread and one reading (device
+// I/O) thread, with no lock and no allocation on either side. Frames are
+// stored by RTP timestamp in a ring allocated up front for capacityPackets
+// packets of up to maxPacketFrames frames: a frame's slot is its timestamp
+// modulo the ring size, stamped with the timestamp and the buffer's reset
+// epoch, and written and read seqlock-style so a half-written frame is never
+// played. Reordered packets land in place by themselves; packets the reader
+// has already passed are counted late. Statistics and limits are atomics,
+// safe from any thread.
 class JitterBuffer {
 public:
-    JitterBuffer(uint32_t minPackets, uint32_t maxPackets, uint32_t sampleRate);
+    static constexpr uint32_t kDefaultMaxPacketFrames = 64;     // 1.33 ms @ 48 kHz
+
+    // capacityPackets: deepest SetDepthLimits() may go (0 = maxPackets)
+    JitterBuffer(uint32_t minPackets, uint32_t maxPackets, uint32_t sampleRate,
+                 uint32_t maxPacketFrames = kDefaultMaxPacketFrames, uint32_t capacityPackets = 0);
     ~JitterBuffer();
-    
-    // Insert packet (takes ownership of samples)
-    void Insert(uint32_t timestamp, uint64_t arrivalTime, 
+
+    JitterBuffer(const JitterBuffer&) = delete;
+    JitterBuffer& operator=(const JitterBuffer&) = delete;
+
+    // Writer side: copy one packet in (frames past maxPacketFrames are dropped)
+    void Insert(uint32_t timestamp, uint64_t arrivalTime,
                 const int32_t* samples, uint32_t frameCount);
-    
-    // Get next packet for playout at given PTP time
-    // Returns null if buffer underrun
-    const JitterBufferPacket* GetNextPacket(uint64_t ptpTimeNs);
-    
-    // Release packet after consumption
-    void ReleasePacket(const JitterBufferPacket* packet);
-    
-    // Statistics
-    uint32_t GetDepth() const { return static_cast<uint32_t>(queue_.size()); }
-    uint32_t GetUnderrunCount() const { return underruns_; }
-    uint32_t GetOverrunCount() const { return overruns_; }
-    
+    // Writer side: forget every frame and the statistics; the reader follows
+    // on its next call
     void Reset();
-    
+
+    // Reader side. Pull-mode playout: copy frames [rtpTimestamp, rtpTimestamp + frames)
+    // into out (interleaved, 8 channels). Missing frames are concealed (last
+    // frame faded to silence). Returns number of frames that came from received packets
+    uint32_t Read(uint32_t rtpTimestamp, int32_t* out, uint32_t frames);
+
+    // RTP timestamp just past the newest packet not yet played, and its arrival time
+    bool GetNewestPacket(uint32_t& endTimestamp, uint64_t& arrivalTime) const;
+
+    // Any thread, for metering: copy the newest frames received (played or
+    // not) without moving the reader or counting underruns. Missing frames
+    // are zero. Returns number of frames that came from received packets
+    uint32_t PeekNewest(int32_t* out, uint32_t frames) const;
+
+    // Depth controller: target covers this quantile of arrival delay (default 0.99)
+    void SetTargetQuantile(double quantile);
+    // New depth bounds while running (max clamped to the capacity); queued
+    // audio is kept and the target moves into the new range
+    void SetDepthLimits(uint32_t minPackets, uint32_t maxPackets);
+    uint32_t GetCapacityPackets() const { return capacityPackets_; }
+
+    // Statistics
+    uint32_t GetDepth() const;                  // Packets queued ahead of the reader
+    uint32_t GetTargetDepth() const { return targetPackets_.load(std::memory_order_relaxed); }
+    uint32_t GetTargetDelayFrames() const {
+        return targetPackets_.load(std::memory_order_relaxed) * packetFrames_.load(std::memory_order_relaxed);
+    }
+    uint32_t GetUnderrunCount() const { return underruns_.load(std::memory_order_relaxed); }
+    uint32_t GetOverrunCount() const { return overruns_.load(std::memory_order_relaxed); }
+    uint32_t GetLateCount() const { return latePackets_.load(std::memory_order_relaxed); }
+    double GetJitterNs() const { return jitterNs_.load(std::memory_order_relaxed); }   // RFC 3550 interarrival jitter
+    uint64_t GetDelayQuantileNs() const { return delayQuantileNs_.load(std::memory_order_relaxed); }
+
 private:
-    void AdjustDepth();
-    
-    uint32_t minPackets_;
-    uint32_t maxPackets_;
-    uint32_t targetPackets_;
-    uint32_t sampleRate_;
-    
-    std::deque<JitterBufferPacket> queue_;
-    
-    uint32_t underruns_ = 0;
-    uint32_t overruns_ = 0;
-    uint64_t lastPlayoutTime_ = 0;
+    static uint64_t Tag(uint32_t epoch, uint32_t timestamp) {
+        return static_cast<uint64_t>(epoch) << 32 | timestamp;
+    }
+    bool ReadFrame(uint32_t epoch, uint32_t timestamp, int32_t* out) const;
+    void PublishNewest(uint32_t epoch, uint32_t endTimestamp, uint64_t arrivalTime);
+    bool LoadNewest(uint32_t& epoch, uint32_t& endTimestamp, uint64_t& arrivalTime) const;
+    void UpdateDelayStatistics(uint32_t timestamp, uint64_t arrivalTime);
+    void AdjustDepth(uint64_t nowNs, uint32_t frameCount);
+    void Conceal(int32_t* out, uint32_t frames);
+
+    // Arrival delay histogram (relative to the fastest recent transit)
+    static constexpr uint32_t kHistogramBins = 256;
+    static constexpr uint64_t kBinWidthNs = 50000;               // 50 µs -> 12.8 ms span
+    static constexpr uint32_t kHistogramDecayPackets = 4096;     // Halve counts this often
+    static constexpr uint32_t kChannels = 8;
+    static constexpr uint32_t kConcealFadeFrames = 48;           // 1 ms fade-out on loss
+
+    // Depth limits (any thread)
+    std::atomic<uint32_t> minPackets_;
+    std::atomic<uint32_t> maxPackets_;
+    std::atomic<uint32_t> targetPackets_;
+    std::atomic<uint64_t> releaseSince_{0};     // When the target first exceeded demand (0 = not)
+    const uint32_t capacityPackets_;
+    const uint32_t maxPacketFrames_;
+    const uint32_t sampleRate_;
+
+    // Frame store: slot = timestamp & frameMask_, stamp = Tag(epoch, timestamp)
+    // (0 = empty, epochs start at 1)
+    const uint32_t frameMask_;
+    std::unique_ptr<std::atomic<uint64_t>[]> stamps_;
+    std::unique_ptr<std::atomic<int32_t>[]> samples_;
+    std::atomic<uint32_t> epoch_{1};            // Bumped by Reset()
+    std::atomic<uint32_t> packetFrames_{0};     // Frames per packet (from the stream)
+
+    // Newest packet (seqlock: odd = write in progress)
+    std::atomic<uint32_t> newestSeq_{0};
+    std::atomic<uint32_t> newestEpoch_{0};      // 0 = none yet
+    std::atomic<uint32_t> newestEnd_{0};
+    std::atomic<uint64_t> newestArrival_{0};
+
+    // Reader position, Tag(epoch, next timestamp); 0 = nothing read
+    std::atomic<uint64_t> readState_{0};
+
+    std::atomic<uint32_t> underruns_{0};
+    std::atomic<uint32_t> overruns_{0};
+    std::atomic<uint32_t> latePackets_{0};
+
+    // Writer state
+    bool haveNewest_ = false;
+    std::atomic<uint32_t> oldest_{0};   // First timestamp of this epoch (depth before the reader starts)
+
+    // Reader state
+    uint32_t readEpoch_ = 1;
+    bool haveRead_ = false;
+    bool havePlayed_ = false;           // Any real frame read yet
+    bool starved_ = false;              // Underrun already counted for this gap
+    std::array<int32_t, kChannels> lastFrame_{};
+    uint32_t concealRun_ = 0;
+
+    // Arrival statistics (writer)
+    bool haveTransit_ = false;
+    uint32_t lastTimestamp_ = 0;
+    int64_t rtpElapsedNs_ = 0;          // Unwrapped RTP time since first packet
+    uint64_t firstArrival_ = 0;
+    int64_t lastTransit_ = 0;
+    int64_t baselineTransit_ = 0;       // Fastest transit of previous epoch
+    int64_t epochMinTransit_ = 0;
+    std::atomic<double> jitterNs_{0.0};
+    std::array<uint32_t, kHistogramBins> histogram_{};
+    uint32_t histogramTotal_ = 0;
+    uint32_t packetsSinceDecay_ = 0;
+    std::atomic<double> targetQuantile_{0.99};
+    std::atomic<uint64_t> delayQuantileNs_{0};
 };
 
 } // namespace AES67
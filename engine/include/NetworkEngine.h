@@ -4,17 +4,26 @@
 #pragma once
 
 #include "AES67_EngineInterface.h"
+#include "AsyncResampler.h"
+#include "EngineConfig.h"
 #include "RTPPacketizer.h"
+#include "RTPReceiver.h"
+#include "RxSubscription.h"
 #include "PTPClient.h"
+#include "PTPTransport.h"
 #include "JitterBuffer.h"
 #include "SAPAnnouncer.h"
+#include "SAPDiscoveryCache.h"
 #include "SDPParser.h"
+#include "SnapshotPublisher.h"
+#include <array>
 #include <memory>
 #include <thread>
 #include <atomic>
-#include <map>
+#include <condition_variable>
 #include <mutex>
 #include <string>
+#include <vector>
 
 namespace AES67 {
 
@@ -33,56 +42,233 @@ public:
     double GetPTPOffset() const override;
     double GetRateScalar() const override;
     void SetCallbacks(const EngineCallbacks& callbacks) override;
-    AudioRingBuffer* GetInputRingBuffer(uint32_t streamIdx) override;
+    uint32_t ReadInputFrames(uint32_t streamIdx, uint64_t ptpTimeNs,
+                             int32_t* buffer, uint32_t frames) override;
     AudioRingBuffer* GetOutputRingBuffer(uint32_t streamIdx) override;
     void NotifyIOCycle(uint64_t hostTime, uint64_t sampleTime) override;
     
     // Configuration helpers
     void SetNetworkInterface(const std::string& interfaceName) { config_.interface = interfaceName; }
+    void SetPTPMode(PTPClient::Mode mode) { config_.ptpMode = mode; }
+    void SetPTPServo(PTPServoType type, const PTPServoConfig& servoConfig = {}) {
+        config_.ptpServo = type;
+        config_.ptpServoConfig = servoConfig;
+    }
+    void SetPTPPriority(uint8_t priority1, uint8_t priority2 = 128) {
+        config_.ptpPriority1 = priority1;
+        config_.ptpPriority2 = priority2;
+    }
+    void SetPTPSyncInterval(int8_t logSyncInterval) { config_.ptpLogSyncInterval = logSyncInterval; }
+    void SetPTPHybrid(bool enable) { config_.ptpHybrid = enable; }
+    void SetPTPUnicastMaster(const std::string& address) { config_.ptpUnicastMaster = address; }
+    void SetPTPDelayMechanism(PTPClient::DelayMechanism mechanism) { config_.ptpDelayMechanism = mechanism; }
+    PTPPortState GetPTPPortState() const;
+    size_t GetPTPSlaveCount() const;
+    PTPStatsSnapshot GetPTPStats(double windowSec = 0.0) const;
     
-    // Stream discovery API
+    // Further PTP domains, followed as slave on the same sockets and thread as
+    // the main one (up to PTPTransport::kMaxDomains in all); only while stopped
+    bool AddPTPDomain(uint8_t domain);
+    bool IsPTPDomainLocked(uint8_t domain) const;
+    PTPPortState GetPTPDomainState(uint8_t domain) const;
+    PTPStatsSnapshot GetPTPDomainStats(uint8_t domain, double windowSec = 0.0) const;
+    
+    // RX stream timeline: arrival times and playout use this domain's clock,
+    // mapped onto the device timeline through host time. A subscription's
+    // a=ts-refclk on a tracked domain takes precedence; otherwise the domain
+    // set here holds across subscriptions. Default: main domain
+    bool SetStreamPTPDomain(uint32_t streamIdx, uint8_t domain);
+    // Same, from the stream's a=ts-refclk attribute
+    bool SetStreamRefClock(uint32_t streamIdx, const std::string& refClock);
+    uint8_t GetStreamPTPDomain(uint32_t streamIdx) const;
+    
+    // Stream discovery API. The snapshot is immutable and taken without a
+    // lock; hold it for a consistent view of every stream.
+    std::shared_ptr<const DiscoverySnapshot> GetDiscoverySnapshot() const;
     std::vector<std::string> GetDiscoveredStreamNames() const;
     bool GetDiscoveredStream(const std::string& name, SDPSession& outSession) const;
+    std::vector<std::string> GetDiscoveredStreamsForGroup(const std::string& multicastAddr) const;
+    
+    // RX subscriptions: what each of the 8 RX slots receives. Changing one
+    // while running retunes only that slot's group membership and
+    // depacketizer; the other streams keep playing. Slot 0 starts on 239.69.2.1:5006 (8-channel
+    // L24), the others idle until subscribed.
+    bool Subscribe(uint32_t streamIdx, const RxSubscription& subscription);
+    bool SubscribeDiscovered(uint32_t streamIdx, const std::string& name);
+    void Unsubscribe(uint32_t streamIdx);
+    bool GetSubscription(uint32_t streamIdx, RxSubscription& out) const;
+    
+    // Rule-based auto-subscribe: a discovered session matching a rule takes
+    // the rule's slot (or the first free one) and follows the session's
+    // updates until it is deleted or expires. No rules by default.
+    void AddAutoSubscribeRule(const AutoSubscribeRule& rule);
+    void ClearAutoSubscribeRules();
+    
+    // Measured device<->network latency (updated every input read / TX packet)
+    // Input: media time of a frame -> device reads it
+    // Output: device writes a frame -> frame leaves on the wire
+    // Resampled RX streams are not on our media clock and report 0
+    int64_t GetInputLatencyNs(uint32_t streamIdx) const;
+    int64_t GetOutputLatencyNs(uint32_t streamIdx) const;
+    
+    // Multi-stream alignment: every PTP-locked RX stream plays media time
+    // (now - playout delay), so streams are sample-aligned with each other.
+    // 0 = automatic (deepest jitter buffer target among receiving streams)
+    void SetPlayoutDelayFrames(uint32_t frames) { config_.playoutDelayFrames = frames; }
+    int64_t GetPlayoutDelayNs() const;
+    // Stream's distance from the common presentation time (0 = aligned, or resampled)
+    int64_t GetAlignmentErrorNs(uint32_t streamIdx) const;
+    
+    // Metering: the newest frames received on a stream (8 channels), played
+    // or not, without touching playout. Missing frames are zero; returns the
+    // number that were received.
+    uint32_t PeekInputFrames(uint32_t streamIdx, int32_t* buffer, uint32_t frames) const;
+    
+    // Asynchronous resampling for RX senders not locked to our PTP domain
+    void SetStreamResampling(uint32_t streamIdx, bool enabled);
+    bool IsStreamResampling(uint32_t streamIdx) const;
+    double GetStreamRateEstimate(uint32_t streamIdx) const;
+    
+    // QoS profiles, from the qos.json next to the engine.json given at
+    // construction. Switching while running retunes only what differs (jitter
+    // buffer limits, TX packet time and stamping offset, DSCP) and every
+    // stream keeps its socket and group. The PTP domain is fixed once the
+    // engine exists; the sync interval applies at the next Start(). Output
+    // rings and jitter buffers are sized at construction for the built-in and
+    // qos.json profiles; a profile needing more is refused.
+    bool SetQoSProfile(const std::string& name);
+    bool ApplyQoSProfile(const QoSProfile& profile);
+    QoSProfile GetQoSProfile() const;                   // Empty name = built-in
+    std::vector<std::string> GetQoSProfileNames() const;
+    void SetNetworkQoS(const NetworkQoS& network);
     
 private:
-    void RTPReceiveThread(uint32_t streamIdx);
+    friend struct NetworkEngineTestAccess;      // Unit tests drive the timing paths
+    
+    void RTPReceiveThread();
     void RTPTransmitThread(uint32_t streamIdx);
-    void JitterBufferPlayoutThread(uint32_t streamIdx);
     void SAPDiscoveryThread();
     void PTPThread();
     
-    void OnStreamDiscovered(const std::string& streamName, const SDPSession& sdp);
+    const PTPClient* PTPClientForDomain(uint8_t domain) const;
+    
+    // RX slot subscription, handed to the receive thread
+    struct RxSlot {
+        mutable std::mutex mutex;
+        RxSubscription subscription;
+        bool subscribed = false;
+        bool automatic = false;         // Made by an auto-subscribe rule
+        uint64_t payloadHash = 0;       // Of the discovered SDP it was made from
+    };
+    bool SetSubscription(uint32_t streamIdx, const RxSubscription* subscription,
+                         bool automatic, uint64_t payloadHash);
+    void ApplyAutoSubscribe(const DiscoverySnapshot& snapshot);
+    
+    // Device timeline anchors (written by NotifyIOCycle, read by TX threads)
+    struct IOCycleAnchor {
+        uint64_t sampleTime = 0;    // Device sample time at cycle start
+        uint64_t mediaOffset = 0;   // Media clock (PTP @ 48kHz) minus device sample time
+        std::array<size_t, 8> outputWriteIndex{};
+    };
+    bool LoadIOCycleAnchor(IOCycleAnchor& out) const;
+    // RTP timestamp for the next packet: device sample time of the ring head
+    // plus the safety offset; also updates the output latency (at ptpNowNs)
+    uint32_t AlignTxTimestamp(uint32_t streamIdx, uint32_t safetyOffsetFrames, uint64_t ptpNowNs);
+    
+    // RX playout state, owned by the thread calling ReadInputFrames
+    struct RxPlayoutState {
+        uint32_t cursor = 0;            // RTP timestamp of the next frame to read
+        bool active = false;
+        bool resampling = false;
+        uint32_t lastNewestEnd = 0;     // Newest packet already fed to the drift controller
+        uint64_t lastFoundNs = 0;       // PTP time of the last read that returned audio
+    };
+    uint32_t UpdatePlayoutDelay(uint64_t ptpTimeNs);
+    uint32_t ReadResampled(uint32_t streamIdx, RxPlayoutState& state,
+                           int32_t* buffer, uint32_t frames);
     
     EngineCallbacks callbacks_;
-    std::unique_ptr<PTPClient> ptpClient_;
+    std::unique_ptr<PTPTransport> ptpTransport_;                // Shared by every domain
+    std::unique_ptr<PTPClient> ptpClient_;                      // Main domain: device timeline
+    std::vector<std::unique_ptr<PTPClient>> ptpExtraDomains_;   // AddPTPDomain()
     std::unique_ptr<SAPAnnouncer> sapAnnouncer_;
     
     // Per-stream components (8 streams each direction)
     std::array<std::unique_ptr<RTPPacketizer>, 8> txPacketizers_;
     std::array<std::unique_ptr<RTPDepacketizer>, 8> rxDepacketizers_;
     std::array<std::unique_ptr<JitterBuffer>, 8> rxJitterBuffers_;
-    std::array<std::unique_ptr<AudioRingBuffer>, 8> inputRings_;
+    std::array<std::unique_ptr<AsyncResampler>, 8> rxResamplers_;
+    std::array<std::unique_ptr<DriftController>, 8> rxDriftControllers_;
     std::array<std::unique_ptr<AudioRingBuffer>, 8> outputRings_;
+    std::array<std::atomic<const PTPClient*>, 8> rxClock_{};   // Stream's PTP domain
+    std::array<std::atomic<const PTPClient*>, 8> rxClockSet_{}; // SetStreamPTPDomain(), nullptr = none
     
     // Worker threads
-    std::array<std::thread, 8> rxThreads_;
+    std::thread rxThread_;              // Every RX slot, through one RTPReceiver
     std::array<std::thread, 8> txThreads_;
-    std::array<std::thread, 8> playoutThreads_;
     std::thread sapDiscoveryThread_;
     std::thread ptpThread_;
     
     std::atomic<bool> running_{false};
     
-    // Discovered streams
-    std::map<std::string, SDPSession> discoveredStreams_;
-    mutable std::mutex discoveryMutex_;
+    // I/O cycle alignment state (seqlock: odd = write in progress)
+    std::atomic<uint32_t> ioAnchorSeq_{0};
+    std::atomic<uint64_t> ioSampleTime_{0};
+    std::atomic<uint64_t> ioMediaOffset_{0};
+    std::array<std::atomic<size_t>, 8> ioOutputWriteIndex_{};
+    
+    // Per-stream alignment state
+    std::array<RxPlayoutState, 8> rxPlayout_{};
+    std::array<std::atomic<int64_t>, 8> inputLatencyNs_{};
+    std::array<std::atomic<int64_t>, 8> outputLatencyNs_{};
+    std::array<std::atomic<int64_t>, 8> alignmentErrorNs_{};
+    uint64_t playoutDelayTimeNs_ = 0;           // Read time the common delay was computed for
+    std::atomic<uint32_t> playoutDelayFrames_{0};
+    
+    // Per-stream ASRC state (resampler/controller owned by the input reader)
+    std::array<std::atomic<bool>, 8> rxResampleEnabled_{};
+    std::array<std::atomic<double>, 8> rxRateEstimate_{};
+    
+    // Discovered streams (cache owned by the SAP discovery thread)
+    SAPDiscoveryCache discovery_;
+    SnapshotPublisher<DiscoverySnapshot> discoverySnapshot_;
+    
+    // RX subscriptions and auto-subscribe rules
+    std::array<RxSlot, 8> rxSlots_;
+    std::atomic<uint32_t> rxGeneration_{0};    // Bumped on any slot change
+    std::mutex rxWakeMutex_;
+    std::condition_variable rxChanged_;         // Wakes an idle receive thread
+    std::mutex autoSubscribeMutex_;     // Rules, and one auto-subscribe pass at a time
+    std::vector<AutoSubscribeRule> autoSubscribeRules_;
+    
+    // Active QoS; the RX and TX threads re-read it when the generation moves
+    struct QoSSettings {
+        QoSProfile profile;
+        NetworkQoS network;
+    };
+    void PublishQoS(const QoSSettings& next);
+    std::vector<StreamDescription> TxStreamDescriptions(uint32_t packetTimeUs) const;
+    SnapshotPublisher<QoSSettings> qos_;
+    std::atomic<uint32_t> qosGeneration_{0};
+    mutable std::mutex qosMutex_;       // Profile list, and one switch at a time
+    std::vector<QoSProfile> qosProfiles_;
     
     // Configuration
     struct Config {
-        uint32_t packetTimeUs = 250;
-        uint32_t jitterBufferPackets = 3;
+        uint32_t ringFrames = 8192;     // Output rings (at least), ~170 ms @ 48kHz
+        uint32_t playoutDelayFrames = 0; // Common RX presentation delay (0 = automatic)
         uint8_t ptpDomain = 0;
+        PTPClient::Mode ptpMode = PTPClient::Mode::Auto;
+        uint8_t ptpPriority1 = 128;
+        uint8_t ptpPriority2 = 128;
+        int8_t ptpLogSyncInterval = -3;     // 8 Hz as grandmaster
+        bool ptpHybrid = false;             // Unicast Delay_Req as slave
+        std::string ptpUnicastMaster;       // Negotiate unicast service from this master
+        PTPClient::DelayMechanism ptpDelayMechanism = PTPClient::DelayMechanism::E2E;
+        PTPServoType ptpServo = PTPServoType::LeastSquares;
+        PTPServoConfig ptpServoConfig;
         bool multicast = true;
+        bool sapAnnounce = true;
         std::string interface = "en0";
     } config_;
 };
@@ -0,0 +1,74 @@
+// PTPBMCA.h - IEEE 1588 Best Master Clock Algorithm
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "PTPTypes.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace AES67 {
+
+// Port state of a single-port ordinary clock
+enum class PTPPortState {
+    Listening,  // Waiting for Announce messages (or no master, slave-only)
+    Master,
+    Slave
+};
+
+const char* PTPPortStateName(PTPPortState state);
+
+// Clock dataset as carried in Announce (IEEE 1588-2008 7.6, 13.5)
+struct PTPClockDataset {
+    uint8_t priority1 = 128;
+    uint8_t clockClass = 248;                   // Default, not traceable
+    uint8_t clockAccuracy = 0xFE;               // Unknown
+    uint16_t offsetScaledLogVariance = 0xFFFF;
+    uint8_t priority2 = 128;
+    ClockIdentity grandmasterIdentity{};
+    uint16_t stepsRemoved = 0;
+    ClockIdentity senderIdentity{};             // sourcePortIdentity of the Announce
+    uint16_t senderPort = 0;
+};
+
+// Parse an Announce message (header included); logInterval from the header
+bool ParsePTPAnnounce(const uint8_t* buffer, size_t length, PTPClockDataset& dataset, int8_t& logInterval);
+
+// Dataset comparison (IEEE 1588-2008 9.3.4): < 0 if a is better, > 0 if b is better
+int ComparePTPDatasets(const PTPClockDataset& a, const PTPClockDataset& b);
+
+// State decision for one port: local is this clock's default dataset,
+// best the best qualified foreign master (nullptr if none)
+PTPPortState DecidePTPPortState(const PTPClockDataset& local, const PTPClockDataset* best, bool slaveOnly);
+
+// Foreign masters heard on the port. A master qualifies after two Announces
+// within four of its announce intervals and expires after three silent ones.
+class PTPForeignMasterTable {
+public:
+    void Add(const PTPClockDataset& dataset, int8_t logAnnounceInterval, uint64_t nowNs);
+    void Expire(uint64_t nowNs);
+    void Clear() { entries_.clear(); }
+
+    // Best qualified foreign master, nullptr if none (valid until the next Add/Expire)
+    const PTPClockDataset* Best() const;
+    size_t Size() const { return entries_.size(); }
+
+private:
+    static constexpr size_t kMaxForeignMasters = 16;
+    static constexpr uint64_t kForeignMasterWindow = 4;     // Announce intervals
+    static constexpr uint64_t kAnnounceReceiptTimeout = 3;  // Announce intervals
+
+    struct Entry {
+        PTPClockDataset dataset;
+        uint64_t intervalNs = 0;
+        uint64_t lastRxNs = 0;
+        uint64_t previousRxNs = 0;
+    };
+
+    bool Qualified(const Entry& entry) const;
+
+    std::vector<Entry> entries_;
+};
+
+} // namespace AES67
@@ -3,11 +3,21 @@
 
 #pragma once
 
+#include "AffineTimeMap.h"
+#include "PTPBMCA.h"
+#include "PTPEventLoop.h"
+#include "PTPFilter.h"
+#include "PTPServo.h"
+#include "PTPStats.h"
+#include "PTPTimestamping.h"
+#include "PTPTransport.h"
 #include "PTPTypes.h"
+#include "PTPUnicast.h"
 #include <cstdint>
 #include <atomic>
 #include <functional>
-#include <thread>
+#include <memory>
+#include <string>
 #include <netinet/in.h>
 
 namespace AES67 {
@@ -15,20 +25,59 @@ namespace AES67 {
 class PTPClient {
 public:
     enum class Mode {
-        Slave,
-        Master
+        Slave,      // Slave-only: never becomes grandmaster
+        Master,     // Forced grandmaster, ignores other masters
+        Auto        // BMCA picks master or slave at runtime
+    };
+    
+    enum class DelayMechanism {
+        E2E,        // Delay_Req/Delay_Resp with the master
+        P2P         // Pdelay with the link peer (peer-to-peer transparent clocks)
     };
 
     explicit PTPClient(uint8_t domain = kPTPDefaultDomain, Mode mode = Mode::Slave);
     ~PTPClient();
     
+    // Own sockets and thread on the interface
     bool Start(const char* interfaceName, Mode mode = Mode::Slave);
+    // One domain of a transport shared with other domains: after transport.Open(),
+    // before transport.Start()
+    bool Start(PTPTransport& transport, Mode mode = Mode::Slave);
+    // Stops the transport too, and with it every domain sharing it
     void Stop();
     
+    uint8_t GetDomain() const { return domain_; }
+    
+    // Select the clock servo (slave mode); only while stopped
+    bool SetServo(PTPServoType type, const PTPServoConfig& config = {});
+    PTPServoType GetServoType() const { return servo_->GetType(); }
+    
+    // BMCA priorities announced as grandmaster (lower wins); only while stopped
+    bool SetPriority(uint8_t priority1, uint8_t priority2 = 128);
+    
+    // Sync rate as grandmaster, 2^logSyncInterval s: -7 (128 Hz) to 0 (1 Hz); only while stopped
+    bool SetSyncInterval(int8_t logSyncInterval);
+    int8_t GetSyncInterval() const { return logSyncInterval_; }
+    
+    // Hybrid mode (slave): Delay_Req goes unicast to the master; only while stopped
+    bool SetHybrid(bool enable);
+    
+    // Unicast negotiation (slave): request Announce, Sync and Delay_Resp from this
+    // master (IPv4 address, empty to disable). Implies hybrid Delay_Req; only while stopped
+    bool SetUnicastMaster(const std::string& address);
+    
+    // Path delay measurement; only while stopped
+    bool SetDelayMechanism(DelayMechanism mechanism);
+    DelayMechanism GetDelayMechanism() const { return delayMechanism_; }
+    
+    // Slaves seen by this master (Delay_Req or unicast grants)
+    size_t GetSlaveCount() const { return slaveCount_.load(); }
+    
     // Get current PTP time (nanoseconds since epoch)
+    // Lock-free: one raw host clock read plus a seqlock-protected affine map
     uint64_t GetPTPTimeNs() const;
     
-    // Affine mapping: hostTime = a * ptpTime + b
+    // Affine mapping between host time (HostClock ns) and PTP time
     uint64_t HostTimeToPTP(uint64_t hostTime) const;
     uint64_t PTPToHostTime(uint64_t ptpTimeNs) const;
     
@@ -40,24 +89,71 @@ public:
     using StatusCallback = std::function<void(bool locked, double offsetNs)>;
     void SetStatusCallback(StatusCallback cb) { statusCallback_ = cb; }
     Mode GetMode() const { return mode_; }
+    PTPPortState GetPortState() const { return portState_.load(); }
+    PTPTimestampMode GetTimestampMode() const { return timestampMode_; }
+    
+    // Slave measurements (E2E: path delay to the master, P2P: link delay to the peer)
+    double GetMeanPathDelayNs() const { return meanPathDelayNs_.load(); }
+    uint32_t GetRejectedSamples() const { return rejectedSamples_.load(); }
+    
+    // Clock quality over the last windowSec (0: all retained samples); any thread
+    PTPStatsSnapshot GetStats(double windowSec = 0.0) const { return stats_.Snapshot(windowSec); }
 
 private:
-    void ReceiveThread();
+    friend class PTPTransport;
+    
+    // Called by the transport's thread with this domain's messages and timers
+    void HandleEventMessage(const uint8_t* buffer, size_t length, uint64_t rxTimeNs, const sockaddr_in& srcAddr);
+    bool HandleGeneralMessage(const uint8_t* buffer, size_t length, const sockaddr_in& srcAddr); // true: Announce
+    void ServeTimers(uint32_t timers, uint64_t nowNs);
+    void ServeMasterTimers(uint32_t timers, uint64_t nowNs);
+    void OnTransportStopped();
+    static uint64_t NextDeadline(uint64_t previousNs, uint64_t intervalNs, uint64_t nowNs);
     void ServoUpdate(int64_t offsetNs, uint64_t hostTime);
+    
+    // BMCA and role switching (event thread only)
+    void HandleAnnounce(const uint8_t* buffer, size_t length);
+    void RunBMCA(uint64_t nowNs);
+    void SelectMaster(const PTPClockDataset& master);
+    void SetPortState(PTPPortState state);
+    
+    // Slave-mode message handling
+    void HandleSync(const uint8_t* buffer, size_t length, uint64_t rxTimeNs, const sockaddr_in& srcAddr);
+    void HandleFollowUp(const uint8_t* buffer, size_t length);
+    void HandleDelayResp(const uint8_t* buffer, size_t length);
+    bool IsFromMaster(const uint8_t* buffer);
+    void SendDelayReq(uint64_t nowNs);
+    void ProcessSyncMeasurement();
+    void ResetSlaveState(bool keepTimeline);
+    
+    // Peer delay mechanism, every port state
+    void SendPdelayReq(uint64_t nowNs);
+    void HandlePdelayReq(const uint8_t* buffer, size_t length, uint64_t rxTimeNs);
+    void HandlePdelayResp(const uint8_t* buffer, size_t length, uint64_t rxTimeNs);
+    void HandlePdelayRespFollowUp(const uint8_t* buffer, size_t length);
+    void CompletePdelay();
+    void ResetPeer();
 
     // Master-mode helpers
-    bool StartSlave(const char* interfaceName);
-    bool StartMaster(const char* interfaceName);
-    bool InitializeInterface(const char* interfaceName);
-    void MasterSendThread();
-    void MasterEventThread();
-    void SendSync(uint16_t sequenceId, uint64_t timestampNs);
-    void SendAnnounce(uint16_t sequenceId, uint64_t timestampNs);
-    void SendDelayResp(const sockaddr_in& destAddr,
-                       const ClockIdentity& requesterId,
-                       uint16_t requesterPortId,
-                       uint16_t sequenceId,
-                       uint64_t receiveTimestampNs);
+    void HandleDelayReq(const uint8_t* buffer, size_t length, uint64_t rxTimeNs, const sockaddr_in& srcAddr);
+    
+    // Unicast negotiation (master grants, slave requests)
+    void HandleSignaling(const uint8_t* buffer, size_t length, const sockaddr_in& srcAddr);
+    void HandleUnicastReply(const PTPUnicastMessage* messages, size_t count,
+                            const PTPPortIdentity& sender, const sockaddr_in& srcAddr, uint64_t nowNs);
+    void NegotiateUnicast(uint64_t nowNs);
+    void CancelUnicast();
+    void ServeUnicast(uint64_t nowNs);
+    
+    // Sync goes out immediately (transmit timestamp); general messages are
+    // queued in generalBatch_ and sent together at the end of the wakeup
+    void SendSync(const sockaddr_in& eventDest, const sockaddr_in& generalDest,
+                  uint16_t sequenceId, int8_t logInterval, uint8_t flags);
+    void QueueAnnounce(const sockaddr_in& dest, uint16_t sequenceId, int8_t logInterval, uint8_t flags);
+    void QueueDelayResp(const sockaddr_in& dest, const PTPPortIdentity& requester,
+                        uint16_t sequenceId, uint64_t receiveTimestampNs);
+    void QueueSignaling(const sockaddr_in& dest, const PTPPortIdentity& target,
+                        const PTPUnicastMessage* messages, size_t count);
     void BuildHeader(uint8_t* buffer,
                      PTPMessageType type,
                      uint16_t messageLength,
@@ -66,47 +162,100 @@ private:
                      int8_t logMessageInterval,
                      uint16_t flagField = 0);
     void WriteTimestamp(uint8_t* buffer, uint64_t timestampNs) const;
-    uint64_t GetSystemTimeNs() const;
-    void CloseSockets();
+    uint64_t GetHostTimeNs() const;
     
     uint8_t domain_;
     Mode mode_;
-    int socketEvent_ = -1;
-    int socketGeneral_ = -1;
+    PTPTransport* transport_ = nullptr;         // Sockets, timestamps, event loop, thread
+    std::unique_ptr<PTPTransport> ownTransport_; // Start(interfaceName): not shared
+    PTPTimestampMode timestampMode_ = PTPTimestampMode::User;
+    int syncTimer_ = -1;
+    int announceTimer_ = -1;
+    int housekeepingTimer_ = -1;        // BMCA, master timeout
+    int unicastTimer_ = -1;             // Next unicast Sync/Announce (master)
+    int negotiationTimer_ = -1;         // Next unicast request/renewal (slave)
+    int pdelayTimer_ = -1;              // Next Pdelay_Req (P2P)
     
     std::atomic<bool> running_{false};
     std::atomic<bool> locked_{false};
+    std::atomic<PTPPortState> portState_{PTPPortState::Listening};
     std::atomic<double> offsetNs_{0.0};
     std::atomic<double> rateRatio_{1.0};
     
-    // Affine coefficients (protected by servo logic)
-    double affineSlopeA_ = 1.0;
-    double affineOffsetB_ = 0.0;
-    uint64_t affineAnchorHost_ = 0;
-    uint64_t affineAnchorPTP_ = 0;
+    // Affine coefficients (written by the servo, read from any thread)
+    AffineTimeMap timeMap_;
+    
+    // Servo state (event thread only)
+    std::unique_ptr<PTPServo> servo_;
+    bool servoStarted_ = false;
+    uint32_t lockCount_ = 0;
+    
+    // Slave state (event thread only)
+    bool haveMaster_ = false;
+    ClockIdentity masterIdentity_{};
+    uint16_t masterPortId_ = 0;
+    uint64_t lastSyncRxNs_ = 0;
+    uint16_t syncSeq_ = 0;
+    uint8_t syncUnicast_ = 0;           // Unicast flag of that Sync
+    bool syncPending_ = false;          // Two-step Sync waiting for Follow_Up
+    int64_t syncT1_ = 0;                // Master origin time (incl. corrections)
+    int64_t syncT2_ = 0;                // Local arrival time
+    int64_t syncCorrection_ = 0;
+    uint16_t delayReqSeq_ = 0;
+    bool delayReqPending_ = false;
+    uint64_t delayReqSentNs_ = 0;
+    PTPExchange delayExchange_;         // Sync t1/t2 + Delay_Req t3/t4 in flight
+    uint64_t nextDelayReqNs_ = 0;
+    uint64_t delayReqIntervalNs_ = 1000000000ULL;
+    PTPMeasurementFilter filter_;
+    std::atomic<double> meanPathDelayNs_{0.0};
+    std::atomic<uint32_t> rejectedSamples_{0};
+    int64_t lastSyncT2_ = 0;            // Previous Sync arrival, for the interval statistic
+    PTPStats stats_;                    // Written per offset sample, read from any thread
     
-    // PI servo state
-    double integrator_ = 0.0;
-    double kp_ = 0.001;
-    double ki_ = 0.0001;
+    // BMCA state (event thread only)
+    PTPClockDataset localDataset_;
+    PTPForeignMasterTable foreignMasters_;
+    uint64_t listenUntilNs_ = 0;
     
     StatusCallback statusCallback_;
-    std::thread receiveThread_;
     
     // Master mode state
-    std::atomic<bool> masterRunning_{false};
-    std::thread masterSendThread_;
-    std::thread masterEventThread_;
     sockaddr_in eventDestAddr_{};
     sockaddr_in generalDestAddr_{};
-    in_addr interfaceAddr_{};
-    ClockIdentity clockIdentity_{};
-    uint8_t macAddress_[6]{};
+    ClockIdentity clockIdentity_{};     // The transport's, shared by its domains
     uint16_t portNumber_ = 1;
     uint16_t syncSequenceId_ = 0;
     uint16_t announceSequenceId_ = 0;
-    int syncIntervalMs_ = 125;      // 8 Hz default
-    int announceIntervalMs_ = 1000; // 1 Hz default
+    int8_t logSyncInterval_ = -3;   // 8 Hz default
+    uint64_t nextSyncNs_ = 0;
+    uint64_t nextAnnounceNs_ = 0;
+    uint16_t signalingSequenceId_ = 0;
+    
+    // Unicast service (event thread only)
+    PTPSlaveTable slaveTable_;              // Master: per-slave grants and state
+    std::atomic<size_t> slaveCount_{0};
+    bool hybrid_ = false;
+    bool unicastEnabled_ = false;
+    in_addr unicastMaster_{};
+    in_addr masterAddr_{};                  // Source of the selected master's Sync
+    PTPUnicastGrant unicastGrants_[3];      // Slave: Announce, Sync, Delay_Resp
+    
+    // Peer delay (event thread only); the link delay outlives master changes
+    DelayMechanism delayMechanism_ = DelayMechanism::E2E;
+    sockaddr_in pdelayEventAddr_{};
+    sockaddr_in pdelayGeneralAddr_{};
+    uint16_t pdelaySeq_ = 0;
+    bool pdelayPending_ = false;            // Pdelay_Req sent, exchange not complete
+    bool pdelayRespReceived_ = false;       // Two-step: waiting for the Follow_Up
+    PTPPdelayExchange pdelayExchange_;
+    PTPPortIdentity pdelayResponder_;
+    uint32_t pdelayLost_ = 0;               // Consecutive unanswered requests
+    bool havePeer_ = false;
+    PTPPortIdentity peerIdentity_;
+    uint32_t peerSamples_ = 0;              // Link delays since the peer appeared
+    bool multiplePeersWarned_ = false;
+    PTPMeasurementFilter linkFilter_;
 };
 
 } // namespace AES67
@@ -0,0 +1,60 @@
+// PTPEventLoop.h - Socket readiness and timers for the PTP thread
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <cstdint>
+
+namespace AES67 {
+
+// Lets one thread sleep until a PTP socket is readable or a timer is due.
+// Linux: epoll, one timerfd per timer and an eventfd for Wake().
+// Other platforms: poll() on the sockets and a wake pipe, with the timeout
+// taken from the earliest timer deadline.
+// Timers are one-shot with deadlines in HostClock nanoseconds.
+class PTPEventLoop {
+public:
+    static constexpr int kMaxSockets = 8;
+    static constexpr int kMaxTimers = 32;  // Ready::timers is a 32-bit mask
+
+    struct Ready {
+        uint32_t sockets = 0;   // Bit per AddSocket() index
+        uint32_t timers = 0;    // Bit per AddTimer() index; reported timers are disarmed
+    };
+
+    PTPEventLoop() = default;
+    ~PTPEventLoop();
+
+    PTPEventLoop(const PTPEventLoop&) = delete;
+    PTPEventLoop& operator=(const PTPEventLoop&) = delete;
+
+    bool Open();
+    void Close();
+
+    // Registration (before Wait() runs); return the index, -1 on failure
+    int AddSocket(int fd);
+    int AddTimer();
+
+    // Owning thread only
+    void ArmTimer(int timer, uint64_t deadlineNs);
+    void DisarmTimer(int timer);
+    Ready Wait();
+
+    // Any thread: make the current or next Wait() return
+    void Wake();
+
+private:
+    int sockets_[kMaxSockets]{};
+    int socketCount_ = 0;
+    uint64_t deadlines_[kMaxTimers]{};  // 0 = disarmed
+    int timerCount_ = 0;
+#if defined(__linux__)
+    int epollFd_ = -1;
+    int wakeFd_ = -1;
+    int timerFds_[kMaxTimers]{};
+#else
+    int wakePipe_[2] = {-1, -1};
+#endif
+};
+
+} // namespace AES67
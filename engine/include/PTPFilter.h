@@ -0,0 +1,75 @@
+// PTPFilter.h - PTP path delay / offset measurement filtering
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <cstdint>
+
+namespace AES67 {
+
+// One completed Sync + Delay_Req exchange (E2E delay mechanism)
+// t1: Sync origin (master)      t2: Sync arrival (slave)
+// t3: Delay_Req departure (slave) t4: Delay_Req arrival (master)
+struct PTPExchange {
+    int64_t t1 = 0;
+    int64_t t2 = 0;
+    int64_t t3 = 0;
+    int64_t t4 = 0;
+
+    // IEEE 1588 mean path delay: ((t2 - t1) + (t4 - t3)) / 2
+    int64_t MeanPathDelay() const { return ((t2 - t1) + (t4 - t3)) / 2; }
+};
+
+// One completed Pdelay exchange (P2P delay mechanism)
+// t1: Pdelay_Req departure (requester)   t2: Pdelay_Req arrival (responder)
+// t3: Pdelay_Resp departure (responder)  t4: Pdelay_Resp arrival (requester)
+// correction: Pdelay_Resp + Pdelay_Resp_Follow_Up correctionFields (one-step
+// responders put their turnaround time there and leave t2 = t3 = 0)
+struct PTPPdelayExchange {
+    int64_t t1 = 0;
+    int64_t t2 = 0;
+    int64_t t3 = 0;
+    int64_t t4 = 0;
+    int64_t correction = 0;
+
+    // IEEE 1588 mean link delay: ((t4 - t1) - (t3 - t2) - correction) / 2
+    int64_t MeanLinkDelay() const { return ((t4 - t1) - (t3 - t2) - correction) / 2; }
+};
+
+// Rejects outlier path delays and offsets (queued packets, switch bursts)
+// before they reach the servo. Keeps a smoothed path delay for offset computation.
+class PTPMeasurementFilter {
+public:
+    // Add a raw path delay measurement; returns false if rejected
+    bool AddPathDelay(int64_t delayNs);
+
+    // Check an offset measurement; returns false if rejected
+    // (a run of rejections is accepted as a genuine step)
+    bool AcceptOffset(int64_t offsetNs);
+
+    bool HasPathDelay() const { return delayCount_ > 0; }
+    int64_t GetMeanPathDelayNs() const { return static_cast<int64_t>(meanDelay_); }
+    uint32_t GetRejectedCount() const { return rejected_; }
+
+    void Reset();
+
+private:
+    static constexpr uint32_t kWarmupSamples = 4;       // Accept unconditionally at start
+    static constexpr double kOutlierFactor = 4.0;       // x mean absolute deviation
+    static constexpr double kMinWindowNs = 2000.0;      // Never reject within ±2 µs
+    static constexpr double kSmoothing = 1.0 / 16.0;
+    static constexpr uint32_t kMaxConsecutiveRejects = 4;
+
+    double meanDelay_ = 0.0;
+    double delayDev_ = 0.0;
+    uint32_t delayCount_ = 0;
+    uint32_t delayRejectRun_ = 0;
+
+    double offsetDev_ = 0.0;
+    uint32_t offsetCount_ = 0;
+    uint32_t offsetRejectRun_ = 0;
+
+    uint32_t rejected_ = 0;
+};
+
+} // namespace AES67
@@ -0,0 +1,59 @@
+// PTPServo.h - Pluggable PTP clock servos
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "AffineTimeMap.h"
+#include <cstdint>
+#include <memory>
+
+namespace AES67 {
+
+enum class PTPServoType {
+    PI,             // Fixed-gain proportional-integral loop on phase error
+    LeastSquares    // Windowed linear regression of master vs host time
+};
+
+const char* PTPServoTypeName(PTPServoType type);
+
+// Lock hysteresis applied to the measured offset after slewed samples
+constexpr double kPTPLockThresholdNs = 10000.0;     // Locked below 10 µs...
+constexpr double kPTPUnlockThresholdNs = 100000.0;  // ...until above 100 µs
+constexpr uint32_t kPTPLockSamples = 4;             // Consecutive good samples to lock
+
+struct PTPServoConfig {
+    int64_t stepThresholdNs = 1000000;      // Step instead of slewing above 1 ms
+    bool stepOnlyAtStart = false;           // Step-then-slew: after start-up, always slew
+    double maxFrequencyPpb = 500000.0;      // ±500 ppm
+    uint32_t windowSamples = 32;            // LeastSquares regression window
+};
+
+enum class PTPServoAction {
+    Ignored,    // Sample rejected as an outlier, mapping unchanged
+    Stepped,    // Phase jumped onto the master
+    Slewed      // Rate adjusted, mapping continuous
+};
+
+// A servo turns offset measurements into updates of the host -> PTP mapping.
+// Called from one thread only (the PTP receive thread, or a simulator).
+class PTPServo {
+public:
+    virtual ~PTPServo() = default;
+
+    // offsetNs = mapped PTP time minus master time, both at host time hostNs.
+    // Updates coeffs in place; the caller publishes them.
+    virtual PTPServoAction Sample(int64_t offsetNs, uint64_t hostNs,
+                                  AffineTimeMap::Coefficients& coeffs) = 0;
+
+    // Start over: the first sample steps onto the master
+    virtual void Reset() = 0;
+
+    // Start over from the current mapping (new master after a role change):
+    // keeps its rate and slews, stepping only beyond the step threshold
+    virtual void ResetContinuous() = 0;
+    virtual PTPServoType GetType() const = 0;
+};
+
+std::unique_ptr<PTPServo> CreatePTPServo(PTPServoType type, const PTPServoConfig& config = {});
+
+} // namespace AES67
@@ -0,0 +1,115 @@
+// PTPStats.h - Lock-free PTP clock quality statistics
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace AES67 {
+
+// One offset measurement as seen by the slave
+struct PTPStatsSample {
+    uint64_t hostNs = 0;            // Sync arrival (t2), HostClock ns
+    int64_t offsetNs = 0;           // Measured offset from the master
+    int64_t pathDelayNs = 0;        // Path (E2E) or link (P2P) delay used for it
+    int64_t syncIntervalNs = 0;     // Since the previous Sync, 0 for the first
+    double frequencyPpb = 0.0;      // Servo frequency adjustment after the sample
+    bool accepted = true;           // Passed the outlier filter
+};
+
+// Signed log2 histogram: bin kZeroBin holds |x| < 1, the bins above it hold
+// [1, 2), [2, 4), ... and the bins below the same magnitudes negated. The
+// last bin on each side also takes everything beyond it.
+struct PTPHistogram {
+    static constexpr size_t kMagnitudes = 40;           // Up to 2^39 (~9 min in ns)
+    static constexpr size_t kZeroBin = kMagnitudes;
+    static constexpr size_t kBins = 2 * kMagnitudes + 1;
+
+    std::array<uint32_t, kBins> counts{};
+
+    static size_t BinOf(int64_t value);
+    // Smallest magnitude of a bin, signed (0 for kZeroBin)
+    static int64_t BinLowerBound(size_t bin);
+};
+
+// Summary of one quantity over the snapshot window
+struct PTPSeriesStats {
+    size_t count = 0;
+    double min = 0.0;
+    double max = 0.0;
+    double mean = 0.0;
+    double stddev = 0.0;
+    double p50 = 0.0;
+    double p90 = 0.0;
+    double p99 = 0.0;
+    PTPHistogram histogram;
+};
+
+// Overlapping Allan deviation and time deviation at tau = m * tau0
+struct PTPDeviation {
+    double tauSec = 0.0;
+    double adev = 0.0;              // Fractional frequency
+    double tdevNs = 0.0;
+};
+
+struct PTPStatsSnapshot {
+    uint64_t totalSamples = 0;      // Recorded since the last reset
+    uint64_t rejectedSamples = 0;   // In the window, not passed to the servo
+    uint64_t windowStartNs = 0;
+    uint64_t windowEndNs = 0;
+    PTPSeriesStats offsetNs;        // Accepted samples only
+    PTPSeriesStats pathDelayNs;
+    PTPSeriesStats syncIntervalNs;
+    PTPSeriesStats frequencyPpb;
+    double tau0Sec = 0.0;           // Median Sync interval
+    std::vector<PTPDeviation> deviations;   // Octaves of tau0, of the offset series
+};
+
+// ADEV/TDEV at tau = m * tau0, m = 1, 2, 4, ..., from evenly spaced phase
+// samples (ns). A tau needs 3m + 1 samples; longer ones are left out.
+std::vector<PTPDeviation> ComputePTPDeviations(const double* phaseNs, size_t count, double tau0Sec);
+
+// Keeps the most recent samples in a ring of per-slot seqlocks. One writer
+// (the PTP event thread) records without locks or allocation; any thread can
+// take a snapshot, which copies the window and does the arithmetic there.
+class PTPStats {
+public:
+    explicit PTPStats(size_t capacity = 4096);     // Rounded up to a power of two
+
+    PTPStats(const PTPStats&) = delete;
+    PTPStats& operator=(const PTPStats&) = delete;
+
+    // Writer side
+    void Record(const PTPStatsSample& sample);
+    void Reset();
+
+    // Reader side (allocates: not for the audio thread)
+    // windowSec 0 takes every sample still in the ring
+    PTPStatsSnapshot Snapshot(double windowSec = 0.0) const;
+    // Complete samples of the window, oldest first; torn slots are skipped
+    void CopySamples(std::vector<PTPStatsSample>& out, double windowSec = 0.0) const;
+
+    size_t Capacity() const { return mask_ + 1; }
+
+private:
+    struct Slot {
+        std::atomic<uint64_t> seq{0};   // 2n + 2 once sample n is complete, odd while written
+        std::atomic<uint64_t> hostNs{0};
+        std::atomic<int64_t> offsetNs{0};
+        std::atomic<int64_t> pathDelayNs{0};
+        std::atomic<int64_t> syncIntervalNs{0};
+        std::atomic<double> frequencyPpb{0.0};
+        std::atomic<bool> accepted{false};
+    };
+
+    std::unique_ptr<Slot[]> slots_;
+    size_t mask_ = 0;
+    std::atomic<uint64_t> count_{0};    // Samples recorded
+};
+
+} // namespace AES67
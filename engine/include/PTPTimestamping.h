@@ -0,0 +1,61 @@
+// PTPTimestamping.h - Kernel/hardware timestamps for PTP event sockets
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <sys/types.h>
+#include <netinet/in.h>
+
+namespace AES67 {
+
+enum class PTPTimestampMode {
+    User,       // Host clock read around send/recv (scheduler latency included)
+    Software,   // Kernel stamps at the driver boundary
+    Hardware    // NIC PHC stamps, converted to host time
+};
+
+const char* PTPTimestampModeName(PTPTimestampMode mode);
+
+// Timestamps PTP event messages on one UDP socket.
+// Linux: SO_TIMESTAMPING with RX stamps in control messages and TX stamps read
+// back from MSG_ERRQUEUE; hardware when the NIC supports it, software otherwise.
+// Other platforms: SO_TIMESTAMP for RX, user-space stamps for TX.
+// All returned times are HostClock nanoseconds (kernel stamps are converted).
+class PTPTimestamper {
+public:
+    PTPTimestamper() = default;
+    ~PTPTimestamper();
+
+    PTPTimestamper(const PTPTimestamper&) = delete;
+    PTPTimestamper& operator=(const PTPTimestamper&) = delete;
+
+    // Enable the best available mode on sock (bound to interfaceName)
+    PTPTimestampMode Enable(int sock, const char* interfaceName);
+    PTPTimestampMode GetMode() const { return mode_; }
+
+    // recvfrom() plus arrival timestamp (falls back to the time after recvmsg)
+    ssize_t Receive(int sock, uint8_t* buffer, size_t length,
+                    sockaddr_in* srcAddr, uint64_t& rxTimeNs);
+
+    // sendto() plus departure timestamp (falls back to the time after sendto)
+    ssize_t Send(int sock, const uint8_t* buffer, size_t length,
+                 const sockaddr_in& destAddr, uint64_t& txTimeNs);
+
+    void Close();
+
+private:
+    bool ReadTxTimestamp(int sock, uint64_t& txTimeNs);
+    void DrainErrorQueue(int sock);
+    bool PhcToHost(uint64_t phcNs, uint64_t& hostNs);
+
+    PTPTimestampMode mode_ = PTPTimestampMode::User;
+    int phcFd_ = -1;
+    std::mutex phcMutex_;               // Send and receive may run on different threads
+    int64_t phcOffsetNs_ = 0;           // PHC minus CLOCK_REALTIME
+    uint64_t phcOffsetTimeNs_ = 0;      // When phcOffsetNs_ was measured
+};
+
+} // namespace AES67
@@ -0,0 +1,101 @@
+// PTPTransport.h - PTP sockets and event thread shared by several domains
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "PTPEventLoop.h"
+#include "PTPTimestamping.h"
+#include "PTPTypes.h"
+#include "PTPUnicast.h"
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <netinet/in.h>
+
+namespace AES67 {
+
+class PTPClient;
+
+// The event/general socket pair, timestamping and the single PTP thread of
+// one interface. Every PTPClient attached to it runs one domain; received
+// messages go to the client whose domain matches the header's domainNumber,
+// and all domains share the event loop, so more domains add no threads.
+//
+// Lifecycle: Open(), PTPClient::Start(transport) for each domain, Start().
+// Stop() (or stopping any attached client) ends every domain on it.
+class PTPTransport {
+public:
+    static constexpr size_t kMaxDomains = 4;    // 6 timers each within PTPEventLoop::kMaxTimers
+
+    PTPTransport();
+    ~PTPTransport();
+
+    PTPTransport(const PTPTransport&) = delete;
+    PTPTransport& operator=(const PTPTransport&) = delete;
+
+    bool Open(const char* interfaceName);
+    bool Start();
+    void Stop();
+
+    // DSCP of PTP traffic (0 = socket default); the event thread applies a
+    // change while running
+    void SetDscp(uint8_t dscp) { dscp_.store(dscp, std::memory_order_relaxed); }
+
+    bool IsOpen() const { return socketEvent_ >= 0; }
+    bool IsRunning() const { return running_.load(); }
+    size_t GetDomainCount() const { return clientCount_; }
+
+    // Interface identity, valid once open
+    const ClockIdentity& GetClockIdentity() const { return clockIdentity_; }
+    in_addr GetInterfaceAddr() const { return interfaceAddr_; }
+    PTPTimestampMode GetTimestampMode() const { return timestamper_.GetMode(); }
+
+private:
+    friend class PTPClient;
+
+    // Attached clients (while stopped)
+    bool Attach(PTPClient* client);
+    void Detach(PTPClient* client);
+
+    // Event thread; also used by the clients while stopped
+    PTPEventLoop& Loop() { return eventLoop_; }
+    PTPSendBatch& GeneralBatch() { return generalBatch_; }
+    ssize_t SendEvent(const uint8_t* buffer, size_t length, const sockaddr_in& dest, uint64_t& txTimeNs);
+    void JoinPdelayGroup();
+
+    void EventThread();
+    void ReceiveEventMessages();
+    void ReceiveGeneralMessages();
+    PTPClient* ClientFor(uint8_t domain) const;
+    bool InitializeInterface(const char* interfaceName);
+    bool OpenSockets(const char* interfaceName);
+    void CloseSockets();
+    void ApplyDscp();
+
+    int socketEvent_ = -1;
+    int socketGeneral_ = -1;
+    PTPTimestamper timestamper_;
+    PTPEventLoop eventLoop_;
+    int eventSocketIndex_ = -1;
+    int generalSocketIndex_ = -1;
+    PTPSendBatch generalBatch_;
+    bool pdelayJoined_ = false;
+    std::atomic<uint8_t> dscp_{0};
+    uint8_t appliedDscp_ = 0;
+
+    in_addr interfaceAddr_{};
+    ClockIdentity clockIdentity_{};
+
+    // Domain demux: domainNumber -> slot in clients_ (kNoClient when unused)
+    static constexpr uint8_t kNoClient = 0xFF;
+    std::array<PTPClient*, kMaxDomains> clients_{};
+    size_t clientCount_ = 0;
+    std::array<uint8_t, 256> domainSlot_{};
+
+    std::atomic<bool> running_{false};
+    std::thread eventThread_;
+};
+
+} // namespace AES67
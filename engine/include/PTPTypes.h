@@ -11,9 +11,13 @@ namespace AES67 {
 enum class PTPMessageType : uint8_t {
     Sync = 0x0,
     Delay_Req = 0x1,
+    Pdelay_Req = 0x2,
+    Pdelay_Resp = 0x3,
     Follow_Up = 0x8,
     Delay_Resp = 0x9,
-    Announce = 0xB
+    Pdelay_Resp_Follow_Up = 0xA,
+    Announce = 0xB,
+    Signaling = 0xC
 };
 
 // PTP clock identity (EUI-64)
@@ -82,6 +86,7 @@ constexpr uint8_t kPTPDefaultDomain = 0;
 
 // PTP multicast addresses
 constexpr char kPTP_IPv4_MulticastAddr[] = "224.0.1.129";
+constexpr char kPTP_IPv4_PdelayMulticastAddr[] = "224.0.0.107";    // Link-local, not forwarded
 constexpr uint16_t kPTP_Event_Port = 319;
 constexpr uint16_t kPTP_General_Port = 320;
 
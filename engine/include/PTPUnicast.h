@@ -0,0 +1,162 @@
+// PTPUnicast.h - PTP unicast negotiation, per-slave state and batched sends
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "PTPTypes.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <netinet/in.h>
+
+namespace AES67 {
+
+// ============================================================================
+// Unicast message negotiation (IEEE 1588-2008 16.1)
+// ============================================================================
+
+enum class PTPUnicastTLV : uint16_t {
+    Request = 0x0004,       // REQUEST_UNICAST_TRANSMISSION
+    Grant = 0x0005,         // GRANT_UNICAST_TRANSMISSION
+    Cancel = 0x0006,        // CANCEL_UNICAST_TRANSMISSION
+    AckCancel = 0x0007      // ACKNOWLEDGE_CANCEL_UNICAST_TRANSMISSION
+};
+
+// One negotiation TLV; fields not carried by a TLV type are ignored
+struct PTPUnicastMessage {
+    PTPUnicastTLV tlv = PTPUnicastTLV::Request;
+    PTPMessageType messageType = PTPMessageType::Sync;  // Announce, Sync or Delay_Resp
+    int8_t logInterval = 0;         // logInterMessagePeriod
+    uint32_t durationSec = 0;       // Request/Grant; 0 in a Grant means denied
+    bool renewal = false;           // Grant: renewal invited
+};
+
+constexpr size_t kPTPSignalingHeaderLength = 44;    // Header + targetPortIdentity
+constexpr size_t kPTPUnicastTLVMaxLength = 12;      // Grant, the longest
+
+// Append one TLV at buffer; returns its length (kPTPUnicastTLVMaxLength at most)
+size_t WritePTPUnicastTLV(uint8_t* buffer, const PTPUnicastMessage& message);
+
+// Parse the TLVs of a Signaling message (header included); unknown TLVs are skipped.
+// Returns the number written to messages (at most maxMessages).
+size_t ParsePTPUnicastTLVs(const uint8_t* buffer, size_t length,
+                           PTPUnicastMessage* messages, size_t maxMessages);
+
+// ============================================================================
+// Per-slave state on the master
+// ============================================================================
+
+struct PTPPortIdentity {
+    ClockIdentity clock{};
+    uint16_t port = 0;
+};
+
+inline bool operator==(const PTPPortIdentity& a, const PTPPortIdentity& b) {
+    return a.port == b.port && std::memcmp(a.clock.id, b.clock.id, sizeof(a.clock.id)) == 0;
+}
+
+// Unicast service granted to one slave for one message type
+struct PTPUnicastGrant {
+    uint64_t expiresNs = 0;         // 0 = not granted
+    uint64_t intervalNs = 0;
+    uint64_t nextNs = 0;            // Next transmission (Sync/Announce)
+    int8_t logInterval = 0;
+    uint16_t sequenceId = 0;
+
+    bool Active(uint64_t nowNs) const { return expiresNs > nowNs; }
+};
+
+struct PTPSlaveEntry {
+    PTPPortIdentity identity;
+    in_addr address{};
+    uint64_t lastSeenNs = 0;
+    uint32_t delayRequests = 0;
+    PTPUnicastGrant announce;
+    PTPUnicastGrant sync;
+    PTPUnicastGrant delayResp;
+
+    // Grant for a negotiable message type, nullptr for any other
+    PTPUnicastGrant* GrantFor(PTPMessageType type) {
+        switch (type) {
+            case PTPMessageType::Announce: return &announce;
+            case PTPMessageType::Sync: return &sync;
+            case PTPMessageType::Delay_Resp: return &delayResp;
+            default: return nullptr;
+        }
+    }
+};
+
+// Slaves known to the master, keyed by port identity. Open addressing with
+// linear probing and backward-shift deletion over one flat array: lookups on
+// the Delay_Req path touch one or two cache lines and never allocate.
+class PTPSlaveTable {
+public:
+    explicit PTPSlaveTable(size_t maxSlaves = 1024);
+
+    PTPSlaveEntry* Find(const PTPPortIdentity& identity);
+
+    // Existing entry or a new one; nullptr when the table is full
+    PTPSlaveEntry* Insert(const PTPPortIdentity& identity);
+    bool Erase(const PTPPortIdentity& identity);
+    void Clear();
+
+    // Drop slaves without an active grant that were not seen for idleNs
+    size_t Expire(uint64_t nowNs, uint64_t idleNs);
+
+    template <typename Fn>
+    void ForEach(Fn&& fn) {
+        for (size_t i = 0; i < slots_.size(); ++i) {
+            if (used_[i]) {
+                fn(slots_[i]);
+            }
+        }
+    }
+
+    size_t Size() const { return size_; }
+    size_t Capacity() const { return maxSlaves_; }
+
+private:
+    size_t Home(const PTPPortIdentity& identity) const;
+    void EraseSlot(size_t slot);
+
+    std::vector<PTPSlaveEntry> slots_;      // Power-of-two length, at most 50% full
+    std::vector<uint8_t> used_;
+    size_t mask_ = 0;
+    size_t size_ = 0;
+    size_t maxSlaves_ = 0;
+};
+
+// ============================================================================
+// Batched transmission
+// ============================================================================
+
+// Collects small datagrams for one socket and sends them with one sendmmsg()
+// (Linux) or a sendto() loop (elsewhere). Not for event messages that need a
+// transmit timestamp.
+class PTPSendBatch {
+public:
+    static constexpr size_t kMaxMessages = 64;
+    static constexpr size_t kMaxMessageLength = 128;
+
+    void SetSocket(int sock) { sock_ = sock; }
+
+    // Buffer for a length-byte message to dest; flushes first when full
+    uint8_t* Add(const sockaddr_in& dest, size_t length);
+    void Flush();
+
+    size_t Pending() const { return count_; }
+    uint64_t GetSentCount() const { return sent_; }
+    uint64_t GetFlushCount() const { return flushes_; }
+
+private:
+    int sock_ = -1;
+    size_t count_ = 0;
+    uint64_t sent_ = 0;
+    uint64_t flushes_ = 0;
+    uint8_t buffers_[kMaxMessages][kMaxMessageLength];
+    size_t lengths_[kMaxMessages]{};
+    sockaddr_in dests_[kMaxMessages]{};
+};
+
+} // namespace AES67
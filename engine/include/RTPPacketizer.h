@@ -4,6 +4,7 @@
 #pragma once
 
 #include "RTPTypes.h"
+#include <cstddef>
 #include <cstdint>
 #include <vector>
 
@@ -20,6 +21,7 @@ public:
     
     void SetSequenceNumber(uint16_t seq) { sequence_ = seq; }
     void SetTimestamp(uint32_t ts) { timestamp_ = ts; }
+    uint32_t GetTimestamp() const { return timestamp_; }
     
 private:
     uint32_t ssrc_;
@@ -29,24 +31,47 @@ private:
     uint32_t timestamp_ = 0;
 };
 
+// Follows one sender: the first packet's SSRC is locked in, and packets
+// from any other SSRC are dropped unless it keeps sending on its own for
+// kSSRCTakeoverPackets (the sender restarted with a new SSRC).
 class RTPDepacketizer {
 public:
+    static constexpr uint32_t kSSRCTakeoverPackets = 500;
+    
     RTPDepacketizer(uint8_t channels, uint32_t sampleRate);
     
+    // Switch to another stream's format (L24 = 3, L16 = 2 bytes per sample);
+    // forgets the sequence state and the locked SSRC
+    void Configure(uint8_t channels, uint8_t payloadType, uint8_t bytesPerSample = 3);
+    // Frames are written this many channels wide (default: the stream's);
+    // channels the stream does not carry are zeroed
+    void SetOutputChannels(uint8_t channels) { outputChannels_ = channels; }
+    
     // Parse RTP packet into audio samples
-    // Returns number of frames decoded
-    uint32_t ParsePacket(const uint8_t* packet, size_t packetSize, int32_t* outSamples);
+    // Returns number of frames decoded (0 if more than maxFrames)
+    uint32_t ParsePacket(const uint8_t* packet, size_t packetSize, int32_t* outSamples,
+                         uint32_t maxFrames = UINT32_MAX);
     
     uint16_t GetLastSequence() const { return lastSequence_; }
     uint32_t GetLastTimestamp() const { return lastTimestamp_; }
     uint32_t GetPacketLossCount() const { return packetLoss_; }
+    uint32_t GetSSRC() const { return ssrc_; }
+    uint32_t GetForeignPacketCount() const { return foreignPackets_; }
+    uint8_t GetChannels() const { return channels_; }
+    uint8_t GetPayloadType() const { return payloadType_; }
     
 private:
     uint8_t channels_;
+    uint8_t outputChannels_ = 0;        // 0 = channels_
+    uint8_t payloadType_ = kRTPPayloadType_L24;
+    uint8_t bytesPerSample_ = 3;
     uint32_t sampleRate_;
     uint16_t lastSequence_ = 0;
     uint32_t lastTimestamp_ = 0;
     uint32_t packetLoss_ = 0;
+    uint32_t ssrc_ = 0;
+    uint32_t foreignPackets_ = 0;       // Dropped for their SSRC
+    uint32_t foreignStreak_ = 0;        // Since our SSRC was last heard
     bool firstPacket_ = true;
 };
 
@@ -0,0 +1,146 @@
+// RTPReceiver.h - Shared RX sockets demultiplexed to RX slots
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "RxSubscription.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/types.h>
+
+namespace AES67 {
+
+// (destination address, port, SSRC) -> RX slot, open addressing with linear
+// probing. A slot is entered either for one SSRC or for any SSRC; a packet
+// goes to its SSRC's slot if there is one, otherwise to the any-SSRC slot.
+// Addresses are in network byte order.
+class RxDemuxTable {
+public:
+    static constexpr size_t kCapacity = 32;     // Power of two, 4x the slots
+
+    void Clear();
+    // False if the key is taken (or the table is full)
+    bool Insert(uint32_t addr, uint16_t port, uint32_t ssrc, bool anySsrc, uint8_t slot);
+    // Slot index, or -1
+    int Find(uint32_t addr, uint16_t port, uint32_t ssrc) const {
+        if (ssrcEntries_ > 0) {
+            const int slot = Probe(addr, port, ssrc, false);
+            if (slot >= 0) return slot;
+        }
+        return Probe(addr, port, 0, true);
+    }
+    size_t Size() const { return count_; }
+
+private:
+    struct Entry {
+        uint32_t addr = 0;
+        uint32_t ssrc = 0;
+        uint16_t port = 0;
+        uint8_t slot = 0;
+        uint8_t state = 0;      // 0 = empty, 1 = one SSRC, 2 = any SSRC
+    };
+
+    static size_t Hash(uint32_t addr, uint16_t port, uint32_t ssrc) {
+        uint64_t h = (static_cast<uint64_t>(addr) << 32 | static_cast<uint64_t>(port) << 16) ^ ssrc;
+        h *= 0x9E3779B97F4A7C15ULL;
+        return static_cast<size_t>(h >> 59);    // Top 5 bits: kCapacity buckets
+    }
+    int Probe(uint32_t addr, uint16_t port, uint32_t ssrc, bool anySsrc) const {
+        const uint8_t state = anySsrc ? 2 : 1;
+        for (size_t i = Hash(addr, port, ssrc), n = 0; n < kCapacity; i = (i + 1) & (kCapacity - 1), ++n) {
+            const Entry& e = entries_[i];
+            if (e.state == 0) return -1;
+            if (e.state == state && e.addr == addr && e.port == port && e.ssrc == ssrc) return e.slot;
+        }
+        return -1;
+    }
+
+    std::array<Entry, kCapacity> entries_{};
+    size_t count_ = 0;
+    size_t ssrcEntries_ = 0;
+};
+
+// Where a received packet goes
+struct RxPacketInfo {
+    uint8_t slot = 0;
+    uint32_t sourceAddr = 0;        // Sender, network byte order
+};
+
+// Every RX slot's packets through as few sockets as possible: one per UDP
+// port, bound to the wildcard address and joined to every subscribed group
+// on it. Each packet's destination address comes from IP_PKTINFO (or
+// IP_RECVDSTADDR) and picks the slot through an RxDemuxTable. Where the
+// wildcard bind is refused (macOS MIDIServer holds 5004/5005), that port's
+// groups get a socket each, bound to the group. Owned by one thread.
+class RTPReceiver {
+public:
+    static constexpr size_t kSlots = 8;
+
+    RTPReceiver() = default;
+    ~RTPReceiver() { Close(); }
+
+    RTPReceiver(const RTPReceiver&) = delete;
+    RTPReceiver& operator=(const RTPReceiver&) = delete;
+
+    // Re-plan sockets and joins for these subscriptions (nullptr = idle slot).
+    // Sockets still needed stay open and only the memberships that changed
+    // are joined or left, so other slots keep receiving. Groups are joined on
+    // interfaceAddr; a source-filter becomes source-specific joins (incl) or
+    // source blocks (excl).
+    void Apply(const std::array<const RxSubscription*, kSlots>& subscriptions, in_addr interfaceAddr);
+    void Close();
+
+    // Receive buffer and DSCP of every socket, open or opened later
+    void SetSocketOptions(int receiveBufferBytes, uint8_t dscp);
+
+    // Next packet for a subscribed slot, waiting up to timeoutMs: its length,
+    // or 0 on timeout. Packets no slot wants, or larger than the buffer, are
+    // dropped here.
+    ssize_t Receive(uint8_t* buffer, size_t length, int timeoutMs, RxPacketInfo& info);
+
+    size_t GetSocketCount() const { return sockets_.size(); }
+    uint64_t GetUnmatchedCount() const { return unmatched_; }
+    uint64_t GetTruncatedCount() const { return truncated_; }
+
+private:
+    struct Membership {
+        uint32_t group = 0;
+        std::vector<uint32_t> sources;  // Sorted; empty = any source
+        bool exclude = false;
+        bool sourceSpecific = false;    // Joined per source (set when joined)
+
+        bool SameFilter(const Membership& other) const {
+            return group == other.group && sources == other.sources && exclude == other.exclude;
+        }
+    };
+    struct Socket {
+        int fd = -1;
+        uint32_t bindAddr = 0;          // INADDR_ANY, or the one group it serves
+        uint16_t port = 0;
+        std::vector<Membership> joined;
+    };
+
+    ssize_t ReadPacket(const Socket& socket, uint8_t* buffer, size_t length, RxPacketInfo& info);
+    int OpenSocket(uint32_t bindAddr, uint16_t port);
+    void ApplySocketOptions(int fd) const;
+    bool Join(int fd, Membership& membership);
+    void Leave(int fd, const Membership& membership);
+    void SetMemberships(Socket& socket, std::vector<Membership> wanted);
+
+    std::vector<Socket> sockets_;
+    std::vector<pollfd> pollFds_;       // Parallel to sockets_
+    size_t nextReady_ = 0;              // Next pollFds_ entry to read from
+    size_t pending_ = 0;                // Entries poll() found readable, not yet drained
+    RxDemuxTable demux_;
+    in_addr interfaceAddr_{};
+    int receiveBufferBytes_ = 1024 * 1024;
+    uint8_t dscp_ = 46;                 // EF
+    uint64_t unmatched_ = 0;
+    uint64_t truncated_ = 0;
+};
+
+} // namespace AES67
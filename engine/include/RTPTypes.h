@@ -56,4 +56,11 @@ inline void Int32ToL24(int32_t val, uint8_t* l24) {
     l24[2] = static_cast<uint8_t>(val & 0xFF);
 }
 
+// L16 encoding: 2 bytes per sample, big-endian, into the same 32-bit container
+inline int32_t L16ToInt32(const uint8_t* l16) {
+    const uint32_t val = (static_cast<uint32_t>(l16[0]) << 24) |
+                         (static_cast<uint32_t>(l16[1]) << 16);
+    return static_cast<int32_t>(val); // Sign already in bit 31
+}
+
 } // namespace AES67
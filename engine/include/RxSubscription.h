@@ -0,0 +1,79 @@
+// RxSubscription.h - What an RX stream slot receives
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "RTPTypes.h"
+#include "SAPDiscoveryCache.h"
+#include "SDPParser.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace AES67 {
+
+// One RX slot's stream. Audio lands in the slot's first `channels` channels;
+// the rest are silent.
+struct RxSubscription {
+    std::string address = "239.69.2.1";     // Multicast group, or a unicast address of ours
+    uint16_t port = 5006;
+    uint8_t channels = 8;                   // 1 .. 8
+    uint8_t payloadType = kRTPPayloadType_L24;
+    uint8_t bytesPerSample = 3;             // 3 = L24, 2 = L16
+    uint32_t packetTimeUs = 1000;
+    std::vector<std::string> sources;       // a=source-filter senders, empty = any
+    bool excludeSources = false;            // sources lists senders to drop (excl)
+    bool pinSsrc = false;                   // Only ssrc; otherwise the first sender heard
+    uint32_t ssrc = 0;
+    std::string refClock;                   // a=ts-refclk value, empty = main PTP domain
+    std::string sessionName;                // Informational
+    std::string sdpOrigin;                  // Discovered session it follows, if any
+
+    bool operator==(const RxSubscription& other) const = default;
+
+    // Socket-level identity: changing these means a new socket and new joins
+    bool SameSocket(const RxSubscription& other) const {
+        return address == other.address && port == other.port &&
+               sources == other.sources && excludeSources == other.excludeSources;
+    }
+};
+
+// Per-packet sender check for a slot. The kernel already filters SSM joins;
+// this also covers unicast, any-source fallback and stacks without SSM.
+class RxSourceFilter {
+public:
+    // False (and accepting everything) if a source is not an IPv4 address
+    bool Set(const RxSubscription& subscription);
+    void Clear() { addrs_.clear(); }
+
+    // sourceAddr in network byte order, as in sockaddr_in
+    bool Accepts(uint32_t sourceAddr) const {
+        if (addrs_.empty()) return true;
+        for (uint32_t addr : addrs_) {
+            if (addr == sourceAddr) return !exclude_;
+        }
+        return exclude_;
+    }
+
+private:
+    std::vector<uint32_t> addrs_;
+    bool exclude_ = false;
+};
+
+// First audio section of the SDP as a subscription. False unless it is
+// 48 kHz L24 or L16 with 1 to 8 channels and a connection address. Its
+// source-filter is kept when it names that address (or "*").
+bool RxSubscriptionFromSDP(const SDPSession& session, RxSubscription& out);
+
+// Discovered sessions matching every non-empty pattern (fnmatch globs) are
+// subscribed to streamIdx, or to the first free slot when it is negative
+struct AutoSubscribeRule {
+    std::string namePattern;                // s=
+    std::string groupPattern;               // Any media connection address
+    std::string originPattern;              // SAP originating source
+    int streamIdx = -1;
+};
+
+bool MatchesAutoSubscribeRule(const AutoSubscribeRule& rule, const DiscoveredSession& session);
+
+} // namespace AES67
@@ -3,11 +3,18 @@
 
 #pragma once
 
+#include "SAPTimerWheel.h"
 #include <cstdint>
 #include <string>
 #include <vector>
 #include <thread>
 #include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <random>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
 
 namespace AES67 {
 
@@ -21,26 +28,83 @@ struct StreamDescription {
     uint32_t packetTimeUs;
 };
 
+// Announces a set of streams on the SAP group (RFC 2974). Each stream's SDP
+// and SAP packet are serialised once, when the set changes. A timer wheel
+// spreads the announcements out: each stream is repeated at the RFC 2974
+// interval, scaled with the total announcement size against a bandwidth
+// limit and jittered by up to a third, and the packets that fall due
+// together go out with one sendmmsg() (Linux) or a sendto() loop
+// (elsewhere). Stop() sends deletions so receivers drop the streams at once
+// instead of timing them out.
 class SAPAnnouncer {
 public:
     SAPAnnouncer();
     ~SAPAnnouncer();
-    
+
     bool Start(const std::vector<StreamDescription>& streams);
     void Stop();
-    
+
+    // Replace the announced set: streams that left or changed are deleted,
+    // new ones are announced within a second, the rest keep their schedule
+    void UpdateStreams(const std::vector<StreamDescription>& streams);
+
+    // Minimum interval and announcement bandwidth (bits/s), before Start().
+    // RFC 2974 uses 300 s and 4000 bits/s; AES67 devices announce every 30 s.
     void SetInterval(uint32_t seconds) { intervalSeconds_ = seconds; }
-    
+    void SetBandwidthLimit(uint32_t bitsPerSecond) { bandwidthLimitBps_ = bitsPerSecond; }
+    // Where announcements go, before Start() (default 239.255.255.255:9875)
+    bool SetDestination(const std::string& address, uint16_t port);
+
+    // Current base interval of each stream
+    double GetIntervalSeconds() const;
+    uint64_t GetSentCount() const { return sent_.load(); }
+    uint64_t GetBatchCount() const { return batches_.load(); }    // Send calls
+
+    // max(minimum, 8 * total bytes / limit); only our own announcements count
+    static double ComputeIntervalSeconds(size_t totalBytes, uint32_t bandwidthLimitBps, uint32_t minimumSeconds);
+    // SDP carried in the stream's announcement
+    static std::string GenerateSDP(const StreamDescription& stream);
+
 private:
+    // Ready-to-send packets for one stream
+    struct Announcement {
+        uint32_t hash = 0;              // Of the SDP
+        std::vector<uint8_t> announce;
+        std::vector<uint8_t> deletion;  // Same packet, message type deletion
+    };
+
+    // Datagrams to the SAP group, prepared for one send call
+    struct Batch {
+        std::vector<iovec> iovs;
+#if defined(__linux__)
+        std::vector<mmsghdr> msgs;
+#endif
+        void Build(const std::vector<const std::vector<uint8_t>*>& packets, sockaddr_in& dest);
+    };
+
     void AnnouncementThread();
-    std::string GenerateSDP(const StreamDescription& stream);
-    
+    static Announcement BuildAnnouncement(const StreamDescription& stream);
+    uint64_t NextIntervalTicks();
+    void Send(Batch& batch);
+    void SendPaced(const std::vector<const std::vector<uint8_t>*>& packets);
+
     int socket_ = -1;
+    sockaddr_in sapAddr_{};
     std::atomic<bool> running_{false};
     std::thread thread_;
-    
-    std::vector<StreamDescription> streams_;
+
+    mutable std::mutex mutex_;                  // Guards everything below
+    std::condition_variable wake_;
+    std::vector<Announcement> announcements_;
+    SAPTimerWheel wheel_;                       // Timer id = index in announcements_
+    std::vector<const std::vector<uint8_t>*> due_;
+    Batch sendBatch_;
     uint32_t intervalSeconds_ = 30;
+    uint32_t bandwidthLimitBps_ = 4000;
+    double intervalSec_ = 30.0;
+    std::mt19937 rng_;
+    std::atomic<uint64_t> sent_{0};
+    std::atomic<uint64_t> batches_{0};
 };
 
 } // namespace AES67
@@ -0,0 +1,136 @@
+// SAPDiscoveryCache.h - Sessions heard on the SAP group
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "SDPParser.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace AES67 {
+
+// One SAP packet (RFC 2974), pointing into the received buffer
+struct SAPPacket {
+    bool deletion = false;
+    uint16_t msgIdHash = 0;
+    uint8_t originLength = 4;           // 4 (IPv4) or 16 (IPv6)
+    std::array<uint8_t, 16> origin{};
+    std::string_view payload;           // SDP, payload type already skipped
+};
+
+// False unless it is an unencrypted, uncompressed SAPv1 packet carrying SDP
+bool ParseSAPPacket(const uint8_t* data, size_t length, SAPPacket& packet);
+
+// Announcement identity: originating source plus message id hash
+struct SAPSessionKey {
+    std::array<uint8_t, 16> origin{};
+    uint8_t originLength = 4;
+    uint16_t msgIdHash = 0;
+
+    bool operator==(const SAPSessionKey& other) const {
+        return msgIdHash == other.msgIdHash && originLength == other.originLength && origin == other.origin;
+    }
+};
+
+struct DiscoveredSession {
+    SAPSessionKey key;
+    std::string name;               // s=, or o= when unnamed
+    std::string originAddr;         // SAP originating source, e.g. "10.0.0.5"
+    std::string sdpOrigin;          // o= without the version: the session across versions
+    SDPSession session;
+    uint64_t payloadHash = 0;
+    uint64_t firstSeenNs = 0;
+    uint64_t lastSeenNs = 0;
+    uint64_t intervalNs = 0;        // Smoothed announcement period, 0 until heard twice
+    uint64_t announcements = 0;
+};
+
+// Immutable view of the discovered sessions, shared with readers. Timing
+// fields are as of the session's last change, not its last refresh.
+struct DiscoverySnapshot {
+    std::vector<std::shared_ptr<const DiscoveredSession>> sessions;     // By name
+    uint64_t generation = 0;
+
+    // First session of that name, nullptr if none
+    const DiscoveredSession* Find(const std::string& name) const;
+};
+
+// Every session currently announced, keyed by (origin, msg id hash). A
+// repeated announcement whose payload hash is unchanged only refreshes the
+// entry; the SDP is parsed when it is new or changed. Deletions remove it,
+// and a session not heard for max(1 h, 10 announcement periods) expires
+// (RFC 2974 3.2). Secondary indexes find sessions by name, multicast group,
+// originating source and SDP origin. Not thread-safe.
+class SAPDiscoveryCache {
+public:
+    enum class Change { None, Added, Updated, Removed };
+
+    static constexpr uint64_t kDefaultMinTimeoutNs = 3600ULL * 1000000000ULL;
+
+    Change OnPacket(const SAPPacket& packet, uint64_t nowNs);
+    // Drops sessions past their timeout; returns how many
+    size_t Expire(uint64_t nowNs);
+    void Clear();
+
+    // Floor of the expiry timeout (RFC 2974: one hour)
+    void SetMinimumTimeout(uint64_t ns) { minTimeoutNs_ = ns; }
+
+    size_t Size() const { return count_; }
+    uint64_t GetParseCount() const { return parses_; }
+    // Bumped whenever a session is added, changed or removed
+    uint64_t GetGeneration() const { return generation_; }
+
+    // Unchanged sessions are shared with earlier snapshots, not copied
+    std::shared_ptr<const DiscoverySnapshot> Snapshot();
+
+    const DiscoveredSession* FindByName(const std::string& name) const;
+    const DiscoveredSession* FindBySdpOrigin(const std::string& sdpOrigin) const;
+    std::vector<const DiscoveredSession*> FindByMulticast(const std::string& addr) const;
+    std::vector<const DiscoveredSession*> FindByOriginAddr(const std::string& originAddr) const;
+
+    template <typename Fn>
+    void ForEach(Fn&& fn) const {
+        for (size_t id = 0; id < sessions_.size(); ++id) {
+            if (active_[id]) fn(sessions_[id]);
+        }
+    }
+
+    // "<user> <sess-id> <nettype> <addrtype> <address>" of an o= value
+    static std::string SdpOriginKey(std::string_view origin);
+
+private:
+    struct KeyHash {
+        size_t operator()(const SAPSessionKey& key) const;
+    };
+    using Index = std::unordered_multimap<std::string, uint32_t>;
+
+    uint32_t Allocate();
+    void Remove(uint32_t id);
+    void IndexSession(uint32_t id);
+    void UnindexSession(uint32_t id);
+    static void EraseFromIndex(Index& index, const std::string& value, uint32_t id);
+    uint64_t TimeoutNs(const DiscoveredSession& session) const;
+
+    std::vector<DiscoveredSession> sessions_;   // Slots; ids stay put
+    std::vector<uint8_t> active_;
+    std::vector<std::shared_ptr<const DiscoveredSession>> published_;   // Per slot, reset on change
+    std::vector<uint32_t> freeSlots_;
+    std::unordered_map<SAPSessionKey, uint32_t, KeyHash> byKey_;    // Msg id hash != 0 only
+    std::unordered_map<std::string, uint32_t> bySdpOrigin_;
+    Index byName_;
+    Index byMulticast_;
+    Index byOriginAddr_;
+    SDPSession scratch_;                        // Parse target, reused
+    uint64_t minTimeoutNs_ = kDefaultMinTimeoutNs;
+    uint64_t parses_ = 0;
+    uint64_t generation_ = 0;
+    size_t count_ = 0;
+};
+
+} // namespace AES67
@@ -0,0 +1,85 @@
+// SAPTimerWheel.h - Hashed timer wheel for SAP announcement scheduling
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace AES67 {
+
+// One timer per id (0 .. ids-1), deadlines in ticks. Slot = due tick modulo
+// the wheel size; deadlines further out than one rotation wait in their slot
+// for later laps. Schedule, Cancel and firing are O(1) per timer, so one
+// thread can keep thousands of announcements spread out. Not thread-safe.
+class SAPTimerWheel {
+public:
+    static constexpr uint64_t kNever = UINT64_MAX;
+
+    explicit SAPTimerWheel(size_t slots = 4096);    // Rounded up to a power of two
+
+    // Forget every timer; ids 0 .. ids-1 become valid, time starts at nowTick
+    void Reset(size_t ids, uint64_t nowTick);
+
+    // Re-scheduling moves the timer. A deadline not after the current tick
+    // fires on the next Advance().
+    void Schedule(uint32_t id, uint64_t dueTick);
+    void Cancel(uint32_t id);
+
+    bool IsScheduled(uint32_t id) const { return entries_[id].scheduled; }
+    uint64_t DueTick(uint32_t id) const { return entries_[id].due; }
+    size_t Size() const { return size_; }
+    uint64_t CurrentTick() const { return current_; }
+
+    // Fire every timer due by nowTick, in slot order, and move time to it.
+    // The callback may schedule the fired timer again (after nowTick).
+    template <typename Fn>
+    void Advance(uint64_t nowTick, Fn&& fired);
+
+    // Earliest deadline, kNever when nothing is scheduled
+    uint64_t NextDue() const;
+
+private:
+    static constexpr uint32_t kNone = UINT32_MAX;
+
+    struct Entry {
+        uint32_t prev = kNone;
+        uint32_t next = kNone;
+        uint32_t slot = 0;
+        uint64_t due = 0;
+        bool scheduled = false;
+    };
+
+    void Unlink(uint32_t id);
+    uint64_t SlotTick(uint64_t dueTick) const { return dueTick > current_ ? dueTick : current_ + 1; }
+
+    std::vector<uint32_t> heads_;
+    std::vector<Entry> entries_;
+    size_t mask_ = 0;
+    size_t size_ = 0;
+    uint64_t current_ = 0;
+};
+
+template <typename Fn>
+void SAPTimerWheel::Advance(uint64_t nowTick, Fn&& fired) {
+    if (nowTick <= current_) {
+        return;
+    }
+    // Past one rotation every slot is visited once
+    const uint64_t last = nowTick - current_ > mask_ ? current_ + mask_ + 1 : nowTick;
+    for (uint64_t tick = current_ + 1; tick <= last; ++tick) {
+        uint32_t id = heads_[tick & mask_];
+        while (id != kNone) {
+            const uint32_t next = entries_[id].next;
+            if (entries_[id].due <= nowTick) {
+                Unlink(id);
+                fired(id);
+            }
+            id = next;
+        }
+    }
+    current_ = nowTick;
+}
+
+} // namespace AES67
@@ -3,35 +3,100 @@
 
 #pragma once
 
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
-#include <map>
 
 namespace AES67 {
 
+// a=source-filter (RFC 4570)
+struct SDPSourceFilter {
+    bool include = true;                    // incl or excl
+    std::string destAddr;                   // Group the filter applies to, "*" for any
+    std::vector<std::string> sourceAddrs;   // Empty when the description has no filter
+};
+
+// a=ts-refclk (RFC 7273)
+struct SDPRefClock {
+    std::string source;         // ptp, localmac, ntp, ...; empty when absent
+    std::string ptpVersion;     // IEEE1588-2008, IEEE1588-2019, IEEE802.1AS-2011, ...
+    std::string ptpGrandmaster; // EUI-64, "traceable", or empty
+    uint8_t ptpDomain = 0;      // 0 when not given
+    bool valid = false;         // PTP with a numeric domain (or none)
+};
+
+// a=mediaclk (RFC 7273)
+struct SDPMediaClock {
+    bool direct = false;
+    uint32_t offset = 0;        // RTP timestamp at the PTP epoch
+    uint32_t rateNum = 0;       // rate=<num>/<den>, 0 when not given
+    uint32_t rateDen = 0;
+};
+
+// One m= section. Session-level c=, ts-refclk, mediaclk and source-filter
+// apply unless the section has its own.
+struct SDPMedia {
+    std::string mediaType;      // audio, video, ...
+    uint16_t port = 0;
+    uint8_t payloadType = 0;
+    std::string connectionAddr;
+    uint8_t ttl = 0;
+    std::string encoding;       // From a=rtpmap for payloadType, e.g. L24
+    uint32_t sampleRate = 0;
+    uint8_t channels = 0;
+    uint32_t packetTimeUs = 0;
+    std::string mid;            // a=mid, e.g. for ST 2022-7 primary/secondary
+    std::string ptpRefClock;    // Raw a=ts-refclk value
+    std::string mediaClk;       // Raw a=mediaclk value
+    SDPRefClock refClock;
+    SDPMediaClock mediaClock;
+    SDPSourceFilter sourceFilter;
+};
+
 struct SDPSession {
     std::string origin;
+    std::string originAddr;     // o= unicast address
+    uint64_t sessionId = 0;
+    uint64_t sessionVersion = 0;
     std::string sessionName;
+
+    // First audio section, flattened
     std::string connectionAddr;
-    uint16_t port;
-    uint8_t payloadType;
-    std::string rtpmap;
-    uint32_t sampleRate;
-    uint8_t channels;
-    uint32_t packetTimeUs;
-    
+    uint16_t port = 0;
+    uint8_t payloadType = 0;
+    std::string rtpmap;         // <encoding>/<rate>/<channels>
+    uint32_t sampleRate = 0;
+    uint8_t channels = 0;
+    uint32_t packetTimeUs = 0;
+
     // AES67-specific
     std::string ptpRefClock;
     std::string mediaClk;
+
+    std::vector<SDPMedia> media;
 };
 
 class SDPParser {
 public:
-    static SDPSession Parse(const std::string& sdp);
+    // Single pass over the text; never throws. Parsing again into the same
+    // session reuses the capacity of its strings and sections, so repeated
+    // announcements of the same stream parse without allocating. False when
+    // the text is not an SDP with at least one m= section; the session then
+    // holds whatever was recognised.
+    static bool Parse(std::string_view sdp, SDPSession& session);
+    static SDPSession Parse(std::string_view sdp);
     static std::string Generate(const SDPSession& session);
-    
-private:
-    static std::map<std::string, std::string> ParseAttributes(const std::string& sdp);
+    // a=ptime value: milliseconds (RFC 4566), e.g. "1", "0.25", "0.125"
+    static std::string FormatPacketTime(uint32_t packetTimeUs);
+
+    // PTP domain of an a=ts-refclk value (RFC 7273), e.g. "ptp=IEEE1588-2008:<gmid>:127".
+    // No domain given means the default, 0. False when the clock is not IEEE 1588-2008/2019 PTP.
+    static bool ParsePTPDomain(std::string_view refClock, uint8_t& domain);
+
+    static bool ParseRefClock(std::string_view value, SDPRefClock& refClock);
+    static bool ParseMediaClock(std::string_view value, SDPMediaClock& mediaClock);
+    static bool ParseSourceFilter(std::string_view value, SDPSourceFilter& filter);
 };
 
 } // namespace AES67
@@ -0,0 +1,83 @@
+// SnapshotPublisher.h - RCU-style publication of immutable snapshots
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace AES67 {
+
+// Holds the current snapshot of some state that readers must not see change
+// under them. Readers take a reference to the whole snapshot without a lock
+// and keep it as long as they like; a writer builds a new one and swaps it
+// in. The shared_ptr itself is handed out from a holder that is only freed
+// once no reader can still be copying from it (reader counts split by an
+// epoch bit, as in sleepable RCU), so Load() never blocks and Publish() waits
+// only for copies already in flight.
+template <typename T>
+class SnapshotPublisher {
+public:
+    explicit SnapshotPublisher(std::shared_ptr<const T> initial = std::make_shared<const T>())
+        : current_(new Holder{std::move(initial)}) {}
+
+    ~SnapshotPublisher() { delete current_.load(std::memory_order_relaxed); }
+
+    SnapshotPublisher(const SnapshotPublisher&) = delete;
+    SnapshotPublisher& operator=(const SnapshotPublisher&) = delete;
+
+    // Reader side: lock-free, any thread
+    std::shared_ptr<const T> Load() const {
+        ReaderCount& counts = readers_[ReaderShard()];
+        const uint32_t side = epoch_.load(std::memory_order_seq_cst) & 1;
+        counts.side[side].fetch_add(1, std::memory_order_seq_cst);
+        std::shared_ptr<const T> snapshot = current_.load(std::memory_order_seq_cst)->snapshot;
+        counts.side[side].fetch_sub(1, std::memory_order_release);
+        return snapshot;
+    }
+
+    // Writer side: serialised, returns once the old holder is freed
+    void Publish(std::shared_ptr<const T> snapshot) {
+        std::lock_guard<std::mutex> lock(writeMutex_);
+        Holder* old = current_.exchange(new Holder{std::move(snapshot)}, std::memory_order_seq_cst);
+        // Drain both sides: a reader may have read the epoch just before a flip
+        for (int flip = 0; flip < 2; ++flip) {
+            const uint32_t side = epoch_.fetch_add(1, std::memory_order_seq_cst) & 1;
+            for (const ReaderCount& counts : readers_) {
+                while (counts.side[side].load(std::memory_order_acquire) != 0) {
+                    std::this_thread::yield();
+                }
+            }
+        }
+        delete old;     // Readers that copied it keep the snapshot alive
+    }
+
+private:
+    static constexpr size_t kReaderShards = 16;
+
+    struct Holder {
+        std::shared_ptr<const T> snapshot;
+    };
+
+    // Readers spread over cache lines so they do not all bounce one counter
+    struct alignas(64) ReaderCount {
+        std::atomic<uint32_t> side[2] = {};
+    };
+
+    static size_t ReaderShard() {
+        static std::atomic<size_t> nextShard{0};
+        thread_local const size_t shard = nextShard.fetch_add(1, std::memory_order_relaxed) % kReaderShards;
+        return shard;
+    }
+
+    std::atomic<Holder*> current_;
+    std::atomic<uint32_t> epoch_{0};
+    mutable ReaderCount readers_[kReaderShards];
+    std::mutex writeMutex_;
+};
+
+} // namespace AES67
@@ -0,0 +1,238 @@
+// AsyncResampler.cpp - Drift-correcting asynchronous sample-rate converter
+// SPDX-License-Identifier: MIT
+
+#include "AsyncResampler.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace AES67 {
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+constexpr double kCutoff = 0.45 * 2.0;     // 0.45 fs, normalized to Nyquist
+constexpr double kMaxDeviation = 2e-3;     // Hard ratio limit (±2000 ppm)
+
+// L24 in 32-bit container <-> float
+constexpr float kToFloat = 1.0f / 2147483648.0f;
+constexpr float kFromFloat = 8388608.0f;
+
+double Sinc(double x) {
+    if (std::abs(x) < 1e-12) return 1.0;
+    return std::sin(kPi * x) / (kPi * x);
+}
+
+} // namespace
+
+// ============================================================================
+// AsyncResampler Implementation
+// ============================================================================
+
+AsyncResampler::AsyncResampler(uint32_t channels, uint32_t maxInputFrames)
+    : channels_(channels)
+    , table_((kPhases + 1) * kTaps)
+    , history_((kTaps + maxInputFrames + 1) * channels)
+    , accum_(channels)
+{
+    BuildFilterTable();
+}
+
+void AsyncResampler::SetRatio(double ratio) {
+    ratio_ = std::clamp(ratio, 1.0 - kMaxDeviation, 1.0 + kMaxDeviation);
+}
+
+void AsyncResampler::Reset() {
+    position_ = 0.0;
+    historyFrames_ = 0;
+    std::fill(history_.begin(), history_.end(), 0.0f);
+}
+
+void AsyncResampler::BuildFilterTable() {
+    // Tap k of phase p sits at distance d from the interpolation point,
+    // which lies between taps kTaps/2 - 1 and kTaps/2
+    const double center = static_cast<double>(kTaps) / 2.0 - 1.0;
+
+    for (uint32_t p = 0; p <= kPhases; ++p) {
+        const double frac = static_cast<double>(p) / kPhases;
+        float* row = &table_[p * kTaps];
+        double sum = 0.0;
+
+        for (uint32_t k = 0; k < kTaps; ++k) {
+            const double d = static_cast<double>(k) - center - frac;
+
+            // Blackman window spanning the filter length
+            const double w = (d + kTaps / 2.0) / kTaps;
+            const double window = 0.42 - 0.5 * std::cos(2.0 * kPi * w) + 0.08 * std::cos(4.0 * kPi * w);
+
+            const double h = kCutoff * Sinc(kCutoff * d) * window;
+            row[k] = static_cast<float>(h);
+            sum += h;
+        }
+
+        // Unity DC gain for every phase
+        for (uint32_t k = 0; k < kTaps; ++k) {
+            row[k] = static_cast<float>(row[k] / sum);
+        }
+    }
+}
+
+uint32_t AsyncResampler::Process(const int32_t* input, uint32_t inputFrames,
+                                 int32_t* output, uint32_t maxOutputFrames) {
+    if (!input || !output || channels_ == 0) {
+        return 0;
+    }
+
+    // History holds kTaps + maxInputFrames_ + 1 frames; never overrun it
+    const uint32_t capacityFrames = static_cast<uint32_t>(history_.size() / channels_);
+    inputFrames = std::min(inputFrames, capacityFrames - historyFrames_);
+
+    // Append input to history
+    float* dst = &history_[historyFrames_ * channels_];
+    for (uint32_t i = 0; i < inputFrames * channels_; ++i) {
+        dst[i] = static_cast<float>(input[i]) * kToFloat;
+    }
+    historyFrames_ += inputFrames;
+
+    uint32_t outFrames = 0;
+    float coeffs[kTaps];
+
+    while (outFrames < maxOutputFrames) {
+        const uint32_t index = static_cast<uint32_t>(position_);
+        if (index + kTaps > historyFrames_) {
+            break; // Need more input
+        }
+
+        // Interpolate coefficients between adjacent phases
+        const double phasePos = (position_ - index) * kPhases;
+        const uint32_t phase = std::min(static_cast<uint32_t>(phasePos), kPhases - 1);
+        const float phaseFrac = static_cast<float>(phasePos - phase);
+        const float* row0 = &table_[phase * kTaps];
+        const float* row1 = row0 + kTaps;
+        for (uint32_t k = 0; k < kTaps; ++k) {
+            coeffs[k] = row0[k] + (row1[k] - row0[k]) * phaseFrac;
+        }
+
+        // Multiply-accumulate across channels (contiguous, vectorizes)
+        std::fill(accum_.begin(), accum_.end(), 0.0f);
+        const float* src = &history_[index * channels_];
+        for (uint32_t k = 0; k < kTaps; ++k) {
+            const float c = coeffs[k];
+            const float* frame = src + k * channels_;
+            for (uint32_t ch = 0; ch < channels_; ++ch) {
+                accum_[ch] += c * frame[ch];
+            }
+        }
+
+        int32_t* out = output + outFrames * channels_;
+        for (uint32_t ch = 0; ch < channels_; ++ch) {
+            const float scaled = std::clamp(accum_[ch] * kFromFloat, -8388608.0f, 8388607.0f);
+            out[ch] = static_cast<int32_t>(std::lrint(scaled)) * 256;
+        }
+
+        position_ += ratio_;
+        outFrames++;
+    }
+
+    // Discard fully consumed frames
+    const uint32_t consumed = std::min(static_cast<uint32_t>(position_), historyFrames_);
+    if (consumed > 0) {
+        std::memmove(history_.data(), &history_[consumed * channels_],
+                     (historyFrames_ - consumed) * channels_ * sizeof(float));
+        historyFrames_ -= consumed;
+        position_ -= consumed;
+    }
+
+    return outFrames;
+}
+
+// ============================================================================
+// DriftController Implementation
+// ============================================================================
+
+namespace {
+
+constexpr uint64_t kMinEstimateWindowNs = 10000000000ULL;  // 10 s before trusting a window
+constexpr uint64_t kMaxEstimateWindowNs = 60000000000ULL;  // Restart window after 60 s
+constexpr uint64_t kEstimateIntervalNs = 1000000000ULL;    // Blend in a new estimate once per second
+constexpr double kFillSmoothing = 0.01;                    // Per-packet EMA weight
+constexpr double kFillKp = 0.05;                           // Ratio per second of excess audio
+constexpr double kFillKi = 1e-6;                           // Per update
+
+} // namespace
+
+DriftController::DriftController(uint32_t sampleRate)
+    : sampleRate_(sampleRate)
+{}
+
+void DriftController::Reset() {
+    haveAnchor_ = false;
+    lastRtp_ = 0;
+    rtpElapsed_ = 0;
+    anchorTimeNs_ = 0;
+    lastEstimateNs_ = 0;
+    rateEstimate_ = 1.0;
+    smoothedFill_ = -1.0;
+    integrator_ = 0.0;
+}
+
+void DriftController::OnPacket(uint32_t rtpTimestamp, uint64_t arrivalTimeNs) {
+    const int32_t step = static_cast<int32_t>(rtpTimestamp - lastRtp_);
+
+    // (Re-)anchor on first packet, timestamp jumps, or time going backwards
+    if (!haveAnchor_ || step <= 0 || static_cast<uint32_t>(step) > sampleRate_ ||
+        arrivalTimeNs < anchorTimeNs_) {
+        haveAnchor_ = true;
+        lastRtp_ = rtpTimestamp;
+        rtpElapsed_ = 0;
+        anchorTimeNs_ = arrivalTimeNs;
+        return;
+    }
+
+    rtpElapsed_ += static_cast<uint32_t>(step);
+    lastRtp_ = rtpTimestamp;
+
+    const uint64_t elapsedNs = arrivalTimeNs - anchorTimeNs_;
+    if (elapsedNs < kMinEstimateWindowNs) {
+        return; // Arrival jitter still dominates
+    }
+    if (arrivalTimeNs - lastEstimateNs_ < kEstimateIntervalNs) {
+        return;
+    }
+    lastEstimateNs_ = arrivalTimeNs;
+
+    const double expected = static_cast<double>(elapsedNs) * sampleRate_ / 1e9;
+    const double measured = static_cast<double>(rtpElapsed_) / expected;
+
+    if (std::abs(measured - 1.0) > kMaxDeviation) {
+        haveAnchor_ = false; // Implausible: sender restarted or PTP stepped
+        return;
+    }
+
+    // Longer windows are more trustworthy; blend accordingly
+    const double weight = std::min(1.0, static_cast<double>(elapsedNs) / kMaxEstimateWindowNs) * 0.5;
+    rateEstimate_ += (measured - rateEstimate_) * weight;
+
+    if (elapsedNs >= kMaxEstimateWindowNs) {
+        rtpElapsed_ = 0;
+        anchorTimeNs_ = arrivalTimeNs;
+    }
+}
+
+double DriftController::Update(double fillFrames, double targetFrames) {
+    if (smoothedFill_ < 0.0) {
+        smoothedFill_ = fillFrames;
+    } else {
+        smoothedFill_ += (fillFrames - smoothedFill_) * kFillSmoothing;
+    }
+
+    // Excess buffered audio in seconds; positive means consume faster
+    const double error = (smoothedFill_ - targetFrames) / sampleRate_;
+
+    integrator_ = std::clamp(integrator_ + error * kFillKi, -kMaxDeviation, kMaxDeviation);
+
+    const double ratio = rateEstimate_ * (1.0 + kFillKp * error + integrator_);
+    return std::clamp(ratio, 1.0 - kMaxDeviation, 1.0 + kMaxDeviation);
+}
+
+} // namespace AES67
@@ -0,0 +1,537 @@
+// EngineConfig.cpp - engine.json / qos.json loading
+// SPDX-License-Identifier: MIT
+
+#include "EngineConfig.h"
+#include "RTPTypes.h"
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+namespace AES67 {
+
+namespace {
+
+// Just enough JSON for the config files: a tree of values
+struct JsonValue {
+    enum class Type { Null, Bool, Number, String, Array, Object };
+    Type type = Type::Null;
+    bool boolean = false;
+    double number = 0.0;
+    std::string string;
+    std::vector<JsonValue> items;
+    std::vector<std::pair<std::string, JsonValue>> members;
+
+    const JsonValue* Get(std::string_view key) const {
+        for (const auto& member : members) {
+            if (member.first == key) return &member.second;
+        }
+        return nullptr;
+    }
+};
+
+// Recursive descent over RFC 8259 JSON
+class JsonReader {
+public:
+    explicit JsonReader(std::string_view text) : text_(text) {}
+
+    bool Parse(JsonValue& out, std::string& error) {
+        if (!ParseValue(out, 0)) {
+            error = error_ + " at offset " + std::to_string(pos_);
+            return false;
+        }
+        SkipSpace();
+        if (pos_ != text_.size()) {
+            error = "trailing characters at offset " + std::to_string(pos_);
+            return false;
+        }
+        return true;
+    }
+
+private:
+    static constexpr int kMaxDepth = 32;
+
+    void SkipSpace() {
+        while (pos_ < text_.size() &&
+               (text_[pos_] == ' ' || text_[pos_] == '\t' || text_[pos_] == '\n' || text_[pos_] == '\r')) {
+            pos_++;
+        }
+    }
+
+    bool Fail(const char* message) {
+        error_ = message;
+        return false;
+    }
+
+    bool Literal(std::string_view word) {
+        if (text_.substr(pos_, word.size()) != word) return Fail("invalid literal");
+        pos_ += word.size();
+        return true;
+    }
+
+    bool ParseValue(JsonValue& out, int depth) {
+        if (depth > kMaxDepth) return Fail("nested too deeply");
+        SkipSpace();
+        if (pos_ >= text_.size()) return Fail("unexpected end");
+
+        switch (text_[pos_]) {
+        case '{': return ParseObject(out, depth);
+        case '[': return ParseArray(out, depth);
+        case '"':
+            out.type = JsonValue::Type::String;
+            return ParseString(out.string);
+        case 't':
+            out.type = JsonValue::Type::Bool;
+            out.boolean = true;
+            return Literal("true");
+        case 'f':
+            out.type = JsonValue::Type::Bool;
+            out.boolean = false;
+            return Literal("false");
+        case 'n':
+            out.type = JsonValue::Type::Null;
+            return Literal("null");
+        default:
+            out.type = JsonValue::Type::Number;
+            return ParseNumber(out.number);
+        }
+    }
+
+    bool ParseObject(JsonValue& out, int depth) {
+        out.type = JsonValue::Type::Object;
+        pos_++;     // {
+        SkipSpace();
+        if (pos_ < text_.size() && text_[pos_] == '}') {
+            pos_++;
+            return true;
+        }
+        for (;;) {
+            SkipSpace();
+            std::string key;
+            if (pos_ >= text_.size() || text_[pos_] != '"' || !ParseString(key)) return Fail("expected key");
+            SkipSpace();
+            if (pos_ >= text_.size() || text_[pos_] != ':') return Fail("expected ':'");
+            pos_++;
+            out.members.emplace_back(std::move(key), JsonValue{});
+            if (!ParseValue(out.members.back().second, depth + 1)) return false;
+            SkipSpace();
+            if (pos_ < text_.size() && text_[pos_] == ',') {
+                pos_++;
+            } else if (pos_ < text_.size() && text_[pos_] == '}') {
+                pos_++;
+                return true;
+            } else {
+                return Fail("expected ',' or '}'");
+            }
+        }
+    }
+
+    bool ParseArray(JsonValue& out, int depth) {
+        out.type = JsonValue::Type::Array;
+        pos_++;     // [
+        SkipSpace();
+        if (pos_ < text_.size() && text_[pos_] == ']') {
+            pos_++;
+            return true;
+        }
+        for (;;) {
+            out.items.emplace_back();
+            if (!ParseValue(out.items.back(), depth + 1)) return false;
+            SkipSpace();
+            if (pos_ < text_.size() && text_[pos_] == ',') {
+                pos_++;
+            } else if (pos_ < text_.size() && text_[pos_] == ']') {
+                pos_++;
+                return true;
+            } else {
+                return Fail("expected ',' or ']'");
+            }
+        }
+    }
+
+    bool ParseHex4(uint32_t& out) {
+        if (pos_ + 4 > text_.size()) return Fail("bad \\u escape");
+        out = 0;
+        for (int i = 0; i < 4; ++i) {
+            const char c = text_[pos_++];
+            out <<= 4;
+            if (c >= '0' && c <= '9') out |= static_cast<uint32_t>(c - '0');
+            else if (c >= 'a' && c <= 'f') out |= static_cast<uint32_t>(c - 'a' + 10);
+            else if (c >= 'A' && c <= 'F') out |= static_cast<uint32_t>(c - 'A' + 10);
+            else return Fail("bad \\u escape");
+        }
+        return true;
+    }
+
+    static void AppendUtf8(std::string& out, uint32_t cp) {
+        if (cp < 0x80) {
+            out += static_cast<char>(cp);
+        } else if (cp < 0x800) {
+            out += static_cast<char>(0xC0 | (cp >> 6));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        } else if (cp < 0x10000) {
+            out += static_cast<char>(0xE0 | (cp >> 12));
+            out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        } else {
+            out += static_cast<char>(0xF0 | (cp >> 18));
+            out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        }
+    }
+
+    bool ParseString(std::string& out) {
+        pos_++;     // Opening quote
+        out.clear();
+        while (pos_ < text_.size()) {
+            const char c = text_[pos_++];
+            if (c == '"') return true;
+            if (static_cast<unsigned char>(c) < 0x20) return Fail("control character in string");
+            if (c != '\\') {
+                out += c;
+                continue;
+            }
+            if (pos_ >= text_.size()) break;
+            const char escape = text_[pos_++];
+            switch (escape) {
+            case '"': out += '"'; break;
+            case '\\': out += '\\'; break;
+            case '/': out += '/'; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'n': out += '\n'; break;
+            case 'r': out += '\r'; break;
+            case 't': out += '\t'; break;
+            case 'u': {
+                uint32_t cp = 0;
+                if (!ParseHex4(cp)) return false;
+                if (cp >= 0xD800 && cp < 0xDC00) {
+                    uint32_t low = 0;
+                    if (text_.substr(pos_, 2) != "\\u") return Fail("unpaired surrogate");
+                    pos_ += 2;
+                    if (!ParseHex4(low) || low < 0xDC00 || low >= 0xE000) return Fail("unpaired surrogate");
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                }
+                AppendUtf8(out, cp);
+                break;
+            }
+            default:
+                return Fail("bad escape");
+            }
+        }
+        return Fail("unterminated string");
+    }
+
+    bool ParseNumber(double& out) {
+        const size_t start = pos_;
+        if (pos_ < text_.size() && text_[pos_] == '-') pos_++;
+        const size_t digits = pos_;
+        while (pos_ < text_.size() && text_[pos_] >= '0' && text_[pos_] <= '9') pos_++;
+        if (pos_ == digits) return Fail("expected a value");
+        if (pos_ < text_.size() && text_[pos_] == '.') {
+            pos_++;
+            const size_t fraction = pos_;
+            while (pos_ < text_.size() && text_[pos_] >= '0' && text_[pos_] <= '9') pos_++;
+            if (pos_ == fraction) return Fail("bad number");
+        }
+        if (pos_ < text_.size() && (text_[pos_] == 'e' || text_[pos_] == 'E')) {
+            pos_++;
+            if (pos_ < text_.size() && (text_[pos_] == '+' || text_[pos_] == '-')) pos_++;
+            const size_t exponent = pos_;
+            while (pos_ < text_.size() && text_[pos_] >= '0' && text_[pos_] <= '9') pos_++;
+            if (pos_ == exponent) return Fail("bad number");
+        }
+        const std::string number(text_.substr(start, pos_ - start));
+        out = std::strtod(number.c_str(), nullptr);
+        return true;
+    }
+
+    std::string_view text_;
+    size_t pos_ = 0;
+    std::string error_;
+};
+
+// Typed field access: a missing key keeps the default, a present one must fit
+template <typename T>
+bool ReadInteger(const JsonValue& object, const char* key, int64_t min, int64_t max, T& out, std::string& error) {
+    const JsonValue* value = object.Get(key);
+    if (!value) return true;
+    if (value->type != JsonValue::Type::Number || value->number != std::floor(value->number) ||
+        value->number < static_cast<double>(min) || value->number > static_cast<double>(max)) {
+        error = std::string(key) + " must be an integer from " + std::to_string(min) + " to " + std::to_string(max);
+        return false;
+    }
+    out = static_cast<T>(value->number);
+    return true;
+}
+
+bool ReadString(const JsonValue& object, const char* key, std::string& out, std::string& error) {
+    const JsonValue* value = object.Get(key);
+    if (!value) return true;
+    if (value->type != JsonValue::Type::String) {
+        error = std::string(key) + " must be a string";
+        return false;
+    }
+    out = value->string;
+    return true;
+}
+
+bool ReadBool(const JsonValue& object, const char* key, bool& out, std::string& error) {
+    const JsonValue* value = object.Get(key);
+    if (!value) return true;
+    if (value->type != JsonValue::Type::Bool) {
+        error = std::string(key) + " must be true or false";
+        return false;
+    }
+    out = value->boolean;
+    return true;
+}
+
+// A DSCP value, or the name of one of the file's dscp_presets
+bool ReadDscp(const JsonValue& object, const char* key, const JsonValue* presets, uint8_t& out, std::string& error) {
+    const JsonValue* value = object.Get(key);
+    if (value && value->type == JsonValue::Type::String) {
+        const JsonValue* preset = presets ? presets->Get(value->string) : nullptr;
+        if (!preset) {
+            error = std::string(key) + ": unknown DSCP preset " + value->string;
+            return false;
+        }
+        return ReadInteger(*presets, value->string.c_str(), 0, 63, out, error);
+    }
+    return ReadInteger(object, key, 0, 63, out, error);
+}
+
+bool ParseDocument(std::string_view json, JsonValue& root, std::string& error) {
+    if (!JsonReader(json).Parse(root, error)) {
+        return false;
+    }
+    if (root.type != JsonValue::Type::Object) {
+        error = "top level must be an object";
+        return false;
+    }
+    return true;
+}
+
+bool ParseInput(const JsonValue& input, uint32_t& slot, RxSubscription& out, bool& enabled, std::string& error) {
+    if (input.type != JsonValue::Type::Object) {
+        error = "inputs entries must be objects";
+        return false;
+    }
+    uint32_t sampleRate = kRTPTimestampClockRate;
+    std::string format = "L24";
+    slot = 0xFFFFFFFF;
+    if (!ReadInteger(input, "id", 0, 7, slot, error) ||
+        !ReadBool(input, "enabled", enabled, error) ||
+        !ReadString(input, "multicast_address", out.address, error) ||
+        !ReadInteger(input, "port", 1, 65535, out.port, error) ||
+        !ReadInteger(input, "channels", 1, 8, out.channels, error) ||
+        !ReadInteger(input, "sample_rate", kRTPTimestampClockRate, kRTPTimestampClockRate, sampleRate, error) ||
+        !ReadString(input, "format", format, error) ||
+        !ReadInteger(input, "payload_type", 0, 127, out.payloadType, error) ||
+        !ReadInteger(input, "packet_time_us", 1, 4000, out.packetTimeUs, error) ||
+        !ReadString(input, "name", out.sessionName, error)) {
+        return false;
+    }
+    if (slot == 0xFFFFFFFF || !input.Get("multicast_address") || !input.Get("port")) {
+        error = "inputs entries need id, multicast_address and port";
+        return false;
+    }
+    if (format == "L24") {
+        out.bytesPerSample = 3;
+    } else if (format == "L16") {
+        out.bytesPerSample = 2;
+    } else {
+        error = "input format must be L24 or L16";
+        return false;
+    }
+    return true;
+}
+
+bool ParseProfile(const std::string& name, const JsonValue& object, const JsonValue* presets,
+                  QoSProfile& out, std::string& error) {
+    if (object.type != JsonValue::Type::Object) {
+        error = "profile " + name + " must be an object";
+        return false;
+    }
+    out.name = name;
+    if (!ReadString(object, "description", out.description, error) ||
+        !ReadInteger(object, "io_buffer_frames", 1, 4096, out.ioBufferFrames, error) ||
+        !ReadInteger(object, "tx_safety_offset_frames", 0, 8192, out.txSafetyOffsetFrames, error) ||
+        !ReadInteger(object, "packet_time_us", 1, 4000, out.packetTimeUs, error) ||
+        !ReadInteger(object, "jitter_buffer_packets_min", 1, 64, out.jitterBufferPacketsMin, error) ||
+        !ReadInteger(object, "jitter_buffer_packets_max", 1, 64, out.jitterBufferPacketsMax, error) ||
+        !ReadInteger(object, "ptp_domain", 0, 127, out.ptpDomain, error) ||
+        !ReadInteger(object, "ptp_sync_interval_log2", -7, 0, out.ptpLogSyncInterval, error) ||
+        !ReadDscp(object, "rtp_dscp", presets, out.rtpDscp, error) ||
+        !ReadDscp(object, "ptp_dscp", presets, out.ptpDscp, error)) {
+        error = "profile " + name + ": " + error;
+        return false;
+    }
+    if (!out.Validate(error)) {
+        error = "profile " + name + ": " + error;
+        return false;
+    }
+    return true;
+}
+
+bool ReadFile(const std::string& path, std::string& out) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return false;
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    out = contents.str();
+    return true;
+}
+
+} // namespace
+
+bool QoSProfile::Validate(std::string& error) const {
+    const uint64_t frameUnits = static_cast<uint64_t>(packetTimeUs) * kRTPTimestampClockRate;
+    if (frameUnits % 1000000 != 0 || frameUnits / 1000000 == 0 || frameUnits / 1000000 > 64) {
+        error = "packet_time_us must be a whole number of frames, 1 to 64 at 48 kHz";
+        return false;
+    }
+    if (jitterBufferPacketsMin == 0 || jitterBufferPacketsMax <= jitterBufferPacketsMin ||
+        jitterBufferPacketsMax > 64) {
+        error = "jitter_buffer_packets_max must exceed jitter_buffer_packets_min, at most 64";
+        return false;
+    }
+    if (ioBufferFrames == 0 || ioBufferFrames > 4096 || txSafetyOffsetFrames > 8192) {
+        error = "io_buffer_frames must be 1 to 4096, tx_safety_offset_frames at most 8192";
+        return false;
+    }
+    if (rtpDscp > 63 || ptpDscp > 63) {
+        error = "rtp_dscp or ptp_dscp out of range";
+        return false;
+    }
+    return true;
+}
+
+uint32_t QoSProfile::TxSafetyOffsetFrames() const {
+    if (txSafetyOffsetFrames != 0) {
+        return txSafetyOffsetFrames;
+    }
+    return ioBufferFrames + static_cast<uint32_t>(static_cast<uint64_t>(packetTimeUs) * kRTPTimestampClockRate / 1000000);
+}
+
+const QoSProfile* EngineFileConfig::FindProfile(const std::string& name) const {
+    for (const QoSProfile& profile : profiles) {
+        if (profile.name == name) return &profile;
+    }
+    return nullptr;
+}
+
+bool ParseEngineConfig(std::string_view json, EngineFileConfig& out, std::string& error) {
+    JsonValue root;
+    if (!ParseDocument(json, root, error) ||
+        !ReadString(root, "interface", out.interface, error) ||
+        !ReadString(root, "qos_profile", out.qosProfile, error) ||
+        !ReadString(root, "qos_file", out.qosPath, error)) {
+        return false;
+    }
+    if (const JsonValue* ptp = root.Get("ptp")) {
+        out.havePtpDomain = ptp->Get("domain") != nullptr;
+        if (!ReadInteger(*ptp, "domain", 0, 127, out.ptpDomain, error)) {
+            return false;
+        }
+    }
+
+    out.inputs.clear();
+    if (const JsonValue* inputs = root.Get("inputs")) {
+        if (inputs->type != JsonValue::Type::Array) {
+            error = "inputs must be an array";
+            return false;
+        }
+        for (const JsonValue& input : inputs->items) {
+            uint32_t slot = 0;
+            bool enabled = true;
+            RxSubscription subscription;
+            if (!ParseInput(input, slot, subscription, enabled, error)) {
+                return false;
+            }
+            if (enabled) {
+                out.inputs.emplace_back(slot, std::move(subscription));
+            }
+        }
+    }
+    return true;
+}
+
+bool ParseQoSConfig(std::string_view json, EngineFileConfig& out, std::string& error) {
+    JsonValue root;
+    if (!ParseDocument(json, root, error)) {
+        return false;
+    }
+    const JsonValue* presets = root.Get("dscp_presets");
+
+    out.profiles.clear();
+    if (const JsonValue* profiles = root.Get("profiles")) {
+        if (profiles->type != JsonValue::Type::Object) {
+            error = "profiles must be an object";
+            return false;
+        }
+        for (const auto& [name, object] : profiles->members) {
+            QoSProfile profile;
+            if (!ParseProfile(name, object, presets, profile, error)) {
+                return false;
+            }
+            out.profiles.push_back(std::move(profile));
+        }
+    }
+
+    if (const JsonValue* network = root.Get("network")) {
+        if (!ReadInteger(*network, "udp_recv_buffer_size", 0, 64 << 20, out.network.udpRecvBufferSize, error) ||
+            !ReadInteger(*network, "udp_send_buffer_size", 0, 64 << 20, out.network.udpSendBufferSize, error) ||
+            !ReadInteger(*network, "multicast_ttl", 1, 255, out.network.multicastTtl, error) ||
+            !ReadBool(*network, "multicast_loop", out.network.multicastLoop, error)) {
+            return false;
+        }
+    }
+
+    if (const JsonValue* sap = root.Get("sap")) {
+        if (!ReadBool(*sap, "enabled", out.sapEnabled, error) ||
+            !ReadInteger(*sap, "interval_seconds", 1, 3600, out.sapIntervalSeconds, error)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool LoadEngineConfig(const std::string& path, EngineFileConfig& out, std::string& error) {
+    std::string text;
+    if (!ReadFile(path, text)) {
+        error = "cannot read " + path;
+        return false;
+    }
+    if (!ParseEngineConfig(text, out, error)) {
+        error = path + ": " + error;
+        return false;
+    }
+
+    // qos.json sits next to engine.json unless it says otherwise
+    const size_t slash = path.find_last_of('/');
+    const std::string dir = slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+    std::string qosPath = out.qosPath.empty() ? "qos.json" : out.qosPath;
+    if (qosPath.front() != '/') {
+        qosPath = dir + qosPath;
+    }
+    if (!ReadFile(qosPath, text)) {
+        if (out.qosPath.empty() && out.qosProfile.empty()) {
+            return true;    // No QoS file and none asked for
+        }
+        error = "cannot read " + qosPath;
+        return false;
+    }
+    if (!ParseQoSConfig(text, out, error)) {
+        error = qosPath + ": " + error;
+        return false;
+    }
+    if (!out.qosProfile.empty() && !out.FindProfile(out.qosProfile)) {
+        error = qosPath + ": no profile named " + out.qosProfile;
+        return false;
+    }
+    return true;
+}
+
+} // namespace AES67
@@ -0,0 +1,82 @@
+// HostClock.cpp - Monotonic host timebase for the PTP affine mapping
+// SPDX-License-Identifier: MIT
+
+#include "HostClock.h"
+#include <atomic>
+
+namespace AES67 {
+namespace {
+
+constexpr uint64_t kRealtimeRefreshNs = 100000000ULL;  // Re-measure every 100 ms (NTP slews)
+
+std::atomic<int64_t> realtimeOffsetNs{0};      // CLOCK_REALTIME minus host time
+std::atomic<uint64_t> realtimeMeasuredNs{0};   // Host time of the last measurement
+
+#if defined(__APPLE__)
+const mach_timebase_info_data_t& Timebase() {
+    static const mach_timebase_info_data_t info = [] {
+        mach_timebase_info_data_t tb{};
+        mach_timebase_info(&tb);
+        return tb;
+    }();
+    return info;
+}
+#endif
+
+} // namespace
+
+uint64_t HostClock::TicksToNs(uint64_t ticks) {
+#if defined(__APPLE__)
+    const auto& tb = Timebase();
+    if (tb.numer == tb.denom) {
+        return ticks;
+    }
+    return static_cast<uint64_t>(static_cast<unsigned __int128>(ticks) * tb.numer / tb.denom);
+#else
+    return ticks;
+#endif
+}
+
+uint64_t HostClock::NsToTicks(uint64_t ns) {
+#if defined(__APPLE__)
+    const auto& tb = Timebase();
+    if (tb.numer == tb.denom) {
+        return ns;
+    }
+    return static_cast<uint64_t>(static_cast<unsigned __int128>(ns) * tb.denom / tb.numer);
+#else
+    return ns;
+#endif
+}
+
+uint64_t HostClock::RealtimeNowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+uint64_t HostClock::RealtimeToHostNs(uint64_t realtimeNs) {
+    const uint64_t now = NowNs();
+    const uint64_t measured = realtimeMeasuredNs.load(std::memory_order_relaxed);
+
+    if (measured == 0 || now - measured > kRealtimeRefreshNs) {
+        // Sandwich the realtime read between host reads; keep the tightest of three
+        int64_t best = 0;
+        uint64_t bestWindow = UINT64_MAX;
+        for (int i = 0; i < 3; ++i) {
+            const uint64_t before = NowNs();
+            const uint64_t realtime = RealtimeNowNs();
+            const uint64_t after = NowNs();
+            if (after - before < bestWindow) {
+                bestWindow = after - before;
+                best = static_cast<int64_t>(realtime - (before + (after - before) / 2));
+            }
+        }
+        realtimeOffsetNs.store(best, std::memory_order_relaxed);
+        realtimeMeasuredNs.store(now, std::memory_order_relaxed);
+    }
+
+    return realtimeNs - static_cast<uint64_t>(realtimeOffsetNs.load(std::memory_order_relaxed));
+}
+
+} // namespace AES67
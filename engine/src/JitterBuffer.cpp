@@ -3,118 +3,407 @@
 
 #include "JitterBuffer.h"
 #include <algorithm>
+#include <cstdlib>
 #include <cstring>
 
 namespace AES67 {
 
-JitterBuffer::JitterBuffer(uint32_t minPackets, uint32_t maxPackets, uint32_t sampleRate)
+namespace {
+
+constexpr uint32_t kMinHistogramSamples = 64;           // Before trusting the quantile
+constexpr uint64_t kReleaseHoldNs = 5000000000ULL;      // Demand must stay low this long per step down
+
+uint32_t FrameCapacity(uint32_t packets, uint32_t packetFrames) {
+    uint32_t capacity = 1;
+    while (capacity < packets * packetFrames) {
+        capacity <<= 1;
+    }
+    return capacity;
+}
+
+} // namespace
+
+JitterBuffer::JitterBuffer(uint32_t minPackets, uint32_t maxPackets, uint32_t sampleRate,
+                           uint32_t maxPacketFrames, uint32_t capacityPackets)
     : minPackets_(minPackets)
     , maxPackets_(maxPackets)
     , targetPackets_((minPackets + maxPackets) / 2)
+    , capacityPackets_(std::max(capacityPackets, maxPackets))
+    , maxPacketFrames_(maxPacketFrames)
     , sampleRate_(sampleRate)
-    , underruns_(0)
-    , overruns_(0)
-    , lastPlayoutTime_(0)
+    , frameMask_(FrameCapacity(capacityPackets_, maxPacketFrames) - 1)
+    , stamps_(new std::atomic<uint64_t>[frameMask_ + 1])
+    , samples_(new std::atomic<int32_t>[(frameMask_ + 1) * kChannels])
 {}
 
-JitterBuffer::~JitterBuffer() {
-    Reset();
+JitterBuffer::~JitterBuffer() = default;
+
+void JitterBuffer::SetTargetQuantile(double quantile) {
+    targetQuantile_.store(std::clamp(quantile, 0.5, 0.9999), std::memory_order_relaxed);
+}
+
+void JitterBuffer::SetDepthLimits(uint32_t minPackets, uint32_t maxPackets) {
+    maxPackets = std::min(maxPackets, capacityPackets_);
+    minPackets = std::min(minPackets, maxPackets);
+    minPackets_.store(minPackets, std::memory_order_relaxed);
+    maxPackets_.store(maxPackets, std::memory_order_relaxed);
+    
+    // The reader and writer move the target too; clamp whatever it is now
+    const uint32_t ceiling = std::max(minPackets, maxPackets - 1);
+    uint32_t target = targetPackets_.load(std::memory_order_relaxed);
+    while (!targetPackets_.compare_exchange_weak(target, std::clamp(target, minPackets, ceiling),
+                                                 std::memory_order_relaxed)) {
+    }
+    releaseSince_.store(0, std::memory_order_relaxed);
 }
 
 void JitterBuffer::Insert(uint32_t timestamp, uint64_t arrivalTime, 
                           const int32_t* samples, uint32_t frameCount) {
-    // Check for overrun
-    if (queue_.size() >= maxPackets_) {
-        overruns_++;
-        return; // Drop packet
+    frameCount = std::min(frameCount, maxPacketFrames_);
+    if (frameCount == 0) {
+        return;
     }
+    const uint32_t epoch = epoch_.load(std::memory_order_relaxed);
     
-    // Create packet entry
-    JitterBufferPacket packet;
-    packet.timestamp = timestamp;
-    packet.arrivalTime = arrivalTime;
-    packet.frameCount = frameCount;
-    packet.samples.resize(frameCount * 8);
-    std::memcpy(packet.samples.data(), samples, frameCount * 8 * sizeof(int32_t));
+    // Late packet: the reader has already passed all of its frames
+    const uint64_t readState = readState_.load(std::memory_order_acquire);
+    const bool haveRead = (readState >> 32) == epoch;
+    const uint32_t readCursor = static_cast<uint32_t>(readState);
+    if (haveRead && static_cast<int32_t>(timestamp + frameCount - readCursor) <= 0) {
+        latePackets_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
     
-    // Insert in timestamp order
-    auto it = queue_.begin();
-    while (it != queue_.end() && it->timestamp < timestamp) {
-        ++it;
+    // Copy in, each frame seqlock-style: stamp cleared, samples, then stamped.
+    // A slot still holding a frame the reader has not reached means the
+    // reader stalled for a whole ring; that frame is overwritten.
+    bool overwrote = false;
+    for (uint32_t f = 0; f < frameCount; ++f) {
+        const uint32_t position = timestamp + f;
+        const uint32_t slot = position & frameMask_;
+        const uint64_t previous = stamps_[slot].load(std::memory_order_relaxed);
+        if (previous >> 32 == epoch && static_cast<uint32_t>(previous) != position &&
+            (!haveRead || static_cast<int32_t>(static_cast<uint32_t>(previous) - readCursor) >= 0)) {
+            overwrote = true;
+        }
+        
+        stamps_[slot].store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        std::atomic<int32_t>* frame = &samples_[static_cast<size_t>(slot) * kChannels];
+        for (uint32_t ch = 0; ch < kChannels; ++ch) {
+            frame[ch].store(samples[f * kChannels + ch], std::memory_order_relaxed);
+        }
+        stamps_[slot].store(Tag(epoch, position), std::memory_order_release);
+    }
+    if (overwrote) {
+        overruns_.fetch_add(1, std::memory_order_relaxed);
     }
     
-    queue_.insert(it, packet);
+    UpdateDelayStatistics(timestamp, arrivalTime);
+    packetFrames_.store(frameCount, std::memory_order_relaxed);
+    
+    // Newest by timestamp (wrap-safe); reordered stragglers do not count
+    const uint32_t end = timestamp + frameCount;
+    uint32_t newestEpoch = 0;
+    uint32_t newestEnd = 0;
+    uint64_t newestArrival = 0;
+    if (!haveNewest_) {
+        oldest_.store(timestamp, std::memory_order_relaxed);
+    }
+    if (!haveNewest_ || !LoadNewest(newestEpoch, newestEnd, newestArrival) ||
+        static_cast<int32_t>(end - newestEnd) > 0) {
+        PublishNewest(epoch, end, arrivalTime);
+        haveNewest_ = true;
+    }
     
     // Adjust buffer depth if needed
-    AdjustDepth();
+    AdjustDepth(arrivalTime, frameCount);
+}
+
+void JitterBuffer::Reset() {
+    // Every stored frame is stamped with the old epoch and no longer matches
+    uint32_t epoch = epoch_.load(std::memory_order_relaxed) + 1;
+    if (epoch == 0) {
+        epoch = 1;
+    }
+    epoch_.store(epoch, std::memory_order_release);
+    
+    haveNewest_ = false;
+    underruns_.store(0, std::memory_order_relaxed);
+    overruns_.store(0, std::memory_order_relaxed);
+    latePackets_.store(0, std::memory_order_relaxed);
+    
+    haveTransit_ = false;
+    jitterNs_.store(0.0, std::memory_order_relaxed);
+    histogram_.fill(0);
+    histogramTotal_ = 0;
+    packetsSinceDecay_ = 0;
+    delayQuantileNs_.store(0, std::memory_order_relaxed);
+    releaseSince_.store(0, std::memory_order_relaxed);
+}
+
+void JitterBuffer::PublishNewest(uint32_t epoch, uint32_t endTimestamp, uint64_t arrivalTime) {
+    const uint32_t seq = newestSeq_.load(std::memory_order_relaxed);
+    newestSeq_.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    newestEpoch_.store(epoch, std::memory_order_relaxed);
+    newestEnd_.store(endTimestamp, std::memory_order_relaxed);
+    newestArrival_.store(arrivalTime, std::memory_order_relaxed);
+    newestSeq_.store(seq + 2, std::memory_order_release);
+}
+
+bool JitterBuffer::LoadNewest(uint32_t& epoch, uint32_t& endTimestamp, uint64_t& arrivalTime) const {
+    // Seqlock read side: retry while Insert is mid-update
+    for (int attempt = 0; attempt < 4; ++attempt) {
+        const uint32_t seq1 = newestSeq_.load(std::memory_order_acquire);
+        if (seq1 & 1) {
+            continue;
+        }
+        epoch = newestEpoch_.load(std::memory_order_relaxed);
+        endTimestamp = newestEnd_.load(std::memory_order_relaxed);
+        arrivalTime = newestArrival_.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (newestSeq_.load(std::memory_order_relaxed) == seq1) {
+            return epoch != 0;
+        }
+    }
+    return false;
+}
+
+bool JitterBuffer::ReadFrame(uint32_t epoch, uint32_t timestamp, int32_t* out) const {
+    const uint32_t slot = timestamp & frameMask_;
+    const uint64_t tag = Tag(epoch, timestamp);
+    if (stamps_[slot].load(std::memory_order_acquire) != tag) {
+        return false;
+    }
+    const std::atomic<int32_t>* frame = &samples_[static_cast<size_t>(slot) * kChannels];
+    for (uint32_t ch = 0; ch < kChannels; ++ch) {
+        out[ch] = frame[ch].load(std::memory_order_relaxed);
+    }
+    // Rewritten while we copied: treat as missing
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return stamps_[slot].load(std::memory_order_relaxed) == tag;
 }
 
-const JitterBufferPacket* JitterBuffer::GetNextPacket(uint64_t ptpTimeNs) {
-    if (queue_.empty()) {
-        underruns_++;
-        return nullptr;
+uint32_t JitterBuffer::Read(uint32_t rtpTimestamp, int32_t* out, uint32_t frames) {
+    // The writer reset the buffer: start over as a new stream
+    const uint32_t epoch = epoch_.load(std::memory_order_acquire);
+    if (epoch != readEpoch_) {
+        readEpoch_ = epoch;
+        haveRead_ = false;
+        havePlayed_ = false;
+        starved_ = false;
+        lastFrame_.fill(0);
+        concealRun_ = 0;
     }
     
-    // Check if first packet is ready for playout
-    const auto& firstPacket = queue_.front();
+    uint32_t found = 0;
+    for (uint32_t f = 0; f < frames; ++f) {
+        int32_t* frame = out + f * kChannels;
+        if (ReadFrame(readEpoch_, rtpTimestamp + f, frame)) {
+            std::memcpy(lastFrame_.data(), frame, kChannels * sizeof(int32_t));
+            concealRun_ = 0;
+            found++;
+        } else {
+            Conceal(frame, 1);
+        }
+    }
     
-    // Calculate expected playout time for this packet
-    // playout_time = arrival_time + target_depth * packet_duration
-    const uint64_t packetDurationNs = (firstPacket.frameCount * 1000000000ULL) / sampleRate_;
-    const uint64_t targetDelay = targetPackets_ * packetDurationNs;
-    const uint64_t playoutTime = firstPacket.arrivalTime + targetDelay;
+    haveRead_ = true;
+    readState_.store(Tag(readEpoch_, rtpTimestamp + frames), std::memory_order_release);
     
-    if (ptpTimeNs >= playoutTime) {
-        lastPlayoutTime_ = ptpTimeNs;
-        return &queue_.front();
+    if (found > 0) {
+        havePlayed_ = true;
     }
     
-    return nullptr; // Not ready yet
+    if (found == frames) {
+        starved_ = false;
+    } else if (havePlayed_ && !starved_) {
+        // Count one underrun per gap on a live stream
+        underruns_.fetch_add(1, std::memory_order_relaxed);
+        starved_ = true;
+        
+        // Fast attack: a real underrun means the target was too shallow
+        uint32_t target = targetPackets_.load(std::memory_order_relaxed);
+        while (target + 1 < maxPackets_.load(std::memory_order_relaxed) &&
+               !targetPackets_.compare_exchange_weak(target, target + 1, std::memory_order_relaxed)) {
+        }
+        releaseSince_.store(0, std::memory_order_relaxed);
+    }
+    
+    return found;
 }
 
-void JitterBuffer::ReleasePacket(const JitterBufferPacket* packet) {
-    if (!packet || queue_.empty()) {
-        return;
+bool JitterBuffer::GetNewestPacket(uint32_t& endTimestamp, uint64_t& arrivalTime) const {
+    uint32_t epoch = 0;
+    if (!LoadNewest(epoch, endTimestamp, arrivalTime) || epoch != epoch_.load(std::memory_order_acquire)) {
+        return false;
+    }
+    
+    // Everything up to it already played
+    const uint64_t readState = readState_.load(std::memory_order_acquire);
+    return (readState >> 32) != epoch || static_cast<int32_t>(endTimestamp - static_cast<uint32_t>(readState)) > 0;
+}
+
+uint32_t JitterBuffer::PeekNewest(int32_t* out, uint32_t frames) const {
+    std::memset(out, 0, static_cast<size_t>(frames) * kChannels * sizeof(int32_t));
+    uint32_t epoch = 0;
+    uint32_t end = 0;
+    uint64_t arrival = 0;
+    if (!LoadNewest(epoch, end, arrival) || epoch != epoch_.load(std::memory_order_acquire)) {
+        return 0;
     }
     
-    // Should be the front packet
-    if (&queue_.front() == packet) {
-        queue_.pop_front();
+    // Frames the writer is overwriting fail their stamp check and stay zero
+    frames = std::min(frames, frameMask_ + 1);
+    const uint32_t start = end - frames;
+    uint32_t found = 0;
+    for (uint32_t f = 0; f < frames; ++f) {
+        int32_t* frame = out + f * kChannels;
+        if (ReadFrame(epoch, start + f, frame)) {
+            found++;
+        } else {
+            std::memset(frame, 0, kChannels * sizeof(int32_t));
+        }
     }
+    return found;
 }
 
-void JitterBuffer::Reset() {
-    for (auto& packet : queue_) {
-        packet.samples.clear();
+uint32_t JitterBuffer::GetDepth() const {
+    uint32_t epoch = 0;
+    uint32_t end = 0;
+    uint64_t arrival = 0;
+    const uint32_t packetFrames = packetFrames_.load(std::memory_order_relaxed);
+    if (packetFrames == 0 || !LoadNewest(epoch, end, arrival) || epoch != epoch_.load(std::memory_order_acquire)) {
+        return 0;
     }
-    queue_.clear();
-    underruns_ = 0;
-    overruns_ = 0;
-    lastPlayoutTime_ = 0;
+    
+    // From the reader's position, or the first packet if it has not started
+    const uint64_t readState = readState_.load(std::memory_order_acquire);
+    const uint32_t start = (readState >> 32) == epoch
+        ? static_cast<uint32_t>(readState) : oldest_.load(std::memory_order_relaxed);
+    const int32_t queued = static_cast<int32_t>(end - start);
+    if (queued <= 0) {
+        return 0;
+    }
+    return std::min((static_cast<uint32_t>(queued) + packetFrames - 1) / packetFrames, capacityPackets_);
 }
 
-void JitterBuffer::AdjustDepth() {
-    // Simple adaptive algorithm: adjust target based on underrun/overrun ratio
-    const uint32_t currentDepth = static_cast<uint32_t>(queue_.size());
+void JitterBuffer::Conceal(int32_t* out, uint32_t frames) {
+    // Fade the last good frame out instead of cutting to silence
+    for (uint32_t f = 0; f < frames; ++f) {
+        const int64_t gain = concealRun_ < kConcealFadeFrames ? kConcealFadeFrames - concealRun_ : 0;
+        for (uint32_t ch = 0; ch < kChannels; ++ch) {
+            out[f * kChannels + ch] = static_cast<int32_t>(
+                (lastFrame_[ch] * gain / kConcealFadeFrames) & ~int64_t{0xFF});
+        }
+        if (concealRun_ < kConcealFadeFrames) {
+            concealRun_++;
+        }
+    }
+}
+
+void JitterBuffer::UpdateDelayStatistics(uint32_t timestamp, uint64_t arrivalTime) {
+    const int32_t tsDelta = static_cast<int32_t>(timestamp - lastTimestamp_);
+    
+    // (Re-)anchor on first packet or a timestamp discontinuity (> 1 s)
+    if (!haveTransit_ || std::abs(static_cast<int64_t>(tsDelta)) > sampleRate_ ||
+        arrivalTime < firstArrival_) {
+        haveTransit_ = true;
+        lastTimestamp_ = timestamp;
+        firstArrival_ = arrivalTime;
+        rtpElapsedNs_ = 0;
+        lastTransit_ = 0;
+        baselineTransit_ = 0;
+        epochMinTransit_ = 0;
+        histogram_.fill(0);
+        histogramTotal_ = 0;
+        packetsSinceDecay_ = 0;
+        return;
+    }
+    
+    // Transit = arrival time minus media time, both relative to the anchor packet
+    const int64_t packetRtpNs = rtpElapsedNs_ + static_cast<int64_t>(tsDelta) * 1000000000LL / sampleRate_;
+    if (tsDelta > 0) {
+        rtpElapsedNs_ = packetRtpNs;
+        lastTimestamp_ = timestamp;
+    }
+    const int64_t transit = static_cast<int64_t>(arrivalTime - firstArrival_) - packetRtpNs;
+    
+    // RFC 3550 interarrival jitter
+    const double d = static_cast<double>(std::abs(transit - lastTransit_));
+    const double jitter = jitterNs_.load(std::memory_order_relaxed);
+    jitterNs_.store(jitter + (d - jitter) / 16.0, std::memory_order_relaxed);
+    lastTransit_ = transit;
     
-    // If we're consistently full, increase target
-    if (currentDepth >= maxPackets_ - 1) {
-        if (targetPackets_ < maxPackets_) {
-            targetPackets_++;
+    // Delay relative to the fastest transit seen over the last one or two epochs
+    epochMinTransit_ = std::min(epochMinTransit_, transit);
+    const int64_t reference = std::min(baselineTransit_, epochMinTransit_);
+    const uint64_t deviation = static_cast<uint64_t>(std::max<int64_t>(0, transit - reference));
+    const uint32_t bin = static_cast<uint32_t>(std::min<uint64_t>(deviation / kBinWidthNs, kHistogramBins - 1));
+    histogram_[bin]++;
+    histogramTotal_++;
+    
+    // Forget old history so the distribution follows the network
+    if (++packetsSinceDecay_ >= kHistogramDecayPackets) {
+        histogramTotal_ = 0;
+        for (auto& count : histogram_) {
+            count /= 2;
+            histogramTotal_ += count;
         }
+        baselineTransit_ = epochMinTransit_;
+        epochMinTransit_ = transit;
+        packetsSinceDecay_ = 0;
     }
     
-    // If we're getting underruns, increase target
-    if (underruns_ > 0 && targetPackets_ < maxPackets_) {
-        targetPackets_++;
-        underruns_ = 0; // Reset counter
+    // Quantile of arrival delay
+    const uint64_t threshold = static_cast<uint64_t>(histogramTotal_ * targetQuantile_.load(std::memory_order_relaxed));
+    uint64_t cumulative = 0;
+    uint32_t quantileBin = kHistogramBins - 1;
+    for (uint32_t i = 0; i < kHistogramBins; ++i) {
+        cumulative += histogram_[i];
+        if (cumulative >= threshold) {
+            quantileBin = i;
+            break;
+        }
+    }
+    delayQuantileNs_.store((quantileBin + 1) * kBinWidthNs, std::memory_order_relaxed);
+}
+
+void JitterBuffer::AdjustDepth(uint64_t nowNs, uint32_t frameCount) {
+    const uint64_t packetDurationNs = (frameCount * 1000000000ULL) / sampleRate_;
+    if (packetDurationNs == 0 || histogramTotal_ < kMinHistogramSamples) {
+        return;
     }
     
-    // If buffer is too deep and no underruns, decrease target
-    if (currentDepth > targetPackets_ + 2 && underruns_ == 0) {
-        if (targetPackets_ > minPackets_) {
-            targetPackets_--;
+    // Cover the delay quantile, plus one packet for playout polling granularity.
+    // Keep one slot free below maxPackets_ so the queue does not overrun at target.
+    const uint32_t minPackets = minPackets_.load(std::memory_order_relaxed);
+    const uint32_t ceiling = std::max(minPackets, maxPackets_.load(std::memory_order_relaxed) - 1);
+    const uint32_t required = std::clamp(
+        static_cast<uint32_t>((delayQuantileNs_.load(std::memory_order_relaxed) + packetDurationNs - 1) /
+                              packetDurationNs) + 1,
+        minPackets, ceiling);
+    
+    // The reader and SetDepthLimits() move the target too: compare-and-swap
+    uint32_t target = targetPackets_.load(std::memory_order_relaxed);
+    if (required > target) {
+        // Fast attack
+        while (target < required &&
+               !targetPackets_.compare_exchange_weak(target, required, std::memory_order_relaxed)) {
+        }
+        releaseSince_.store(0, std::memory_order_relaxed);
+    } else if (required < target) {
+        // Slow release, one packet per hold period
+        const uint64_t since = releaseSince_.load(std::memory_order_relaxed);
+        if (since == 0) {
+            releaseSince_.store(nowNs, std::memory_order_relaxed);
+        } else if (nowNs - since >= kReleaseHoldNs) {
+            targetPackets_.compare_exchange_strong(target, target - 1, std::memory_order_relaxed);
+            releaseSince_.store(nowNs, std::memory_order_relaxed);
         }
+    } else {
+        releaseSince_.store(0, std::memory_order_relaxed);
     }
 }
 
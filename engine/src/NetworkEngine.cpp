@@ -2,30 +2,111 @@
 // SPDX-License-Identifier: MIT
 
 #include "NetworkEngine.h"
+#include "HostClock.h"
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <unistd.h>
+#include <algorithm>
+#include <chrono>
 #include <cstring>
 #include <iostream>
-#include <time.h>
 
 namespace AES67 {
 
+namespace {
+
+// PTP nanoseconds -> media clock samples (a=mediaclk:direct=0)
+uint64_t PTPNsToMediaSamples(uint64_t ptpNs) {
+    return (ptpNs / 1000000000ULL) * kRTPTimestampClockRate +
+           ((ptpNs % 1000000000ULL) * kRTPTimestampClockRate) / 1000000000ULL;
+}
+
+int64_t MediaFramesToNs(int64_t frames) {
+    return frames * 1000000000LL / kRTPTimestampClockRate;
+}
+
+constexpr uint32_t kResampleChunkFrames = 64;   // Jitter buffer -> resampler pull size
+constexpr int32_t kCursorToleranceFrames = 2;   // Host time rounding between reads
+constexpr uint64_t kStreamIdleNs = 1000000000ULL; // Stream leaves the alignment set after 1 s
+constexpr uint32_t kMaxRxPacketFrames = 1500 / 2; // L16 mono in a full-size datagram
+
+uint32_t PacketFrames(uint32_t packetTimeUs) {
+    return static_cast<uint32_t>(static_cast<uint64_t>(packetTimeUs) * kRTPTimestampClockRate / 1000000);
+}
+
+// Output ring a profile needs: the device buffer plus a packet waiting for
+// TX, with room for scheduling hiccups (AlignTxTimestamp needs under half)
+uint32_t RingFramesFor(const QoSProfile& profile) {
+    return 8 * (profile.ioBufferFrames + PacketFrames(profile.packetTimeUs));
+}
+
+void ApplyTxSocketOptions(int sock, const NetworkQoS& network, uint8_t dscp) {
+    // Send buffer size
+    int sendBufSize = network.udpSendBufferSize;
+    setsockopt(sock, SOL_SOCKET, SO_SNDBUF, &sendBufSize, sizeof(sendBufSize));
+    
+    // Set DSCP for QoS (EF = 46 for expedited forwarding)
+    int tos = dscp << 2; // DSCP is in top 6 bits of TOS byte
+    setsockopt(sock, IPPROTO_IP, IP_TOS, &tos, sizeof(tos));
+    
+    // Set multicast TTL and loopback
+    int ttl = network.multicastTtl;
+    setsockopt(sock, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+    unsigned char loop = network.multicastLoop ? 1 : 0;
+    setsockopt(sock, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+}
+
+} // namespace
+
 NetworkEngine::NetworkEngine(const char* configPath) {
-    (void)configPath; // TODO: Load from JSON file
+    // engine.json and its qos.json; anything missing keeps the built-in default
+    EngineFileConfig file;
+    QoSSettings qos;
+    if (configPath && *configPath) {
+        std::string error;
+        if (LoadEngineConfig(configPath, file, error)) {
+            if (!file.interface.empty()) {
+                config_.interface = file.interface;
+            }
+            qosProfiles_ = file.profiles;
+            qos.network = file.network;
+            if (const QoSProfile* profile = file.FindProfile(file.qosProfile)) {
+                qos.profile = *profile;
+                config_.ptpDomain = profile->ptpDomain;
+                config_.ptpLogSyncInterval = profile->ptpLogSyncInterval;
+            }
+            if (file.havePtpDomain) {
+                config_.ptpDomain = file.ptpDomain;     // engine.json's own wins
+            }
+            config_.sapAnnounce = file.sapEnabled;
+        } else {
+            std::cerr << "NetworkEngine: " << error << ", using defaults\n";
+            file = EngineFileConfig{};
+        }
+    }
+    qos_.Publish(std::make_shared<const QoSSettings>(qos));
     
-    // Create PTP clock (operate as grandmaster)
-    ptpClient_ = std::make_unique<PTPClient>(config_.ptpDomain, PTPClient::Mode::Master);
+    // Create PTP clock (BMCA picks the role by default, see SetPTPMode)
+    ptpTransport_ = std::make_unique<PTPTransport>();
+    ptpTransport_->SetDscp(qos.profile.ptpDscp);
+    ptpClient_ = std::make_unique<PTPClient>(config_.ptpDomain, config_.ptpMode);
+    for (auto& clock : rxClock_) {
+        clock = ptpClient_.get();
+    }
     
     // Create SAP announcer
     sapAnnouncer_ = std::make_unique<SAPAnnouncer>();
+    sapAnnouncer_->SetInterval(file.sapIntervalSeconds);
     
-    // Create ring buffers (large enough for low latency)
-    const size_t ringSize = 48000; // 1 second @ 48kHz
+    // Create output ring buffers (input is pulled straight from the jitter buffers).
+    // The driver holds on to them, so they are sized once for every profile.
+    size_t ringSize = std::max(config_.ringFrames, RingFramesFor(qos.profile));
+    for (const QoSProfile& profile : qosProfiles_) {
+        ringSize = std::max<size_t>(ringSize, RingFramesFor(profile));
+    }
     for (uint32_t i = 0; i < 8; ++i) {
-        inputRings_[i] = std::make_unique<AudioRingBuffer>(ringSize * 8);
-        outputRings_[i] = std::make_unique<AudioRingBuffer>(ringSize * 8);
+        outputRings_[i] = std::make_unique<AudioRingBuffer>(ringSize * kChannelsPerStream);
     }
     
     // Create RTP packetizers for TX
@@ -34,17 +115,42 @@ NetworkEngine::NetworkEngine(const char* configPath) {
         txPacketizers_[i] = std::make_unique<RTPPacketizer>(ssrc, 8, 48000);
     }
     
-    // Create RTP depacketizers for RX
+    // Create RTP depacketizers for RX (frames always land 8 channels wide)
     for (uint32_t i = 0; i < 8; ++i) {
         rxDepacketizers_[i] = std::make_unique<RTPDepacketizer>(8, 48000);
+        rxDepacketizers_[i]->SetOutputChannels(kChannelsPerStream);
     }
     
-    // Create jitter buffers for RX
+    // engine.json inputs, else slot 0 listens on the historical default; the
+    // others wait for Subscribe()
+    if (file.inputs.empty()) {
+        rxSlots_[0].subscription = RxSubscription{};
+        rxSlots_[0].subscribed = true;
+    }
+    for (const auto& [slot, subscription] : file.inputs) {
+        rxSlots_[slot].subscription = subscription;
+        rxSlots_[slot].subscribed = true;
+    }
+    
+    // Create jitter buffers for RX. Their stores are allocated here, deep
+    // enough for the largest packets and the deepest profile, so neither
+    // Insert() nor a profile switch allocates.
+    uint32_t jitterCapacity = qos.profile.jitterBufferPacketsMax;
+    for (const QoSProfile& profile : qosProfiles_) {
+        jitterCapacity = std::max(jitterCapacity, profile.jitterBufferPacketsMax);
+    }
     for (uint32_t i = 0; i < 8; ++i) {
         rxJitterBuffers_[i] = std::make_unique<JitterBuffer>(
-            config_.jitterBufferPackets, 
-            config_.jitterBufferPackets * 2,
-            48000);
+            qos.profile.jitterBufferPacketsMin, 
+            qos.profile.jitterBufferPacketsMax,
+            48000, kMaxRxPacketFrames, jitterCapacity);
+    }
+    
+    // Create drift-correcting resamplers for RX (disabled until requested)
+    for (uint32_t i = 0; i < 8; ++i) {
+        rxResamplers_[i] = std::make_unique<AsyncResampler>(kChannelsPerStream, kResampleChunkFrames);
+        rxDriftControllers_[i] = std::make_unique<DriftController>(48000);
+        rxRateEstimate_[i] = 1.0;
     }
 }
 
@@ -55,14 +161,40 @@ NetworkEngine::~NetworkEngine() {
 bool NetworkEngine::Start() {
     if (running_) return true;
     
-    // Start PTP clock as network grandmaster
-    if (!ptpClient_->Start(config_.interface.c_str(), PTPClient::Mode::Master)) {
+    // Start PTP clock (grandmaster, or follower of the house grandmaster)
+    ptpClient_->SetServo(config_.ptpServo, config_.ptpServoConfig);
+    ptpClient_->SetPriority(config_.ptpPriority1, config_.ptpPriority2);
+    ptpClient_->SetSyncInterval(config_.ptpLogSyncInterval);
+    ptpClient_->SetHybrid(config_.ptpHybrid);
+    ptpClient_->SetDelayMechanism(config_.ptpDelayMechanism);
+    if (!ptpClient_->SetUnicastMaster(config_.ptpUnicastMaster)) {
+        return false;
+    }
+    if (!ptpTransport_->Open(config_.interface.c_str())) {
+        return false;
+    }
+    if (!ptpClient_->Start(*ptpTransport_, config_.ptpMode)) {
+        ptpTransport_->Stop();
+        return false;
+    }
+    
+    // Other domains only follow their grandmaster, on the same sockets and thread
+    for (auto& domain : ptpExtraDomains_) {
+        domain->SetServo(config_.ptpServo, config_.ptpServoConfig);
+        domain->SetHybrid(config_.ptpHybrid);
+        domain->SetDelayMechanism(config_.ptpDelayMechanism);
+        if (!domain->Start(*ptpTransport_, PTPClient::Mode::Slave)) {
+            ptpTransport_->Stop();
+            return false;
+        }
+    }
+    if (!ptpTransport_->Start()) {
+        ptpTransport_->Stop();
         return false;
     }
     
     running_ = true;
     
-    std::cout << "NetworkEngine::Start() - Starting threads..." << std::endl;
     fprintf(stderr, "NetworkEngine::Start() - Starting threads...\n");
     fflush(stderr);
     
@@ -71,19 +203,8 @@ bool NetworkEngine::Start() {
     fprintf(stderr, "NetworkEngine::Start() - SAP thread started\n");
     fflush(stderr);
     
-    // Start RTP threads (only stream 0 for receive - monitoring single stream at 239.69.2.1)
-    // TODO: Support multiple streams with different ports or shared socket
-    for (uint32_t i = 0; i < 1; ++i) {  // Only start stream 0 receiver
-        fprintf(stderr, "NetworkEngine::Start() - Starting RX thread %u\n", i);
-        fflush(stderr);
-        rxThreads_[i] = std::thread(&NetworkEngine::RTPReceiveThread, this, i);
-        
-        fprintf(stderr, "NetworkEngine::Start() - Starting playout thread %u\n", i);
-        fflush(stderr);
-        playoutThreads_[i] = std::thread(&NetworkEngine::JitterBufferPlayoutThread, this, i);
-        fprintf(stderr, "NetworkEngine::Start() - Playout thread %u created\n", i);
-        fflush(stderr);
-    }
+    // Start the RTP receive thread; unsubscribed slots idle until Subscribe()
+    rxThread_ = std::thread(&NetworkEngine::RTPReceiveThread, this);
     
     // Start TX threads for all streams (if needed for sending)
     for (uint32_t i = 0; i < 8; ++i) {
@@ -93,6 +214,14 @@ bool NetworkEngine::Start() {
     fflush(stderr);
     
     // Start SAP announcements
+    if (config_.sapAnnounce) {
+        sapAnnouncer_->Start(TxStreamDescriptions(qos_.Load()->profile.packetTimeUs));
+    }
+    
+    return true;
+}
+
+std::vector<StreamDescription> NetworkEngine::TxStreamDescriptions(uint32_t packetTimeUs) const {
     std::vector<StreamDescription> streams;
     for (uint32_t i = 0; i < 8; ++i) {
         StreamDescription desc;
@@ -102,13 +231,10 @@ bool NetworkEngine::Start() {
         desc.port = 5004;
         desc.channels = 8;
         desc.sampleRate = 48000;
-        desc.packetTimeUs = config_.packetTimeUs;
+        desc.packetTimeUs = packetTimeUs;
         streams.push_back(desc);
     }
-    
-    sapAnnouncer_->Start(streams);
-    
-    return true;
+    return streams;
 }
 
 void NetworkEngine::Stop() {
@@ -116,21 +242,25 @@ void NetworkEngine::Stop() {
     
     running_ = false;
     
-    // Stop PTP
-    ptpClient_->Stop();
+    // Stop PTP (every domain)
+    ptpTransport_->Stop();
     
     // Stop SAP
     sapAnnouncer_->Stop();
     
+    // Wake an idle receive thread
+    {
+        std::lock_guard<std::mutex> lock(rxWakeMutex_);
+        rxChanged_.notify_all();
+    }
+    
     // Join all threads
     if (sapDiscoveryThread_.joinable()) {
         sapDiscoveryThread_.join();
     }
     
-    for (auto& thread : rxThreads_) {
-        if (thread.joinable()) {
-            thread.join();
-        }
+    if (rxThread_.joinable()) {
+        rxThread_.join();
     }
     
     for (auto& thread : txThreads_) {
@@ -138,30 +268,107 @@ void NetworkEngine::Stop() {
             thread.join();
         }
     }
-    
-    for (auto& thread : playoutThreads_) {
-        if (thread.joinable()) {
-            thread.join();
-        }
-    }
 }
 
 uint64_t NetworkEngine::GetPTPTimeNs() const {
     return ptpClient_->GetPTPTimeNs();
 }
 
+// Driver host times are mach_absolute_time ticks; the PTP map runs in host nanoseconds
 uint64_t NetworkEngine::HostTimeToPTP(uint64_t hostTime) const {
-    return ptpClient_->HostTimeToPTP(hostTime);
+    return ptpClient_->HostTimeToPTP(HostClock::TicksToNs(hostTime));
 }
 
 uint64_t NetworkEngine::PTPToHostTime(uint64_t ptpTimeNs) const {
-    return ptpClient_->PTPToHostTime(ptpTimeNs);
+    return HostClock::NsToTicks(ptpClient_->PTPToHostTime(ptpTimeNs));
 }
 
 bool NetworkEngine::IsPTPLocked() const {
     return ptpClient_->IsLocked();
 }
 
+PTPPortState NetworkEngine::GetPTPPortState() const {
+    return ptpClient_->GetPortState();
+}
+
+size_t NetworkEngine::GetPTPSlaveCount() const {
+    return ptpClient_->GetSlaveCount();
+}
+
+PTPStatsSnapshot NetworkEngine::GetPTPStats(double windowSec) const {
+    return ptpClient_->GetStats(windowSec);
+}
+
+const PTPClient* NetworkEngine::PTPClientForDomain(uint8_t domain) const {
+    if (domain == ptpClient_->GetDomain()) {
+        return ptpClient_.get();
+    }
+    for (const auto& client : ptpExtraDomains_) {
+        if (client->GetDomain() == domain) {
+            return client.get();
+        }
+    }
+    return nullptr;
+}
+
+bool NetworkEngine::AddPTPDomain(uint8_t domain) {
+    if (running_) {
+        std::cerr << "NetworkEngine: PTP domains can only be added while stopped\n";
+        return false;
+    }
+    if (PTPClientForDomain(domain)) {
+        return true;
+    }
+    if (ptpExtraDomains_.size() + 1 >= PTPTransport::kMaxDomains) {
+        std::cerr << "NetworkEngine: at most " << PTPTransport::kMaxDomains << " PTP domains\n";
+        return false;
+    }
+    ptpExtraDomains_.push_back(std::make_unique<PTPClient>(domain, PTPClient::Mode::Slave));
+    return true;
+}
+
+bool NetworkEngine::IsPTPDomainLocked(uint8_t domain) const {
+    const PTPClient* client = PTPClientForDomain(domain);
+    return client && client->IsLocked();
+}
+
+PTPPortState NetworkEngine::GetPTPDomainState(uint8_t domain) const {
+    const PTPClient* client = PTPClientForDomain(domain);
+    return client ? client->GetPortState() : PTPPortState::Listening;
+}
+
+PTPStatsSnapshot NetworkEngine::GetPTPDomainStats(uint8_t domain, double windowSec) const {
+    const PTPClient* client = PTPClientForDomain(domain);
+    return client ? client->GetStats(windowSec) : PTPStatsSnapshot{};
+}
+
+bool NetworkEngine::SetStreamPTPDomain(uint32_t streamIdx, uint8_t domain) {
+    if (streamIdx >= 8) return false;
+    const PTPClient* client = PTPClientForDomain(domain);
+    if (!client) {
+        std::cerr << "NetworkEngine: PTP domain " << static_cast<int>(domain) << " is not tracked (AddPTPDomain)\n";
+        return false;
+    }
+    // The reader re-anchors its cursor on the new timeline by itself
+    rxClockSet_[streamIdx].store(client, std::memory_order_release);
+    rxClock_[streamIdx].store(client, std::memory_order_release);
+    return true;
+}
+
+bool NetworkEngine::SetStreamRefClock(uint32_t streamIdx, const std::string& refClock) {
+    uint8_t domain = 0;
+    if (!SDPParser::ParsePTPDomain(refClock, domain)) {
+        std::cerr << "NetworkEngine: ts-refclk " << refClock << " is not a PTP clock\n";
+        return false;
+    }
+    return SetStreamPTPDomain(streamIdx, domain);
+}
+
+uint8_t NetworkEngine::GetStreamPTPDomain(uint32_t streamIdx) const {
+    if (streamIdx >= 8) return ptpClient_->GetDomain();
+    return rxClock_[streamIdx].load(std::memory_order_acquire)->GetDomain();
+}
+
 double NetworkEngine::GetPTPOffset() const {
     return ptpClient_->GetOffsetNs();
 }
@@ -181,196 +388,673 @@ void NetworkEngine::SetCallbacks(const EngineCallbacks& callbacks) {
     });
 }
 
-AudioRingBuffer* NetworkEngine::GetInputRingBuffer(uint32_t streamIdx) {
-    if (streamIdx >= 8) return nullptr;
-    return inputRings_[streamIdx].get();
-}
-
 AudioRingBuffer* NetworkEngine::GetOutputRingBuffer(uint32_t streamIdx) {
     if (streamIdx >= 8) return nullptr;
     return outputRings_[streamIdx].get();
 }
 
 void NetworkEngine::NotifyIOCycle(uint64_t hostTime, uint64_t sampleTime) {
-    (void)hostTime;
-    (void)sampleTime;
-    // TODO: Use for precise timestamp alignment
+    const uint64_t mediaNow = PTPNsToMediaSamples(HostTimeToPTP(hostTime));
+    
+    // Publish device timeline anchor for TX threads (seqlock write side)
+    const uint32_t seq = ioAnchorSeq_.load(std::memory_order_relaxed);
+    ioAnchorSeq_.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    ioSampleTime_.store(sampleTime, std::memory_order_relaxed);
+    ioMediaOffset_.store(mediaNow - sampleTime, std::memory_order_relaxed);
+    for (uint32_t i = 0; i < 8; ++i) {
+        ioOutputWriteIndex_[i].store(outputRings_[i]->WriteIndex(), std::memory_order_relaxed);
+    }
+    ioAnchorSeq_.store(seq + 2, std::memory_order_release);
+}
+
+uint32_t NetworkEngine::ReadInputFrames(uint32_t streamIdx, uint64_t ptpTimeNs,
+                                        int32_t* buffer, uint32_t frames) {
+    if (streamIdx >= 8 || !buffer || frames == 0) return 0;
+    
+    auto& state = rxPlayout_[streamIdx];
+    auto& jitterBuffer = *rxJitterBuffers_[streamIdx];
+    
+    // A stream on another domain plays by that domain's media clock: device
+    // (main domain) time -> host time -> stream domain time
+    const PTPClient* clock = rxClock_[streamIdx].load(std::memory_order_acquire);
+    const uint64_t streamTimeNs = clock == ptpClient_.get()
+        ? ptpTimeNs : clock->HostTimeToPTP(ptpClient_->PTPToHostTime(ptpTimeNs));
+    const uint32_t mediaNow = static_cast<uint32_t>(PTPNsToMediaSamples(streamTimeNs));
+    
+    // Start each resampling run from a clean filter/controller state
+    const bool wantResampling = rxResampleEnabled_[streamIdx].load(std::memory_order_relaxed);
+    if (wantResampling != state.resampling) {
+        rxResamplers_[streamIdx]->Reset();
+        rxDriftControllers_[streamIdx]->Reset();
+        state.resampling = wantResampling;
+        state.active = false;
+    }
+    
+    uint32_t found = 0;
+    if (state.resampling) {
+        found = ReadResampled(streamIdx, state, buffer, frames);
+    } else {
+        // Sender shares our PTP clock: play media time "now - common delay", the
+        // same for every stream. The cursor free-runs between reads and only
+        // re-anchors on real jumps.
+        const uint32_t want = mediaNow - UpdatePlayoutDelay(ptpTimeNs);
+        const int32_t error = static_cast<int32_t>(want - state.cursor);
+        if (!state.active || error > kCursorToleranceFrames || error < -kCursorToleranceFrames) {
+            state.cursor = want;
+            state.active = true;
+        }
+        
+        found = jitterBuffer.Read(state.cursor, buffer, frames);
+        state.cursor += frames;
+    }
+    
+    if (found > 0) {
+        state.lastFoundNs = ptpTimeNs;
+    }
+    
+    // A resampled stream's cursor runs on the sender's RTP timeline, not our
+    // media clock: it has no latency or alignment against it to report
+    if (state.resampling) {
+        inputLatencyNs_[streamIdx].store(0, std::memory_order_relaxed);
+        alignmentErrorNs_[streamIdx].store(0, std::memory_order_relaxed);
+        return found;
+    }
+    
+    // Media time of the first frame handed to the device this read
+    const uint32_t headRtp = state.cursor - frames;
+    const int32_t lagFrames = static_cast<int32_t>(mediaNow - headRtp);
+    inputLatencyNs_[streamIdx].store(MediaFramesToNs(lagFrames), std::memory_order_relaxed);
+    
+    const int32_t delayFrames = static_cast<int32_t>(playoutDelayFrames_.load(std::memory_order_relaxed));
+    alignmentErrorNs_[streamIdx].store(MediaFramesToNs(lagFrames - delayFrames), std::memory_order_relaxed);
+    
+    return found;
+}
+
+uint32_t NetworkEngine::UpdatePlayoutDelay(uint64_t ptpTimeNs) {
+    // All streams of one I/O cycle are read at the same time; compute once per cycle
+    if (ptpTimeNs == playoutDelayTimeNs_) {
+        return playoutDelayFrames_.load(std::memory_order_relaxed);
+    }
+    playoutDelayTimeNs_ = ptpTimeNs;
+    
+    uint32_t delay = config_.playoutDelayFrames;
+    if (delay == 0) {
+        // Deepest target among PTP-locked streams that are receiving, so the
+        // most jittery stream sets the pace and none of them underruns
+        for (uint32_t i = 0; i < 8; ++i) {
+            if (rxPlayout_[i].resampling) continue;
+            
+            uint32_t newestEnd = 0;
+            uint64_t newestArrival = 0;
+            const bool receiving = rxJitterBuffers_[i]->GetNewestPacket(newestEnd, newestArrival) ||
+                                   ptpTimeNs - rxPlayout_[i].lastFoundNs < kStreamIdleNs;
+            if (receiving) {
+                delay = std::max(delay, rxJitterBuffers_[i]->GetTargetDelayFrames());
+            }
+        }
+    }
+    
+    playoutDelayFrames_.store(delay, std::memory_order_relaxed);
+    return delay;
+}
+
+uint32_t NetworkEngine::ReadResampled(uint32_t streamIdx, RxPlayoutState& state,
+                                      int32_t* buffer, uint32_t frames) {
+    auto& jitterBuffer = *rxJitterBuffers_[streamIdx];
+    auto& resampler = *rxResamplers_[streamIdx];
+    auto& drift = *rxDriftControllers_[streamIdx];
+    
+    // Sender clock is foreign: the cursor runs at the sender's rate and the ratio
+    // holds the audio queued ahead of it at the jitter buffer's target delay
+    uint32_t newestEnd = 0;
+    uint64_t newestArrival = 0;
+    const uint32_t targetFrames = jitterBuffer.GetTargetDelayFrames();
+    if (jitterBuffer.GetNewestPacket(newestEnd, newestArrival)) {
+        if (newestEnd != state.lastNewestEnd) {
+            drift.OnPacket(newestEnd, newestArrival);
+            state.lastNewestEnd = newestEnd;
+        }
+        
+        const int32_t fill = static_cast<int32_t>(newestEnd - state.cursor);
+        if (!state.active || fill < 0 || fill > static_cast<int32_t>(4 * targetFrames + frames)) {
+            state.cursor = newestEnd - targetFrames;
+            state.active = true;
+        }
+        resampler.SetRatio(drift.Update(fill, targetFrames));
+    }
+    rxRateEstimate_[streamIdx].store(drift.GetRateEstimate(), std::memory_order_relaxed);
+    
+    // Pull just enough input to produce the requested frames
+    int32_t input[8 * kResampleChunkFrames];
+    uint32_t found = 0;
+    uint32_t produced = resampler.Process(input, 0, buffer, frames);
+    for (uint32_t pass = 0; produced < frames && pass < frames / kResampleChunkFrames + 4; ++pass) {
+        const uint32_t chunk = std::min(kResampleChunkFrames, frames - produced + 1);
+        found += jitterBuffer.Read(state.cursor, input, chunk);
+        state.cursor += chunk;
+        produced += resampler.Process(input, chunk, buffer + produced * kChannelsPerStream,
+                                      frames - produced);
+    }
+    
+    // Filter warm-up after a reset
+    if (produced < frames) {
+        std::memset(buffer + produced * kChannelsPerStream, 0,
+                    (frames - produced) * kChannelsPerStream * sizeof(int32_t));
+    }
+    
+    return std::min(found, frames);
+}
+
+uint32_t NetworkEngine::PeekInputFrames(uint32_t streamIdx, int32_t* buffer, uint32_t frames) const {
+    if (streamIdx >= 8 || !buffer || frames == 0) return 0;
+    return rxJitterBuffers_[streamIdx]->PeekNewest(buffer, frames);
+}
+
+int64_t NetworkEngine::GetInputLatencyNs(uint32_t streamIdx) const {
+    if (streamIdx >= 8) return 0;
+    return inputLatencyNs_[streamIdx].load(std::memory_order_relaxed);
+}
+
+int64_t NetworkEngine::GetOutputLatencyNs(uint32_t streamIdx) const {
+    if (streamIdx >= 8) return 0;
+    return outputLatencyNs_[streamIdx].load(std::memory_order_relaxed);
+}
+
+void NetworkEngine::SetStreamResampling(uint32_t streamIdx, bool enabled) {
+    if (streamIdx >= 8) return;
+    rxResampleEnabled_[streamIdx].store(enabled, std::memory_order_relaxed);
+}
+
+bool NetworkEngine::IsStreamResampling(uint32_t streamIdx) const {
+    if (streamIdx >= 8) return false;
+    return rxResampleEnabled_[streamIdx].load(std::memory_order_relaxed);
+}
+
+int64_t NetworkEngine::GetPlayoutDelayNs() const {
+    return MediaFramesToNs(playoutDelayFrames_.load(std::memory_order_relaxed));
+}
+
+int64_t NetworkEngine::GetAlignmentErrorNs(uint32_t streamIdx) const {
+    if (streamIdx >= 8) return 0;
+    return alignmentErrorNs_[streamIdx].load(std::memory_order_relaxed);
+}
+
+double NetworkEngine::GetStreamRateEstimate(uint32_t streamIdx) const {
+    if (streamIdx >= 8) return 1.0;
+    return rxRateEstimate_[streamIdx].load(std::memory_order_relaxed);
+}
+
+bool NetworkEngine::LoadIOCycleAnchor(IOCycleAnchor& out) const {
+    // Seqlock read side: retry while NotifyIOCycle is mid-update
+    for (int attempt = 0; attempt < 4; ++attempt) {
+        const uint32_t seq1 = ioAnchorSeq_.load(std::memory_order_acquire);
+        if (seq1 == 0) {
+            return false; // No I/O cycle seen yet
+        }
+        if (seq1 & 1) {
+            continue;
+        }
+        
+        out.sampleTime = ioSampleTime_.load(std::memory_order_relaxed);
+        out.mediaOffset = ioMediaOffset_.load(std::memory_order_relaxed);
+        for (uint32_t i = 0; i < 8; ++i) {
+            out.outputWriteIndex[i] = ioOutputWriteIndex_[i].load(std::memory_order_relaxed);
+        }
+        
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (ioAnchorSeq_.load(std::memory_order_relaxed) == seq1) {
+            return true;
+        }
+    }
+    return false;
+}
+
+uint32_t NetworkEngine::AlignTxTimestamp(uint32_t streamIdx, uint32_t safetyOffsetFrames, uint64_t ptpNowNs) {
+    auto& packetizer = *txPacketizers_[streamIdx];
+    
+    IOCycleAnchor anchor;
+    if (!LoadIOCycleAnchor(anchor)) {
+        return packetizer.GetTimestamp(); // Not driven by a device: free-run
+    }
+    
+    // Samples between ring head and the anchored write position. Negative when the
+    // device has already written past the anchor during the current cycle.
+    auto* ring = outputRings_[streamIdx].get();
+    const int64_t capacity = static_cast<int64_t>(ring->Capacity());
+    int64_t pending = static_cast<int64_t>(
+        (anchor.outputWriteIndex[streamIdx] - ring->ReadIndex()) & (ring->Capacity() - 1));
+    if (pending > capacity / 2) {
+        pending -= capacity;
+    }
+    
+    // Device sample time of the frame at the ring head -> RTP media time
+    const uint64_t headSample = anchor.sampleTime - pending / kChannelsPerStream;
+    const uint32_t headMedia = static_cast<uint32_t>(headSample + anchor.mediaOffset);
+    const uint32_t target = headMedia + safetyOffsetFrames;
+    
+    // Re-anchor on real discontinuities only; ±1 frame is host time rounding
+    const int32_t error = static_cast<int32_t>(target - packetizer.GetTimestamp());
+    if (error > 1 || error < -1) {
+        packetizer.SetTimestamp(target);
+    }
+    
+    const uint32_t mediaNow = static_cast<uint32_t>(PTPNsToMediaSamples(ptpNowNs));
+    outputLatencyNs_[streamIdx].store(
+        MediaFramesToNs(static_cast<int32_t>(mediaNow - headMedia)), std::memory_order_relaxed);
+    
+    return packetizer.GetTimestamp();
+}
+
+std::shared_ptr<const DiscoverySnapshot> NetworkEngine::GetDiscoverySnapshot() const {
+    return discoverySnapshot_.Load();
 }
 
 std::vector<std::string> NetworkEngine::GetDiscoveredStreamNames() const {
-    std::lock_guard<std::mutex> lock(discoveryMutex_);
+    const auto snapshot = discoverySnapshot_.Load();
     std::vector<std::string> names;
-    names.reserve(discoveredStreams_.size());
+    names.reserve(snapshot->sessions.size());
     
-    for (const auto& pair : discoveredStreams_) {
-        names.push_back(pair.first);
+    // Already sorted by name
+    for (const auto& stream : snapshot->sessions) {
+        if (names.empty() || names.back() != stream->name) {
+            names.push_back(stream->name);
+        }
     }
     
     return names;
 }
 
 bool NetworkEngine::GetDiscoveredStream(const std::string& name, SDPSession& outSession) const {
-    std::lock_guard<std::mutex> lock(discoveryMutex_);
-    auto it = discoveredStreams_.find(name);
+    const auto snapshot = discoverySnapshot_.Load();
+    const DiscoveredSession* stream = snapshot->Find(name);
     
-    if (it != discoveredStreams_.end()) {
-        outSession = it->second;
+    if (stream) {
+        outSession = stream->session;
         return true;
     }
     
     return false;
 }
 
-void NetworkEngine::RTPReceiveThread(uint32_t streamIdx) {
-    fprintf(stderr, "RTPReceiveThread[%u]: Starting...\n", streamIdx);
-    fflush(stderr);
+std::vector<std::string> NetworkEngine::GetDiscoveredStreamsForGroup(const std::string& multicastAddr) const {
+    const auto snapshot = discoverySnapshot_.Load();
+    std::vector<std::string> names;
     
-    // Create UDP socket
-    const int sock = socket(AF_INET, SOCK_DGRAM, 0);
-    if (sock < 0) {
-        fprintf(stderr, "RTPReceiveThread[%u]: Failed to create socket\n", streamIdx);
-        fflush(stderr);
-        return;
+    for (const auto& stream : snapshot->sessions) {
+        for (const SDPMedia& media : stream->session.media) {
+            if (media.connectionAddr == multicastAddr) {
+                names.push_back(stream->name);
+                break;
+            }
+        }
     }
-    fprintf(stderr, "RTPReceiveThread[%u]: Socket created\n", streamIdx);
-    fflush(stderr);
-    
-    // Set socket options for multicast
-    int reuse = 1;
-    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
-    #ifdef SO_REUSEPORT
-    setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, &reuse, sizeof(reuse));
-    #endif
     
-    // Set receive buffer size for low latency
-    int recvBufSize = 256 * 1024; // 256KB
-    setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &recvBufSize, sizeof(recvBufSize));
+    return names;
+}
+
+bool NetworkEngine::Subscribe(uint32_t streamIdx, const RxSubscription& subscription) {
+    if (streamIdx >= 8) return false;
+    in_addr addr{};
+    if (inet_pton(AF_INET, subscription.address.c_str(), &addr) != 1 || subscription.port == 0 ||
+        subscription.channels == 0 || subscription.channels > kChannelsPerStream ||
+        (subscription.bytesPerSample != 2 && subscription.bytesPerSample != 3)) {
+        std::cerr << "NetworkEngine: invalid RX subscription for stream " << streamIdx << "\n";
+        return false;
+    }
+    return SetSubscription(streamIdx, &subscription, false, 0);
+}
+
+bool NetworkEngine::SubscribeDiscovered(uint32_t streamIdx, const std::string& name) {
+    if (streamIdx >= 8) return false;
+    const auto snapshot = discoverySnapshot_.Load();
+    const DiscoveredSession* stream = snapshot->Find(name);
+    if (!stream) {
+        std::cerr << "NetworkEngine: no discovered stream named " << name << "\n";
+        return false;
+    }
+    RxSubscription subscription;
+    if (!RxSubscriptionFromSDP(stream->session, subscription)) {
+        std::cerr << "NetworkEngine: " << name << " is not a 48 kHz L24/L16 stream of 1-8 channels\n";
+        return false;
+    }
+    subscription.sdpOrigin = stream->sdpOrigin;
+    return SetSubscription(streamIdx, &subscription, false, stream->payloadHash);
+}
+
+void NetworkEngine::Unsubscribe(uint32_t streamIdx) {
+    if (streamIdx >= 8) return;
+    SetSubscription(streamIdx, nullptr, false, 0);
+}
+
+bool NetworkEngine::GetSubscription(uint32_t streamIdx, RxSubscription& out) const {
+    if (streamIdx >= 8) return false;
+    std::lock_guard<std::mutex> lock(rxSlots_[streamIdx].mutex);
+    out = rxSlots_[streamIdx].subscription;
+    return rxSlots_[streamIdx].subscribed;
+}
+
+void NetworkEngine::AddAutoSubscribeRule(const AutoSubscribeRule& rule) {
+    {
+        std::lock_guard<std::mutex> lock(autoSubscribeMutex_);
+        autoSubscribeRules_.push_back(rule);
+    }
+    // Streams already discovered count too
+    ApplyAutoSubscribe(*discoverySnapshot_.Load());
+}
+
+void NetworkEngine::ClearAutoSubscribeRules() {
+    std::lock_guard<std::mutex> lock(autoSubscribeMutex_);
+    autoSubscribeRules_.clear();
+}
+
+bool NetworkEngine::SetSubscription(uint32_t streamIdx, const RxSubscription* subscription,
+                                    bool automatic, uint64_t payloadHash) {
+    // The stream's clock follows its ts-refclk when we track that domain;
+    // otherwise (no ts-refclk, untracked, unsubscribed) the one set with
+    // SetStreamPTPDomain(), else the main domain
+    const PTPClient* client = rxClockSet_[streamIdx].load(std::memory_order_acquire);
+    if (!client) {
+        client = ptpClient_.get();
+    }
+    if (subscription && !subscription->refClock.empty()) {
+        uint8_t domain = 0;
+        const PTPClient* tracked = SDPParser::ParsePTPDomain(subscription->refClock, domain)
+            ? PTPClientForDomain(domain) : nullptr;
+        if (tracked) {
+            client = tracked;
+        } else {
+            std::cerr << "NetworkEngine: stream " << streamIdx << " clock " << subscription->refClock
+                      << " is not tracked, using domain " << static_cast<int>(client->GetDomain()) << "\n";
+        }
+    }
+    rxClock_[streamIdx].store(client, std::memory_order_release);
     
-    // Set socket priority for real-time audio (SO_PRIORITY is Linux-specific)
-    #ifdef __linux__
-    int priority = 6; // Real-time priority
-    setsockopt(sock, SOL_SOCKET, SO_PRIORITY, &priority, sizeof(priority));
-    #endif
+    RxSlot& slot = rxSlots_[streamIdx];
+    {
+        std::lock_guard<std::mutex> lock(slot.mutex);
+        slot.automatic = automatic && subscription;
+        slot.payloadHash = payloadHash;
+        const bool unchanged = subscription
+            ? slot.subscribed && slot.subscription == *subscription
+            : !slot.subscribed;
+        if (unchanged) {
+            return true;
+        }
+        if (subscription) {
+            slot.subscription = *subscription;
+        }
+        slot.subscribed = subscription != nullptr;
+    }
+    {
+        std::lock_guard<std::mutex> lock(rxWakeMutex_);
+        rxGeneration_.fetch_add(1, std::memory_order_release);
+    }
+    rxChanged_.notify_all();
+    return true;
+}
+
+void NetworkEngine::ApplyAutoSubscribe(const DiscoverySnapshot& snapshot) {
+    std::lock_guard<std::mutex> rulesLock(autoSubscribeMutex_);
     
-    // Set DSCP for QoS (EF = 46 for expedited forwarding)
-    int dscp = 46 << 2; // DSCP is in top 6 bits of TOS byte
-    setsockopt(sock, IPPROTO_IP, IP_TOS, &dscp, sizeof(dscp));
+    auto findByOrigin = [&](const std::string& sdpOrigin) -> const DiscoveredSession* {
+        for (const auto& stream : snapshot.sessions) {
+            if (stream->sdpOrigin == sdpOrigin) return stream.get();
+        }
+        return nullptr;
+    };
     
-    // Bind to port 5006 (avoiding macOS MIDIServer on ports 5004 and 5005)
-    // Bind to INADDR_ANY so all 8 receive threads can share the port
-    sockaddr_in addr{};
-    addr.sin_family = AF_INET;
-    addr.sin_addr.s_addr = INADDR_ANY;
-    addr.sin_port = htons(5006);
+    // Auto subscriptions follow their session: retuned when it changes,
+    // released when it is deleted or expires
+    std::array<std::string, 8> taken;       // sdpOrigin per subscribed slot
+    std::array<bool, 8> free{};
+    for (uint32_t i = 0; i < 8; ++i) {
+        RxSubscription current;
+        bool automatic = false;
+        uint64_t payloadHash = 0;
+        {
+            std::lock_guard<std::mutex> lock(rxSlots_[i].mutex);
+            free[i] = !rxSlots_[i].subscribed;
+            current = rxSlots_[i].subscription;
+            automatic = rxSlots_[i].automatic;
+            payloadHash = rxSlots_[i].payloadHash;
+        }
+        if (free[i]) continue;
+        taken[i] = current.sdpOrigin;
+        if (!automatic) continue;
+        
+        const DiscoveredSession* stream = findByOrigin(current.sdpOrigin);
+        RxSubscription next;
+        if (stream && stream->payloadHash == payloadHash) {
+            continue;
+        }
+        if (stream && RxSubscriptionFromSDP(stream->session, next)) {
+            next.sdpOrigin = stream->sdpOrigin;
+            SetSubscription(i, &next, true, stream->payloadHash);
+        } else {
+            SetSubscription(i, nullptr, false, 0);
+            free[i] = true;
+            taken[i].clear();
+        }
+    }
     
-    if (bind(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
-        perror("RTPReceiveThread bind failed");
-        close(sock);
+    // New sessions matching a rule take the rule's slot or the first free one
+    for (const auto& stream : snapshot.sessions) {
+        if (std::find(taken.begin(), taken.end(), stream->sdpOrigin) != taken.end()) continue;
+        
+        for (const AutoSubscribeRule& rule : autoSubscribeRules_) {
+            if (!MatchesAutoSubscribeRule(rule, *stream)) continue;
+            
+            int slot = rule.streamIdx;
+            if (slot < 0) {
+                const auto it = std::find(free.begin(), free.end(), true);
+                slot = it != free.end() ? static_cast<int>(it - free.begin()) : -1;
+            }
+            RxSubscription subscription;
+            if (slot >= 0 && slot < 8 && free[slot] && RxSubscriptionFromSDP(stream->session, subscription)) {
+                subscription.sdpOrigin = stream->sdpOrigin;
+                SetSubscription(static_cast<uint32_t>(slot), &subscription, true, stream->payloadHash);
+                fprintf(stderr, "NetworkEngine: auto-subscribed stream %d to %s\n", slot, stream->name.c_str());
+                free[slot] = false;
+                taken[slot] = stream->sdpOrigin;
+            }
+            break;      // First matching rule decides
+        }
+    }
+}
+
+bool NetworkEngine::SetQoSProfile(const std::string& name) {
+    QoSProfile profile;
+    {
+        std::lock_guard<std::mutex> lock(qosMutex_);
+        const auto it = std::find_if(qosProfiles_.begin(), qosProfiles_.end(),
+                                     [&](const QoSProfile& p) { return p.name == name; });
+        if (it == qosProfiles_.end()) {
+            std::cerr << "NetworkEngine: no QoS profile named " << name << "\n";
+            return false;
+        }
+        profile = *it;
+    }
+    return ApplyQoSProfile(profile);
+}
+
+bool NetworkEngine::ApplyQoSProfile(const QoSProfile& profile) {
+    std::string error;
+    if (!profile.Validate(error)) {
+        std::cerr << "NetworkEngine: QoS profile " << profile.name << ": " << error << "\n";
+        return false;
+    }
+    // Output rings and jitter buffer stores are allocated once, at construction
+    if (RingFramesFor(profile) * kChannelsPerStream > outputRings_[0]->Capacity() ||
+        profile.jitterBufferPacketsMax > rxJitterBuffers_[0]->GetCapacityPackets()) {
+        std::cerr << "NetworkEngine: QoS profile " << profile.name
+                  << " needs larger buffers than were allocated at construction\n";
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(qosMutex_);
+    QoSSettings next = *qos_.Load();
+    next.profile = profile;
+    PublishQoS(next);
+    return true;
+}
+
+void NetworkEngine::SetNetworkQoS(const NetworkQoS& network) {
+    std::lock_guard<std::mutex> lock(qosMutex_);
+    QoSSettings next = *qos_.Load();
+    next.network = network;
+    PublishQoS(next);
+}
+
+QoSProfile NetworkEngine::GetQoSProfile() const {
+    return qos_.Load()->profile;
+}
+
+std::vector<std::string> NetworkEngine::GetQoSProfileNames() const {
+    std::lock_guard<std::mutex> lock(qosMutex_);
+    std::vector<std::string> names;
+    for (const QoSProfile& profile : qosProfiles_) {
+        names.push_back(profile.name);
+    }
+    return names;
+}
+
+// Caller holds qosMutex_
+void NetworkEngine::PublishQoS(const QoSSettings& next) {
+    const auto current = qos_.Load();
+    const QoSProfile& was = current->profile;
+    const QoSProfile& profile = next.profile;
+    if (profile == was && next.network == current->network) {
         return;
     }
     
-    // Join multicast group (239.69.2.x for RX)
-    ip_mreq mreq{};
-    const std::string mcastAddr = "239.69.2." + std::to_string(streamIdx + 1);
-    inet_pton(AF_INET, mcastAddr.c_str(), &mreq.imr_multiaddr);
-    mreq.imr_interface.s_addr = INADDR_ANY;
-    
-    if (setsockopt(sock, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0) {
-        char error_msg[256];
-        snprintf(error_msg, sizeof(error_msg), "RTPReceiveThread: Failed to join multicast group %s", mcastAddr.c_str());
-        perror(error_msg);
-        close(sock);
-        return;
+    // Applied here: jitter buffers keep their audio, PTP sockets their port
+    if (profile.jitterBufferPacketsMin != was.jitterBufferPacketsMin ||
+        profile.jitterBufferPacketsMax != was.jitterBufferPacketsMax) {
+        for (auto& jitterBuffer : rxJitterBuffers_) {
+            jitterBuffer->SetDepthLimits(profile.jitterBufferPacketsMin, profile.jitterBufferPacketsMax);
+        }
+    }
+    if (profile.ptpDscp != was.ptpDscp) {
+        ptpTransport_->SetDscp(profile.ptpDscp);
+    }
+    if (profile.ptpLogSyncInterval != was.ptpLogSyncInterval) {
+        config_.ptpLogSyncInterval = profile.ptpLogSyncInterval;
+        if (running_) {
+            std::cerr << "NetworkEngine: PTP sync interval takes effect at the next Start()\n";
+        }
+    }
+    if (profile.ptpDomain != was.ptpDomain && profile.ptpDomain != ptpClient_->GetDomain()) {
+        std::cerr << "NetworkEngine: PTP domain is fixed once created, staying on domain "
+                  << static_cast<int>(ptpClient_->GetDomain()) << "\n";
     }
     
-    fprintf(stderr, "RTPReceiveThread[%u]: Joined multicast group %s on port 5006\n", streamIdx, mcastAddr.c_str());
-    fflush(stderr);
+    // The RX and TX threads pick up the rest on their next pass
+    qos_.Publish(std::make_shared<const QoSSettings>(next));
+    qosGeneration_.fetch_add(1, std::memory_order_release);
+    
+    // Receivers learn the new packet time from the SDP
+    if (profile.packetTimeUs != was.packetTimeUs && running_ && config_.sapAnnounce) {
+        sapAnnouncer_->UpdateStreams(TxStreamDescriptions(profile.packetTimeUs));
+    }
+    if (profile.name != was.name) {
+        fprintf(stderr, "NetworkEngine: QoS profile %s\n", profile.name.empty() ? "(built-in)" : profile.name.c_str());
+    }
+}
+
+void NetworkEngine::RTPReceiveThread() {
+    RTPReceiver receiver;
+    std::array<RxSubscription, 8> active;
+    std::array<bool, 8> subscribed{};
+    std::array<RxSourceFilter, 8> sourceFilters;
+    std::array<uint32_t, 8> packetCounts{};
+    std::array<uint32_t, 8> filteredCounts{};
+    uint32_t applied = rxGeneration_.load(std::memory_order_acquire) - 1;  // Apply on entry
+    uint32_t qosApplied = qosGeneration_.load(std::memory_order_acquire) - 1;
     
     uint8_t packetBuf[1500];
-    uint32_t packetCount = 0;
+    int32_t sampleBuf[kChannelsPerStream * kMaxRxPacketFrames];
     
     while (running_) {
-        const ssize_t bytes = recv(sock, packetBuf, sizeof(packetBuf), 0);
+        // QoS switch: socket options only, every socket and group stays
+        const uint32_t qosGeneration = qosGeneration_.load(std::memory_order_acquire);
+        if (qosGeneration != qosApplied) {
+            qosApplied = qosGeneration;
+            const auto qos = qos_.Load();
+            receiver.SetSocketOptions(qos->network.udpRecvBufferSize, qos->profile.rtpDscp);
+        }
+        
+        // Retune: only slots whose subscription changed are reset, and the
+        // receiver only joins or leaves the groups that changed
+        const uint32_t generation = rxGeneration_.load(std::memory_order_acquire);
+        if (generation != applied) {
+            applied = generation;
+            std::array<const RxSubscription*, 8> wanted{};
+            for (uint32_t i = 0; i < 8; ++i) {
+                RxSubscription next;
+                bool nextSubscribed = false;
+                {
+                    std::lock_guard<std::mutex> lock(rxSlots_[i].mutex);
+                    next = rxSlots_[i].subscription;
+                    nextSubscribed = rxSlots_[i].subscribed;
+                }
+                if (nextSubscribed && (!subscribed[i] || !(next == active[i]))) {
+                    if (!sourceFilters[i].Set(next)) {
+                        fprintf(stderr, "RTPReceiveThread[%u]: Ignoring non-IPv4 source-filter\n", i);
+                    }
+                    rxDepacketizers_[i]->Configure(next.channels, next.payloadType, next.bytesPerSample);
+                    rxJitterBuffers_[i]->Reset();
+                    packetCounts[i] = 0;
+                    filteredCounts[i] = 0;
+                    active[i] = next;
+                }
+                subscribed[i] = nextSubscribed;
+                wanted[i] = nextSubscribed ? &active[i] : nullptr;
+            }
+            receiver.Apply(wanted, ptpTransport_->GetInterfaceAddr());
+        }
+        
+        if (receiver.GetSocketCount() == 0) {
+            std::unique_lock<std::mutex> lock(rxWakeMutex_);
+            rxChanged_.wait_for(lock, std::chrono::milliseconds(100), [&] {
+                return !running_ || rxGeneration_.load(std::memory_order_acquire) != applied;
+            });
+            continue;
+        }
+        
+        RxPacketInfo info;
+        const ssize_t bytes = receiver.Receive(packetBuf, sizeof(packetBuf), 100, info);
         if (bytes <= 0) continue;
+        const uint32_t streamIdx = info.slot;
         
-        packetCount++;
+        // Stray senders on a shared group never reach the depacketizer
+        if (!sourceFilters[streamIdx].Accepts(info.sourceAddr)) {
+            filteredCounts[streamIdx]++;
+            continue;
+        }
+        
+        RTPDepacketizer& depacketizer = *rxDepacketizers_[streamIdx];
+        const uint32_t packetCount = ++packetCounts[streamIdx];
         if (packetCount % 1000 == 0) {
-            fprintf(stderr, "RTPReceiveThread[%u]: Received %u packets (%zd bytes last)\n", 
-                    streamIdx, packetCount, bytes);
+            fprintf(stderr, "RTPReceiveThread[%u]: Received %u packets (%zd bytes last, %u filtered, %u foreign SSRC)\n", 
+                    streamIdx, packetCount, bytes, filteredCounts[streamIdx], depacketizer.GetForeignPacketCount());
             fflush(stderr);
         }
         
-        // Depacketize into temporary buffer
-        int32_t sampleBuf[8 * 64]; // Max 64 frames @ 8 channels
-        const uint32_t frames = rxDepacketizers_[streamIdx]->ParsePacket(
-            packetBuf, bytes, sampleBuf);
+        // Depacketize into temporary buffer (8 channels wide)
+        const uint32_t frames = depacketizer.ParsePacket(
+            packetBuf, static_cast<size_t>(bytes), sampleBuf, kMaxRxPacketFrames);
         
         if (frames > 0) {
-            // Get current PTP time and RTP timestamp
-            const uint64_t arrivalTime = ptpClient_->GetPTPTimeNs();
-            const uint32_t rtpTimestamp = rxDepacketizers_[streamIdx]->GetLastTimestamp();
+            // Get current PTP time (stream's domain) and RTP timestamp
+            const uint64_t arrivalTime = rxClock_[streamIdx].load(std::memory_order_acquire)->GetPTPTimeNs();
+            const uint32_t rtpTimestamp = depacketizer.GetLastTimestamp();
             
             // Insert into jitter buffer (buffer takes ownership via copy)
             rxJitterBuffers_[streamIdx]->Insert(rtpTimestamp, arrivalTime, 
                                                  sampleBuf, frames);
         }
     }
-    
-    close(sock);
-}
-
-void NetworkEngine::JitterBufferPlayoutThread(uint32_t streamIdx) {
-    std::cout << "JitterBufferPlayoutThread[" << streamIdx << "]: Starting..." << std::endl;
-    fprintf(stderr, "JitterBufferPlayoutThread[%u]: Starting...\n", streamIdx);
-    fflush(stderr);
-    
-    // Buffer for playout
-    int32_t playoutBuf[8 * 64]; // Max 64 frames @ 8 channels
-    uint32_t writeCount = 0;
-    
-    std::cout << "JitterBufferPlayoutThread[" << streamIdx << "]: Entering main loop, running_=" << running_ << std::endl;
-    
-    while (running_) {
-        // Get current PTP time (or use system time if PTP not available)
-        uint64_t ptpTimeNs = ptpClient_->GetPTPTimeNs();
-        if (ptpTimeNs == 0) {
-            // PTP not locked - use system time as fallback
-            struct timespec ts;
-            clock_gettime(CLOCK_REALTIME, &ts);
-            ptpTimeNs = (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
-        }
-        
-        // Try to get next packet for playout
-        const auto* packet = rxJitterBuffers_[streamIdx]->GetNextPacket(ptpTimeNs);
-        
-        if (packet) {
-            // Copy samples to playout buffer
-            const size_t sampleCount = packet->frameCount * 8; // 8 channels per stream
-            std::memcpy(playoutBuf, packet->samples.data(), sampleCount * sizeof(int32_t));
-            
-            // Write to ring buffer for driver to consume (samples not frames)
-            inputRings_[streamIdx]->Write(playoutBuf, sampleCount);
-            
-            writeCount++;
-            if (writeCount % 1000 == 0) {
-                fprintf(stderr, "JitterBufferPlayoutThread[%u]: Wrote %u packets to ring buffer (%u frames last)\n",
-                        streamIdx, writeCount, packet->frameCount);
-                fflush(stderr);
-            }
-            
-            // Release packet back to jitter buffer
-            rxJitterBuffers_[streamIdx]->ReleasePacket(packet);
-        } else {
-            // Underrun - write silence
-            const uint32_t silenceFrames = 6; // 125µs @ 48kHz
-            const size_t silenceSamples = silenceFrames * 8;
-            std::memset(playoutBuf, 0, silenceSamples * sizeof(int32_t));
-            inputRings_[streamIdx]->Write(playoutBuf, silenceSamples);
-        }
-        
-        // Sleep for packet time (match config_.packetTimeUs)
-        usleep(config_.packetTimeUs);
-    }
 }
 
 void NetworkEngine::RTPTransmitThread(uint32_t streamIdx) {
@@ -378,24 +1062,12 @@ void NetworkEngine::RTPTransmitThread(uint32_t streamIdx) {
     const int sock = socket(AF_INET, SOCK_DGRAM, 0);
     if (sock < 0) return;
     
-    // Set send buffer size for low latency
-    int sendBufSize = 256 * 1024; // 256KB
-    setsockopt(sock, SOL_SOCKET, SO_SNDBUF, &sendBufSize, sizeof(sendBufSize));
-    
     // Set socket priority for real-time audio (SO_PRIORITY is Linux-specific)
     #ifdef __linux__
     int priority = 6; // Real-time priority
     setsockopt(sock, SOL_SOCKET, SO_PRIORITY, &priority, sizeof(priority));
     #endif
     
-    // Set DSCP for QoS (EF = 46 for expedited forwarding)
-    int dscp = 46 << 2; // DSCP is in top 6 bits of TOS byte
-    setsockopt(sock, IPPROTO_IP, IP_TOS, &dscp, sizeof(dscp));
-    
-    // Set multicast TTL
-    int ttl = 32;
-    setsockopt(sock, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
-    
     // Destination address (239.69.1.x for TX)
     sockaddr_in destAddr{};
     destAddr.sin_family = AF_INET;
@@ -403,18 +1075,32 @@ void NetworkEngine::RTPTransmitThread(uint32_t streamIdx) {
     const std::string mcastAddr = "239.69.1." + std::to_string(streamIdx + 1);
     inet_pton(AF_INET, mcastAddr.c_str(), &destAddr.sin_addr);
     
-    // Calculate frames per packet based on packet time
-    const uint32_t framesPerPacket = (config_.packetTimeUs * 48000) / 1000000;
     int32_t sampleBuf[8 * 64]; // Max 64 frames @ 8 channels
+    std::shared_ptr<const QoSSettings> qos;
+    uint32_t framesPerPacket = 0;
+    uint32_t qosApplied = qosGeneration_.load(std::memory_order_acquire) - 1;
     
     while (running_) {
-        // Read from output ring
-        const size_t framesRead = outputRings_[streamIdx]->Read(sampleBuf, framesPerPacket);
+        // QoS switch: new packet time, offset and socket options on the same socket
+        const uint32_t qosGeneration = qosGeneration_.load(std::memory_order_acquire);
+        if (qosGeneration != qosApplied) {
+            qosApplied = qosGeneration;
+            qos = qos_.Load();
+            ApplyTxSocketOptions(sock, qos->network, qos->profile.rtpDscp);
+            framesPerPacket = PacketFrames(qos->profile.packetTimeUs);
+        }
+        
+        // Stamp with device sample time + safety offset (before the read moves the head)
+        AlignTxTimestamp(streamIdx, qos->profile.TxSafetyOffsetFrames(), ptpClient_->GetPTPTimeNs());
+        
+        // Read from output ring (samples, 8 channels per frame)
+        const size_t framesRead = outputRings_[streamIdx]->Read(
+            sampleBuf, framesPerPacket * kChannelsPerStream) / kChannelsPerStream;
         
         if (framesRead > 0) {
             // Packetize
             const auto packet = txPacketizers_[streamIdx]->CreatePacket(
-                sampleBuf, framesRead);
+                sampleBuf, static_cast<uint32_t>(framesRead));
             
             if (!packet.empty()) {
                 // Send
@@ -424,7 +1110,7 @@ void NetworkEngine::RTPTransmitThread(uint32_t streamIdx) {
         }
         
         // Sleep for packet time
-        usleep(config_.packetTimeUs);
+        usleep(qos->profile.packetTimeUs);
     }
     
     close(sock);
@@ -460,76 +1146,47 @@ void NetworkEngine::SAPDiscoveryThread() {
     setsockopt(sock, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq));
     
     uint8_t buffer[2048];
+    SAPPacket packet;
+    uint64_t lastExpireNs = HostClock::NowNs();
+    uint64_t lastPublishNs = 0;
+    uint64_t publishedGeneration = discovery_.GetGeneration();
     
     while (running_) {
-        // Set receive timeout so we can check running_ periodically
+        // Short receive timeout: checks running_ and flushes pending changes
         timeval timeout{};
-        timeout.tv_sec = 1;
-        timeout.tv_usec = 0;
+        timeout.tv_sec = 0;
+        timeout.tv_usec = 100000;
         setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
         
         const ssize_t bytes = recv(sock, buffer, sizeof(buffer), 0);
-        if (bytes <= 0) continue;
-        
-        // Parse SAP header (minimum 8 bytes)
-        if (bytes < 8) continue;
+        const uint64_t nowNs = HostClock::NowNs();
         
-        const uint8_t version = (buffer[0] >> 5) & 0x7;
-        const bool isAnnouncement = (buffer[0] & 0x04) == 0; // A bit (deletion if set)
-        
-        if (version != 1 || !isAnnouncement) continue;
-        
-        // Skip SAP header to get SDP payload
-        // SAP header: V(3) A(1) R(1) T(1) E(1) C(1) + auth_len(1) + msg_id_hash(2) + origin(4) [+ auth_data]
-        size_t sdpOffset = 8; // Minimum SAP header size
-        
-        const uint8_t authLen = buffer[1];
-        sdpOffset += authLen * 4; // Auth data is in 32-bit words
-        
-        if (sdpOffset >= static_cast<size_t>(bytes)) continue;
+        // Unchanged re-announcements only refresh their entry; the SDP is
+        // parsed when a session is new or has changed
+        if (bytes > 0 && ParseSAPPacket(buffer, static_cast<size_t>(bytes), packet)) {
+            discovery_.OnPacket(packet, nowNs);
+        }
         
-        // Extract SDP
-        const std::string sdp(reinterpret_cast<const char*>(buffer + sdpOffset), 
-                             bytes - sdpOffset);
+        // Timeouts are an hour or more: a scan per second is plenty
+        if (nowNs - lastExpireNs >= 1000000000ULL) {
+            discovery_.Expire(nowNs);
+            lastExpireNs = nowNs;
+        }
         
-        try {
-            // Parse SDP
-            const SDPSession session = SDPParser::Parse(sdp);
-            
-            // Create unique stream name from origin
-            const std::string streamName = session.sessionName.empty() 
-                ? session.origin 
-                : session.sessionName;
-            
-            // Notify about discovered stream
-            OnStreamDiscovered(streamName, session);
-            
-        } catch (...) {
-            // Ignore malformed SDP
+        // Readers see a new snapshot only when something changed, at most
+        // every 100 ms so a burst of new sessions is one publish
+        if (discovery_.GetGeneration() != publishedGeneration && nowNs - lastPublishNs >= 100000000ULL) {
+            const auto snapshot = discovery_.Snapshot();
+            discoverySnapshot_.Publish(snapshot);
+            publishedGeneration = discovery_.GetGeneration();
+            lastPublishNs = nowNs;
+            ApplyAutoSubscribe(*snapshot);
         }
     }
     
     close(sock);
 }
 
-void NetworkEngine::OnStreamDiscovered(const std::string& streamName, const SDPSession& sdp) {
-    std::lock_guard<std::mutex> lock(discoveryMutex_);
-    
-    // Check if this is a new stream or an update
-    auto it = discoveredStreams_.find(streamName);
-    const bool isNew = (it == discoveredStreams_.end());
-    
-    // Store/update stream info
-    discoveredStreams_[streamName] = sdp;
-    
-    // Log discovery (in production, this could trigger UI updates or auto-subscription)
-    if (isNew) {
-        // New stream discovered
-        // TODO: Notify callback or log
-        // For now, streams are stored and can be queried via a future API
-    }
-}
-
 } // namespace AES67
 
 // C interface implementation
@@ -0,0 +1,141 @@
+// PTPBMCA.cpp - IEEE 1588 Best Master Clock Algorithm
+// SPDX-License-Identifier: MIT
+
+#include "PTPBMCA.h"
+#include <cstring>
+
+namespace AES67 {
+namespace {
+
+constexpr size_t kAnnounceLength = 64;
+
+uint16_t ReadUint16(const uint8_t* buffer) {
+    return static_cast<uint16_t>(buffer[0] << 8 | buffer[1]);
+}
+
+int CompareIdentity(const ClockIdentity& a, const ClockIdentity& b) {
+    return std::memcmp(a.id, b.id, sizeof(a.id));
+}
+
+int CompareValues(unsigned a, unsigned b) {
+    return a < b ? -1 : (a > b ? 1 : 0);
+}
+
+} // namespace
+
+const char* PTPPortStateName(PTPPortState state) {
+    switch (state) {
+        case PTPPortState::Master: return "master";
+        case PTPPortState::Slave: return "slave";
+        default: return "listening";
+    }
+}
+
+bool ParsePTPAnnounce(const uint8_t* buffer, size_t length, PTPClockDataset& dataset, int8_t& logInterval) {
+    if (length < kAnnounceLength ||
+        (buffer[0] & 0x0F) != static_cast<uint8_t>(PTPMessageType::Announce)) {
+        return false;
+    }
+
+    std::memcpy(dataset.senderIdentity.id, buffer + 20, sizeof(dataset.senderIdentity.id));
+    dataset.senderPort = ReadUint16(buffer + 28);
+    logInterval = static_cast<int8_t>(buffer[33]);
+
+    dataset.priority1 = buffer[47];
+    dataset.clockClass = buffer[48];
+    dataset.clockAccuracy = buffer[49];
+    dataset.offsetScaledLogVariance = ReadUint16(buffer + 50);
+    dataset.priority2 = buffer[52];
+    std::memcpy(dataset.grandmasterIdentity.id, buffer + 53, sizeof(dataset.grandmasterIdentity.id));
+    dataset.stepsRemoved = ReadUint16(buffer + 61);
+    return true;
+}
+
+int ComparePTPDatasets(const PTPClockDataset& a, const PTPClockDataset& b) {
+    if (CompareIdentity(a.grandmasterIdentity, b.grandmasterIdentity) != 0) {
+        // Different grandmasters: compare their quality (Figure 27)
+        if (int c = CompareValues(a.priority1, b.priority1)) return c;
+        if (int c = CompareValues(a.clockClass, b.clockClass)) return c;
+        if (int c = CompareValues(a.clockAccuracy, b.clockAccuracy)) return c;
+        if (int c = CompareValues(a.offsetScaledLogVariance, b.offsetScaledLogVariance)) return c;
+        if (int c = CompareValues(a.priority2, b.priority2)) return c;
+        return CompareIdentity(a.grandmasterIdentity, b.grandmasterIdentity);
+    }
+
+    // Same grandmaster over different paths: prefer the shorter one (Figure 28)
+    if (int c = CompareValues(a.stepsRemoved, b.stepsRemoved)) return c;
+    if (int c = CompareIdentity(a.senderIdentity, b.senderIdentity)) return c;
+    return CompareValues(a.senderPort, b.senderPort);
+}
+
+PTPPortState DecidePTPPortState(const PTPClockDataset& local, const PTPClockDataset* best, bool slaveOnly) {
+    if (best == nullptr) {
+        return slaveOnly ? PTPPortState::Listening : PTPPortState::Master;
+    }
+    if (!slaveOnly && ComparePTPDatasets(local, *best) < 0) {
+        return PTPPortState::Master;
+    }
+    return PTPPortState::Slave;
+}
+
+void PTPForeignMasterTable::Add(const PTPClockDataset& dataset, int8_t logAnnounceInterval, uint64_t nowNs) {
+    // Announce from a clock that is itself a slave of ours, or looped: not a candidate
+    if (dataset.stepsRemoved >= 255) {
+        return;
+    }
+
+    if (logAnnounceInterval < -3 || logAnnounceInterval > 4) {
+        logAnnounceInterval = 1; // Out of the AES67/default profile range
+    }
+    const uint64_t intervalNs = logAnnounceInterval >= 0
+        ? 1000000000ULL << logAnnounceInterval
+        : 1000000000ULL >> -logAnnounceInterval;
+
+    for (auto& entry : entries_) {
+        if (CompareIdentity(entry.dataset.senderIdentity, dataset.senderIdentity) == 0 &&
+            entry.dataset.senderPort == dataset.senderPort) {
+            entry.dataset = dataset;
+            entry.intervalNs = intervalNs;
+            entry.previousRxNs = entry.lastRxNs;
+            entry.lastRxNs = nowNs;
+            return;
+        }
+    }
+
+    if (entries_.size() >= kMaxForeignMasters) {
+        return;
+    }
+    Entry entry;
+    entry.dataset = dataset;
+    entry.intervalNs = intervalNs;
+    entry.lastRxNs = nowNs;
+    entries_.push_back(entry);
+}
+
+void PTPForeignMasterTable::Expire(uint64_t nowNs) {
+    for (size_t i = 0; i < entries_.size();) {
+        if (nowNs - entries_[i].lastRxNs > kAnnounceReceiptTimeout * entries_[i].intervalNs) {
+            entries_[i] = entries_.back();
+            entries_.pop_back();
+        } else {
+            ++i;
+        }
+    }
+}
+
+bool PTPForeignMasterTable::Qualified(const Entry& entry) const {
+    return entry.previousRxNs != 0 &&
+           entry.lastRxNs - entry.previousRxNs <= kForeignMasterWindow * entry.intervalNs;
+}
+
+const PTPClockDataset* PTPForeignMasterTable::Best() const {
+    const PTPClockDataset* best = nullptr;
+    for (const auto& entry : entries_) {
+        if (Qualified(entry) && (best == nullptr || ComparePTPDatasets(entry.dataset, *best) < 0)) {
+            best = &entry.dataset;
+        }
+    }
+    return best;
+}
+
+} // namespace AES67
@@ -2,179 +2,217 @@
 // SPDX-License-Identifier: MIT
 
 #include "PTPClient.h"
+#include "HostClock.h"
 
+#include <algorithm>
 #include <arpa/inet.h>
 #include <cerrno>
-#include <chrono>
 #include <cmath>
+#include <cstdio>
 #include <cstring>
-#include <fcntl.h>
-#include <ifaddrs.h>
 #include <iostream>
-#include <net/if.h>
-#if defined(__APPLE__)
-#include <net/if_dl.h>
-#endif
-#if defined(__linux__)
-#include <netpacket/packet.h>
-#endif
 #include <sys/socket.h>
 #include <sys/time.h>
 #include <time.h>
-#include <unistd.h>
 
 namespace AES67 {
 namespace {
 
+constexpr uint64_t kMasterTimeoutNs = 5000000000ULL;  // No Sync for 5 s: master lost
+constexpr uint8_t kTwoStepFlag = 0x02;              // flagField octet 0
+constexpr uint64_t kListenTimeoutNs = 3000000000ULL; // Announce receipt timeout at 1 Hz
+constexpr uint8_t kDefaultClockClass = 248;
+constexpr uint8_t kSlaveOnlyClockClass = 255;
+constexpr uint64_t kHousekeepingIntervalNs = 100000000ULL; // BMCA and timeouts, 10 Hz
+constexpr uint64_t kAnnounceIntervalNs = 1000000000ULL;     // logAnnounceInterval 0
+constexpr int8_t kMinLogSyncInterval = -7;                 // 128 Hz
+constexpr int8_t kMaxLogSyncInterval = 0;                  // 1 Hz
+constexpr uint8_t kUnicastFlag = 0x04;                     // flagField octet 0
+constexpr uint32_t kUnicastDurationSec = 60;               // Requested grant duration
+constexpr uint32_t kMaxGrantDurationSec = 300;
+constexpr uint64_t kNegotiationRetryNs = 1000000000ULL;    // Unanswered request
+constexpr uint64_t kDeniedRetryNs = 10000000000ULL;        // Denied request
+constexpr uint64_t kSlaveIdleNs = 10000000000ULL;          // Forget a silent slave
+constexpr size_t kMaxUnicastTLVs = 8;
+constexpr int8_t kLogPdelayInterval = 0;                   // logMinPdelayReqInterval
+constexpr uint64_t kPdelayIntervalNs = 1000000000ULL;
+constexpr uint64_t kPdelayFastIntervalNs = 125000000ULL;   // While a new peer's delay settles
+constexpr uint32_t kPdelayFastSamples = 8;
+constexpr uint32_t kMaxLostPdelay = 3;                     // Unanswered in a row: peer gone
+
+// Negotiable message types, in PTPClient::unicastGrants_ order
+constexpr PTPMessageType kUnicastTypes[] = {
+    PTPMessageType::Announce, PTPMessageType::Sync, PTPMessageType::Delay_Resp};
+
+int UnicastTypeIndex(PTPMessageType type) {
+    for (int i = 0; i < 3; ++i) {
+        if (kUnicastTypes[i] == type) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// 2^logInterval seconds
+uint64_t LogIntervalToNs(int8_t logInterval) {
+    return logInterval >= 0 ? 1000000000ULL << logInterval : 1000000000ULL >> -logInterval;
+}
+
 uint16_t ReadUint16(const uint8_t* buffer) {
     return static_cast<uint16_t>(buffer[0] << 8 | buffer[1]);
 }
 
-// Helper to obtain current system (wall-clock) time in nanoseconds.
-uint64_t GetSystemTimeNsInternal() {
-    struct timespec ts{};
-    if (clock_gettime(CLOCK_REALTIME, &ts) != 0) {
-        return 0;
+// 48-bit seconds + 32-bit nanoseconds
+uint64_t ReadTimestamp(const uint8_t* buffer) {
+    uint64_t seconds = 0;
+    for (int i = 0; i < 6; ++i) {
+        seconds = (seconds << 8) | buffer[i];
+    }
+    const uint32_t nanoseconds = static_cast<uint32_t>(buffer[6]) << 24 |
+                                 static_cast<uint32_t>(buffer[7]) << 16 |
+                                 static_cast<uint32_t>(buffer[8]) << 8 |
+                                 static_cast<uint32_t>(buffer[9]);
+    return seconds * 1000000000ULL + nanoseconds;
+}
+
+// correctionField is nanoseconds scaled by 2^16
+int64_t ReadCorrectionNs(const uint8_t* header) {
+    uint64_t raw = 0;
+    for (int i = 0; i < 8; ++i) {
+        raw = (raw << 8) | header[8 + i];
     }
-    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL +
-           static_cast<uint64_t>(ts.tv_nsec);
+    return static_cast<int64_t>(raw) / 65536;
 }
 
 } // namespace
 
 PTPClient::PTPClient(uint8_t domain, Mode mode)
     : domain_(domain)
-    , mode_(mode) {
+    , mode_(mode)
+    , servo_(CreatePTPServo(PTPServoType::LeastSquares)) {
 }
 
 PTPClient::~PTPClient() {
     Stop();
 }
 
-bool PTPClient::Start(const char* interfaceName, Mode mode) {
-    mode_ = mode;
-    if (mode_ == Mode::Master) {
-        return StartMaster(interfaceName);
+bool PTPClient::SetServo(PTPServoType type, const PTPServoConfig& config) {
+    // The servo is owned by the event thread while running
+    if (running_) {
+        std::cerr << "PTPClient: servo can only be changed while stopped\n";
+        return false;
     }
-    return StartSlave(interfaceName);
+    servo_ = CreatePTPServo(type, config);
+    servoStarted_ = false;
+    return true;
 }
 
-bool PTPClient::StartSlave(const char* interfaceName) {
+bool PTPClient::SetPriority(uint8_t priority1, uint8_t priority2) {
     if (running_) {
-        return true;
-    }
-
-    (void)interfaceName; // TODO: Bind to specific interface
-
-    socketEvent_ = socket(AF_INET, SOCK_DGRAM, 0);
-    if (socketEvent_ < 0) {
+        std::cerr << "PTPClient: priority can only be changed while stopped\n";
         return false;
     }
+    localDataset_.priority1 = priority1;
+    localDataset_.priority2 = priority2;
+    return true;
+}
 
-    socketGeneral_ = socket(AF_INET, SOCK_DGRAM, 0);
-    if (socketGeneral_ < 0) {
-        CloseSockets();
+bool PTPClient::SetSyncInterval(int8_t logSyncInterval) {
+    if (running_) {
+        std::cerr << "PTPClient: sync interval can only be changed while stopped\n";
         return false;
     }
-
-    int reuse = 1;
-    setsockopt(socketEvent_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
-    setsockopt(socketGeneral_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
-
-    sockaddr_in addrEvent{};
-    addrEvent.sin_family = AF_INET;
-    addrEvent.sin_addr.s_addr = INADDR_ANY;
-    addrEvent.sin_port = htons(kPTP_Event_Port);
-
-    if (bind(socketEvent_, reinterpret_cast<sockaddr*>(&addrEvent), sizeof(addrEvent)) < 0) {
-        CloseSockets();
+    if (logSyncInterval < kMinLogSyncInterval || logSyncInterval > kMaxLogSyncInterval) {
+        std::cerr << "PTPClient: logSyncInterval " << static_cast<int>(logSyncInterval) << " out of range\n";
         return false;
     }
+    logSyncInterval_ = logSyncInterval;
+    return true;
+}
 
-    sockaddr_in addrGeneral{};
-    addrGeneral.sin_family = AF_INET;
-    addrGeneral.sin_addr.s_addr = INADDR_ANY;
-    addrGeneral.sin_port = htons(kPTP_General_Port);
-
-    if (bind(socketGeneral_, reinterpret_cast<sockaddr*>(&addrGeneral), sizeof(addrGeneral)) < 0) {
-        CloseSockets();
+bool PTPClient::SetHybrid(bool enable) {
+    if (running_) {
+        std::cerr << "PTPClient: hybrid mode can only be changed while stopped\n";
         return false;
     }
-
-    ip_mreq mreq{};
-    inet_pton(AF_INET, kPTP_IPv4_MulticastAddr, &mreq.imr_multiaddr);
-    mreq.imr_interface.s_addr = INADDR_ANY;
-
-    setsockopt(socketEvent_, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq));
-    setsockopt(socketGeneral_, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq));
-
-    fcntl(socketEvent_, F_SETFL, O_NONBLOCK);
-    fcntl(socketGeneral_, F_SETFL, O_NONBLOCK);
-
-    affineAnchorHost_ = GetSystemTimeNsInternal();
-    affineAnchorPTP_ = 0;
-
-    running_ = true;
-    receiveThread_ = std::thread(&PTPClient::ReceiveThread, this);
+    hybrid_ = enable;
     return true;
 }
 
-bool PTPClient::StartMaster(const char* interfaceName) {
-    if (masterRunning_) {
+bool PTPClient::SetUnicastMaster(const std::string& address) {
+    if (running_) {
+        std::cerr << "PTPClient: unicast master can only be changed while stopped\n";
+        return false;
+    }
+    if (address.empty()) {
+        unicastEnabled_ = false;
         return true;
     }
-
-    if (!InitializeInterface(interfaceName)) {
-        std::cerr << "PTPClient: failed to resolve interface " << interfaceName << " for PTP master\n";
+    in_addr addr{};
+    if (inet_pton(AF_INET, address.c_str(), &addr) != 1) {
+        std::cerr << "PTPClient: invalid unicast master address " << address << "\n";
         return false;
     }
+    unicastMaster_ = addr;
+    unicastEnabled_ = true;
+    return true;
+}
 
-    socketEvent_ = socket(AF_INET, SOCK_DGRAM, 0);
-    if (socketEvent_ < 0) {
-        std::cerr << "PTPClient: failed to create event socket: " << std::strerror(errno) << "\n";
+bool PTPClient::SetDelayMechanism(DelayMechanism mechanism) {
+    if (running_) {
+        std::cerr << "PTPClient: delay mechanism can only be changed while stopped\n";
         return false;
     }
+    delayMechanism_ = mechanism;
+    return true;
+}
 
-    socketGeneral_ = socket(AF_INET, SOCK_DGRAM, 0);
-    if (socketGeneral_ < 0) {
-        std::cerr << "PTPClient: failed to create general socket: " << std::strerror(errno) << "\n";
-        CloseSockets();
+bool PTPClient::Start(const char* interfaceName, Mode mode) {
+    if (running_) {
+        return true;
+    }
+    ownTransport_ = std::make_unique<PTPTransport>();
+    if (!ownTransport_->Open(interfaceName)) {
+        ownTransport_.reset();
         return false;
     }
-
-    int reuse = 1;
-    setsockopt(socketEvent_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
-    setsockopt(socketGeneral_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
-
-    sockaddr_in addrEvent{};
-    addrEvent.sin_family = AF_INET;
-    addrEvent.sin_addr.s_addr = INADDR_ANY;
-    addrEvent.sin_port = htons(kPTP_Event_Port);
-    if (bind(socketEvent_, reinterpret_cast<sockaddr*>(&addrEvent), sizeof(addrEvent)) < 0) {
-        std::cerr << "PTPClient: failed to bind event socket to port 319: " << std::strerror(errno) << "\n";
-        CloseSockets();
+    if (!Start(*ownTransport_, mode) || !ownTransport_->Start()) {
+        ownTransport_->Stop();
+        ownTransport_.reset();
         return false;
     }
+    return true;
+}
 
-    sockaddr_in addrGeneral{};
-    addrGeneral.sin_family = AF_INET;
-    addrGeneral.sin_addr.s_addr = INADDR_ANY;
-    addrGeneral.sin_port = htons(kPTP_General_Port);
-    if (bind(socketGeneral_, reinterpret_cast<sockaddr*>(&addrGeneral), sizeof(addrGeneral)) < 0) {
-        std::cerr << "PTPClient: failed to bind general socket to port 320: " << std::strerror(errno) << "\n";
-        CloseSockets();
+bool PTPClient::Start(PTPTransport& transport, Mode mode) {
+    if (running_) {
+        return true;
+    }
+    if (!transport.Attach(this)) {
         return false;
     }
+    mode_ = mode;
 
-    fcntl(socketEvent_, F_SETFL, O_NONBLOCK);
-    fcntl(socketGeneral_, F_SETFL, O_NONBLOCK);
-
-    uint8_t ttl = 1;
-    setsockopt(socketEvent_, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
-    setsockopt(socketGeneral_, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
-
-    setsockopt(socketEvent_, IPPROTO_IP, IP_MULTICAST_IF, &interfaceAddr_, sizeof(interfaceAddr_));
-    setsockopt(socketGeneral_, IPPROTO_IP, IP_MULTICAST_IF, &interfaceAddr_, sizeof(interfaceAddr_));
+    // Six timers per domain on the shared loop
+    PTPEventLoop& loop = transport.Loop();
+    syncTimer_ = loop.AddTimer();
+    announceTimer_ = loop.AddTimer();
+    housekeepingTimer_ = loop.AddTimer();
+    unicastTimer_ = loop.AddTimer();
+    negotiationTimer_ = loop.AddTimer();
+    pdelayTimer_ = loop.AddTimer();
+    if (syncTimer_ < 0 || announceTimer_ < 0 || housekeepingTimer_ < 0 || unicastTimer_ < 0 ||
+        negotiationTimer_ < 0 || pdelayTimer_ < 0) {
+        std::cerr << "PTPClient: no event loop timers left for domain " << static_cast<int>(domain_) << "\n";
+        transport.Detach(this);
+        return false;
+    }
+    transport_ = &transport;
+    clockIdentity_ = transport.GetClockIdentity();
+    timestampMode_ = transport.GetTimestampMode();
+    if (delayMechanism_ == DelayMechanism::P2P) {
+        transport.JoinPdelayGroup();
+    }
 
     std::memset(&eventDestAddr_, 0, sizeof(eventDestAddr_));
     eventDestAddr_.sin_family = AF_INET;
@@ -186,342 +224,940 @@ bool PTPClient::StartMaster(const char* interfaceName) {
     generalDestAddr_.sin_port = htons(kPTP_General_Port);
     inet_pton(AF_INET, kPTP_IPv4_MulticastAddr, &generalDestAddr_.sin_addr);
 
+    pdelayEventAddr_ = eventDestAddr_;
+    inet_pton(AF_INET, kPTP_IPv4_PdelayMulticastAddr, &pdelayEventAddr_.sin_addr);
+    pdelayGeneralAddr_ = generalDestAddr_;
+    inet_pton(AF_INET, kPTP_IPv4_PdelayMulticastAddr, &pdelayGeneralAddr_.sin_addr);
+
+    // Our own default dataset, as announced when we are grandmaster
+    localDataset_.clockClass = mode_ == Mode::Slave ? kSlaveOnlyClockClass : kDefaultClockClass;
+    localDataset_.grandmasterIdentity = clockIdentity_;
+    localDataset_.stepsRemoved = 0;
+    localDataset_.senderIdentity = clockIdentity_;
+    localDataset_.senderPort = portNumber_;
+
+    foreignMasters_.Clear();
+    slaveTable_.Clear();
+    slaveCount_ = 0;
+    for (auto& grant : unicastGrants_) {
+        grant = {};
+    }
+    haveMaster_ = false;
+    ResetSlaveState(false);
+    ResetPeer();
+    stats_.Reset();
+    pdelayPending_ = false;
+    pdelayLost_ = 0;
+    multiplePeersWarned_ = false;
     syncSequenceId_ = 0;
     announceSequenceId_ = 0;
+    offsetNs_ = 0.0;
 
-    const uint64_t nowNs = GetSystemTimeNs();
-    affineAnchorHost_ = nowNs;
-    affineAnchorPTP_ = nowNs;
-    affineSlopeA_ = 1.0;
-    affineOffsetB_ = 0.0;
+    // Free-run on the raw host clock from wall-clock time until a master is selected
+    timeMap_.Publish({1.0, GetHostTimeNs(), HostClock::RealtimeNowNs()});
     rateRatio_ = 1.0;
-    offsetNs_ = 0.0;
 
     running_ = true;
-    masterRunning_ = true;
-    locked_ = true;
-
-    if (statusCallback_) {
-        statusCallback_(true, 0.0);
+    if (mode_ == Mode::Master) {
+        SetPortState(PTPPortState::Master); // Forced grandmaster, no BMCA
+    } else {
+        // Hear out the network for a full announce receipt timeout before claiming grandmaster
+        portState_ = PTPPortState::Listening;
+        listenUntilNs_ = GetHostTimeNs() + kListenTimeoutNs;
+    }
+    loop.ArmTimer(housekeepingTimer_, GetHostTimeNs() + kHousekeepingIntervalNs);
+    if (unicastEnabled_) {
+        loop.ArmTimer(negotiationTimer_, GetHostTimeNs());
+    }
+    if (delayMechanism_ == DelayMechanism::P2P) {
+        loop.ArmTimer(pdelayTimer_, GetHostTimeNs());
     }
-
-    masterSendThread_ = std::thread(&PTPClient::MasterSendThread, this);
-    masterEventThread_ = std::thread(&PTPClient::MasterEventThread, this);
     return true;
 }
 
 void PTPClient::Stop() {
-    if (mode_ == Mode::Master) {
-        if (!masterRunning_) {
-            return;
-        }
+    if (!running_) {
+        return;
+    }
+    // The transport calls OnTransportStopped() on every domain it carries
+    transport_->Stop();
+    ownTransport_.reset();
+}
+
+void PTPClient::OnTransportStopped() {
+    // Release the unicast service we were granted
+    if (unicastEnabled_) {
+        CancelUnicast();
+    }
+
+    running_ = false;
+    transport_ = nullptr;
+    portState_ = PTPPortState::Listening;
+    locked_ = false;
+}
 
-        masterRunning_ = false;
-        running_ = false;
+uint64_t PTPClient::GetPTPTimeNs() const {
+    if (portState_.load(std::memory_order_relaxed) != PTPPortState::Master &&
+        !locked_.load(std::memory_order_relaxed)) {
+        return 0;
+    }
+
+    return timeMap_.HostToPTP(HostClock::NowNs());
+}
+
+uint64_t PTPClient::HostTimeToPTP(uint64_t hostTime) const {
+    return timeMap_.HostToPTP(hostTime);
+}
+
+uint64_t PTPClient::PTPToHostTime(uint64_t ptpTimeNs) const {
+    return timeMap_.PTPToHost(ptpTimeNs);
+}
 
-        if (masterSendThread_.joinable()) {
-            masterSendThread_.join();
+void PTPClient::ServeTimers(uint32_t timers, uint64_t nowNs) {
+    if (timers & (1u << housekeepingTimer_)) {
+        // Master announces but sent no Sync: drop it until BMCA picks it again
+        if (haveMaster_ && nowNs > lastSyncRxNs_ + kMasterTimeoutNs) {
+            std::cerr << "PTPClient: master timed out\n";
+            SetPortState(PTPPortState::Listening);
         }
-        if (masterEventThread_.joinable()) {
-            masterEventThread_.join();
+        RunBMCA(nowNs);
+        if (portState_ == PTPPortState::Master) {
+            slaveTable_.Expire(nowNs, kSlaveIdleNs);
+            slaveCount_ = slaveTable_.Size();
         }
+        transport_->Loop().ArmTimer(housekeepingTimer_, nowNs + kHousekeepingIntervalNs);
+    }
+    if (timers & (1u << negotiationTimer_)) {
+        NegotiateUnicast(nowNs);
+    }
+    if (timers & (1u << pdelayTimer_)) {
+        SendPdelayReq(nowNs);
+    }
 
-        CloseSockets();
-        locked_ = false;
+    if (portState_ == PTPPortState::Master) {
+        ServeMasterTimers(timers, nowNs);
+    }
+}
+
+void PTPClient::ServeMasterTimers(uint32_t timers, uint64_t nowNs) {
+    if (timers & (1u << syncTimer_)) {
+        SendSync(eventDestAddr_, generalDestAddr_, syncSequenceId_++, logSyncInterval_, 0);
+        nextSyncNs_ = NextDeadline(nextSyncNs_, LogIntervalToNs(logSyncInterval_), nowNs);
+        transport_->Loop().ArmTimer(syncTimer_, nextSyncNs_);
+    }
+    if (timers & (1u << announceTimer_)) {
+        QueueAnnounce(generalDestAddr_, announceSequenceId_++, 0, 0);
+        nextAnnounceNs_ = NextDeadline(nextAnnounceNs_, kAnnounceIntervalNs, nowNs);
+        transport_->Loop().ArmTimer(announceTimer_, nextAnnounceNs_);
+    }
+    if (timers & (1u << unicastTimer_)) {
+        ServeUnicast(nowNs);
+    }
+}
+
+void PTPClient::HandleEventMessage(const uint8_t* buffer, size_t length, uint64_t rxTimeNs,
+                                    const sockaddr_in& srcAddr) {
+    const uint8_t messageType = buffer[0] & 0x0F;
+    const PTPPortState state = portState_.load();
+    const bool p2p = delayMechanism_ == DelayMechanism::P2P;
+    if (messageType == static_cast<uint8_t>(PTPMessageType::Sync) && state == PTPPortState::Slave) {
+        HandleSync(buffer, length, rxTimeNs, srcAddr);
+    } else if (messageType == static_cast<uint8_t>(PTPMessageType::Delay_Req) &&
+               state == PTPPortState::Master && !p2p) {
+        HandleDelayReq(buffer, length, rxTimeNs, srcAddr);
+    } else if (messageType == static_cast<uint8_t>(PTPMessageType::Pdelay_Req) && p2p) {
+        HandlePdelayReq(buffer, length, rxTimeNs);
+    } else if (messageType == static_cast<uint8_t>(PTPMessageType::Pdelay_Resp) && p2p) {
+        HandlePdelayResp(buffer, length, rxTimeNs);
+    }
+}
+
+bool PTPClient::HandleGeneralMessage(const uint8_t* buffer, size_t length, const sockaddr_in& srcAddr) {
+    const uint8_t messageType = buffer[0] & 0x0F;
+    if (messageType == static_cast<uint8_t>(PTPMessageType::Announce)) {
+        HandleAnnounce(buffer, length);
+        return true;
+    }
+    if (messageType == static_cast<uint8_t>(PTPMessageType::Signaling)) {
+        HandleSignaling(buffer, length, srcAddr);
+    } else if (messageType == static_cast<uint8_t>(PTPMessageType::Pdelay_Resp_Follow_Up)) {
+        HandlePdelayRespFollowUp(buffer, length);
+    } else if (portState_ != PTPPortState::Slave) {
+        return false;
+    } else if (messageType == static_cast<uint8_t>(PTPMessageType::Follow_Up)) {
+        HandleFollowUp(buffer, length);
+    } else if (messageType == static_cast<uint8_t>(PTPMessageType::Delay_Resp)) {
+        HandleDelayResp(buffer, length);
+    }
+    return false;
+}
+
+uint64_t PTPClient::NextDeadline(uint64_t previousNs, uint64_t intervalNs, uint64_t nowNs) {
+    // Keep the cadence; after a stall, restart from now instead of bursting
+    const uint64_t next = previousNs + intervalNs;
+    return next > nowNs ? next : nowNs + intervalNs;
+}
+
+bool PTPClient::IsFromMaster(const uint8_t* buffer) {
+    return std::memcmp(buffer + 20, masterIdentity_.id, sizeof(masterIdentity_.id)) == 0 &&
+           ReadUint16(buffer + 28) == masterPortId_;
+}
+
+void PTPClient::HandleSync(const uint8_t* buffer, size_t length, uint64_t rxTimeNs,
+                           const sockaddr_in& srcAddr) {
+    if (length < 44) {
         return;
     }
 
-    if (!running_) {
+    // Only the master chosen by BMCA
+    if (!haveMaster_ || !IsFromMaster(buffer)) {
+        return;
+    }
+    // With unicast Sync granted, the multicast stream (own sequenceIds) is ignored
+    const uint8_t unicast = buffer[6] & kUnicastFlag;
+    if (!unicast && unicastEnabled_ &&
+        unicastGrants_[UnicastTypeIndex(PTPMessageType::Sync)].Active(rxTimeNs)) {
         return;
     }
 
-    running_ = false;
+    lastSyncRxNs_ = rxTimeNs;
+    masterAddr_ = srcAddr.sin_addr;     // Hybrid / unicast Delay_Req destination
+    syncSeq_ = ReadUint16(buffer + 30);
+    syncUnicast_ = unicast;
+    syncT2_ = static_cast<int64_t>(rxTimeNs);
+    syncCorrection_ = ReadCorrectionNs(buffer);
 
-    if (receiveThread_.joinable()) {
-        receiveThread_.join();
+    if (buffer[6] & kTwoStepFlag) {
+        // Precise origin time follows in Follow_Up
+        syncPending_ = true;
+        return;
     }
 
-    CloseSockets();
-    locked_ = false;
+    syncT1_ = static_cast<int64_t>(ReadTimestamp(buffer + 34)) + syncCorrection_;
+    syncPending_ = false;
+    ProcessSyncMeasurement();
 }
 
-uint64_t PTPClient::GetPTPTimeNs() const {
-    if (mode_ == Mode::Master) {
-        return GetSystemTimeNs();
+void PTPClient::HandleFollowUp(const uint8_t* buffer, size_t length) {
+    if (length < 44 || !haveMaster_ || !IsFromMaster(buffer)) {
+        return;
+    }
+    if (!syncPending_ || ReadUint16(buffer + 30) != syncSeq_ || (buffer[6] & kUnicastFlag) != syncUnicast_) {
+        return; // Follow_Up for a Sync we missed
     }
 
-    if (!locked_) {
-        return 0;
+    syncT1_ = static_cast<int64_t>(ReadTimestamp(buffer + 34)) + syncCorrection_ + ReadCorrectionNs(buffer);
+    syncPending_ = false;
+    ProcessSyncMeasurement();
+}
+
+void PTPClient::HandleDelayResp(const uint8_t* buffer, size_t length) {
+    if (length < 54 || !haveMaster_ || !IsFromMaster(buffer) || !delayReqPending_) {
+        return;
+    }
+
+    // Must answer our own outstanding Delay_Req
+    if (std::memcmp(buffer + 44, clockIdentity_.id, sizeof(clockIdentity_.id)) != 0 ||
+        ReadUint16(buffer + 52) != portNumber_ ||
+        ReadUint16(buffer + 30) != delayReqSeq_) {
+        return;
     }
+    delayReqPending_ = false;
 
-    const uint64_t hostTime = GetSystemTimeNs();
-    return HostTimeToPTP(hostTime);
+    delayExchange_.t4 = static_cast<int64_t>(ReadTimestamp(buffer + 34)) - ReadCorrectionNs(buffer);
+
+    // logMinDelayReqInterval from the master
+    const int8_t logInterval = static_cast<int8_t>(buffer[33]);
+    if (logInterval >= -7 && logInterval <= 6) {
+        delayReqIntervalNs_ = LogIntervalToNs(logInterval);
+    }
+
+    filter_.AddPathDelay(delayExchange_.MeanPathDelay());
+    meanPathDelayNs_ = static_cast<double>(filter_.GetMeanPathDelayNs());
+    rejectedSamples_ = filter_.GetRejectedCount();
 }
 
-uint64_t PTPClient::HostTimeToPTP(uint64_t hostTime) const {
-    if (mode_ == Mode::Master) {
-        return hostTime;
+void PTPClient::ProcessSyncMeasurement() {
+    // P2P: t1 carries the upstream link delays and residence times in its
+    // correction, so only the delay of our own link is added
+    const bool p2p = delayMechanism_ == DelayMechanism::P2P;
+    const PTPMeasurementFilter& delay = p2p ? linkFilter_ : filter_;
+    const int64_t syncIntervalNs = lastSyncT2_ != 0 ? syncT2_ - lastSyncT2_ : 0;
+    lastSyncT2_ = syncT2_;
+
+    // Offset needs a path delay; until then only ask for one
+    if (delay.HasPathDelay()) {
+        // Master time at t2 is t1 + path delay; compare with our mapping
+        const int64_t masterAtT2 = syncT1_ + delay.GetMeanPathDelayNs();
+        const int64_t offset = static_cast<int64_t>(HostTimeToPTP(static_cast<uint64_t>(syncT2_))) - masterAtT2;
+
+        const bool accepted = !servoStarted_ || filter_.AcceptOffset(offset);
+        if (accepted) {
+            ServoUpdate(offset, static_cast<uint64_t>(syncT2_));
+        }
+        rejectedSamples_ = filter_.GetRejectedCount();
+
+        PTPStatsSample sample;
+        sample.hostNs = static_cast<uint64_t>(syncT2_);
+        sample.offsetNs = offset;
+        sample.pathDelayNs = delay.GetMeanPathDelayNs();
+        sample.syncIntervalNs = syncIntervalNs;
+        sample.frequencyPpb = (rateRatio_.load() - 1.0) * 1e9;
+        sample.accepted = accepted;
+        stats_.Record(sample);
+    }
+    if (p2p) {
+        return; // Link delay comes from Pdelay, independent of Sync
     }
 
-    const int64_t hostDelta = static_cast<int64_t>(hostTime - affineAnchorHost_);
-    const int64_t ptpDelta = static_cast<int64_t>(affineSlopeA_ * hostDelta);
-    return affineAnchorPTP_ + ptpDelta;
+    // Pair a Delay_Req with this Sync (faster until the first path delay arrives)
+    const uint64_t nowNs = GetHostTimeNs();
+    if (delayReqPending_ && nowNs - delayReqSentNs_ > kMasterTimeoutNs / 5) {
+        delayReqPending_ = false; // Delay_Resp lost
+    }
+    if (!delayReqPending_ && (!filter_.HasPathDelay() || nowNs >= nextDelayReqNs_)) {
+        delayExchange_.t1 = syncT1_;
+        delayExchange_.t2 = syncT2_;
+        SendDelayReq(nowNs);
+    }
 }
 
-uint64_t PTPClient::PTPToHostTime(uint64_t ptpTimeNs) const {
-    if (mode_ == Mode::Master) {
-        return ptpTimeNs;
+void PTPClient::SendDelayReq(uint64_t nowNs) {
+    // Hybrid and unicast slaves ask the master directly instead of the whole group
+    const bool unicast = hybrid_ || unicastEnabled_;
+    sockaddr_in dest = eventDestAddr_;
+    if (unicast) {
+        dest.sin_addr = masterAddr_;
     }
 
-    const int64_t ptpDelta = static_cast<int64_t>(ptpTimeNs - affineAnchorPTP_);
-    const int64_t hostDelta = static_cast<int64_t>(ptpDelta / affineSlopeA_);
-    return affineAnchorHost_ + hostDelta;
+    uint8_t message[44]{};
+    BuildHeader(message, PTPMessageType::Delay_Req, sizeof(message), ++delayReqSeq_, 1, 0x7F,
+                unicast ? static_cast<uint16_t>(kUnicastFlag) << 8 : 0);
+    WriteTimestamp(message + 34, HostTimeToPTP(nowNs));
+
+    uint64_t txTimeNs = 0;
+    if (transport_->SendEvent(message, sizeof(message), dest, txTimeNs) < 0) {
+        std::cerr << "PTPClient: failed to send Delay_Req: " << std::strerror(errno) << "\n";
+        return;
+    }
+
+    delayExchange_.t3 = static_cast<int64_t>(txTimeNs);
+    delayReqSentNs_ = nowNs;
+    delayReqPending_ = true;
+    nextDelayReqNs_ = nowNs + delayReqIntervalNs_;
 }
 
-void PTPClient::ReceiveThread() {
-    uint8_t buffer[1500];
+void PTPClient::SendPdelayReq(uint64_t nowNs) {
+    if (pdelayPending_ && ++pdelayLost_ >= kMaxLostPdelay && havePeer_) {
+        std::cerr << "PTPClient: Pdelay peer lost\n";
+        ResetPeer();
+    }
+
+    uint8_t message[54]{};
+    BuildHeader(message, PTPMessageType::Pdelay_Req, sizeof(message), ++pdelaySeq_, 5, kLogPdelayInterval);
+    WriteTimestamp(message + 34, HostTimeToPTP(nowNs));
+
+    uint64_t txTimeNs = 0;
+    pdelayExchange_ = {};
+    pdelayRespReceived_ = false;
+    pdelayPending_ = transport_->SendEvent(message, sizeof(message), pdelayEventAddr_, txTimeNs) >= 0;
+    if (!pdelayPending_) {
+        std::cerr << "PTPClient: failed to send Pdelay_Req: " << std::strerror(errno) << "\n";
+    }
+    pdelayExchange_.t1 = static_cast<int64_t>(txTimeNs);
 
-    while (running_) {
-        const ssize_t bytesEvent = recv(socketEvent_, buffer, sizeof(buffer), 0);
-        if (bytesEvent > 0) {
-            if (!locked_ && bytesEvent >= static_cast<ssize_t>(sizeof(PTPSyncMessage))) {
-                locked_ = true;
-                offsetNs_ = 0.0;
-                if (statusCallback_) {
-                    statusCallback_(true, 0.0);
-                }
+    // Settle a new peer's link delay quickly, then drop to the profile rate
+    const bool fast = peerSamples_ < kPdelayFastSamples && pdelayLost_ < kMaxLostPdelay;
+    transport_->Loop().ArmTimer(pdelayTimer_, nowNs + (fast ? kPdelayFastIntervalNs : kPdelayIntervalNs));
+}
+
+void PTPClient::HandlePdelayReq(const uint8_t* buffer, size_t length, uint64_t rxTimeNs) {
+    if (length < 54) {
+        return;
+    }
+    PTPPortIdentity requester;
+    std::memcpy(requester.clock.id, buffer + 20, sizeof(requester.clock.id));
+    requester.port = ReadUint16(buffer + 28);
+    if (requester == PTPPortIdentity{clockIdentity_, portNumber_}) {
+        return; // Our own request, looped back
+    }
+    const uint16_t sequenceId = ReadUint16(buffer + 30);
+
+    // Two-step: requestReceiptTimestamp now, responseOriginTimestamp in the Follow_Up
+    uint8_t response[54]{};
+    BuildHeader(response, PTPMessageType::Pdelay_Resp, sizeof(response), sequenceId, 5, 0x7F,
+                static_cast<uint16_t>(kTwoStepFlag) << 8);
+    WriteTimestamp(response + 34, HostTimeToPTP(rxTimeNs));
+    std::memcpy(response + 44, buffer + 20, 10);    // requestingPortIdentity
+
+    uint64_t txTimeNs = 0;
+    if (transport_->SendEvent(response, sizeof(response), pdelayEventAddr_, txTimeNs) < 0) {
+        std::cerr << "PTPClient: failed to send Pdelay_Resp: " << std::strerror(errno) << "\n";
+        return;
+    }
+
+    uint8_t* followUp = transport_->GeneralBatch().Add(pdelayGeneralAddr_, 54);
+    BuildHeader(followUp, PTPMessageType::Pdelay_Resp_Follow_Up, 54, sequenceId, 5, 0x7F);
+    WriteTimestamp(followUp + 34, HostTimeToPTP(txTimeNs));
+    std::memcpy(followUp + 44, buffer + 20, 10);
+}
+
+void PTPClient::HandlePdelayResp(const uint8_t* buffer, size_t length, uint64_t rxTimeNs) {
+    if (length < 54 || ReadUint16(buffer + 30) != pdelaySeq_ ||
+        std::memcmp(buffer + 44, clockIdentity_.id, sizeof(clockIdentity_.id)) != 0 ||
+        ReadUint16(buffer + 52) != portNumber_) {
+        return; // Not an answer to our latest request
+    }
+    PTPPortIdentity responder;
+    std::memcpy(responder.clock.id, buffer + 20, sizeof(responder.clock.id));
+    responder.port = ReadUint16(buffer + 28);
+
+    if (pdelayRespReceived_) {
+        // A second responder: this link has no P2P transparent clock
+        if (!(responder == pdelayResponder_)) {
+            if (!multiplePeersWarned_) {
+                std::cerr << "PTPClient: multiple Pdelay responders on the link\n";
+                multiplePeersWarned_ = true;
             }
+            pdelayPending_ = false;
         }
+        return;
+    }
+    if (!pdelayPending_) {
+        return;
+    }
 
-        const ssize_t bytesGeneral = recv(socketGeneral_, buffer, sizeof(buffer), 0);
-        if (bytesGeneral > 0) {
-            (void)bytesGeneral;
-        }
+    pdelayRespReceived_ = true;
+    pdelayResponder_ = responder;
+    pdelayExchange_.t2 = static_cast<int64_t>(ReadTimestamp(buffer + 34));
+    pdelayExchange_.t4 = static_cast<int64_t>(rxTimeNs);
+    pdelayExchange_.correction = ReadCorrectionNs(buffer);
+    if (!(buffer[6] & kTwoStepFlag)) {
+        // One-step: the turnaround time is in correctionField
+        pdelayExchange_.t3 = pdelayExchange_.t2;
+        CompletePdelay();
+    }
+}
 
-        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+void PTPClient::HandlePdelayRespFollowUp(const uint8_t* buffer, size_t length) {
+    if (length < 54 || !pdelayPending_ || !pdelayRespReceived_ || ReadUint16(buffer + 30) != pdelaySeq_ ||
+        std::memcmp(buffer + 44, clockIdentity_.id, sizeof(clockIdentity_.id)) != 0 ||
+        ReadUint16(buffer + 52) != portNumber_) {
+        return;
+    }
+    PTPPortIdentity responder;
+    std::memcpy(responder.clock.id, buffer + 20, sizeof(responder.clock.id));
+    responder.port = ReadUint16(buffer + 28);
+    if (!(responder == pdelayResponder_)) {
+        return;
     }
+
+    pdelayExchange_.t3 = static_cast<int64_t>(ReadTimestamp(buffer + 34));
+    pdelayExchange_.correction += ReadCorrectionNs(buffer);
+    CompletePdelay();
 }
 
-void PTPClient::ServoUpdate(int64_t offsetNs, uint64_t hostTime) {
-    const double error = static_cast<double>(offsetNs);
-    const double pTerm = kp_ * error;
+void PTPClient::CompletePdelay() {
+    pdelayPending_ = false;
+    pdelayLost_ = 0;
 
-    integrator_ += error;
-    if (integrator_ > 1e9) integrator_ = 1e9;
-    if (integrator_ < -1e9) integrator_ = -1e9;
-    const double iTerm = ki_ * integrator_;
+    // A different peer means the topology changed: measure the new link from scratch
+    if (!havePeer_ || !(peerIdentity_ == pdelayResponder_)) {
+        if (havePeer_) {
+            std::cerr << "PTPClient: Pdelay peer changed\n";
+        }
+        ResetPeer();
+        havePeer_ = true;
+        peerIdentity_ = pdelayResponder_;
+    }
 
-    const double adjustment = pTerm + iTerm;
-    rateRatio_ = 1.0 + (adjustment / 1e9);
+    linkFilter_.AddPathDelay(pdelayExchange_.MeanLinkDelay());
+    peerSamples_++;
+    meanPathDelayNs_ = static_cast<double>(linkFilter_.GetMeanPathDelayNs());
+}
 
-    affineSlopeA_ = rateRatio_.load();
-    affineAnchorHost_ = hostTime;
-    offsetNs_ = error;
+void PTPClient::ResetPeer() {
+    havePeer_ = false;
+    peerSamples_ = 0;
+    linkFilter_.Reset();
+}
 
-    const bool wasLocked = locked_;
-    locked_ = (std::abs(error) < 500.0);
+void PTPClient::HandleAnnounce(const uint8_t* buffer, size_t length) {
+    PTPClockDataset dataset;
+    int8_t logInterval = 0;
+    if (!ParsePTPAnnounce(buffer, length, dataset, logInterval)) {
+        return;
+    }
+    // Our own Announce, looped back by the multicast socket
+    if (std::memcmp(dataset.senderIdentity.id, clockIdentity_.id, sizeof(clockIdentity_.id)) == 0) {
+        return;
+    }
+    foreignMasters_.Add(dataset, logInterval, GetHostTimeNs());
+}
 
-    if (locked_ != wasLocked && statusCallback_) {
-        statusCallback_(locked_, error);
+void PTPClient::RunBMCA(uint64_t nowNs) {
+    if (mode_ == Mode::Master) {
+        return;
+    }
+
+    foreignMasters_.Expire(nowNs);
+    const PTPClockDataset* best = foreignMasters_.Best();
+    const PTPPortState next = DecidePTPPortState(localDataset_, best, mode_ == Mode::Slave);
+    const PTPPortState current = portState_.load();
+
+    if (next == PTPPortState::Slave) {
+        if (current != PTPPortState::Slave || !haveMaster_ ||
+            std::memcmp(best->senderIdentity.id, masterIdentity_.id, sizeof(masterIdentity_.id)) != 0 ||
+            best->senderPort != masterPortId_) {
+            SelectMaster(*best);
+        }
+    } else if (next != current) {
+        if (next == PTPPortState::Master && current == PTPPortState::Listening && nowNs < listenUntilNs_) {
+            return; // Still hearing out the network after start-up
+        }
+        SetPortState(next);
     }
 }
 
-bool PTPClient::InitializeInterface(const char* interfaceName) {
-    bool haveIPv4 = false;
-    bool haveMac = false;
+void PTPClient::SelectMaster(const PTPClockDataset& master) {
+    // Keep time continuous when handing over from our own or another locked timeline
+    const bool continuous = portState_ == PTPPortState::Master || locked_;
+
+    masterIdentity_ = master.senderIdentity;
+    masterPortId_ = master.senderPort;
+    haveMaster_ = true;
+    lastSyncRxNs_ = GetHostTimeNs();
+    ResetSlaveState(continuous);
+
+    char id[24];
+    std::snprintf(id, sizeof(id), "%02x%02x%02x.%02x%02x.%02x%02x%02x",
+                  master.senderIdentity.id[0], master.senderIdentity.id[1], master.senderIdentity.id[2],
+                  master.senderIdentity.id[3], master.senderIdentity.id[4], master.senderIdentity.id[5],
+                  master.senderIdentity.id[6], master.senderIdentity.id[7]);
+    std::cerr << "PTPClient: following master " << id << " (priority1 " << static_cast<int>(master.priority1)
+              << ", class " << static_cast<int>(master.clockClass) << ")\n";
+    SetPortState(PTPPortState::Slave);
+}
 
-    struct ifaddrs* ifaddr = nullptr;
-    if (getifaddrs(&ifaddr) != 0) {
-        return false;
+void PTPClient::SetPortState(PTPPortState state) {
+    const PTPPortState previous = portState_.exchange(state);
+    if (previous != state) {
+        std::cerr << "PTPClient: " << PTPPortStateName(previous) << " -> " << PTPPortStateName(state) << "\n";
     }
 
-    for (auto* ifa = ifaddr; ifa != nullptr; ifa = ifa->ifa_next) {
-        if (!ifa->ifa_addr) {
-            continue;
+    if (state == PTPPortState::Master) {
+        // Start sending right away
+        if (previous != PTPPortState::Master) {
+            nextSyncNs_ = GetHostTimeNs();
+            nextAnnounceNs_ = nextSyncNs_;
+            transport_->Loop().ArmTimer(syncTimer_, nextSyncNs_);
+            transport_->Loop().ArmTimer(announceTimer_, nextAnnounceNs_);
+            transport_->Loop().ArmTimer(unicastTimer_, nextSyncNs_);
         }
 
-        if (std::strcmp(ifa->ifa_name, interfaceName) != 0) {
-            continue;
+        // Free-run from the current mapping; its slope keeps the last frequency estimate
+        haveMaster_ = false;
+        offsetNs_ = 0.0;
+        if (!locked_.exchange(true) && statusCallback_) {
+            statusCallback_(true, 0.0);
         }
+        return;
+    }
 
-        if (ifa->ifa_addr->sa_family == AF_INET) {
-            interfaceAddr_ = reinterpret_cast<sockaddr_in*>(ifa->ifa_addr)->sin_addr;
-            haveIPv4 = true;
-        }
-#if defined(AF_LINK)
-        else if (ifa->ifa_addr->sa_family == AF_LINK) {
-            const auto* sdl = reinterpret_cast<sockaddr_dl*>(ifa->ifa_addr);
-            if (sdl->sdl_alen == 6) {
-                std::memcpy(macAddress_, LLADDR(sdl), 6);
-                haveMac = true;
-            }
-        }
-#endif
-#if defined(AF_PACKET)
-        else if (ifa->ifa_addr->sa_family == AF_PACKET) {
-            const auto* sll = reinterpret_cast<sockaddr_ll*>(ifa->ifa_addr);
-            if (sll->sll_halen == 6) {
-                std::memcpy(macAddress_, sll->sll_addr, 6);
-                haveMac = true;
-            }
+    transport_->Loop().DisarmTimer(syncTimer_);
+    transport_->Loop().DisarmTimer(announceTimer_);
+    transport_->Loop().DisarmTimer(unicastTimer_);
+    if (state == PTPPortState::Listening) {
+        haveMaster_ = false;
+        ResetSlaveState(false);
+        if (locked_.exchange(false) && statusCallback_) {
+            statusCallback_(false, offsetNs_.load());
         }
-#endif
     }
+    // Slave: lock now follows the servo
+}
 
-    freeifaddrs(ifaddr);
+void PTPClient::ResetSlaveState(bool keepTimeline) {
+    syncPending_ = false;
+    delayReqPending_ = false;
+    nextDelayReqNs_ = 0;
+    delayReqIntervalNs_ = 1000000000ULL;
+    lastSyncT2_ = 0;
+    filter_.Reset();
+    if (keepTimeline) {
+        servo_->ResetContinuous();
+    } else {
+        servo_->Reset();
+    }
+    servoStarted_ = false;
+    lockCount_ = 0;
+}
 
-    if (!haveIPv4 || !haveMac) {
-        return false;
+void PTPClient::ServoUpdate(int64_t offsetNs, uint64_t hostTime) {
+    // offsetNs > 0: our PTP estimate is ahead of the master
+    const double error = static_cast<double>(offsetNs);
+    offsetNs_ = error;
+
+    AffineTimeMap::Coefficients coeffs = timeMap_.Load();
+    const PTPServoAction action = servo_->Sample(offsetNs, hostTime, coeffs);
+    servoStarted_ = true;
+    if (action == PTPServoAction::Ignored) {
+        return;
     }
+    timeMap_.Publish(coeffs);
+    rateRatio_ = coeffs.slope;
 
-    clockIdentity_.id[0] = macAddress_[0];
-    clockIdentity_.id[1] = macAddress_[1];
-    clockIdentity_.id[2] = macAddress_[2];
-    clockIdentity_.id[3] = 0xFF;
-    clockIdentity_.id[4] = 0xFE;
-    clockIdentity_.id[5] = macAddress_[3];
-    clockIdentity_.id[6] = macAddress_[4];
-    clockIdentity_.id[7] = macAddress_[5];
+    if (action == PTPServoAction::Stepped) {
+        lockCount_ = 0;
+        if (locked_.exchange(false) && statusCallback_) {
+            statusCallback_(false, error);
+        }
+        return;
+    }
 
-    return true;
+    // Lock with hysteresis
+    const bool wasLocked = locked_;
+    if (std::abs(error) < kPTPLockThresholdNs) {
+        lockCount_++;
+    } else {
+        lockCount_ = 0;
+    }
+    if (!wasLocked && lockCount_ >= kPTPLockSamples) {
+        locked_ = true;
+    } else if (wasLocked && std::abs(error) > kPTPUnlockThresholdNs) {
+        locked_ = false;
+    }
+
+    if (locked_ != wasLocked && statusCallback_) {
+        statusCallback_(locked_, error);
+    }
 }
 
-void PTPClient::MasterSendThread() {
-    using namespace std::chrono;
+void PTPClient::HandleDelayReq(const uint8_t* buffer, size_t length, uint64_t rxTimeNs,
+                               const sockaddr_in& srcAddr) {
+    if (length < 44) {
+        return;
+    }
 
-    const auto syncInterval = milliseconds(syncIntervalMs_);
-    const auto announceInterval = milliseconds(announceIntervalMs_);
+    PTPPortIdentity requester;
+    std::memcpy(requester.clock.id, buffer + 20, sizeof(requester.clock.id));
+    requester.port = ReadUint16(buffer + 28);
+    const uint16_t sequenceId = ReadUint16(buffer + 30);
 
-    auto nextSync = steady_clock::now();
-    auto nextAnnounce = nextSync;
+    // Answer even when the table is full: Delay_Resp needs no state
+    if (PTPSlaveEntry* slave = slaveTable_.Insert(requester)) {
+        slave->address = srcAddr.sin_addr;
+        slave->lastSeenNs = rxTimeNs;
+        slave->delayRequests++;
+    }
 
-    while (masterRunning_) {
-        const auto now = steady_clock::now();
+    sockaddr_in destAddr = srcAddr;
+    destAddr.sin_port = htons(kPTP_General_Port);
+    QueueDelayResp(destAddr, requester, sequenceId, HostTimeToPTP(rxTimeNs));
+}
 
-        if (now >= nextSync) {
-            const uint64_t timestamp = GetSystemTimeNs();
-            SendSync(syncSequenceId_++, timestamp);
-            do {
-                nextSync += syncInterval;
-            } while (nextSync <= now);
+void PTPClient::HandleSignaling(const uint8_t* buffer, size_t length, const sockaddr_in& srcAddr) {
+    PTPUnicastMessage messages[kMaxUnicastTLVs];
+    const size_t count = ParsePTPUnicastTLVs(buffer, length, messages, kMaxUnicastTLVs);
+    if (count == 0) {
+        return;
+    }
+    // Addressed to another clock
+    static const uint8_t kAllClocks[8] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+    if (std::memcmp(buffer + 34, clockIdentity_.id, 8) != 0 && std::memcmp(buffer + 34, kAllClocks, 8) != 0) {
+        return;
+    }
+
+    PTPPortIdentity sender;
+    std::memcpy(sender.clock.id, buffer + 20, sizeof(sender.clock.id));
+    sender.port = ReadUint16(buffer + 28);
+    const uint64_t nowNs = GetHostTimeNs();
+
+    if (messages[0].tlv == PTPUnicastTLV::Grant || messages[0].tlv == PTPUnicastTLV::AckCancel ||
+        (messages[0].tlv == PTPUnicastTLV::Cancel && unicastEnabled_ &&
+         srcAddr.sin_addr.s_addr == unicastMaster_.s_addr)) {
+        HandleUnicastReply(messages, count, sender, srcAddr, nowNs);
+        return;
+    }
+    if (portState_ != PTPPortState::Master) {
+        return; // Only a master grants unicast service
+    }
+
+    // Requests and cancellations from a slave
+    PTPSlaveEntry* slave = slaveTable_.Insert(sender);
+    PTPUnicastMessage replies[kMaxUnicastTLVs];
+    size_t replyCount = 0;
+    bool newService = false;
+    for (size_t i = 0; i < count; ++i) {
+        const PTPUnicastMessage& m = messages[i];
+        if (UnicastTypeIndex(m.messageType) < 0 ||
+            (m.tlv != PTPUnicastTLV::Request && m.tlv != PTPUnicastTLV::Cancel)) {
+            continue;
+        }
+        PTPUnicastGrant* grant = slave ? slave->GrantFor(m.messageType) : nullptr;
+
+        PTPUnicastMessage& reply = replies[replyCount++];
+        reply.messageType = m.messageType;
+        if (m.tlv == PTPUnicastTLV::Cancel) {
+            reply.tlv = PTPUnicastTLV::AckCancel;
+            if (grant) {
+                *grant = {};
+            }
+            continue;
         }
 
-        if (now >= nextAnnounce) {
-            const uint64_t timestamp = GetSystemTimeNs();
-            SendAnnounce(announceSequenceId_++, timestamp);
-            do {
-                nextAnnounce += announceInterval;
-            } while (nextAnnounce <= now);
+        // Grant what we can serve; duration 0 denies
+        reply.tlv = PTPUnicastTLV::Grant;
+        reply.logInterval = m.logInterval;
+        reply.renewal = true;
+        if (grant && m.logInterval >= kMinLogSyncInterval && m.logInterval <= 4 && m.durationSec > 0) {
+            reply.durationSec = std::min(m.durationSec, kMaxGrantDurationSec);
+            if (!grant->Active(nowNs) || grant->logInterval != m.logInterval) {
+                grant->nextNs = nowNs;
+                newService = true;
+            }
+            grant->logInterval = m.logInterval;
+            grant->intervalNs = LogIntervalToNs(m.logInterval);
+            grant->expiresNs = nowNs + static_cast<uint64_t>(reply.durationSec) * 1000000000ULL;
         }
+    }
+    if (slave) {
+        slave->address = srcAddr.sin_addr;
+        slave->lastSeenNs = nowNs;
+    }
+    slaveCount_ = slaveTable_.Size();
 
-        std::this_thread::sleep_for(milliseconds(1));
+    if (replyCount == 0) {
+        return;
+    }
+    sockaddr_in dest = srcAddr;
+    dest.sin_port = htons(kPTP_General_Port);
+    QueueSignaling(dest, sender, replies, replyCount);
+    if (newService) {
+        transport_->Loop().ArmTimer(unicastTimer_, nowNs);
     }
 }
 
-void PTPClient::MasterEventThread() {
-    uint8_t buffer[1500];
-
-    while (masterRunning_) {
-        sockaddr_in srcAddr{};
-        socklen_t srcLen = sizeof(srcAddr);
-        const ssize_t bytes = recvfrom(socketEvent_, buffer, sizeof(buffer), 0,
-                                       reinterpret_cast<sockaddr*>(&srcAddr), &srcLen);
+void PTPClient::HandleUnicastReply(const PTPUnicastMessage* messages, size_t count,
+                                   const PTPPortIdentity& sender, const sockaddr_in& srcAddr,
+                                   uint64_t nowNs) {
+    if (!unicastEnabled_ || srcAddr.sin_addr.s_addr != unicastMaster_.s_addr) {
+        return;
+    }
 
-        if (bytes < 0) {
-            if (errno == EWOULDBLOCK || errno == EAGAIN) {
-                std::this_thread::sleep_for(std::chrono::milliseconds(1));
-                continue;
-            }
-            if (errno == EINTR) {
-                continue;
-            }
-            std::cerr << "PTPClient: recvfrom error on Delay_Req socket: " << std::strerror(errno) << "\n";
-            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    PTPUnicastMessage acks[kMaxUnicastTLVs];
+    size_t ackCount = 0;
+    uint64_t nextNs = 0;
+    for (size_t i = 0; i < count; ++i) {
+        const PTPUnicastMessage& m = messages[i];
+        const int index = UnicastTypeIndex(m.messageType);
+        if (index < 0) {
             continue;
         }
+        PTPUnicastGrant& grant = unicastGrants_[index];
+
+        if (m.tlv == PTPUnicastTLV::Grant) {
+            if (m.durationSec == 0) {
+                std::cerr << "PTPClient: unicast " << static_cast<int>(m.messageType) << " denied by master\n";
+                grant.expiresNs = 0;
+                grant.nextNs = nowNs + kDeniedRetryNs;
+            } else {
+                // Renew halfway through the grant
+                grant.expiresNs = nowNs + static_cast<uint64_t>(m.durationSec) * 1000000000ULL;
+                grant.nextNs = nowNs + static_cast<uint64_t>(m.durationSec) * 500000000ULL;
+                grant.logInterval = m.logInterval;
+            }
+        } else if (m.tlv == PTPUnicastTLV::Cancel) {
+            // Master withdrew the service: acknowledge and ask again later
+            acks[ackCount].tlv = PTPUnicastTLV::AckCancel;
+            acks[ackCount++].messageType = m.messageType;
+            grant.expiresNs = 0;
+            grant.nextNs = nowNs + kDeniedRetryNs;
+        }
+    }
+    for (const auto& grant : unicastGrants_) {
+        if (nextNs == 0 || grant.nextNs < nextNs) {
+            nextNs = grant.nextNs;
+        }
+    }
+    transport_->Loop().ArmTimer(negotiationTimer_, nextNs);
+
+    if (ackCount > 0) {
+        sockaddr_in dest{};
+        dest.sin_family = AF_INET;
+        dest.sin_addr = srcAddr.sin_addr;
+        dest.sin_port = htons(kPTP_General_Port);
+        QueueSignaling(dest, sender, acks, ackCount);
+    }
+}
 
-        if (bytes < 34) {
-            continue;
+void PTPClient::NegotiateUnicast(uint64_t nowNs) {
+    // Request (or renew) every service that is due, in one Signaling message
+    PTPUnicastMessage requests[3];
+    size_t count = 0;
+    uint64_t nextNs = 0;
+    for (int i = 0; i < 3; ++i) {
+        if (kUnicastTypes[i] == PTPMessageType::Delay_Resp && delayMechanism_ == DelayMechanism::P2P) {
+            continue; // Pdelay is link-local
+        }
+        PTPUnicastGrant& grant = unicastGrants_[i];
+        if (grant.nextNs <= nowNs) {
+            PTPUnicastMessage& m = requests[count++];
+            m.tlv = PTPUnicastTLV::Request;
+            m.messageType = kUnicastTypes[i];
+            m.logInterval = kUnicastTypes[i] == PTPMessageType::Sync ? logSyncInterval_ : 0;
+            m.durationSec = kUnicastDurationSec;
+            grant.nextNs = nowNs + kNegotiationRetryNs;    // Until the grant arrives
+        }
+        if (nextNs == 0 || grant.nextNs < nextNs) {
+            nextNs = grant.nextNs;
         }
+    }
+    transport_->Loop().ArmTimer(negotiationTimer_, nextNs);
+
+    if (count > 0) {
+        sockaddr_in dest{};
+        dest.sin_family = AF_INET;
+        dest.sin_addr = unicastMaster_;
+        dest.sin_port = htons(kPTP_General_Port);
+        PTPPortIdentity anyMaster;
+        std::memset(anyMaster.clock.id, 0xFF, sizeof(anyMaster.clock.id));
+        anyMaster.port = 0xFFFF;
+        QueueSignaling(dest, anyMaster, requests, count);
+    }
+}
 
-        const uint8_t messageType = buffer[0] & 0x0F;
-        if (messageType != static_cast<uint8_t>(PTPMessageType::Delay_Req)) {
-            continue;
+void PTPClient::CancelUnicast() {
+    PTPUnicastMessage cancels[3];
+    size_t count = 0;
+    const uint64_t nowNs = GetHostTimeNs();
+    for (int i = 0; i < 3; ++i) {
+        if (unicastGrants_[i].Active(nowNs)) {
+            cancels[count].tlv = PTPUnicastTLV::Cancel;
+            cancels[count++].messageType = kUnicastTypes[i];
         }
+        unicastGrants_[i] = {};
+    }
+    if (count > 0) {
+        sockaddr_in dest{};
+        dest.sin_family = AF_INET;
+        dest.sin_addr = unicastMaster_;
+        dest.sin_port = htons(kPTP_General_Port);
+        PTPPortIdentity anyMaster;
+        std::memset(anyMaster.clock.id, 0xFF, sizeof(anyMaster.clock.id));
+        anyMaster.port = 0xFFFF;
+        QueueSignaling(dest, anyMaster, cancels, count);
+        transport_->GeneralBatch().Flush();
+    }
+}
 
-        if (bytes < 44) {
-            continue;
+void PTPClient::ServeUnicast(uint64_t nowNs) {
+    // Unicast Sync/Announce to every slave that is due, then sleep until the next one
+    uint64_t nextNs = 0;
+    slaveTable_.ForEach([&](PTPSlaveEntry& slave) {
+        sockaddr_in general{};
+        general.sin_family = AF_INET;
+        general.sin_addr = slave.address;
+        general.sin_port = htons(kPTP_General_Port);
+
+        PTPUnicastGrant& sync = slave.sync;
+        if (sync.Active(nowNs)) {
+            if (sync.nextNs <= nowNs) {
+                sockaddr_in event = general;
+                event.sin_port = htons(kPTP_Event_Port);
+                SendSync(event, general, sync.sequenceId++, sync.logInterval, kUnicastFlag);
+                sync.nextNs = NextDeadline(sync.nextNs, sync.intervalNs, nowNs);
+            }
+            nextNs = nextNs == 0 ? sync.nextNs : std::min(nextNs, sync.nextNs);
         }
 
-        ClockIdentity requester{};
-        std::memcpy(requester.id, buffer + 20, sizeof(requester.id));
-        const uint16_t requesterPortId = ReadUint16(buffer + 28);
-        const uint16_t sequenceId = ReadUint16(buffer + 30);
-        const uint64_t rxTimestamp = GetSystemTimeNs();
+        PTPUnicastGrant& announce = slave.announce;
+        if (announce.Active(nowNs)) {
+            if (announce.nextNs <= nowNs) {
+                QueueAnnounce(general, announce.sequenceId++, announce.logInterval, kUnicastFlag);
+                announce.nextNs = NextDeadline(announce.nextNs, announce.intervalNs, nowNs);
+            }
+            nextNs = nextNs == 0 ? announce.nextNs : std::min(nextNs, announce.nextNs);
+        }
+    });
 
-        sockaddr_in destAddr = srcAddr;
-        destAddr.sin_port = htons(kPTP_General_Port);
-        SendDelayResp(destAddr, requester, requesterPortId, sequenceId, rxTimestamp);
+    if (nextNs != 0) {
+        transport_->Loop().ArmTimer(unicastTimer_, nextNs);
     }
 }
 
-void PTPClient::SendSync(uint16_t sequenceId, uint64_t timestampNs) {
+void PTPClient::SendSync(const sockaddr_in& eventDest, const sockaddr_in& generalDest,
+                         uint16_t sequenceId, int8_t logInterval, uint8_t flags) {
+    // Two-step: originTimestamp is approximate, Follow_Up carries the departure time
     uint8_t message[44]{};
-    BuildHeader(message, PTPMessageType::Sync, sizeof(message), sequenceId, 0, -3);
-    WriteTimestamp(message + 34, timestampNs);
+    BuildHeader(message, PTPMessageType::Sync, sizeof(message), sequenceId, 0, logInterval,
+                static_cast<uint16_t>(kTwoStepFlag | flags) << 8);
+    WriteTimestamp(message + 34, GetPTPTimeNs());
 
-    if (sendto(socketEvent_, message, sizeof(message), 0,
-               reinterpret_cast<sockaddr*>(&eventDestAddr_), sizeof(eventDestAddr_)) < 0) {
+    uint64_t txTimeNs = 0;
+    if (transport_->SendEvent(message, sizeof(message), eventDest, txTimeNs) < 0) {
         std::cerr << "PTPClient: failed to send Sync: " << std::strerror(errno) << "\n";
+        return;
     }
+
+    uint8_t* followUp = transport_->GeneralBatch().Add(generalDest, 44);
+    BuildHeader(followUp, PTPMessageType::Follow_Up, 44, sequenceId, 2, logInterval,
+                static_cast<uint16_t>(flags) << 8);
+    WriteTimestamp(followUp + 34, HostTimeToPTP(txTimeNs));
 }
 
-void PTPClient::SendAnnounce(uint16_t sequenceId, uint64_t timestampNs) {
-    uint8_t message[64]{};
-    BuildHeader(message, PTPMessageType::Announce, sizeof(message), sequenceId, 5, 0);
-    WriteTimestamp(message + 34, timestampNs);
+void PTPClient::QueueAnnounce(const sockaddr_in& dest, uint16_t sequenceId, int8_t logInterval, uint8_t flags) {
+    uint8_t* message = transport_->GeneralBatch().Add(dest, 64);
+    BuildHeader(message, PTPMessageType::Announce, 64, sequenceId, 5, logInterval,
+                static_cast<uint16_t>(flags) << 8);
+    WriteTimestamp(message + 34, GetPTPTimeNs());
 
     const uint16_t currentUtcOffset = 37;
     message[44] = static_cast<uint8_t>((currentUtcOffset >> 8) & 0xFF);
     message[45] = static_cast<uint8_t>(currentUtcOffset & 0xFF);
     message[46] = 0x00; // reserved
-    message[47] = 128;  // grandmasterPriority1
-
-    message[48] = 248; // clockClass
-    message[49] = 0xFE; // clockAccuracy unknown
-    message[50] = 0xFF;
-    message[51] = 0xFF; // offsetScaledLogVariance
-
-    message[52] = 128; // grandmasterPriority2
-    std::memcpy(message + 53, clockIdentity_.id, sizeof(clockIdentity_.id));
-
-    const uint16_t stepsRemoved = 0;
-    message[61] = static_cast<uint8_t>((stepsRemoved >> 8) & 0xFF);
-    message[62] = static_cast<uint8_t>(stepsRemoved & 0xFF);
+    message[47] = localDataset_.priority1;
+    message[48] = localDataset_.clockClass;
+    message[49] = localDataset_.clockAccuracy;
+    message[50] = static_cast<uint8_t>((localDataset_.offsetScaledLogVariance >> 8) & 0xFF);
+    message[51] = static_cast<uint8_t>(localDataset_.offsetScaledLogVariance & 0xFF);
+    message[52] = localDataset_.priority2;
+    std::memcpy(message + 53, localDataset_.grandmasterIdentity.id, sizeof(localDataset_.grandmasterIdentity.id));
+    message[61] = static_cast<uint8_t>((localDataset_.stepsRemoved >> 8) & 0xFF);
+    message[62] = static_cast<uint8_t>(localDataset_.stepsRemoved & 0xFF);
     message[63] = 0xA0; // timeSource: internal oscillator
-
-    if (sendto(socketGeneral_, message, sizeof(message), 0,
-               reinterpret_cast<sockaddr*>(&generalDestAddr_), sizeof(generalDestAddr_)) < 0) {
-        std::cerr << "PTPClient: failed to send Announce: " << std::strerror(errno) << "\n";
-    }
 }
 
-void PTPClient::SendDelayResp(const sockaddr_in& destAddr,
-                              const ClockIdentity& requesterId,
-                              uint16_t requesterPortId,
-                              uint16_t sequenceId,
-                              uint64_t receiveTimestampNs) {
-    uint8_t message[54]{};
-    BuildHeader(message, PTPMessageType::Delay_Resp, sizeof(message), sequenceId, 3, 0x7F);
+void PTPClient::QueueDelayResp(const sockaddr_in& dest, const PTPPortIdentity& requester,
+                               uint16_t sequenceId, uint64_t receiveTimestampNs) {
+    uint8_t* message = transport_->GeneralBatch().Add(dest, 54);
+    BuildHeader(message, PTPMessageType::Delay_Resp, 54, sequenceId, 3, 0x7F,
+                static_cast<uint16_t>(kUnicastFlag) << 8);
     WriteTimestamp(message + 34, receiveTimestampNs);
-    std::memcpy(message + 44, requesterId.id, sizeof(requesterId.id));
-    message[52] = static_cast<uint8_t>((requesterPortId >> 8) & 0xFF);
-    message[53] = static_cast<uint8_t>(requesterPortId & 0xFF);
+    std::memcpy(message + 44, requester.clock.id, sizeof(requester.clock.id));
+    message[52] = static_cast<uint8_t>((requester.port >> 8) & 0xFF);
+    message[53] = static_cast<uint8_t>(requester.port & 0xFF);
+}
 
-    if (sendto(socketGeneral_, message, sizeof(message), 0,
-               reinterpret_cast<const sockaddr*>(&destAddr), sizeof(destAddr)) < 0) {
-        std::cerr << "PTPClient: failed to send Delay_Resp: " << std::strerror(errno) << "\n";
+void PTPClient::QueueSignaling(const sockaddr_in& dest, const PTPPortIdentity& target,
+                               const PTPUnicastMessage* messages, size_t count) {
+    uint8_t tlvs[kMaxUnicastTLVs * kPTPUnicastTLVMaxLength];
+    size_t tlvLength = 0;
+    for (size_t i = 0; i < count && i < kMaxUnicastTLVs; ++i) {
+        tlvLength += WritePTPUnicastTLV(tlvs + tlvLength, messages[i]);
+    }
+
+    const uint16_t length = static_cast<uint16_t>(kPTPSignalingHeaderLength + tlvLength);
+    uint8_t* message = transport_->GeneralBatch().Add(dest, length);
+    if (message == nullptr) {
+        return;
     }
+    BuildHeader(message, PTPMessageType::Signaling, length, signalingSequenceId_++, 5, 0x7F,
+                static_cast<uint16_t>(kUnicastFlag) << 8);
+    std::memcpy(message + 34, target.clock.id, sizeof(target.clock.id));
+    message[42] = static_cast<uint8_t>((target.port >> 8) & 0xFF);
+    message[43] = static_cast<uint8_t>(target.port & 0xFF);
+    std::memcpy(message + kPTPSignalingHeaderLength, tlvs, tlvLength);
 }
 
 void PTPClient::BuildHeader(uint8_t* buffer,
@@ -567,19 +1203,8 @@ void PTPClient::WriteTimestamp(uint8_t* buffer, uint64_t timestampNs) const {
     buffer[9] = static_cast<uint8_t>(nanoseconds & 0xFF);
 }
 
-uint64_t PTPClient::GetSystemTimeNs() const {
-    return GetSystemTimeNsInternal();
-}
-
-void PTPClient::CloseSockets() {
-    if (socketEvent_ >= 0) {
-        close(socketEvent_);
-        socketEvent_ = -1;
-    }
-    if (socketGeneral_ >= 0) {
-        close(socketGeneral_);
-        socketGeneral_ = -1;
-    }
+uint64_t PTPClient::GetHostTimeNs() const {
+    return HostClock::NowNs();
 }
 
 } // namespace AES67
@@ -0,0 +1,253 @@
+// PTPEventLoop.cpp - Socket readiness and timers for the PTP thread
+// SPDX-License-Identifier: MIT
+
+#include "PTPEventLoop.h"
+#include "HostClock.h"
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <unistd.h>
+#if defined(__linux__)
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#else
+#include <fcntl.h>
+#include <poll.h>
+#endif
+
+namespace AES67 {
+
+#if defined(__linux__)
+namespace {
+
+// epoll_event.data tags
+constexpr uint32_t kSocketTag = 0x100;
+constexpr uint32_t kTimerTag = 0x200;
+constexpr uint32_t kWakeTag = 0x300;
+
+bool Watch(int epollFd, int fd, uint32_t tag) {
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.u32 = tag;
+    return epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev) == 0;
+}
+
+} // namespace
+
+PTPEventLoop::~PTPEventLoop() {
+    Close();
+}
+
+bool PTPEventLoop::Open() {
+    Close();
+    epollFd_ = epoll_create1(EPOLL_CLOEXEC);
+    wakeFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epollFd_ < 0 || wakeFd_ < 0 || !Watch(epollFd_, wakeFd_, kWakeTag)) {
+        std::cerr << "PTPEventLoop: failed to create epoll/eventfd: " << std::strerror(errno) << "\n";
+        Close();
+        return false;
+    }
+    return true;
+}
+
+void PTPEventLoop::Close() {
+    for (int i = 0; i < timerCount_; ++i) {
+        close(timerFds_[i]);
+    }
+    if (wakeFd_ >= 0) {
+        close(wakeFd_);
+    }
+    if (epollFd_ >= 0) {
+        close(epollFd_);
+    }
+    epollFd_ = -1;
+    wakeFd_ = -1;
+    socketCount_ = 0;
+    timerCount_ = 0;
+}
+
+int PTPEventLoop::AddSocket(int fd) {
+    if (socketCount_ >= kMaxSockets || !Watch(epollFd_, fd, kSocketTag | socketCount_)) {
+        return -1;
+    }
+    sockets_[socketCount_] = fd;
+    return socketCount_++;
+}
+
+int PTPEventLoop::AddTimer() {
+    if (timerCount_ >= kMaxTimers) {
+        return -1;
+    }
+    // timerfd has no CLOCK_MONOTONIC_RAW: timers are armed relative to now,
+    // so the slew between the two clocks only scales the interval by ppm
+    const int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (fd < 0 || !Watch(epollFd_, fd, kTimerTag | timerCount_)) {
+        std::cerr << "PTPEventLoop: failed to create timerfd: " << std::strerror(errno) << "\n";
+        if (fd >= 0) {
+            close(fd);
+        }
+        return -1;
+    }
+    timerFds_[timerCount_] = fd;
+    deadlines_[timerCount_] = 0;
+    return timerCount_++;
+}
+
+void PTPEventLoop::ArmTimer(int timer, uint64_t deadlineNs) {
+    const uint64_t nowNs = HostClock::NowNs();
+    const uint64_t delayNs = deadlineNs > nowNs ? deadlineNs - nowNs : 1; // 0 would disarm
+
+    itimerspec spec{};
+    spec.it_value.tv_sec = static_cast<time_t>(delayNs / 1000000000ULL);
+    spec.it_value.tv_nsec = static_cast<long>(delayNs % 1000000000ULL);
+    timerfd_settime(timerFds_[timer], 0, &spec, nullptr);
+    deadlines_[timer] = deadlineNs;
+}
+
+void PTPEventLoop::DisarmTimer(int timer) {
+    itimerspec spec{};
+    timerfd_settime(timerFds_[timer], 0, &spec, nullptr);
+    deadlines_[timer] = 0;
+}
+
+PTPEventLoop::Ready PTPEventLoop::Wait() {
+    Ready ready;
+    epoll_event events[kMaxSockets + kMaxTimers + 1];
+    const int count = epoll_wait(epollFd_, events, static_cast<int>(std::size(events)), -1);
+
+    for (int i = 0; i < count; ++i) {
+        const uint32_t tag = events[i].data.u32;
+        const uint32_t index = tag & 0xFF;
+        uint64_t value = 0;
+        switch (tag & ~0xFFu) {
+            case kSocketTag:
+                ready.sockets |= 1u << index;
+                break;
+            case kTimerTag:
+                // Expiration count; a re-armed timer may have nothing to read
+                if (read(timerFds_[index], &value, sizeof(value)) == sizeof(value) && deadlines_[index] != 0) {
+                    ready.timers |= 1u << index;
+                    deadlines_[index] = 0;
+                }
+                break;
+            default:
+                read(wakeFd_, &value, sizeof(value));
+                break;
+        }
+    }
+    return ready;
+}
+
+void PTPEventLoop::Wake() {
+    const uint64_t one = 1;
+    write(wakeFd_, &one, sizeof(one));
+}
+
+#else
+
+PTPEventLoop::~PTPEventLoop() {
+    Close();
+}
+
+bool PTPEventLoop::Open() {
+    Close();
+    if (pipe(wakePipe_) != 0) {
+        std::cerr << "PTPEventLoop: failed to create wake pipe: " << std::strerror(errno) << "\n";
+        wakePipe_[0] = wakePipe_[1] = -1;
+        return false;
+    }
+    fcntl(wakePipe_[0], F_SETFL, O_NONBLOCK);
+    fcntl(wakePipe_[1], F_SETFL, O_NONBLOCK);
+    return true;
+}
+
+void PTPEventLoop::Close() {
+    for (int& fd : wakePipe_) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        fd = -1;
+    }
+    socketCount_ = 0;
+    timerCount_ = 0;
+}
+
+int PTPEventLoop::AddSocket(int fd) {
+    if (socketCount_ >= kMaxSockets) {
+        return -1;
+    }
+    sockets_[socketCount_] = fd;
+    return socketCount_++;
+}
+
+int PTPEventLoop::AddTimer() {
+    if (timerCount_ >= kMaxTimers) {
+        return -1;
+    }
+    deadlines_[timerCount_] = 0;
+    return timerCount_++;
+}
+
+void PTPEventLoop::ArmTimer(int timer, uint64_t deadlineNs) {
+    deadlines_[timer] = deadlineNs != 0 ? deadlineNs : 1;
+}
+
+void PTPEventLoop::DisarmTimer(int timer) {
+    deadlines_[timer] = 0;
+}
+
+PTPEventLoop::Ready PTPEventLoop::Wait() {
+    // Sleep until the earliest deadline, rounded up to poll()'s milliseconds
+    uint64_t nowNs = HostClock::NowNs();
+    int timeoutMs = -1;
+    for (int i = 0; i < timerCount_; ++i) {
+        if (deadlines_[i] == 0) {
+            continue;
+        }
+        const uint64_t delayNs = deadlines_[i] > nowNs ? deadlines_[i] - nowNs : 0;
+        const int ms = static_cast<int>((delayNs + 999999) / 1000000);
+        if (timeoutMs < 0 || ms < timeoutMs) {
+            timeoutMs = ms;
+        }
+    }
+
+    pollfd fds[kMaxSockets + 1];
+    for (int i = 0; i < socketCount_; ++i) {
+        fds[i] = {sockets_[i], POLLIN, 0};
+    }
+    fds[socketCount_] = {wakePipe_[0], POLLIN, 0};
+
+    Ready ready;
+    if (poll(fds, static_cast<nfds_t>(socketCount_ + 1), timeoutMs) > 0) {
+        for (int i = 0; i < socketCount_; ++i) {
+            if (fds[i].revents & (POLLIN | POLLERR)) {
+                ready.sockets |= 1u << i;
+            }
+        }
+        if (fds[socketCount_].revents & POLLIN) {
+            uint8_t drain[64];
+            while (read(wakePipe_[0], drain, sizeof(drain)) > 0) {
+            }
+        }
+    }
+
+    nowNs = HostClock::NowNs();
+    for (int i = 0; i < timerCount_; ++i) {
+        if (deadlines_[i] != 0 && deadlines_[i] <= nowNs) {
+            ready.timers |= 1u << i;
+            deadlines_[i] = 0;
+        }
+    }
+    return ready;
+}
+
+void PTPEventLoop::Wake() {
+    const uint8_t one = 1;
+    write(wakePipe_[1], &one, sizeof(one));
+}
+
+#endif
+
+} // namespace AES67
@@ -0,0 +1,72 @@
+// PTPFilter.cpp - PTP path delay / offset measurement filtering
+// SPDX-License-Identifier: MIT
+
+#include "PTPFilter.h"
+#include <algorithm>
+#include <cmath>
+
+namespace AES67 {
+
+bool PTPMeasurementFilter::AddPathDelay(int64_t delayNs) {
+    const double delay = static_cast<double>(delayNs);
+    const double deviation = std::abs(delay - meanDelay_);
+
+    const bool outlier = delayCount_ >= kWarmupSamples &&
+                         deviation > std::max(kOutlierFactor * delayDev_, kMinWindowNs);
+    if (outlier && ++delayRejectRun_ < kMaxConsecutiveRejects) {
+        rejected_++;
+        return false;
+    }
+    delayRejectRun_ = 0;
+
+    if (outlier) {
+        // Persistent change (path rerouted): restart from the new delay
+        meanDelay_ = delay;
+        delayDev_ = deviation / kOutlierFactor;
+    } else if (delayCount_ < kWarmupSamples) {
+        // Plain running average until the EMA has something to stand on
+        delayCount_++;
+        meanDelay_ += (delay - meanDelay_) / delayCount_;
+        delayDev_ += (std::abs(delay - meanDelay_) - delayDev_) / delayCount_;
+    } else {
+        meanDelay_ += (delay - meanDelay_) * kSmoothing;
+        delayDev_ += (deviation - delayDev_) * kSmoothing;
+    }
+
+    // Negative path delay is measurement noise around a very short link
+    meanDelay_ = std::max(meanDelay_, 0.0);
+    return true;
+}
+
+bool PTPMeasurementFilter::AcceptOffset(int64_t offsetNs) {
+    const double magnitude = std::abs(static_cast<double>(offsetNs));
+
+    if (offsetCount_ >= kWarmupSamples &&
+        magnitude > std::max(kOutlierFactor * offsetDev_, kMinWindowNs) &&
+        ++offsetRejectRun_ < kMaxConsecutiveRejects) {
+        rejected_++;
+        return false;
+    }
+    offsetRejectRun_ = 0;
+
+    if (offsetCount_ < kWarmupSamples) {
+        offsetCount_++;
+        offsetDev_ += (magnitude - offsetDev_) / offsetCount_;
+    } else {
+        offsetDev_ += (magnitude - offsetDev_) * kSmoothing;
+    }
+    return true;
+}
+
+void PTPMeasurementFilter::Reset() {
+    meanDelay_ = 0.0;
+    delayDev_ = 0.0;
+    delayCount_ = 0;
+    delayRejectRun_ = 0;
+    offsetDev_ = 0.0;
+    offsetCount_ = 0;
+    offsetRejectRun_ = 0;
+    rejected_ = 0;
+}
+
+} // namespace AES67
@@ -0,0 +1,276 @@
+// PTPServo.cpp - Pluggable PTP clock servos
+// SPDX-License-Identifier: MIT
+
+#include "PTPServo.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace AES67 {
+namespace {
+
+constexpr double kDefaultIntervalSec = 0.125;   // 8 Sync/s when no interval is known yet
+
+// ============================================================================
+// PI servo
+// ============================================================================
+
+class PIServo final : public PTPServo {
+public:
+    explicit PIServo(const PTPServoConfig& config) : config_(config) {}
+
+    PTPServoAction Sample(int64_t offsetNs, uint64_t hostNs,
+                          AffineTimeMap::Coefficients& coeffs) override {
+        const uint64_t predicted = AffineTimeMap::HostToPTP(coeffs, hostNs);
+
+        if (!started_ && continuous_) {
+            // Carry on at the mapping's current rate
+            started_ = true;
+            integrator_ = (1.0 - coeffs.slope) * 1e9;
+            lastHostNs_ = hostNs;
+        }
+
+        if (!started_ || (!config_.stepOnlyAtStart && std::llabs(offsetNs) > config_.stepThresholdNs)) {
+            // Step the mapping onto the master, keep the frequency estimate
+            coeffs.anchorPTP = predicted - offsetNs;
+            coeffs.anchorHost = hostNs;
+            started_ = true;
+            lastHostNs_ = hostNs;
+            return PTPServoAction::Stepped;
+        }
+
+        double intervalSec = static_cast<double>(hostNs - lastHostNs_) / 1e9;
+        if (intervalSec <= 0.0 || intervalSec > 10.0) {
+            intervalSec = kDefaultIntervalSec;
+        }
+        lastHostNs_ = hostNs;
+
+        // PI on phase error -> frequency correction (ppb)
+        const double error = static_cast<double>(offsetNs);
+        const double maxPpb = config_.maxFrequencyPpb;
+        integrator_ = std::clamp(integrator_ + kKi * error / intervalSec, -maxPpb, maxPpb);
+        const double frequencyPpb = std::clamp(kKp * error / intervalSec + integrator_, -maxPpb, maxPpb);
+
+        // Re-anchor at this sample so the mapping stays continuous
+        coeffs.slope = 1.0 - frequencyPpb / 1e9;
+        coeffs.anchorPTP = predicted;
+        coeffs.anchorHost = hostNs;
+        return PTPServoAction::Slewed;
+    }
+
+    void Reset() override {
+        started_ = false;
+        continuous_ = false;
+        integrator_ = 0.0;
+        lastHostNs_ = 0;
+    }
+
+    void ResetContinuous() override {
+        Reset();
+        continuous_ = true;
+    }
+
+    PTPServoType GetType() const override { return PTPServoType::PI; }
+
+private:
+    static constexpr double kKp = 0.7;      // Gains per sync interval
+    static constexpr double kKi = 0.3;
+
+    PTPServoConfig config_;
+    bool started_ = false;
+    bool continuous_ = false;
+    double integrator_ = 0.0;
+    uint64_t lastHostNs_ = 0;
+};
+
+// ============================================================================
+// Least-squares servo
+// ============================================================================
+
+// Fits master - host = intercept + frequency * (host - now) over a window of
+// samples, so offset and frequency are estimated jointly. The mapping is then
+// slewed toward the fitted line rather than the noisy latest sample.
+class LeastSquaresServo final : public PTPServo {
+public:
+    explicit LeastSquaresServo(const PTPServoConfig& config)
+        : config_(config)
+        , points_(std::max<uint32_t>(config.windowSamples, kMinFitSamples)) {}
+
+    PTPServoAction Sample(int64_t offsetNs, uint64_t hostNs,
+                          AffineTimeMap::Coefficients& coeffs) override {
+        const uint64_t predicted = AffineTimeMap::HostToPTP(coeffs, hostNs);
+        const uint64_t master = predicted - offsetNs;
+
+        if (samples_ == 0) {
+            // Keep y small so the regression stays exact in double precision
+            yRef_ = static_cast<int64_t>(master - hostNs);
+            if (continuous_) {
+                // Skip start-up: fill the window at the mapping's current rate
+                frequency_ = coeffs.slope - 1.0;
+                samples_ = kMinFitSamples;
+            }
+        }
+        const double y = static_cast<double>(static_cast<int64_t>(master - hostNs) - yRef_);
+
+        // Reject samples far off the fitted line; a run of them is a real change
+        Fit fit;
+        if (count_ >= kMinFitSamples && FitAt(hostNs, fit, Refilling())) {
+            const double residual = std::abs(y - fit.intercept);
+            if (residual > std::max(kOutlierFactor * fit.rms, kMinWindowNs)) {
+                if (++rejectRun_ < kMaxConsecutiveRejects) {
+                    return PTPServoAction::Ignored;
+                }
+                count_ = 0; // Restart the window from this sample
+            }
+        }
+        rejectRun_ = 0;
+
+        points_[next_] = {hostNs, y};
+        next_ = (next_ + 1) % points_.size();
+        count_ = std::min<size_t>(count_ + 1, points_.size());
+        samples_++;
+
+        // After a restart, a fit over a few noisy samples would swing the
+        // frequency: hold the previous estimate until the window refills
+        uint64_t estimate = master;
+        if (count_ >= 2 && FitAt(hostNs, fit, Refilling())) {
+            const double maxFrequency = config_.maxFrequencyPpb / 1e9;
+            frequency_ = std::clamp(fit.slope, -maxFrequency, maxFrequency);
+            estimate = hostNs + static_cast<uint64_t>(yRef_ + static_cast<int64_t>(std::llround(fit.intercept)));
+        }
+        const int64_t phaseError = static_cast<int64_t>(predicted - estimate);
+
+        const uint64_t intervalNs = lastHostNs_ && hostNs > lastHostNs_
+            ? hostNs - lastHostNs_
+            : static_cast<uint64_t>(kDefaultIntervalSec * 1e9);
+        lastHostNs_ = hostNs;
+
+        // Step-then-slew: step phase and frequency while the window fills,
+        // afterwards only on large errors (never, with stepOnlyAtStart)
+        const bool startUp = samples_ <= kMinFitSamples;
+        if (startUp || (!config_.stepOnlyAtStart && std::llabs(phaseError) > config_.stepThresholdNs)) {
+            coeffs.slope = 1.0 + frequency_;
+            coeffs.anchorPTP = estimate;
+            coeffs.anchorHost = hostNs;
+            return PTPServoAction::Stepped;
+        }
+
+        // Remove the phase error over a few intervals on top of the fitted rate
+        const double maxFrequency = config_.maxFrequencyPpb / 1e9;
+        const double correction = static_cast<double>(phaseError) / (kSlewIntervals * static_cast<double>(intervalNs));
+        coeffs.slope = 1.0 + std::clamp(frequency_ - correction, -maxFrequency, maxFrequency);
+        coeffs.anchorPTP = predicted;
+        coeffs.anchorHost = hostNs;
+        return PTPServoAction::Slewed;
+    }
+
+    void Reset() override {
+        count_ = 0;
+        next_ = 0;
+        samples_ = 0;
+        rejectRun_ = 0;
+        frequency_ = 0.0;
+        lastHostNs_ = 0;
+        continuous_ = false;
+    }
+
+    void ResetContinuous() override {
+        Reset();
+        continuous_ = true;
+    }
+
+    PTPServoType GetType() const override { return PTPServoType::LeastSquares; }
+
+private:
+    static constexpr size_t kMinFitSamples = 4;        // Before outlier checks and slewing
+    static constexpr double kOutlierFactor = 4.0;       // x RMS residual
+    static constexpr double kMinWindowNs = 1000.0;      // Never reject within ±1 µs
+    static constexpr uint32_t kMaxConsecutiveRejects = 8;
+    static constexpr double kSlewIntervals = 4.0;
+
+    struct Point {
+        uint64_t hostNs;
+        double y;           // (master - host) - yRef_
+    };
+
+    struct Fit {
+        double intercept = 0.0;     // y at the evaluation time
+        double slope = 0.0;         // Frequency offset of master vs host
+        double rms = 0.0;           // Residual RMS
+    };
+
+    // Window restarted after start-up and not yet full again
+    bool Refilling() const {
+        return samples_ > kMinFitSamples && count_ < points_.size();
+    }
+
+    // Ordinary least squares over the window, x relative to nowNs
+    // (intercept only, with the slope held at frequency_, if holdSlope)
+    bool FitAt(uint64_t nowNs, Fit& fit, bool holdSlope = false) const {
+        const size_t n = count_;
+        const size_t size = points_.size();
+        double sumX = 0.0, sumY = 0.0;
+        for (size_t i = 0; i < n; ++i) {
+            const Point& p = points_[(next_ + size - 1 - i) % size];
+            sumX += static_cast<double>(static_cast<int64_t>(p.hostNs - nowNs));
+            sumY += p.y;
+        }
+        const double meanX = sumX / n;
+        const double meanY = sumY / n;
+
+        double sxx = 0.0, sxy = 0.0;
+        for (size_t i = 0; i < n; ++i) {
+            const Point& p = points_[(next_ + size - 1 - i) % size];
+            const double dx = static_cast<double>(static_cast<int64_t>(p.hostNs - nowNs)) - meanX;
+            sxx += dx * dx;
+            sxy += dx * (p.y - meanY);
+        }
+        if (holdSlope) {
+            fit.slope = frequency_;
+        } else if (sxx > 0.0) {
+            fit.slope = sxy / sxx;
+        } else {
+            return false;
+        }
+        fit.intercept = meanY - fit.slope * meanX;
+
+        double sumSq = 0.0;
+        for (size_t i = 0; i < n; ++i) {
+            const Point& p = points_[(next_ + size - 1 - i) % size];
+            const double x = static_cast<double>(static_cast<int64_t>(p.hostNs - nowNs));
+            const double r = p.y - (fit.intercept + fit.slope * x);
+            sumSq += r * r;
+        }
+        fit.rms = std::sqrt(sumSq / n);
+        return true;
+    }
+
+    PTPServoConfig config_;
+    std::vector<Point> points_;     // Ring buffer, windowSamples long
+    size_t count_ = 0;
+    size_t next_ = 0;
+    uint64_t samples_ = 0;          // Accepted since Reset
+    uint32_t rejectRun_ = 0;
+    bool continuous_ = false;
+    int64_t yRef_ = 0;
+    double frequency_ = 0.0;
+    uint64_t lastHostNs_ = 0;
+};
+
+} // namespace
+
+const char* PTPServoTypeName(PTPServoType type) {
+    switch (type) {
+        case PTPServoType::LeastSquares: return "least-squares";
+        default: return "PI";
+    }
+}
+
+std::unique_ptr<PTPServo> CreatePTPServo(PTPServoType type, const PTPServoConfig& config) {
+    switch (type) {
+        case PTPServoType::LeastSquares: return std::make_unique<LeastSquaresServo>(config);
+        default: return std::make_unique<PIServo>(config);
+    }
+}
+
+} // namespace AES67
@@ -0,0 +1,226 @@
+// PTPStats.cpp - Lock-free PTP clock quality statistics
+// SPDX-License-Identifier: MIT
+
+#include "PTPStats.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace AES67 {
+namespace {
+
+PTPSeriesStats Summarize(std::vector<double>& values) {
+    PTPSeriesStats stats;
+    stats.count = values.size();
+    if (values.empty()) {
+        return stats;
+    }
+    std::sort(values.begin(), values.end());
+
+    double sum = 0.0;
+    for (double v : values) {
+        sum += v;
+        stats.histogram.counts[PTPHistogram::BinOf(std::llround(v))]++;
+    }
+    stats.mean = sum / static_cast<double>(values.size());
+    double sumSq = 0.0;
+    for (double v : values) {
+        sumSq += (v - stats.mean) * (v - stats.mean);
+    }
+    stats.stddev = std::sqrt(sumSq / static_cast<double>(values.size()));
+
+    auto percentile = [&values](double p) {
+        return values[std::min(values.size() - 1, static_cast<size_t>(p * static_cast<double>(values.size())))];
+    };
+    stats.min = values.front();
+    stats.max = values.back();
+    stats.p50 = percentile(0.50);
+    stats.p90 = percentile(0.90);
+    stats.p99 = percentile(0.99);
+    return stats;
+}
+
+} // namespace
+
+// ============================================================================
+// Histogram
+// ============================================================================
+
+size_t PTPHistogram::BinOf(int64_t value) {
+    const uint64_t magnitude = value < 0 ? static_cast<uint64_t>(-(value + 1)) + 1 : static_cast<uint64_t>(value);
+    if (magnitude == 0) {
+        return kZeroBin;
+    }
+    // [2^(k-1), 2^k) -> k, capped at the outermost bin
+    size_t k = 0;
+    for (uint64_t m = magnitude; m != 0; m >>= 1) {
+        k++;
+    }
+    k = std::min(k, kMagnitudes);
+    return value < 0 ? kZeroBin - k : kZeroBin + k;
+}
+
+int64_t PTPHistogram::BinLowerBound(size_t bin) {
+    if (bin == kZeroBin || bin >= kBins) {
+        return 0;
+    }
+    const size_t k = bin > kZeroBin ? bin - kZeroBin : kZeroBin - bin;
+    const int64_t magnitude = int64_t{1} << (k - 1);
+    return bin > kZeroBin ? magnitude : -magnitude;
+}
+
+// ============================================================================
+// Allan / time deviation
+// ============================================================================
+
+std::vector<PTPDeviation> ComputePTPDeviations(const double* phaseNs, size_t count, double tau0Sec) {
+    std::vector<PTPDeviation> deviations;
+    if (tau0Sec <= 0.0) {
+        return deviations;
+    }
+
+    std::vector<double> d2;
+    for (size_t m = 1; 3 * m + 1 <= count; m *= 2) {
+        // Second differences of phase at this tau
+        const size_t n2 = count - 2 * m;
+        d2.resize(n2);
+        double adevSum = 0.0;
+        for (size_t i = 0; i < n2; ++i) {
+            d2[i] = phaseNs[i + 2 * m] - 2.0 * phaseNs[i + m] + phaseNs[i];
+            adevSum += d2[i] * d2[i];
+        }
+
+        // TDEV: squared sums of m consecutive second differences (sliding)
+        double window = 0.0;
+        for (size_t i = 0; i < m; ++i) {
+            window += d2[i];
+        }
+        const size_t windows = count - 3 * m + 1;
+        double tdevSum = window * window;
+        for (size_t j = 1; j < windows; ++j) {
+            window += d2[j + m - 1] - d2[j - 1];
+            tdevSum += window * window;
+        }
+
+        const double mD = static_cast<double>(m);
+        const double tau = mD * tau0Sec;
+        PTPDeviation dev;
+        dev.tauSec = tau;
+        dev.adev = std::sqrt(adevSum / (2.0 * static_cast<double>(n2))) / tau * 1e-9;
+        dev.tdevNs = std::sqrt(tdevSum / (6.0 * mD * mD * static_cast<double>(windows)));
+        deviations.push_back(dev);
+    }
+    return deviations;
+}
+
+// ============================================================================
+// Collector
+// ============================================================================
+
+PTPStats::PTPStats(size_t capacity) {
+    size_t slots = 16;
+    while (slots < capacity) {
+        slots <<= 1;
+    }
+    slots_ = std::make_unique<Slot[]>(slots);
+    mask_ = slots - 1;
+}
+
+void PTPStats::Record(const PTPStatsSample& sample) {
+    const uint64_t n = count_.load(std::memory_order_relaxed);
+    Slot& slot = slots_[n & mask_];
+    slot.seq.store(2 * n + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.hostNs.store(sample.hostNs, std::memory_order_relaxed);
+    slot.offsetNs.store(sample.offsetNs, std::memory_order_relaxed);
+    slot.pathDelayNs.store(sample.pathDelayNs, std::memory_order_relaxed);
+    slot.syncIntervalNs.store(sample.syncIntervalNs, std::memory_order_relaxed);
+    slot.frequencyPpb.store(sample.frequencyPpb, std::memory_order_relaxed);
+    slot.accepted.store(sample.accepted, std::memory_order_relaxed);
+    slot.seq.store(2 * n + 2, std::memory_order_release);
+    count_.store(n + 1, std::memory_order_release);
+}
+
+void PTPStats::Reset() {
+    count_.store(0, std::memory_order_release);
+    for (size_t i = 0; i <= mask_; ++i) {
+        slots_[i].seq.store(0, std::memory_order_release);
+    }
+}
+
+void PTPStats::CopySamples(std::vector<PTPStatsSample>& out, double windowSec) const {
+    out.clear();
+    const uint64_t n = count_.load(std::memory_order_acquire);
+    const uint64_t first = n > Capacity() ? n - Capacity() : 0;
+    out.reserve(static_cast<size_t>(n - first));
+
+    for (uint64_t i = first; i < n; ++i) {
+        const Slot& slot = slots_[i & mask_];
+        const uint64_t seq = slot.seq.load(std::memory_order_acquire);
+        if (seq != 2 * i + 2) {
+            continue; // Being overwritten, or already reused
+        }
+        PTPStatsSample sample;
+        sample.hostNs = slot.hostNs.load(std::memory_order_relaxed);
+        sample.offsetNs = slot.offsetNs.load(std::memory_order_relaxed);
+        sample.pathDelayNs = slot.pathDelayNs.load(std::memory_order_relaxed);
+        sample.syncIntervalNs = slot.syncIntervalNs.load(std::memory_order_relaxed);
+        sample.frequencyPpb = slot.frequencyPpb.load(std::memory_order_relaxed);
+        sample.accepted = slot.accepted.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.seq.load(std::memory_order_relaxed) == seq) {
+            out.push_back(sample);
+        }
+    }
+
+    if (windowSec > 0.0 && !out.empty()) {
+        const uint64_t spanNs = static_cast<uint64_t>(windowSec * 1e9);
+        const uint64_t endNs = out.back().hostNs;
+        const uint64_t startNs = endNs > spanNs ? endNs - spanNs : 0;
+        const auto firstInWindow = std::find_if(out.begin(), out.end(),
+            [startNs](const PTPStatsSample& s) { return s.hostNs >= startNs; });
+        out.erase(out.begin(), firstInWindow);
+    }
+}
+
+PTPStatsSnapshot PTPStats::Snapshot(double windowSec) const {
+    PTPStatsSnapshot snapshot;
+    snapshot.totalSamples = count_.load(std::memory_order_acquire);
+
+    std::vector<PTPStatsSample> samples;
+    CopySamples(samples, windowSec);
+    if (samples.empty()) {
+        return snapshot;
+    }
+    snapshot.windowStartNs = samples.front().hostNs;
+    snapshot.windowEndNs = samples.back().hostNs;
+
+    std::vector<double> offsets, delays, intervals, frequencies;
+    offsets.reserve(samples.size());
+    for (const PTPStatsSample& s : samples) {
+        if (s.accepted) {
+            offsets.push_back(static_cast<double>(s.offsetNs));
+        } else {
+            snapshot.rejectedSamples++;
+        }
+        delays.push_back(static_cast<double>(s.pathDelayNs));
+        if (s.syncIntervalNs > 0) {
+            intervals.push_back(static_cast<double>(s.syncIntervalNs));
+        }
+        frequencies.push_back(s.frequencyPpb);
+    }
+
+    // Deviations want the offsets in arrival order, so take them before sorting
+    std::vector<double> phase = offsets;
+    snapshot.offsetNs = Summarize(offsets);
+    snapshot.pathDelayNs = Summarize(delays);
+    snapshot.syncIntervalNs = Summarize(intervals);
+    snapshot.frequencyPpb = Summarize(frequencies);
+
+    // Samples are treated as evenly spaced at the median Sync interval
+    snapshot.tau0Sec = snapshot.syncIntervalNs.p50 / 1e9;
+    snapshot.deviations = ComputePTPDeviations(phase.data(), phase.size(), snapshot.tau0Sec);
+    return snapshot;
+}
+
+} // namespace AES67
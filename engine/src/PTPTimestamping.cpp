@@ -0,0 +1,318 @@
+// PTPTimestamping.cpp - Kernel/hardware timestamps for PTP event sockets
+// SPDX-License-Identifier: MIT
+
+#include "PTPTimestamping.h"
+#include "HostClock.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <fcntl.h>
+#include <linux/errqueue.h>
+#include <linux/ethtool.h>
+#include <linux/net_tstamp.h>
+#include <linux/ptp_clock.h>
+#include <linux/sockios.h>
+#include <net/if.h>
+#include <sys/ioctl.h>
+#endif
+
+namespace AES67 {
+namespace {
+
+constexpr int kTxTimestampTimeoutMs = 10;               // Wait for TX stamp on the error queue
+constexpr uint64_t kPhcOffsetRefreshNs = 100000000ULL;  // Re-measure PHC vs system every 100 ms
+
+uint64_t TimespecToNs(const struct timespec& ts) {
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+// Kernel software stamps are CLOCK_REALTIME
+uint64_t TimespecToHostNs(const struct timespec& ts) {
+    return HostClock::RealtimeToHostNs(TimespecToNs(ts));
+}
+
+#if defined(__linux__)
+// Ask the driver for hardware stamping and return the interface's PHC index (-1 if none)
+int EnableHardwareTimestamping(int sock, const char* interfaceName) {
+    ifreq ifr{};
+    std::strncpy(ifr.ifr_name, interfaceName, IFNAMSIZ - 1);
+
+    ethtool_ts_info info{};
+    info.cmd = ETHTOOL_GET_TS_INFO;
+    ifr.ifr_data = reinterpret_cast<char*>(&info);
+    if (ioctl(sock, SIOCETHTOOL, &ifr) < 0 || info.phc_index < 0) {
+        return -1;
+    }
+
+    const uint32_t required = SOF_TIMESTAMPING_TX_HARDWARE | SOF_TIMESTAMPING_RX_HARDWARE |
+                              SOF_TIMESTAMPING_RAW_HARDWARE;
+    if ((info.so_timestamping & required) != required) {
+        return -1;
+    }
+
+    hwtstamp_config config{};
+    config.tx_type = HWTSTAMP_TX_ON;
+    config.rx_filter = HWTSTAMP_FILTER_PTP_V2_L4_EVENT;
+    ifr.ifr_data = reinterpret_cast<char*>(&config);
+    if (ioctl(sock, SIOCSHWTSTAMP, &ifr) < 0) {
+        // Needs CAP_NET_ADMIN; another daemon may have configured it already
+        config = {};
+        if (ioctl(sock, SIOCGHWTSTAMP, &ifr) < 0 ||
+            config.tx_type != HWTSTAMP_TX_ON || config.rx_filter == HWTSTAMP_FILTER_NONE) {
+            return -1;
+        }
+    }
+
+    return info.phc_index;
+}
+#endif
+
+} // namespace
+
+const char* PTPTimestampModeName(PTPTimestampMode mode) {
+    switch (mode) {
+        case PTPTimestampMode::Hardware: return "hardware";
+        case PTPTimestampMode::Software: return "kernel software";
+        default: return "user-space";
+    }
+}
+
+PTPTimestamper::~PTPTimestamper() {
+    Close();
+}
+
+void PTPTimestamper::Close() {
+    if (phcFd_ >= 0) {
+        close(phcFd_);
+        phcFd_ = -1;
+    }
+    phcOffsetTimeNs_ = 0;
+    mode_ = PTPTimestampMode::User;
+}
+
+PTPTimestampMode PTPTimestamper::Enable(int sock, const char* interfaceName) {
+    Close();
+
+#if defined(__linux__)
+    // Hardware first: needs driver support plus a PHC we can read against system time
+    const int phcIndex = EnableHardwareTimestamping(sock, interfaceName);
+    if (phcIndex >= 0) {
+        char path[32];
+        std::snprintf(path, sizeof(path), "/dev/ptp%d", phcIndex);
+        phcFd_ = open(path, O_RDONLY);
+
+        int flags = SOF_TIMESTAMPING_TX_HARDWARE | SOF_TIMESTAMPING_RX_HARDWARE |
+                    SOF_TIMESTAMPING_RAW_HARDWARE;
+        uint64_t probe = 0;
+        if (phcFd_ >= 0 && PhcToHost(HostClock::RealtimeNowNs(), probe) &&
+            setsockopt(sock, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags)) == 0) {
+            mode_ = PTPTimestampMode::Hardware;
+            return mode_;
+        }
+        Close();
+    }
+
+    int flags = SOF_TIMESTAMPING_TX_SOFTWARE | SOF_TIMESTAMPING_RX_SOFTWARE |
+                SOF_TIMESTAMPING_SOFTWARE;
+    if (setsockopt(sock, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags)) == 0) {
+        mode_ = PTPTimestampMode::Software;
+        return mode_;
+    }
+#else
+    (void)interfaceName;
+
+    // RX arrival stamped by the kernel; TX stays in user space
+    int enable = 1;
+    if (setsockopt(sock, SOL_SOCKET, SO_TIMESTAMP, &enable, sizeof(enable)) == 0) {
+        mode_ = PTPTimestampMode::Software;
+        return mode_;
+    }
+#endif
+
+    mode_ = PTPTimestampMode::User;
+    return mode_;
+}
+
+ssize_t PTPTimestamper::Receive(int sock, uint8_t* buffer, size_t length,
+                                sockaddr_in* srcAddr, uint64_t& rxTimeNs) {
+    iovec iov{buffer, length};
+    alignas(cmsghdr) uint8_t control[256];
+
+    msghdr msg{};
+    msg.msg_name = srcAddr;
+    msg.msg_namelen = srcAddr ? sizeof(sockaddr_in) : 0;
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    const ssize_t bytes = recvmsg(sock, &msg, 0);
+    rxTimeNs = HostClock::NowNs();
+    if (bytes <= 0 || mode_ == PTPTimestampMode::User) {
+        return bytes;
+    }
+
+    for (cmsghdr* cm = CMSG_FIRSTHDR(&msg); cm != nullptr; cm = CMSG_NXTHDR(&msg, cm)) {
+        if (cm->cmsg_level != SOL_SOCKET) {
+            continue;
+        }
+#if defined(__linux__)
+        if (cm->cmsg_type == SO_TIMESTAMPING) {
+            // ts[0] = software, ts[2] = raw hardware
+            struct timespec ts[3];
+            std::memcpy(ts, CMSG_DATA(cm), sizeof(ts));
+            if (mode_ == PTPTimestampMode::Hardware) {
+                uint64_t hostNs = 0;
+                if ((ts[2].tv_sec || ts[2].tv_nsec) && PhcToHost(TimespecToNs(ts[2]), hostNs)) {
+                    rxTimeNs = hostNs;
+                }
+            } else if (ts[0].tv_sec || ts[0].tv_nsec) {
+                rxTimeNs = TimespecToHostNs(ts[0]);
+            }
+        }
+#else
+        if (cm->cmsg_type == SCM_TIMESTAMP) {
+            timeval tv{};
+            std::memcpy(&tv, CMSG_DATA(cm), sizeof(tv));
+            rxTimeNs = HostClock::RealtimeToHostNs(static_cast<uint64_t>(tv.tv_sec) * 1000000000ULL +
+                                                   static_cast<uint64_t>(tv.tv_usec) * 1000ULL);
+        }
+#endif
+    }
+
+    return bytes;
+}
+
+ssize_t PTPTimestamper::Send(int sock, const uint8_t* buffer, size_t length,
+                             const sockaddr_in& destAddr, uint64_t& txTimeNs) {
+    DrainErrorQueue(sock);
+
+    const ssize_t bytes = sendto(sock, buffer, length, 0,
+                                 reinterpret_cast<const sockaddr*>(&destAddr), sizeof(destAddr));
+    txTimeNs = HostClock::NowNs();
+
+    if (bytes > 0 && mode_ != PTPTimestampMode::User) {
+        uint64_t stamped = 0;
+        if (ReadTxTimestamp(sock, stamped)) {
+            txTimeNs = stamped;
+        }
+    }
+    return bytes;
+}
+
+bool PTPTimestamper::ReadTxTimestamp(int sock, uint64_t& txTimeNs) {
+#if defined(__linux__)
+    pollfd pfd{sock, POLLPRI, 0};
+    if (poll(&pfd, 1, kTxTimestampTimeoutMs) <= 0 || !(pfd.revents & POLLERR)) {
+        return false; // Driver did not deliver a stamp in time
+    }
+
+    uint8_t data[256];
+    iovec iov{data, sizeof(data)};
+    alignas(cmsghdr) uint8_t control[256];
+
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    if (recvmsg(sock, &msg, MSG_ERRQUEUE) < 0) {
+        return false;
+    }
+
+    for (cmsghdr* cm = CMSG_FIRSTHDR(&msg); cm != nullptr; cm = CMSG_NXTHDR(&msg, cm)) {
+        if (cm->cmsg_level != SOL_SOCKET || cm->cmsg_type != SO_TIMESTAMPING) {
+            continue;
+        }
+        struct timespec ts[3];
+        std::memcpy(ts, CMSG_DATA(cm), sizeof(ts));
+        if (mode_ == PTPTimestampMode::Hardware) {
+            return (ts[2].tv_sec || ts[2].tv_nsec) && PhcToHost(TimespecToNs(ts[2]), txTimeNs);
+        }
+        if (ts[0].tv_sec || ts[0].tv_nsec) {
+            txTimeNs = TimespecToHostNs(ts[0]);
+            return true;
+        }
+    }
+    return false;
+#else
+    (void)sock;
+    (void)txTimeNs;
+    return false;
+#endif
+}
+
+void PTPTimestamper::DrainErrorQueue(int sock) {
+#if defined(__linux__)
+    // Stale stamps (a previous timeout) would be mistaken for this packet's
+    if (mode_ == PTPTimestampMode::User) {
+        return;
+    }
+    uint8_t data[256];
+    alignas(cmsghdr) uint8_t control[256];
+    for (int i = 0; i < 8; ++i) {
+        iovec iov{data, sizeof(data)};
+        msghdr msg{};
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        if (recvmsg(sock, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+            break;
+        }
+    }
+#else
+    (void)sock;
+#endif
+}
+
+bool PTPTimestamper::PhcToHost(uint64_t phcNs, uint64_t& hostNs) {
+#if defined(__linux__)
+    if (phcFd_ < 0) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(phcMutex_);
+    const uint64_t nowNs = HostClock::NowNs();
+    if (phcOffsetTimeNs_ == 0 || nowNs - phcOffsetTimeNs_ > kPhcOffsetRefreshNs) {
+        // sys/phc/sys sandwiches; the tightest one bounds the read latency best
+        ptp_sys_offset offset{};
+        offset.n_samples = 5;
+        if (ioctl(phcFd_, PTP_SYS_OFFSET, &offset) < 0) {
+            return false;
+        }
+
+        int64_t bestWindow = INT64_MAX;
+        for (unsigned i = 0; i < offset.n_samples; ++i) {
+            const auto& before = offset.ts[2 * i];
+            const auto& phc = offset.ts[2 * i + 1];
+            const auto& after = offset.ts[2 * i + 2];
+            const int64_t t1 = before.sec * 1000000000LL + before.nsec;
+            const int64_t tp = phc.sec * 1000000000LL + phc.nsec;
+            const int64_t t2 = after.sec * 1000000000LL + after.nsec;
+            if (t2 - t1 < bestWindow) {
+                bestWindow = t2 - t1;
+                phcOffsetNs_ = tp - (t1 + (t2 - t1) / 2);
+            }
+        }
+        phcOffsetTimeNs_ = nowNs;
+    }
+
+    hostNs = HostClock::RealtimeToHostNs(static_cast<uint64_t>(static_cast<int64_t>(phcNs) - phcOffsetNs_));
+    return true;
+#else
+    (void)phcNs;
+    (void)hostNs;
+    return false;
+#endif
+}
+
+} // namespace AES67
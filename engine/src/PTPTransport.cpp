@@ -0,0 +1,375 @@
+// PTPTransport.cpp - PTP sockets and event thread shared by several domains
+// SPDX-License-Identifier: MIT
+
+#include "PTPTransport.h"
+#include "PTPClient.h"
+#include "HostClock.h"
+
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <ifaddrs.h>
+#include <iostream>
+#include <net/if.h>
+#if defined(__APPLE__)
+#include <net/if_dl.h>
+#endif
+#if defined(__linux__)
+#include <netpacket/packet.h>
+#endif
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace AES67 {
+
+PTPTransport::PTPTransport() {
+    domainSlot_.fill(kNoClient);
+}
+
+PTPTransport::~PTPTransport() {
+    Stop();
+}
+
+bool PTPTransport::Open(const char* interfaceName) {
+    if (IsOpen()) {
+        std::cerr << "PTPTransport: already open\n";
+        return false;
+    }
+
+    // Clock identity and source address for Delay_Req / Announce
+    if (!InitializeInterface(interfaceName)) {
+        std::cerr << "PTPTransport: failed to resolve interface " << interfaceName << "\n";
+        return false;
+    }
+    if (!OpenSockets(interfaceName)) {
+        return false;
+    }
+
+    // One thread serves every domain: it sleeps until a socket is readable or a timer is due
+    if (!eventLoop_.Open()) {
+        CloseSockets();
+        return false;
+    }
+    eventSocketIndex_ = eventLoop_.AddSocket(socketEvent_);
+    generalSocketIndex_ = eventLoop_.AddSocket(socketGeneral_);
+    if (eventSocketIndex_ < 0 || generalSocketIndex_ < 0) {
+        eventLoop_.Close();
+        CloseSockets();
+        return false;
+    }
+    generalBatch_.SetSocket(socketGeneral_);
+    return true;
+}
+
+bool PTPTransport::Start() {
+    if (running_) {
+        return true;
+    }
+    if (!IsOpen() || clientCount_ == 0) {
+        std::cerr << "PTPTransport: open it and attach a domain before starting\n";
+        return false;
+    }
+    running_ = true;
+    eventThread_ = std::thread(&PTPTransport::EventThread, this);
+    return true;
+}
+
+void PTPTransport::Stop() {
+    if (running_.exchange(false)) {
+        eventLoop_.Wake();
+    }
+    if (eventThread_.joinable()) {
+        eventThread_.join();
+    }
+    if (!IsOpen()) {
+        return;
+    }
+
+    // Each domain winds down while the sockets are still open (unicast cancellations)
+    for (size_t i = 0; i < clientCount_; ++i) {
+        clients_[i]->OnTransportStopped();
+    }
+    generalBatch_.Flush();
+    clients_.fill(nullptr);
+    clientCount_ = 0;
+    domainSlot_.fill(kNoClient);
+
+    eventLoop_.Close();
+    CloseSockets();
+}
+
+bool PTPTransport::Attach(PTPClient* client) {
+    if (running_ || !IsOpen()) {
+        std::cerr << "PTPTransport: domains attach after Open() and before Start()\n";
+        return false;
+    }
+    const uint8_t domain = client->GetDomain();
+    if (domainSlot_[domain] != kNoClient) {
+        std::cerr << "PTPTransport: domain " << static_cast<int>(domain) << " is already attached\n";
+        return false;
+    }
+    if (clientCount_ >= kMaxDomains) {
+        std::cerr << "PTPTransport: at most " << kMaxDomains << " domains per interface\n";
+        return false;
+    }
+    domainSlot_[domain] = static_cast<uint8_t>(clientCount_);
+    clients_[clientCount_++] = client;
+    return true;
+}
+
+void PTPTransport::Detach(PTPClient* client) {
+    size_t kept = 0;
+    domainSlot_.fill(kNoClient);
+    for (size_t i = 0; i < clientCount_; ++i) {
+        if (clients_[i] != client) {
+            domainSlot_[clients_[i]->GetDomain()] = static_cast<uint8_t>(kept);
+            clients_[kept++] = clients_[i];
+        }
+    }
+    for (size_t i = kept; i < clientCount_; ++i) {
+        clients_[i] = nullptr;
+    }
+    clientCount_ = kept;
+}
+
+PTPClient* PTPTransport::ClientFor(uint8_t domain) const {
+    const uint8_t slot = domainSlot_[domain];
+    return slot == kNoClient ? nullptr : clients_[slot];
+}
+
+ssize_t PTPTransport::SendEvent(const uint8_t* buffer, size_t length, const sockaddr_in& dest,
+                                uint64_t& txTimeNs) {
+    return timestamper_.Send(socketEvent_, buffer, length, dest, txTimeNs);
+}
+
+void PTPTransport::JoinPdelayGroup() {
+    if (pdelayJoined_) {
+        return;
+    }
+    ip_mreq mreq{};
+    inet_pton(AF_INET, kPTP_IPv4_PdelayMulticastAddr, &mreq.imr_multiaddr);
+    mreq.imr_interface = interfaceAddr_;
+    setsockopt(socketEvent_, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq));
+    setsockopt(socketGeneral_, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq));
+    pdelayJoined_ = true;
+}
+
+void PTPTransport::EventThread() {
+    while (running_) {
+        const PTPEventLoop::Ready ready = eventLoop_.Wait();
+        if (!running_) {
+            break;
+        }
+
+        if (ready.sockets & (1u << eventSocketIndex_)) {
+            ReceiveEventMessages();
+        }
+        if (ready.sockets & (1u << generalSocketIndex_)) {
+            ReceiveGeneralMessages();
+        }
+
+        // Each domain checks its own timer bits
+        const uint64_t nowNs = HostClock::NowNs();
+        for (size_t i = 0; i < clientCount_; ++i) {
+            clients_[i]->ServeTimers(ready.timers, nowNs);
+        }
+
+        // Follow_Up, Announce, Delay_Resp, Pdelay_Resp_Follow_Up and Signaling
+        // queued above, from every domain
+        generalBatch_.Flush();
+
+        if (dscp_.load(std::memory_order_relaxed) != appliedDscp_) {
+            ApplyDscp();
+        }
+    }
+}
+
+void PTPTransport::ApplyDscp() {
+    appliedDscp_ = dscp_.load(std::memory_order_relaxed);
+    int tos = appliedDscp_ << 2;    // DSCP is in top 6 bits of TOS byte
+    setsockopt(socketEvent_, IPPROTO_IP, IP_TOS, &tos, sizeof(tos));
+    setsockopt(socketGeneral_, IPPROTO_IP, IP_TOS, &tos, sizeof(tos));
+}
+
+void PTPTransport::ReceiveEventMessages() {
+    // Sync / Delay_Req / Pdelay, with kernel/hardware arrival stamps where available
+    uint8_t buffer[1500];
+    ssize_t bytes;
+    uint64_t rxTimeNs = 0;
+    sockaddr_in srcAddr{};
+    while ((bytes = timestamper_.Receive(socketEvent_, buffer, sizeof(buffer), &srcAddr, rxTimeNs)) > 0) {
+        if (bytes < static_cast<ssize_t>(sizeof(PTPHeader))) {
+            continue;
+        }
+        if (PTPClient* client = ClientFor(buffer[4])) {
+            client->HandleEventMessage(buffer, static_cast<size_t>(bytes), rxTimeNs, srcAddr);
+        }
+    }
+}
+
+void PTPTransport::ReceiveGeneralMessages() {
+    // Announce, Follow_Up, Delay_Resp, Pdelay_Resp_Follow_Up, Signaling
+    uint8_t buffer[1500];
+    ssize_t bytes;
+    bool announced[kMaxDomains] = {};
+    sockaddr_in srcAddr{};
+    socklen_t srcLen = sizeof(srcAddr);
+    while ((bytes = recvfrom(socketGeneral_, buffer, sizeof(buffer), 0,
+                             reinterpret_cast<sockaddr*>(&srcAddr), &srcLen)) > 0) {
+        srcLen = sizeof(srcAddr);
+        if (bytes < static_cast<ssize_t>(sizeof(PTPHeader))) {
+            continue;
+        }
+        const uint8_t slot = domainSlot_[buffer[4]];
+        if (slot != kNoClient &&
+            clients_[slot]->HandleGeneralMessage(buffer, static_cast<size_t>(bytes), srcAddr)) {
+            announced[slot] = true;
+        }
+    }
+
+    // React to a better master right away rather than at the next housekeeping tick
+    for (size_t i = 0; i < clientCount_; ++i) {
+        if (announced[i]) {
+            clients_[i]->RunBMCA(HostClock::NowNs());
+        }
+    }
+}
+
+bool PTPTransport::InitializeInterface(const char* interfaceName) {
+    bool haveIPv4 = false;
+    bool haveMac = false;
+    uint8_t macAddress[6]{};
+
+    struct ifaddrs* ifaddr = nullptr;
+    if (getifaddrs(&ifaddr) != 0) {
+        return false;
+    }
+
+    for (auto* ifa = ifaddr; ifa != nullptr; ifa = ifa->ifa_next) {
+        if (!ifa->ifa_addr) {
+            continue;
+        }
+
+        if (std::strcmp(ifa->ifa_name, interfaceName) != 0) {
+            continue;
+        }
+
+        if (ifa->ifa_addr->sa_family == AF_INET) {
+            interfaceAddr_ = reinterpret_cast<sockaddr_in*>(ifa->ifa_addr)->sin_addr;
+            haveIPv4 = true;
+        }
+#if defined(AF_LINK)
+        else if (ifa->ifa_addr->sa_family == AF_LINK) {
+            const auto* sdl = reinterpret_cast<sockaddr_dl*>(ifa->ifa_addr);
+            if (sdl->sdl_alen == 6) {
+                std::memcpy(macAddress, LLADDR(sdl), 6);
+                haveMac = true;
+            }
+        }
+#endif
+#if defined(AF_PACKET)
+        else if (ifa->ifa_addr->sa_family == AF_PACKET) {
+            const auto* sll = reinterpret_cast<sockaddr_ll*>(ifa->ifa_addr);
+            if (sll->sll_halen == 6) {
+                std::memcpy(macAddress, sll->sll_addr, 6);
+                haveMac = true;
+            }
+        }
+#endif
+    }
+
+    freeifaddrs(ifaddr);
+
+    if (!haveIPv4 || !haveMac) {
+        return false;
+    }
+
+    // EUI-64 from the MAC, shared by every domain on this interface
+    clockIdentity_.id[0] = macAddress[0];
+    clockIdentity_.id[1] = macAddress[1];
+    clockIdentity_.id[2] = macAddress[2];
+    clockIdentity_.id[3] = 0xFF;
+    clockIdentity_.id[4] = 0xFE;
+    clockIdentity_.id[5] = macAddress[3];
+    clockIdentity_.id[6] = macAddress[4];
+    clockIdentity_.id[7] = macAddress[5];
+
+    return true;
+}
+
+bool PTPTransport::OpenSockets(const char* interfaceName) {
+    socketEvent_ = socket(AF_INET, SOCK_DGRAM, 0);
+    if (socketEvent_ < 0) {
+        std::cerr << "PTPTransport: failed to create event socket: " << std::strerror(errno) << "\n";
+        return false;
+    }
+
+    socketGeneral_ = socket(AF_INET, SOCK_DGRAM, 0);
+    if (socketGeneral_ < 0) {
+        std::cerr << "PTPTransport: failed to create general socket: " << std::strerror(errno) << "\n";
+        CloseSockets();
+        return false;
+    }
+
+    int reuse = 1;
+    setsockopt(socketEvent_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    setsockopt(socketGeneral_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    sockaddr_in addrEvent{};
+    addrEvent.sin_family = AF_INET;
+    addrEvent.sin_addr.s_addr = INADDR_ANY;
+    addrEvent.sin_port = htons(kPTP_Event_Port);
+    if (bind(socketEvent_, reinterpret_cast<sockaddr*>(&addrEvent), sizeof(addrEvent)) < 0) {
+        std::cerr << "PTPTransport: failed to bind event socket to port 319: " << std::strerror(errno) << "\n";
+        CloseSockets();
+        return false;
+    }
+
+    sockaddr_in addrGeneral{};
+    addrGeneral.sin_family = AF_INET;
+    addrGeneral.sin_addr.s_addr = INADDR_ANY;
+    addrGeneral.sin_port = htons(kPTP_General_Port);
+    if (bind(socketGeneral_, reinterpret_cast<sockaddr*>(&addrGeneral), sizeof(addrGeneral)) < 0) {
+        std::cerr << "PTPTransport: failed to bind general socket to port 320: " << std::strerror(errno) << "\n";
+        CloseSockets();
+        return false;
+    }
+
+    const PTPTimestampMode tsMode = timestamper_.Enable(socketEvent_, interfaceName);
+    std::cerr << "PTPTransport: using " << PTPTimestampModeName(tsMode) << " timestamps on " << interfaceName << "\n";
+
+    // Every domain and role listens to the PTP group; Pdelay joins its own on demand
+    ip_mreq mreq{};
+    inet_pton(AF_INET, kPTP_IPv4_MulticastAddr, &mreq.imr_multiaddr);
+    mreq.imr_interface = interfaceAddr_;
+    setsockopt(socketEvent_, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq));
+    setsockopt(socketGeneral_, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq));
+
+    fcntl(socketEvent_, F_SETFL, O_NONBLOCK);
+    fcntl(socketGeneral_, F_SETFL, O_NONBLOCK);
+
+    uint8_t ttl = 1;
+    setsockopt(socketEvent_, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+    setsockopt(socketGeneral_, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+
+    setsockopt(socketEvent_, IPPROTO_IP, IP_MULTICAST_IF, &interfaceAddr_, sizeof(interfaceAddr_));
+    setsockopt(socketGeneral_, IPPROTO_IP, IP_MULTICAST_IF, &interfaceAddr_, sizeof(interfaceAddr_));
+    ApplyDscp();
+    return true;
+}
+
+void PTPTransport::CloseSockets() {
+    timestamper_.Close();
+    if (socketEvent_ >= 0) {
+        close(socketEvent_);
+        socketEvent_ = -1;
+    }
+    if (socketGeneral_ >= 0) {
+        close(socketGeneral_);
+        socketGeneral_ = -1;
+    }
+    pdelayJoined_ = false;
+}
+
+} // namespace AES67
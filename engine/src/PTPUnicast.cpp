@@ -0,0 +1,265 @@
+// PTPUnicast.cpp - PTP unicast negotiation, per-slave state and batched sends
+// SPDX-License-Identifier: MIT
+
+#include "PTPUnicast.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <sys/socket.h>
+
+namespace AES67 {
+namespace {
+
+uint16_t ReadUint16(const uint8_t* buffer) {
+    return static_cast<uint16_t>(buffer[0] << 8 | buffer[1]);
+}
+
+void WriteUint16(uint8_t* buffer, uint16_t value) {
+    buffer[0] = static_cast<uint8_t>(value >> 8);
+    buffer[1] = static_cast<uint8_t>(value);
+}
+
+} // namespace
+
+// ============================================================================
+// Negotiation TLVs
+// ============================================================================
+
+size_t WritePTPUnicastTLV(uint8_t* buffer, const PTPUnicastMessage& message) {
+    // messageType sits in the upper nibble of the first value octet
+    const uint8_t type = static_cast<uint8_t>(static_cast<uint8_t>(message.messageType) << 4);
+    WriteUint16(buffer, static_cast<uint16_t>(message.tlv));
+
+    switch (message.tlv) {
+        case PTPUnicastTLV::Request:
+            WriteUint16(buffer + 2, 6);
+            buffer[4] = type;
+            buffer[5] = static_cast<uint8_t>(message.logInterval);
+            WriteUint16(buffer + 6, static_cast<uint16_t>(message.durationSec >> 16));
+            WriteUint16(buffer + 8, static_cast<uint16_t>(message.durationSec));
+            return 10;
+        case PTPUnicastTLV::Grant:
+            WriteUint16(buffer + 2, 8);
+            buffer[4] = type;
+            buffer[5] = static_cast<uint8_t>(message.logInterval);
+            WriteUint16(buffer + 6, static_cast<uint16_t>(message.durationSec >> 16));
+            WriteUint16(buffer + 8, static_cast<uint16_t>(message.durationSec));
+            buffer[10] = 0;
+            buffer[11] = message.renewal ? 0x01 : 0x00;
+            return 12;
+        default: // Cancel / AckCancel
+            WriteUint16(buffer + 2, 2);
+            buffer[4] = type;
+            buffer[5] = 0;
+            return 6;
+    }
+}
+
+size_t ParsePTPUnicastTLVs(const uint8_t* buffer, size_t length,
+                           PTPUnicastMessage* messages, size_t maxMessages) {
+    if (length < kPTPSignalingHeaderLength ||
+        (buffer[0] & 0x0F) != static_cast<uint8_t>(PTPMessageType::Signaling)) {
+        return 0;
+    }
+    length = std::min<size_t>(length, ReadUint16(buffer + 2));
+
+    size_t count = 0;
+    size_t offset = kPTPSignalingHeaderLength;
+    while (offset + 4 <= length && count < maxMessages) {
+        const uint16_t tlvType = ReadUint16(buffer + offset);
+        const uint16_t tlvLength = ReadUint16(buffer + offset + 2);
+        const uint8_t* value = buffer + offset + 4;
+        if (offset + 4 + tlvLength > length) {
+            break;
+        }
+        offset += 4 + tlvLength;
+
+        PTPUnicastMessage& m = messages[count];
+        m = {};
+        m.tlv = static_cast<PTPUnicastTLV>(tlvType);
+        switch (m.tlv) {
+            case PTPUnicastTLV::Request:
+            case PTPUnicastTLV::Grant:
+                if (tlvLength < (m.tlv == PTPUnicastTLV::Grant ? 8 : 6)) {
+                    continue;
+                }
+                m.messageType = static_cast<PTPMessageType>(value[0] >> 4);
+                m.logInterval = static_cast<int8_t>(value[1]);
+                m.durationSec = static_cast<uint32_t>(ReadUint16(value + 2)) << 16 | ReadUint16(value + 4);
+                m.renewal = m.tlv == PTPUnicastTLV::Grant && (value[7] & 0x01);
+                count++;
+                break;
+            case PTPUnicastTLV::Cancel:
+            case PTPUnicastTLV::AckCancel:
+                if (tlvLength < 2) {
+                    continue;
+                }
+                m.messageType = static_cast<PTPMessageType>(value[0] >> 4);
+                count++;
+                break;
+            default:
+                break; // Not a negotiation TLV
+        }
+    }
+    return count;
+}
+
+// ============================================================================
+// Slave table
+// ============================================================================
+
+PTPSlaveTable::PTPSlaveTable(size_t maxSlaves)
+    : maxSlaves_(maxSlaves) {
+    size_t slots = 16;
+    while (slots < maxSlaves * 2) {
+        slots <<= 1;
+    }
+    slots_.resize(slots);
+    used_.assign(slots, 0);
+    mask_ = slots - 1;
+}
+
+size_t PTPSlaveTable::Home(const PTPPortIdentity& identity) const {
+    // FNV-1a over the 10-byte port identity
+    uint32_t hash = 2166136261u;
+    for (uint8_t byte : identity.clock.id) {
+        hash = (hash ^ byte) * 16777619u;
+    }
+    hash = (hash ^ static_cast<uint8_t>(identity.port >> 8)) * 16777619u;
+    hash = (hash ^ static_cast<uint8_t>(identity.port)) * 16777619u;
+    return hash & mask_;
+}
+
+PTPSlaveEntry* PTPSlaveTable::Find(const PTPPortIdentity& identity) {
+    for (size_t slot = Home(identity); used_[slot]; slot = (slot + 1) & mask_) {
+        if (slots_[slot].identity == identity) {
+            return &slots_[slot];
+        }
+    }
+    return nullptr;
+}
+
+PTPSlaveEntry* PTPSlaveTable::Insert(const PTPPortIdentity& identity) {
+    size_t slot = Home(identity);
+    for (; used_[slot]; slot = (slot + 1) & mask_) {
+        if (slots_[slot].identity == identity) {
+            return &slots_[slot];
+        }
+    }
+    if (size_ >= maxSlaves_) {
+        return nullptr;
+    }
+    slots_[slot] = {};
+    slots_[slot].identity = identity;
+    used_[slot] = 1;
+    size_++;
+    return &slots_[slot];
+}
+
+bool PTPSlaveTable::Erase(const PTPPortIdentity& identity) {
+    for (size_t slot = Home(identity); used_[slot]; slot = (slot + 1) & mask_) {
+        if (slots_[slot].identity == identity) {
+            EraseSlot(slot);
+            return true;
+        }
+    }
+    return false;
+}
+
+void PTPSlaveTable::EraseSlot(size_t slot) {
+    // Backward-shift: pull later members of the probe run into the hole
+    size_t hole = slot;
+    for (size_t next = (hole + 1) & mask_; used_[next]; next = (next + 1) & mask_) {
+        const size_t home = Home(slots_[next].identity);
+        // Move if home is not cyclically within (hole, next]
+        if (((next - home) & mask_) >= ((next - hole) & mask_)) {
+            slots_[hole] = slots_[next];
+            hole = next;
+        }
+    }
+    used_[hole] = 0;
+    size_--;
+}
+
+void PTPSlaveTable::Clear() {
+    used_.assign(used_.size(), 0);
+    size_ = 0;
+}
+
+size_t PTPSlaveTable::Expire(uint64_t nowNs, uint64_t idleNs) {
+    size_t removed = 0;
+    for (size_t slot = 0; slot < slots_.size();) {
+        const PTPSlaveEntry& e = slots_[slot];
+        if (used_[slot] && !e.announce.Active(nowNs) && !e.sync.Active(nowNs) &&
+            !e.delayResp.Active(nowNs) && nowNs - e.lastSeenNs > idleNs) {
+            EraseSlot(slot);    // May shift another entry into this slot: look again
+            removed++;
+        } else {
+            slot++;
+        }
+    }
+    return removed;
+}
+
+// ============================================================================
+// Send batch
+// ============================================================================
+
+uint8_t* PTPSendBatch::Add(const sockaddr_in& dest, size_t length) {
+    if (length > kMaxMessageLength) {
+        return nullptr;
+    }
+    if (count_ == kMaxMessages) {
+        Flush();
+    }
+    dests_[count_] = dest;
+    lengths_[count_] = length;
+    return buffers_[count_++];
+}
+
+void PTPSendBatch::Flush() {
+    if (count_ == 0) {
+        return;
+    }
+    flushes_++;
+
+#if defined(__linux__)
+    mmsghdr msgs[kMaxMessages]{};
+    iovec iovs[kMaxMessages];
+    for (size_t i = 0; i < count_; ++i) {
+        iovs[i] = {buffers_[i], lengths_[i]};
+        msgs[i].msg_hdr.msg_name = &dests_[i];
+        msgs[i].msg_hdr.msg_namelen = sizeof(dests_[i]);
+        msgs[i].msg_hdr.msg_iov = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    size_t done = 0;
+    while (done < count_) {
+        const int n = sendmmsg(sock_, msgs + done, static_cast<unsigned>(count_ - done), 0);
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            std::cerr << "PTPSendBatch: sendmmsg failed: " << std::strerror(errno) << "\n";
+            done++; // Skip the datagram that failed
+            continue;
+        }
+        done += static_cast<size_t>(n);
+        sent_ += static_cast<uint64_t>(n);
+    }
+#else
+    for (size_t i = 0; i < count_; ++i) {
+        if (sendto(sock_, buffers_[i], lengths_[i], 0,
+                   reinterpret_cast<const sockaddr*>(&dests_[i]), sizeof(dests_[i])) < 0) {
+            std::cerr << "PTPSendBatch: sendto failed: " << std::strerror(errno) << "\n";
+        } else {
+            sent_++;
+        }
+    }
+#endif
+    count_ = 0;
+}
+
+} // namespace AES67
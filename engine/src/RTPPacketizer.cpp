@@ -73,7 +73,21 @@ RTPDepacketizer::RTPDepacketizer(uint8_t channels, uint32_t sampleRate)
     , firstPacket_(true)
 {}
 
-uint32_t RTPDepacketizer::ParsePacket(const uint8_t* packet, size_t packetSize, int32_t* outSamples) {
+void RTPDepacketizer::Configure(uint8_t channels, uint8_t payloadType, uint8_t bytesPerSample) {
+    channels_ = channels;
+    payloadType_ = payloadType;
+    bytesPerSample_ = bytesPerSample;
+    lastSequence_ = 0;
+    lastTimestamp_ = 0;
+    packetLoss_ = 0;
+    ssrc_ = 0;
+    foreignPackets_ = 0;
+    foreignStreak_ = 0;
+    firstPacket_ = true;
+}
+
+uint32_t RTPDepacketizer::ParsePacket(const uint8_t* packet, size_t packetSize, int32_t* outSamples,
+                                      uint32_t maxFrames) {
     if (!packet || !outSamples || packetSize < sizeof(RTPHeader)) {
         return 0;
     }
@@ -86,10 +100,22 @@ uint32_t RTPDepacketizer::ParsePacket(const uint8_t* packet, size_t packetSize,
         return 0; // Invalid RTP version
     }
     
-    if (header->GetPayloadType() != kRTPPayloadType_L24) {
+    if (header->GetPayloadType() != payloadType_) {
         return 0; // Wrong payload type
     }
     
+    // Another sender on the same group and port
+    const uint32_t ssrc = ntohl(header->ssrc);
+    if (!firstPacket_ && ssrc != ssrc_) {
+        foreignPackets_++;
+        if (++foreignStreak_ < kSSRCTakeoverPackets) {
+            return 0;
+        }
+        firstPacket_ = true;    // Ours went quiet: follow the new one
+    }
+    foreignStreak_ = 0;
+    ssrc_ = ssrc;
+    
     const uint16_t sequence = ntohs(header->sequence);
     const uint32_t timestamp = ntohl(header->timestamp);
     
@@ -115,21 +141,29 @@ uint32_t RTPDepacketizer::ParsePacket(const uint8_t* packet, size_t packetSize,
     }
     
     const size_t payloadSize = packetSize - headerSize;
-    const size_t bytesPerFrame = channels_ * 3; // L24
+    const size_t bytesPerFrame = channels_ * bytesPerSample_;
     
-    if (payloadSize % bytesPerFrame != 0) {
+    if (bytesPerFrame == 0 || payloadSize % bytesPerFrame != 0) {
         return 0; // Invalid payload size
     }
     
     const uint32_t frameCount = static_cast<uint32_t>(payloadSize / bytesPerFrame);
+    if (frameCount > maxFrames) {
+        return 0;
+    }
     
-    // Decode L24 payload to int32 samples
+    // Decode L24/L16 payload to int32 samples
     const uint8_t* payload = packet + headerSize;
+    const uint8_t stride = outputChannels_ > channels_ ? outputChannels_ : channels_;
     
     for (uint32_t frame = 0; frame < frameCount; ++frame) {
+        int32_t* out = outSamples + frame * stride;
         for (uint8_t ch = 0; ch < channels_; ++ch) {
-            outSamples[frame * channels_ + ch] = L24ToInt32(payload);
-            payload += 3;
+            out[ch] = bytesPerSample_ == 3 ? L24ToInt32(payload) : L16ToInt32(payload);
+            payload += bytesPerSample_;
+        }
+        for (uint8_t ch = channels_; ch < stride; ++ch) {
+            out[ch] = 0;
         }
     }
     
@@ -0,0 +1,461 @@
+// RTPReceiver.cpp - Shared RX sockets demultiplexed to RX slots
+// SPDX-License-Identifier: MIT
+
+#include "RTPReceiver.h"
+#include <arpa/inet.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace AES67 {
+
+namespace {
+
+std::string AddrString(uint32_t addr) {
+    char text[INET_ADDRSTRLEN] = {};
+    in_addr in{};
+    in.s_addr = addr;
+    inet_ntop(AF_INET, &in, text, sizeof(text));
+    return text;
+}
+
+} // namespace
+
+void RxDemuxTable::Clear() {
+    entries_.fill(Entry{});
+    count_ = 0;
+    ssrcEntries_ = 0;
+}
+
+bool RxDemuxTable::Insert(uint32_t addr, uint16_t port, uint32_t ssrc, bool anySsrc, uint8_t slot) {
+    if (anySsrc) {
+        ssrc = 0;
+    }
+    const uint8_t state = anySsrc ? 2 : 1;
+    for (size_t i = Hash(addr, port, ssrc), n = 0; n < kCapacity; i = (i + 1) & (kCapacity - 1), ++n) {
+        Entry& e = entries_[i];
+        if (e.state == state && e.addr == addr && e.port == port && e.ssrc == ssrc) {
+            return false;
+        }
+        if (e.state == 0) {
+            e = Entry{addr, ssrc, port, slot, state};
+            count_++;
+            if (!anySsrc) ssrcEntries_++;
+            return true;
+        }
+    }
+    return false;
+}
+
+void RTPReceiver::Apply(const std::array<const RxSubscription*, kSlots>& subscriptions, in_addr interfaceAddr) {
+    interfaceAddr_ = interfaceAddr;
+    demux_.Clear();
+
+    // What each port needs: the groups on it, each with the union of its
+    // slots' source filters, and the unicast addresses of ours
+    struct PortPlan {
+        uint16_t port = 0;
+        std::vector<Membership> groups;
+        std::vector<uint32_t> unicast;
+    };
+    std::vector<PortPlan> plans;
+    size_t slots = 0;
+
+    for (size_t slot = 0; slot < kSlots; ++slot) {
+        const RxSubscription* subscription = subscriptions[slot];
+        if (!subscription) continue;
+
+        in_addr addr{};
+        if (inet_pton(AF_INET, subscription->address.c_str(), &addr) != 1) {
+            fprintf(stderr, "RTPReceiver: Bad address %s for stream %zu\n", subscription->address.c_str(), slot);
+            continue;
+        }
+        if (!demux_.Insert(addr.s_addr, subscription->port, subscription->ssrc, !subscription->pinSsrc,
+                           static_cast<uint8_t>(slot))) {
+            fprintf(stderr, "RTPReceiver: Stream %zu duplicates another stream's %s:%u, ignored\n",
+                    slot, subscription->address.c_str(), subscription->port);
+            continue;
+        }
+        slots++;
+
+        auto plan = std::find_if(plans.begin(), plans.end(),
+                                 [&](const PortPlan& p) { return p.port == subscription->port; });
+        if (plan == plans.end()) {
+            plans.push_back(PortPlan{subscription->port, {}, {}});
+            plan = plans.end() - 1;
+        }
+        if (!IN_MULTICAST(ntohl(addr.s_addr))) {
+            plan->unicast.push_back(addr.s_addr);
+            continue;
+        }
+
+        Membership wanted;
+        wanted.group = addr.s_addr;
+        wanted.exclude = subscription->excludeSources;
+        for (const std::string& source : subscription->sources) {
+            in_addr sourceAddr{};
+            if (inet_pton(AF_INET, source.c_str(), &sourceAddr) == 1) {
+                wanted.sources.push_back(sourceAddr.s_addr);
+            }
+        }
+        std::sort(wanted.sources.begin(), wanted.sources.end());
+        wanted.sources.erase(std::unique(wanted.sources.begin(), wanted.sources.end()), wanted.sources.end());
+        if (wanted.sources.empty()) {
+            wanted.exclude = false;
+        }
+
+        auto group = std::find_if(plan->groups.begin(), plan->groups.end(),
+                                  [&](const Membership& m) { return m.group == wanted.group; });
+        if (group == plan->groups.end()) {
+            plan->groups.push_back(std::move(wanted));
+        } else if (group->sources.empty() || wanted.sources.empty() ||
+                   group->exclude != wanted.exclude || (group->exclude && group->sources != wanted.sources)) {
+            // Slots disagree: the socket takes any source, each slot filters its own
+            group->sources.clear();
+            group->exclude = false;
+        } else if (!group->exclude) {
+            std::vector<uint32_t> merged;
+            std::set_union(group->sources.begin(), group->sources.end(),
+                           wanted.sources.begin(), wanted.sources.end(), std::back_inserter(merged));
+            group->sources = std::move(merged);
+        }
+    }
+
+    // Keep sockets that are still wanted, open the missing ones
+    auto take = [&](uint32_t bindAddr, uint16_t port, std::vector<Socket>& into) -> Socket* {
+        for (Socket& socket : sockets_) {
+            if (socket.fd >= 0 && socket.bindAddr == bindAddr && socket.port == port) {
+                into.push_back(std::move(socket));
+                socket.fd = -1;
+                return &into.back();
+            }
+        }
+        const int fd = OpenSocket(bindAddr, port);
+        if (fd < 0) return nullptr;
+        into.push_back(Socket{fd, bindAddr, port, {}});
+        return &into.back();
+    };
+
+    std::vector<Socket> next;
+    next.reserve(sockets_.size() + kSlots);
+    for (PortPlan& plan : plans) {
+        if (Socket* shared = take(INADDR_ANY, plan.port, next)) {
+            SetMemberships(*shared, std::move(plan.groups));
+            continue;
+        }
+        // Wildcard refused: one socket per address, bound to it
+        for (Membership& group : plan.groups) {
+            if (Socket* own = take(group.group, plan.port, next)) {
+                SetMemberships(*own, {std::move(group)});
+            }
+        }
+        for (uint32_t addr : plan.unicast) {
+            take(addr, plan.port, next);
+        }
+    }
+
+    // Sockets no longer needed; closing leaves their groups
+    for (Socket& socket : sockets_) {
+        if (socket.fd >= 0) {
+            close(socket.fd);
+        }
+    }
+    sockets_ = std::move(next);
+
+    pollFds_.clear();
+    size_t groups = 0;
+    for (const Socket& socket : sockets_) {
+        pollFds_.push_back(pollfd{socket.fd, POLLIN, 0});
+        groups += socket.joined.size();
+    }
+    nextReady_ = 0;
+    pending_ = 0;
+
+    fprintf(stderr, "RTPReceiver: %zu stream(s) on %zu socket(s), %zu group(s) joined\n",
+            slots, sockets_.size(), groups);
+}
+
+void RTPReceiver::Close() {
+    for (Socket& socket : sockets_) {
+        close(socket.fd);
+    }
+    sockets_.clear();
+    pollFds_.clear();
+    nextReady_ = 0;
+    pending_ = 0;
+    demux_.Clear();
+}
+
+void RTPReceiver::SetSocketOptions(int receiveBufferBytes, uint8_t dscp) {
+    if (receiveBufferBytes == receiveBufferBytes_ && dscp == dscp_) {
+        return;
+    }
+    receiveBufferBytes_ = receiveBufferBytes;
+    dscp_ = dscp;
+    for (const Socket& socket : sockets_) {
+        ApplySocketOptions(socket.fd);
+    }
+}
+
+void RTPReceiver::ApplySocketOptions(int fd) const {
+    // Room for every stream on the port
+    int recvBufSize = receiveBufferBytes_;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &recvBufSize, sizeof(recvBufSize));
+
+    // Set DSCP for QoS (EF = 46 for expedited forwarding)
+    int dscp = dscp_ << 2; // DSCP is in top 6 bits of TOS byte
+    setsockopt(fd, IPPROTO_IP, IP_TOS, &dscp, sizeof(dscp));
+}
+
+ssize_t RTPReceiver::Receive(uint8_t* buffer, size_t length, int timeoutMs, RxPacketInfo& info) {
+    if (pollFds_.empty()) {
+        return 0;
+    }
+
+    bool polled = false;
+    for (;;) {
+        // One packet per ready socket in turn, until each would block
+        while (pending_ > 0) {
+            if (nextReady_ >= pollFds_.size()) {
+                nextReady_ = 0;
+            }
+            pollfd& pfd = pollFds_[nextReady_];
+            const Socket& socket = sockets_[nextReady_];
+            nextReady_++;
+            if (!(pfd.revents & POLLIN)) {
+                continue;
+            }
+            const ssize_t bytes = ReadPacket(socket, buffer, length, info);
+            if (bytes < 0) {
+                pfd.revents = 0;
+                pending_--;
+            } else if (bytes > 0) {
+                return bytes;
+            }
+        }
+        if (polled) {
+            return 0;
+        }
+
+        if (poll(pollFds_.data(), pollFds_.size(), timeoutMs) <= 0) {
+            return 0;
+        }
+        polled = true;
+        nextReady_ = 0;
+        for (const pollfd& pfd : pollFds_) {
+            if (pfd.revents & POLLIN) pending_++;
+        }
+    }
+}
+
+ssize_t RTPReceiver::ReadPacket(const Socket& socket, uint8_t* buffer, size_t length, RxPacketInfo& info) {
+    sockaddr_in from{};
+    iovec iov{buffer, length};
+    alignas(cmsghdr) uint8_t control[64];
+
+    msghdr msg{};
+    msg.msg_name = &from;
+    msg.msg_namelen = sizeof(from);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    const ssize_t bytes = recvmsg(socket.fd, &msg, MSG_DONTWAIT);
+    if (bytes < 0) {
+        return -1;      // Drained (or failed; poll() reports it again)
+    }
+    if (msg.msg_flags & MSG_TRUNC) {
+        truncated_++;   // Cut to the buffer: the audio would not match its header
+        return 0;
+    }
+
+    // Destination address: the group (or our unicast address) it was sent to
+    uint32_t dest = socket.bindAddr;
+    for (cmsghdr* cm = CMSG_FIRSTHDR(&msg); cm != nullptr; cm = CMSG_NXTHDR(&msg, cm)) {
+        if (cm->cmsg_level != IPPROTO_IP) {
+            continue;
+        }
+#if defined(IP_PKTINFO)
+        if (cm->cmsg_type == IP_PKTINFO) {
+            in_pktinfo pktinfo{};
+            std::memcpy(&pktinfo, CMSG_DATA(cm), sizeof(pktinfo));
+            dest = pktinfo.ipi_addr.s_addr;
+        }
+#elif defined(IP_RECVDSTADDR)
+        if (cm->cmsg_type == IP_RECVDSTADDR) {
+            in_addr addr{};
+            std::memcpy(&addr, CMSG_DATA(cm), sizeof(addr));
+            dest = addr.s_addr;
+        }
+#endif
+    }
+
+    // RTP header is at least 12 bytes; SSRC at offset 8
+    int slot = -1;
+    if (bytes >= 12) {
+        const uint32_t ssrc = (static_cast<uint32_t>(buffer[8]) << 24) | (static_cast<uint32_t>(buffer[9]) << 16) |
+                              (static_cast<uint32_t>(buffer[10]) << 8) | buffer[11];
+        slot = demux_.Find(dest, socket.port, ssrc);
+    }
+    if (slot < 0) {
+        unmatched_++;
+        return 0;
+    }
+
+    info.slot = static_cast<uint8_t>(slot);
+    info.sourceAddr = from.sin_addr.s_addr;
+    return bytes;
+}
+
+int RTPReceiver::OpenSocket(uint32_t bindAddr, uint16_t port) {
+    const int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sock < 0) {
+        fprintf(stderr, "RTPReceiver: Failed to create socket\n");
+        return -1;
+    }
+
+    // Several sockets (or processes) may share a port
+    int reuse = 1;
+    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    #ifdef SO_REUSEPORT
+    setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, &reuse, sizeof(reuse));
+    #endif
+
+    // Set socket priority for real-time audio (SO_PRIORITY is Linux-specific)
+    #ifdef __linux__
+    int priority = 6; // Real-time priority
+    setsockopt(sock, SOL_SOCKET, SO_PRIORITY, &priority, sizeof(priority));
+    #endif
+
+    ApplySocketOptions(sock);
+
+    // Each packet's destination address, for the demultiplexer
+    int on = 1;
+    #if defined(IP_PKTINFO)
+    setsockopt(sock, IPPROTO_IP, IP_PKTINFO, &on, sizeof(on));
+    #elif defined(IP_RECVDSTADDR)
+    setsockopt(sock, IPPROTO_IP, IP_RECVDSTADDR, &on, sizeof(on));
+    #endif
+
+    #ifdef IP_MULTICAST_ALL
+    int all = 0;    // Linux: only groups joined on this socket
+    setsockopt(sock, IPPROTO_IP, IP_MULTICAST_ALL, &all, sizeof(all));
+    #endif
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = bindAddr;
+    if (bind(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        fprintf(stderr, "RTPReceiver: Cannot bind %s:%u: %s\n", AddrString(bindAddr).c_str(), port, strerror(errno));
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+void RTPReceiver::SetMemberships(Socket& socket, std::vector<Membership> wanted) {
+    std::vector<Membership> kept;
+    for (Membership& joined : socket.joined) {
+        const auto it = std::find_if(wanted.begin(), wanted.end(),
+                                     [&](const Membership& m) { return m.SameFilter(joined); });
+        if (it != wanted.end()) {
+            kept.push_back(std::move(joined));
+            wanted.erase(it);
+        } else {
+            Leave(socket.fd, joined);
+        }
+    }
+    for (Membership& membership : wanted) {
+        if (Join(socket.fd, membership)) {
+            kept.push_back(std::move(membership));
+        }
+    }
+    socket.joined = std::move(kept);
+}
+
+// IGMPv3 source-specific joins for incl, an any-source join (plus blocks
+// for excl) otherwise or when the source-specific join is refused
+bool RTPReceiver::Join(int fd, Membership& membership) {
+    in_addr group{};
+    group.s_addr = membership.group;
+    in_addr source{};
+
+    if (!membership.sources.empty() && !membership.exclude) {
+        size_t joined = 0;
+        for (uint32_t sourceAddr : membership.sources) {
+            ip_mreq_source mreq{};
+            mreq.imr_multiaddr = group;
+            source.s_addr = sourceAddr;
+            mreq.imr_sourceaddr = source;
+            mreq.imr_interface = interfaceAddr_;
+            if (setsockopt(fd, IPPROTO_IP, IP_ADD_SOURCE_MEMBERSHIP, &mreq, sizeof(mreq)) < 0) {
+                break;
+            }
+            joined++;
+        }
+        if (joined == membership.sources.size()) {
+            membership.sourceSpecific = true;
+            return true;
+        }
+        perror("RTPReceiver: Source-specific join failed, joining any-source");
+        Membership partial = membership;
+        partial.sourceSpecific = true;
+        partial.sources.resize(joined);
+        Leave(fd, partial);
+    }
+    membership.sourceSpecific = false;
+
+    ip_mreq mreq{};
+    mreq.imr_multiaddr = group;
+    mreq.imr_interface = interfaceAddr_;
+    if (setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0) {
+        char error_msg[256];
+        snprintf(error_msg, sizeof(error_msg), "RTPReceiver: Failed to join multicast group %s",
+                 AddrString(membership.group).c_str());
+        perror(error_msg);
+        return false;
+    }
+
+    // Excluded senders: block them in the kernel where it can
+    if (membership.exclude) {
+        for (uint32_t sourceAddr : membership.sources) {
+            ip_mreq_source block{};
+            block.imr_multiaddr = group;
+            source.s_addr = sourceAddr;
+            block.imr_sourceaddr = source;
+            block.imr_interface = interfaceAddr_;
+            setsockopt(fd, IPPROTO_IP, IP_BLOCK_SOURCE, &block, sizeof(block));
+        }
+    }
+    return true;
+}
+
+void RTPReceiver::Leave(int fd, const Membership& membership) {
+    in_addr group{};
+    group.s_addr = membership.group;
+    if (membership.sourceSpecific) {
+        for (uint32_t sourceAddr : membership.sources) {
+            ip_mreq_source mreq{};
+            mreq.imr_multiaddr = group;
+            in_addr source{};
+            source.s_addr = sourceAddr;
+            mreq.imr_sourceaddr = source;
+            mreq.imr_interface = interfaceAddr_;
+            setsockopt(fd, IPPROTO_IP, IP_DROP_SOURCE_MEMBERSHIP, &mreq, sizeof(mreq));
+        }
+        return;
+    }
+    ip_mreq mreq{};
+    mreq.imr_multiaddr = group;
+    mreq.imr_interface = interfaceAddr_;
+    setsockopt(fd, IPPROTO_IP, IP_DROP_MEMBERSHIP, &mreq, sizeof(mreq));
+}
+
+} // namespace AES67
@@ -0,0 +1,85 @@
+// RxSubscription.cpp - What an RX stream slot receives
+// SPDX-License-Identifier: MIT
+
+#include "RxSubscription.h"
+#include <arpa/inet.h>
+#include <fnmatch.h>
+
+namespace AES67 {
+
+namespace {
+
+bool Matches(const std::string& pattern, const std::string& value) {
+    return pattern.empty() || fnmatch(pattern.c_str(), value.c_str(), 0) == 0;
+}
+
+} // namespace
+
+bool RxSubscriptionFromSDP(const SDPSession& session, RxSubscription& out) {
+    for (const SDPMedia& media : session.media) {
+        if (media.mediaType != "audio") {
+            continue;
+        }
+        uint8_t bytesPerSample = 0;
+        if (media.encoding == "L24") {
+            bytesPerSample = 3;
+        } else if (media.encoding == "L16") {
+            bytesPerSample = 2;
+        }
+        if (bytesPerSample == 0 || media.sampleRate != kRTPTimestampClockRate ||
+            media.channels == 0 || media.channels > 8 ||
+            media.connectionAddr.empty() || media.port == 0) {
+            return false;
+        }
+
+        out.address = media.connectionAddr;
+        out.port = media.port;
+        out.channels = media.channels;
+        out.payloadType = media.payloadType;
+        out.bytesPerSample = bytesPerSample;
+        out.packetTimeUs = media.packetTimeUs ? media.packetTimeUs : 1000;   // AES67 default
+        const SDPSourceFilter& filter = media.sourceFilter;
+        if (filter.destAddr == "*" || filter.destAddr == media.connectionAddr) {
+            out.sources = filter.sourceAddrs;
+            out.excludeSources = !filter.include;
+        } else {
+            out.sources.clear();
+            out.excludeSources = false;
+        }
+        out.refClock = media.ptpRefClock;
+        out.sessionName = session.sessionName;
+        return true;
+    }
+    return false;
+}
+
+bool RxSourceFilter::Set(const RxSubscription& subscription) {
+    addrs_.clear();
+    exclude_ = subscription.excludeSources;
+    for (const std::string& source : subscription.sources) {
+        in_addr addr{};
+        if (inet_pton(AF_INET, source.c_str(), &addr) != 1) {
+            addrs_.clear();
+            return false;
+        }
+        addrs_.push_back(addr.s_addr);
+    }
+    return true;
+}
+
+bool MatchesAutoSubscribeRule(const AutoSubscribeRule& rule, const DiscoveredSession& session) {
+    if (!Matches(rule.namePattern, session.name) || !Matches(rule.originPattern, session.originAddr)) {
+        return false;
+    }
+    if (rule.groupPattern.empty()) {
+        return true;
+    }
+    for (const SDPMedia& media : session.session.media) {
+        if (Matches(rule.groupPattern, media.connectionAddr)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace AES67
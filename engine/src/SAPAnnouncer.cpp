@@ -2,13 +2,17 @@
 // SPDX-License-Identifier: MIT
 
 #include "SAPAnnouncer.h"
+#include "SDPParser.h"
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
 #include <cstring>
 #include <sstream>
-#include <iomanip>
+#include <unordered_map>
 
 namespace AES67 {
 
@@ -19,25 +23,60 @@ struct SAPHeader {
     uint16_t msg_id;    // Message identifier hash
     
     void SetVersion(uint8_t v) { vat_flags = (vat_flags & 0x1F) | (v << 5); }
-    void SetAnnounce(bool a) { vat_flags = (vat_flags & 0xEF) | (a ? 0 : 0x10); }
+    void SetAnnounce(bool a) { vat_flags = (vat_flags & 0xFB) | (a ? 0 : 0x04); } // T: 0 announce, 1 delete
 } __attribute__((packed));
 
+namespace {
+
+constexpr uint32_t kTickMs = 10;
+constexpr uint32_t kFirstAnnounceSpreadMs = 1000;  // New streams go out within this
+constexpr size_t kDeletionBurst = 32;               // Then 1 ms apart
+
+uint64_t NowTick() {
+    const auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(now).count()) / kTickMs;
+}
+
+std::chrono::steady_clock::time_point TickTime(uint64_t tick) {
+    return std::chrono::steady_clock::time_point(std::chrono::milliseconds(tick * kTickMs));
+}
+
+} // namespace
+
 SAPAnnouncer::SAPAnnouncer()
     : socket_(-1)
     , running_(false)
     , intervalSeconds_(30)
-{}
+    , rng_(std::random_device{}())
+{
+    sapAddr_.sin_family = AF_INET;
+    sapAddr_.sin_port = htons(9875); // SAP port
+    inet_pton(AF_INET, "239.255.255.255", &sapAddr_.sin_addr);
+}
 
 SAPAnnouncer::~SAPAnnouncer() {
     Stop();
 }
 
+bool SAPAnnouncer::SetDestination(const std::string& address, uint16_t port) {
+    if (running_) {
+        return false;
+    }
+    in_addr addr{};
+    if (inet_pton(AF_INET, address.c_str(), &addr) != 1) {
+        return false;
+    }
+    sapAddr_.sin_addr = addr;
+    sapAddr_.sin_port = htons(port);
+    return true;
+}
+
 bool SAPAnnouncer::Start(const std::vector<StreamDescription>& streams) {
     if (running_) {
         return true;
     }
     
-    streams_ = streams;
+    UpdateStreams(streams);
     
     // Create UDP socket
     socket_ = socket(AF_INET, SOCK_DGRAM, 0);
@@ -63,60 +102,232 @@ void SAPAnnouncer::Stop() {
         return;
     }
     
-    running_ = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+    }
+    wake_.notify_all();
     
     if (thread_.joinable()) {
         thread_.join();
     }
     
     if (socket_ >= 0) {
+        // Tell receivers the streams are gone rather than letting them time out
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<const std::vector<uint8_t>*> deletions;
+        for (const Announcement& a : announcements_) {
+            deletions.push_back(&a.deletion);
+        }
+        SendPaced(deletions);
+        
         close(socket_);
         socket_ = -1;
     }
 }
 
-void SAPAnnouncer::AnnouncementThread() {
-    sockaddr_in sapAddr{};
-    sapAddr.sin_family = AF_INET;
-    sapAddr.sin_port = htons(9875); // SAP port
-    inet_pton(AF_INET, "239.255.255.255", &sapAddr.sin_addr);
+void SAPAnnouncer::UpdateStreams(const std::vector<StreamDescription>& streams) {
+    std::vector<Announcement> updated;
+    updated.reserve(streams.size());
+    size_t totalBytes = 0;
+    for (const auto& stream : streams) {
+        updated.push_back(BuildAnnouncement(stream));
+        totalBytes += updated.back().announce.size();
+    }
+    
+    std::lock_guard<std::mutex> lock(mutex_);
+    const uint64_t now = NowTick();
+    intervalSec_ = ComputeIntervalSeconds(totalBytes, bandwidthLimitBps_, intervalSeconds_);
+    
+    // Unchanged streams keep their place in the schedule
+    std::unordered_multimap<uint32_t, size_t> previous;
+    for (size_t i = 0; i < announcements_.size(); ++i) {
+        previous.emplace(announcements_[i].hash, i);
+    }
+    std::vector<bool> kept(announcements_.size(), false);
+    std::vector<uint64_t> due(updated.size(), SAPTimerWheel::kNever);
+    for (size_t j = 0; j < updated.size(); ++j) {
+        const auto range = previous.equal_range(updated[j].hash);
+        for (auto it = range.first; it != range.second; ++it) {
+            if (!kept[it->second] && announcements_[it->second].announce == updated[j].announce) {
+                kept[it->second] = true;
+                if (wheel_.IsScheduled(static_cast<uint32_t>(it->second))) {
+                    due[j] = wheel_.DueTick(static_cast<uint32_t>(it->second));
+                }
+                break;
+            }
+        }
+    }
+    
+    // Streams that left or changed: their old announcement is withdrawn
+    if (running_ && socket_ >= 0) {
+        std::vector<const std::vector<uint8_t>*> deletions;
+        for (size_t i = 0; i < announcements_.size(); ++i) {
+            if (!kept[i]) {
+                deletions.push_back(&announcements_[i].deletion);
+            }
+        }
+        SendPaced(deletions);
+    }
     
+    // New and changed streams are announced soon, spread over a moment
+    std::uniform_int_distribution<uint64_t> spread(1, kFirstAnnounceSpreadMs / kTickMs);
+    announcements_ = std::move(updated);
+    wheel_.Reset(announcements_.size(), now);
+    for (size_t j = 0; j < announcements_.size(); ++j) {
+        wheel_.Schedule(static_cast<uint32_t>(j), due[j] != SAPTimerWheel::kNever ? due[j] : now + spread(rng_));
+    }
+    due_.reserve(announcements_.size());
+    wake_.notify_all();
+}
+
+double SAPAnnouncer::GetIntervalSeconds() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return intervalSec_;
+}
+
+double SAPAnnouncer::ComputeIntervalSeconds(size_t totalBytes, uint32_t bandwidthLimitBps, uint32_t minimumSeconds) {
+    // RFC 2974 3.1: interval = max(minimum, 8 * no_of_ads * ad_size / limit)
+    const double scaled = bandwidthLimitBps > 0 ? 8.0 * static_cast<double>(totalBytes) / bandwidthLimitBps : 0.0;
+    return std::max(static_cast<double>(minimumSeconds), scaled);
+}
+
+uint64_t SAPAnnouncer::NextIntervalTicks() {
+    // RFC 2974 3.1: offset uniform in [-interval/3, +interval/3]
+    const double intervalTicks = intervalSec_ * 1000.0 / kTickMs;
+    std::uniform_real_distribution<double> jitter(2.0 / 3.0, 4.0 / 3.0);
+    return std::max<uint64_t>(1, static_cast<uint64_t>(intervalTicks * jitter(rng_)));
+}
+
+void SAPAnnouncer::SendPaced(const std::vector<const std::vector<uint8_t>*>& packets) {
+    // Deletions cannot wait for the wheel; short bursts keep receivers'
+    // socket buffers from overflowing when hundreds go at once
+    Batch batch;
+    std::vector<const std::vector<uint8_t>*> burst;
+    for (size_t i = 0; i < packets.size(); i += kDeletionBurst) {
+        if (i > 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        const size_t end = std::min(packets.size(), i + kDeletionBurst);
+        burst.assign(packets.begin() + static_cast<std::ptrdiff_t>(i), packets.begin() + static_cast<std::ptrdiff_t>(end));
+        batch.Build(burst, sapAddr_);
+        Send(batch);
+    }
+}
+
+void SAPAnnouncer::AnnouncementThread() {
+    std::unique_lock<std::mutex> lock(mutex_);
     while (running_) {
-        for (const auto& stream : streams_) {
-            // Generate SDP
-            const std::string sdp = GenerateSDP(stream);
-            
-            // Build SAP packet
-            std::vector<uint8_t> packet;
-            
-            // SAP header
-            SAPHeader header{};
-            header.SetVersion(1);
-            header.SetAnnounce(true); // Announcement (not deletion)
-            header.auth_len = 0;
-            header.msg_id = htons(stream.streamIndex);
-            
-            packet.resize(sizeof(SAPHeader) + 4 + sdp.size()); // +4 for originating source
-            
-            std::memcpy(packet.data(), &header, sizeof(SAPHeader));
-            
-            // Originating source (IPv4 address) - use 0.0.0.0 for now
-            uint32_t origin = 0;
-            std::memcpy(packet.data() + sizeof(SAPHeader), &origin, 4);
-            
-            // SDP payload
-            std::memcpy(packet.data() + sizeof(SAPHeader) + 4, sdp.data(), sdp.size());
-            
-            // Send
-            sendto(socket_, packet.data(), packet.size(), 0,
-                   reinterpret_cast<sockaddr*>(&sapAddr), sizeof(sapAddr));
+        // Everything due this tick goes out in one batch
+        const uint64_t now = NowTick();
+        due_.clear();
+        wheel_.Advance(now, [&](uint32_t id) {
+            due_.push_back(&announcements_[id].announce);
+            wheel_.Schedule(id, now + NextIntervalTicks());
+        });
+        if (!due_.empty()) {
+            sendBatch_.Build(due_, sapAddr_);
+            Send(sendBatch_);
         }
         
-        // Sleep until next announcement interval
-        for (uint32_t i = 0; i < intervalSeconds_ && running_; ++i) {
-            sleep(1);
+        // Sleep until the next announcement, a stream change or Stop()
+        const uint64_t next = wheel_.NextDue();
+        if (next == SAPTimerWheel::kNever) {
+            wake_.wait(lock);
+        } else {
+            wake_.wait_until(lock, TickTime(next));
+        }
+    }
+}
+
+SAPAnnouncer::Announcement SAPAnnouncer::BuildAnnouncement(const StreamDescription& stream) {
+    const std::string sdp = GenerateSDP(stream);
+    
+    // Message id hash: changes with the description, never 0
+    uint32_t hash = 2166136261u;    // FNV-1a
+    for (const char c : sdp) {
+        hash = (hash ^ static_cast<uint8_t>(c)) * 16777619u;
+    }
+    uint16_t msgId = static_cast<uint16_t>(hash ^ (hash >> 16));
+    if (msgId == 0) {
+        msgId = 1;
+    }
+    
+    // SAP header
+    SAPHeader header{};
+    header.SetVersion(1);
+    header.SetAnnounce(true); // Announcement (not deletion)
+    header.auth_len = 0;
+    header.msg_id = htons(msgId);
+    
+    Announcement announcement;
+    announcement.hash = hash;
+    std::vector<uint8_t>& packet = announcement.announce;
+    packet.resize(sizeof(SAPHeader) + 4 + sdp.size()); // +4 for originating source
+    
+    std::memcpy(packet.data(), &header, sizeof(SAPHeader));
+    
+    // Originating source (IPv4 address) - use 0.0.0.0 for now
+    uint32_t origin = 0;
+    std::memcpy(packet.data() + sizeof(SAPHeader), &origin, 4);
+    
+    // SDP payload
+    std::memcpy(packet.data() + sizeof(SAPHeader) + 4, sdp.data(), sdp.size());
+    
+    // Deletion: same hash, origin and description, T bit set
+    announcement.deletion = packet;
+    header.SetAnnounce(false);
+    std::memcpy(announcement.deletion.data(), &header, sizeof(SAPHeader));
+    
+    return announcement;
+}
+
+void SAPAnnouncer::Batch::Build(const std::vector<const std::vector<uint8_t>*>& packets, sockaddr_in& dest) {
+    iovs.resize(packets.size());
+    for (size_t i = 0; i < packets.size(); ++i) {
+        iovs[i].iov_base = const_cast<uint8_t*>(packets[i]->data());
+        iovs[i].iov_len = packets[i]->size();
+    }
+#if defined(__linux__)
+    msgs.assign(packets.size(), mmsghdr{});
+    for (size_t i = 0; i < packets.size(); ++i) {
+        msgs[i].msg_hdr.msg_name = &dest;
+        msgs[i].msg_hdr.msg_namelen = sizeof(dest);
+        msgs[i].msg_hdr.msg_iov = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+#else
+    (void)dest;
+#endif
+}
+
+void SAPAnnouncer::Send(Batch& batch) {
+    const size_t count = batch.iovs.size();
+    size_t done = 0;
+    batches_++;
+#if defined(__linux__)
+    while (done < count) {
+        // The kernel takes up to UIO_MAXIOV (1024) messages per call
+        const size_t chunk = std::min<size_t>(count - done, 1024);
+        const int n = sendmmsg(socket_, batch.msgs.data() + done, static_cast<unsigned>(chunk), 0);
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            done++; // Skip the datagram that failed
+            continue;
+        }
+        done += static_cast<size_t>(n);
+        sent_ += static_cast<uint64_t>(n);
+    }
+#else
+    for (; done < count; ++done) {
+        if (sendto(socket_, batch.iovs[done].iov_base, batch.iovs[done].iov_len, 0,
+                   reinterpret_cast<const sockaddr*>(&sapAddr_), sizeof(sapAddr_)) >= 0) {
+            sent_++;
         }
     }
+#endif
 }
 
 std::string SAPAnnouncer::GenerateSDP(const StreamDescription& stream) {
@@ -137,9 +348,8 @@ std::string SAPAnnouncer::GenerateSDP(const StreamDescription& stream) {
     sdp << "a=rtpmap:96 L24/" << stream.sampleRate << "/" 
         << static_cast<int>(stream.channels) << "\r\n";
     
-    // Packet time (in seconds)
-    const double ptimeSec = stream.packetTimeUs / 1000000.0;
-    sdp << "a=ptime:" << std::fixed << std::setprecision(3) << ptimeSec << "\r\n";
+    // Packet time (in milliseconds)
+    sdp << "a=ptime:" << SDPParser::FormatPacketTime(stream.packetTimeUs) << "\r\n";
     
     // AES67-specific attributes
     sdp << "a=mediaclk:direct=0\r\n";
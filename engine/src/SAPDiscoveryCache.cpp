@@ -0,0 +1,344 @@
+// SAPDiscoveryCache.cpp - Sessions heard on the SAP group
+// SPDX-License-Identifier: MIT
+
+#include "SAPDiscoveryCache.h"
+#include <algorithm>
+#include <cstring>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+namespace AES67 {
+
+namespace {
+
+constexpr uint32_t kNone = UINT32_MAX;
+
+uint64_t HashBytes(const void* data, size_t length, uint64_t hash = 14695981039346656037ULL) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < length; ++i) {
+        hash = (hash ^ bytes[i]) * 1099511628211ULL;     // FNV-1a
+    }
+    return hash;
+}
+
+// Value of the o= line, empty when there is none
+std::string_view FindOriginLine(std::string_view sdp) {
+    size_t pos = 0;
+    while (pos < sdp.size()) {
+        size_t end = sdp.find('\n', pos);
+        if (end == std::string_view::npos) {
+            end = sdp.size();
+        }
+        std::string_view line = sdp.substr(pos, end - pos);
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        if (line.size() >= 2 && line[0] == 'o' && line[1] == '=') {
+            return line.substr(2);
+        }
+        pos = end + 1;
+    }
+    return {};
+}
+
+std::string FormatOrigin(const SAPSessionKey& key) {
+    char text[INET6_ADDRSTRLEN] = {};
+    inet_ntop(key.originLength == 16 ? AF_INET6 : AF_INET, key.origin.data(), text, sizeof(text));
+    return text;
+}
+
+} // namespace
+
+bool ParseSAPPacket(const uint8_t* data, size_t length, SAPPacket& packet) {
+    // V(3) A(1) R(1) T(1) E(1) C(1), auth length, msg id hash, origin, auth data
+    if (length < 4) {
+        return false;
+    }
+    const uint8_t flags = data[0];
+    if ((flags >> 5) != 1 || (flags & 0x03) != 0) {
+        return false;   // Other versions, encrypted or compressed
+    }
+    packet.deletion = (flags & 0x04) != 0;
+    packet.originLength = (flags & 0x10) ? 16 : 4;
+    packet.msgIdHash = static_cast<uint16_t>((data[2] << 8) | data[3]);
+
+    size_t offset = 4;
+    if (length < offset + packet.originLength) {
+        return false;
+    }
+    packet.origin.fill(0);
+    std::memcpy(packet.origin.data(), data + offset, packet.originLength);
+    offset += packet.originLength + static_cast<size_t>(data[1]) * 4;
+    if (offset >= length) {
+        return false;
+    }
+
+    // Optional payload type ("application/sdp\0") before the SDP itself
+    std::string_view payload(reinterpret_cast<const char*>(data + offset), length - offset);
+    if (payload.compare(0, 2, "v=") != 0 && payload.compare(0, 2, "o=") != 0) {
+        const size_t typeEnd = payload.find('\0');
+        if (typeEnd == std::string_view::npos || payload.substr(0, typeEnd) != "application/sdp") {
+            return false;
+        }
+        payload.remove_prefix(typeEnd + 1);
+    }
+    packet.payload = payload;
+    return true;
+}
+
+size_t SAPDiscoveryCache::KeyHash::operator()(const SAPSessionKey& key) const {
+    const uint64_t hash = HashBytes(key.origin.data(), key.originLength);
+    return static_cast<size_t>(HashBytes(&key.msgIdHash, sizeof(key.msgIdHash), hash));
+}
+
+std::string SAPDiscoveryCache::SdpOriginKey(std::string_view origin) {
+    // <username> <sess-id> <sess-version> <nettype> <addrtype> <unicast-address>
+    std::string key;
+    key.reserve(origin.size());
+    size_t field = 0;
+    size_t pos = 0;
+    while (pos < origin.size()) {
+        while (pos < origin.size() && origin[pos] == ' ') pos++;
+        const size_t end = std::min(origin.find(' ', pos), origin.size());
+        if (end > pos && field != 2) {
+            if (!key.empty()) key += ' ';
+            key.append(origin.substr(pos, end - pos));
+        }
+        field += end > pos ? 1 : 0;
+        pos = end;
+    }
+    return key;
+}
+
+SAPDiscoveryCache::Change SAPDiscoveryCache::OnPacket(const SAPPacket& packet, uint64_t nowNs) {
+    SAPSessionKey key;
+    key.origin = packet.origin;
+    key.originLength = packet.originLength;
+    key.msgIdHash = packet.msgIdHash;
+
+    // Msg id hash 0 means "none": fall back to the SDP origin (RFC 2974 5)
+    uint32_t id = kNone;
+    if (key.msgIdHash != 0) {
+        const auto it = byKey_.find(key);
+        if (it != byKey_.end()) id = it->second;
+    }
+    if (id == kNone && (key.msgIdHash == 0 || packet.deletion)) {
+        const auto it = bySdpOrigin_.find(SdpOriginKey(FindOriginLine(packet.payload)));
+        if (it != bySdpOrigin_.end()) id = it->second;
+    }
+
+    if (packet.deletion) {
+        if (id == kNone) {
+            return Change::None;
+        }
+        Remove(id);
+        return Change::Removed;
+    }
+
+    // Unchanged re-announcement: no parse
+    const uint64_t payloadHash = HashBytes(packet.payload.data(), packet.payload.size());
+    if (id != kNone && sessions_[id].payloadHash == payloadHash) {
+        DiscoveredSession& session = sessions_[id];
+        const uint64_t gap = nowNs - session.lastSeenNs;
+        session.intervalNs = session.intervalNs == 0 ? gap : (session.intervalNs * 7 + gap) / 8;
+        session.lastSeenNs = nowNs;
+        session.announcements++;
+        return Change::None;
+    }
+
+    parses_++;
+    if (!SDPParser::Parse(packet.payload, scratch_)) {
+        return Change::None;
+    }
+    std::string sdpOrigin = SdpOriginKey(scratch_.origin);
+
+    // A new msg id hash for a session we know: a new version replaces the old
+    if (id == kNone) {
+        const auto it = bySdpOrigin_.find(sdpOrigin);
+        if (it != bySdpOrigin_.end()) id = it->second;
+    }
+
+    Change change = Change::Updated;
+    if (id == kNone) {
+        id = Allocate();
+        sessions_[id].firstSeenNs = nowNs;
+        sessions_[id].lastSeenNs = nowNs;
+        sessions_[id].intervalNs = 0;
+        sessions_[id].announcements = 0;
+        change = Change::Added;
+    } else {
+        UnindexSession(id);
+    }
+
+    DiscoveredSession& session = sessions_[id];
+    if (change == Change::Updated) {
+        const uint64_t gap = nowNs - session.lastSeenNs;
+        session.intervalNs = session.intervalNs == 0 ? gap : (session.intervalNs * 7 + gap) / 8;
+    }
+    session.key = key;
+    session.payloadHash = payloadHash;
+    session.session = scratch_;
+    session.sdpOrigin = std::move(sdpOrigin);
+    session.name = scratch_.sessionName.empty() ? scratch_.origin : scratch_.sessionName;
+    session.originAddr = FormatOrigin(key);
+    session.lastSeenNs = nowNs;
+    session.announcements++;
+    IndexSession(id);
+    published_[id].reset();
+    generation_++;
+    return change;
+}
+
+size_t SAPDiscoveryCache::Expire(uint64_t nowNs) {
+    size_t expired = 0;
+    for (uint32_t id = 0; id < sessions_.size(); ++id) {
+        if (active_[id] && nowNs - sessions_[id].lastSeenNs > TimeoutNs(sessions_[id])) {
+            Remove(id);
+            expired++;
+        }
+    }
+    return expired;
+}
+
+void SAPDiscoveryCache::Clear() {
+    sessions_.clear();
+    active_.clear();
+    published_.clear();
+    freeSlots_.clear();
+    byKey_.clear();
+    bySdpOrigin_.clear();
+    byName_.clear();
+    byMulticast_.clear();
+    byOriginAddr_.clear();
+    count_ = 0;
+    generation_++;
+}
+
+std::shared_ptr<const DiscoverySnapshot> SAPDiscoveryCache::Snapshot() {
+    auto snapshot = std::make_shared<DiscoverySnapshot>();
+    snapshot->generation = generation_;
+    snapshot->sessions.reserve(count_);
+    for (size_t id = 0; id < sessions_.size(); ++id) {
+        if (!active_[id]) {
+            continue;
+        }
+        if (!published_[id]) {
+            published_[id] = std::make_shared<const DiscoveredSession>(sessions_[id]);
+        }
+        snapshot->sessions.push_back(published_[id]);
+    }
+    std::sort(snapshot->sessions.begin(), snapshot->sessions.end(),
+              [](const auto& a, const auto& b) { return a->name < b->name; });
+    return snapshot;
+}
+
+const DiscoveredSession* DiscoverySnapshot::Find(const std::string& name) const {
+    const auto it = std::lower_bound(sessions.begin(), sessions.end(), name,
+                                     [](const auto& session, const std::string& n) { return session->name < n; });
+    return it != sessions.end() && (*it)->name == name ? it->get() : nullptr;
+}
+
+const DiscoveredSession* SAPDiscoveryCache::FindByName(const std::string& name) const {
+    const auto it = byName_.find(name);
+    return it != byName_.end() ? &sessions_[it->second] : nullptr;
+}
+
+const DiscoveredSession* SAPDiscoveryCache::FindBySdpOrigin(const std::string& sdpOrigin) const {
+    const auto it = bySdpOrigin_.find(sdpOrigin);
+    return it != bySdpOrigin_.end() ? &sessions_[it->second] : nullptr;
+}
+
+std::vector<const DiscoveredSession*> SAPDiscoveryCache::FindByMulticast(const std::string& addr) const {
+    std::vector<const DiscoveredSession*> found;
+    const auto range = byMulticast_.equal_range(addr);
+    for (auto it = range.first; it != range.second; ++it) {
+        found.push_back(&sessions_[it->second]);
+    }
+    return found;
+}
+
+std::vector<const DiscoveredSession*> SAPDiscoveryCache::FindByOriginAddr(const std::string& originAddr) const {
+    std::vector<const DiscoveredSession*> found;
+    const auto range = byOriginAddr_.equal_range(originAddr);
+    for (auto it = range.first; it != range.second; ++it) {
+        found.push_back(&sessions_[it->second]);
+    }
+    return found;
+}
+
+uint32_t SAPDiscoveryCache::Allocate() {
+    count_++;
+    if (!freeSlots_.empty()) {
+        const uint32_t id = freeSlots_.back();
+        freeSlots_.pop_back();
+        active_[id] = 1;
+        return id;
+    }
+    sessions_.emplace_back();
+    active_.push_back(1);
+    published_.emplace_back();
+    return static_cast<uint32_t>(sessions_.size() - 1);
+}
+
+void SAPDiscoveryCache::Remove(uint32_t id) {
+    UnindexSession(id);
+    active_[id] = 0;
+    published_[id].reset();
+    freeSlots_.push_back(id);   // Strings keep their capacity for the next session
+    count_--;
+    generation_++;
+}
+
+void SAPDiscoveryCache::IndexSession(uint32_t id) {
+    const DiscoveredSession& session = sessions_[id];
+    if (session.key.msgIdHash != 0) {
+        byKey_[session.key] = id;
+    }
+    bySdpOrigin_[session.sdpOrigin] = id;
+    byName_.emplace(session.name, id);
+    byOriginAddr_.emplace(session.originAddr, id);
+    for (size_t i = 0; i < session.session.media.size(); ++i) {
+        const std::string& addr = session.session.media[i].connectionAddr;
+        bool seen = addr.empty();
+        for (size_t j = 0; j < i && !seen; ++j) {
+            seen = session.session.media[j].connectionAddr == addr;
+        }
+        if (!seen) {
+            byMulticast_.emplace(addr, id);
+        }
+    }
+}
+
+void SAPDiscoveryCache::UnindexSession(uint32_t id) {
+    const DiscoveredSession& session = sessions_[id];
+    const auto key = byKey_.find(session.key);
+    if (key != byKey_.end() && key->second == id) {
+        byKey_.erase(key);
+    }
+    const auto origin = bySdpOrigin_.find(session.sdpOrigin);
+    if (origin != bySdpOrigin_.end() && origin->second == id) {
+        bySdpOrigin_.erase(origin);
+    }
+    EraseFromIndex(byName_, session.name, id);
+    EraseFromIndex(byOriginAddr_, session.originAddr, id);
+    for (const SDPMedia& media : session.session.media) {
+        EraseFromIndex(byMulticast_, media.connectionAddr, id);
+    }
+}
+
+void SAPDiscoveryCache::EraseFromIndex(Index& index, const std::string& value, uint32_t id) {
+    const auto range = index.equal_range(value);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second == id) {
+            index.erase(it);
+            return;
+        }
+    }
+}
+
+uint64_t SAPDiscoveryCache::TimeoutNs(const DiscoveredSession& session) const {
+    // RFC 2974 3.2: ten announcement periods or one hour, whichever is greater
+    return std::max(minTimeoutNs_, session.intervalNs * 10);
+}
+
+} // namespace AES67
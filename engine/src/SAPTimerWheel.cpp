@@ -0,0 +1,84 @@
+// SAPTimerWheel.cpp - Hashed timer wheel for SAP announcement scheduling
+// SPDX-License-Identifier: MIT
+
+#include "SAPTimerWheel.h"
+
+namespace AES67 {
+
+SAPTimerWheel::SAPTimerWheel(size_t slots) {
+    size_t size = 1;
+    while (size < slots) {
+        size <<= 1;
+    }
+    heads_.assign(size, kNone);
+    mask_ = size - 1;
+}
+
+void SAPTimerWheel::Reset(size_t ids, uint64_t nowTick) {
+    heads_.assign(heads_.size(), kNone);
+    entries_.assign(ids, Entry{});
+    size_ = 0;
+    current_ = nowTick;
+}
+
+void SAPTimerWheel::Schedule(uint32_t id, uint64_t dueTick) {
+    if (entries_[id].scheduled) {
+        Unlink(id);
+    }
+    Entry& entry = entries_[id];
+    entry.due = dueTick;
+    entry.scheduled = true;
+    entry.prev = kNone;
+    entry.slot = static_cast<uint32_t>(SlotTick(dueTick) & mask_);
+
+    uint32_t& head = heads_[entry.slot];
+    entry.next = head;
+    if (head != kNone) {
+        entries_[head].prev = id;
+    }
+    head = id;
+    size_++;
+}
+
+void SAPTimerWheel::Cancel(uint32_t id) {
+    if (entries_[id].scheduled) {
+        Unlink(id);
+    }
+}
+
+void SAPTimerWheel::Unlink(uint32_t id) {
+    Entry& entry = entries_[id];
+    if (entry.prev != kNone) {
+        entries_[entry.prev].next = entry.next;
+    } else {
+        heads_[entry.slot] = entry.next;
+    }
+    if (entry.next != kNone) {
+        entries_[entry.next].prev = entry.prev;
+    }
+    entry.prev = kNone;
+    entry.next = kNone;
+    entry.scheduled = false;
+    size_--;
+}
+
+uint64_t SAPTimerWheel::NextDue() const {
+    if (size_ == 0) {
+        return kNever;
+    }
+    // The first slot holding a timer for this lap has the earliest deadline;
+    // failing that, every timer is a later lap and the minimum wins
+    uint64_t earliest = kNever;
+    for (uint64_t tick = current_ + 1; tick <= current_ + mask_ + 1; ++tick) {
+        for (uint32_t id = heads_[tick & mask_]; id != kNone; id = entries_[id].next) {
+            const uint64_t due = entries_[id].due;
+            if (due <= tick) {
+                return due;
+            }
+            earliest = due < earliest ? due : earliest;
+        }
+    }
+    return earliest;
+}
+
+} // namespace AES67
@@ -2,88 +2,387 @@
 // SPDX-License-Identifier: MIT
 
 #include "SDPParser.h"
+#include <charconv>
 #include <sstream>
-#include <regex>
 
 namespace AES67 {
 
-SDPSession SDPParser::Parse(const std::string& sdp) {
-    SDPSession session;
-    
-    std::istringstream stream(sdp);
-    std::string line;
-    
-    while (std::getline(stream, line)) {
-        // Remove \r if present
+namespace {
+
+// a=ts-refclk split in place
+struct RefClockView {
+    std::string_view source;
+    std::string_view ptpVersion;
+    std::string_view ptpGrandmaster;
+    uint8_t ptpDomain = 0;
+    bool valid = false;
+};
+
+std::string_view Trim(std::string_view s) {
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) s.remove_prefix(1);
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t')) s.remove_suffix(1);
+    return s;
+}
+
+// Next space-separated token of rest, consumed
+std::string_view NextToken(std::string_view& rest) {
+    rest = Trim(rest);
+    const size_t end = rest.find_first_of(" \t");
+    const std::string_view token = rest.substr(0, end);
+    rest.remove_prefix(token.size());
+    return token;
+}
+
+// Text before the first separator, consumed along with it
+std::string_view NextField(std::string_view& rest, char separator) {
+    const size_t end = rest.find(separator);
+    const std::string_view field = rest.substr(0, end);
+    rest.remove_prefix(end == std::string_view::npos ? rest.size() : end + 1);
+    return field;
+}
+
+// Whole-string decimal number within T
+template <typename T>
+bool ParseNumber(std::string_view s, T& out) {
+    if (s.empty() || s.front() < '0' || s.front() > '9') return false;
+    T value{};
+    const auto [end, ec] = std::from_chars(s.data(), s.data() + s.size(), value);
+    if (ec != std::errc() || end != s.data() + s.size()) return false;
+    out = value;
+    return true;
+}
+
+// Milliseconds with up to microsecond precision, e.g. "0.125"; no floating point
+bool ParseMilliseconds(std::string_view s, uint32_t& outUs) {
+    const std::string_view whole = NextField(s, '.');
+    uint32_t ms = 0;
+    if (!ParseNumber(whole, ms) || ms > 1000000) return false;
+    uint32_t us = 0;
+    uint32_t scale = 100;
+    for (const char c : s) {
+        if (c < '0' || c > '9') return false;
+        us += static_cast<uint32_t>(c - '0') * scale;     // Digits past the sixth add 0
+        scale /= 10;
+    }
+    outUs = ms * 1000 + us;
+    return true;
+}
+
+// "IN IP4 239.69.1.1/32[/count]"
+bool ParseConnection(std::string_view value, std::string_view& addr, uint8_t& ttl) {
+    if (NextToken(value) != "IN") return false;
+    const std::string_view addrType = NextToken(value);
+    if (addrType != "IP4" && addrType != "IP6") return false;
+    std::string_view address = NextToken(value);
+    addr = NextField(address, '/');
+    ttl = 0;
+    if (addrType == "IP4" && !address.empty()) {
+        ParseNumber(NextField(address, '/'), ttl);
+    }
+    return !addr.empty();
+}
+
+RefClockView SplitRefClock(std::string_view value) {
+    RefClockView view;
+    value = Trim(value);
+    view.source = NextField(value, '=');
+    if (view.source != "ptp") {
+        return view;
+    }
+
+    // ptp=<version>[:<gmid>[:<domain>]]
+    const size_t versionEnd = value.find(':');
+    view.ptpVersion = value.substr(0, versionEnd);
+    std::string_view domainText;
+    bool hasDomain = false;
+    if (versionEnd != std::string_view::npos) {
+        value.remove_prefix(versionEnd + 1);
+        const size_t grandmasterEnd = value.find(':');
+        view.ptpGrandmaster = value.substr(0, grandmasterEnd);
+        hasDomain = grandmasterEnd != std::string_view::npos;
+        if (hasDomain) domainText = value.substr(grandmasterEnd + 1);
+    }
+    // 1588-2002 names its domains, other clocks have none
+    if (view.ptpVersion != "IEEE1588-2008" && view.ptpVersion != "IEEE1588-2019" &&
+        view.ptpVersion != "IEEE802.1AS-2011") {
+        return view;
+    }
+    if (!hasDomain) {
+        view.valid = true;
+        return view;
+    }
+    uint32_t domain = 0;
+    if (domainText.size() > 3 || !ParseNumber(domainText, domain) || domain > 255) {
+        return view;
+    }
+    view.ptpDomain = static_cast<uint8_t>(domain);
+    view.valid = true;
+    return view;
+}
+
+// Refill the section in place, keeping string capacity
+void ResetMedia(SDPMedia& media) {
+    media.mediaType.clear();
+    media.port = 0;
+    media.payloadType = 0;
+    media.connectionAddr.clear();
+    media.ttl = 0;
+    media.encoding.clear();
+    media.sampleRate = 0;
+    media.channels = 0;
+    media.packetTimeUs = 0;
+    media.mid.clear();
+    media.ptpRefClock.clear();
+    media.mediaClk.clear();
+    media.refClock.source.clear();
+    media.refClock.ptpVersion.clear();
+    media.refClock.ptpGrandmaster.clear();
+    media.refClock.ptpDomain = 0;
+    media.refClock.valid = false;
+    media.mediaClock = SDPMediaClock{};
+    media.sourceFilter.include = true;
+    media.sourceFilter.destAddr.clear();
+    media.sourceFilter.sourceAddrs.clear();
+}
+
+// "audio 5004 RTP/AVP 96 ..."; the first format is the one described
+void ParseMediaLine(std::string_view value, SDPMedia& media) {
+    media.mediaType.assign(NextToken(value));
+    std::string_view port = NextToken(value);
+    ParseNumber(NextField(port, '/'), media.port);
+    NextToken(value);   // Protocol
+    ParseNumber(NextToken(value), media.payloadType);
+}
+
+// "96 L24/48000/8", applied only to the section's payload type
+void ParseRtpmap(std::string_view value, SDPMedia& media) {
+    uint8_t payloadType = 0;
+    if (!ParseNumber(NextToken(value), payloadType) || payloadType != media.payloadType) {
+        return;
+    }
+    std::string_view format = NextToken(value);
+    media.encoding.assign(NextField(format, '/'));
+    uint32_t sampleRate = 0;
+    if (!ParseNumber(NextField(format, '/'), sampleRate)) {
+        return;
+    }
+    media.sampleRate = sampleRate;
+    media.channels = 1;     // Audio default when omitted
+    if (!format.empty()) {
+        ParseNumber(format, media.channels);
+    }
+}
+
+void ApplyRefClock(std::string_view value, SDPMedia& media) {
+    // Several clocks may be listed; prefer the first usable PTP one
+    const RefClockView view = SplitRefClock(value);
+    if (!media.ptpRefClock.empty() && (media.refClock.valid || !view.valid)) {
+        return;
+    }
+    media.ptpRefClock.assign(Trim(value));
+    media.refClock.source.assign(view.source);
+    media.refClock.ptpVersion.assign(view.ptpVersion);
+    media.refClock.ptpGrandmaster.assign(view.ptpGrandmaster);
+    media.refClock.ptpDomain = view.ptpDomain;
+    media.refClock.valid = view.valid;
+}
+
+void ApplyMediaClock(std::string_view value, SDPMedia& media) {
+    if (!media.mediaClk.empty()) {
+        return;
+    }
+    media.mediaClk.assign(Trim(value));
+    SDPParser::ParseMediaClock(value, media.mediaClock);
+}
+
+void ApplySourceFilter(std::string_view value, SDPMedia& media) {
+    if (!media.sourceFilter.sourceAddrs.empty()) {
+        return;     // First filter wins
+    }
+    SDPParser::ParseSourceFilter(value, media.sourceFilter);
+}
+
+// "<encoding>/<rate>/<channels>" without going through a stream
+void FormatRtpmap(const SDPMedia& media, std::string& out) {
+    char buffer[32];
+    out.assign(media.encoding);
+    out += '/';
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), media.sampleRate);
+    out.append(buffer, result.ptr);
+    out += '/';
+    result = std::to_chars(buffer, buffer + sizeof(buffer), static_cast<unsigned>(media.channels));
+    out.append(buffer, result.ptr);
+}
+
+} // namespace
+
+bool SDPParser::Parse(std::string_view sdp, SDPSession& session) {
+    session.origin.clear();
+    session.originAddr.clear();
+    session.sessionId = 0;
+    session.sessionVersion = 0;
+    session.sessionName.clear();
+    session.connectionAddr.clear();
+    session.port = 0;
+    session.payloadType = 0;
+    session.rtpmap.clear();
+    session.sampleRate = 0;
+    session.channels = 0;
+    session.packetTimeUs = 0;
+    session.ptpRefClock.clear();
+    session.mediaClk.clear();
+
+    // Session-level values, applied to sections without their own at the end
+    std::string_view sessionConnection;
+    uint8_t sessionTtl = 0;
+    std::string_view sessionRefClock;
+    std::string_view sessionMediaClk;
+    std::string_view sessionSourceFilter;
+
+    bool sawVersion = false;
+    size_t mediaCount = 0;
+    SDPMedia* media = nullptr;
+
+    std::string_view rest = sdp;
+    while (!rest.empty()) {
+        std::string_view line = NextField(rest, '\n');
         if (!line.empty() && line.back() == '\r') {
-            line.pop_back();
+            line.remove_suffix(1);
         }
-        
         if (line.size() < 2 || line[1] != '=') {
             continue;
         }
-        
-        const char type = line[0];
-        const std::string value = line.substr(2);
-        
-        switch (type) {
-            case 'o': // Origin
-                session.origin = value;
+
+        const std::string_view value = line.substr(2);
+        switch (line[0]) {
+            case 'v':
+                sawVersion = sawVersion || value == "0";
+                break;
+
+            case 'o': { // Origin: <user> <sess-id> <sess-version> IN IP4 <address>
+                session.origin.assign(value);
+                std::string_view fields = value;
+                NextToken(fields);
+                ParseNumber(NextToken(fields), session.sessionId);
+                ParseNumber(NextToken(fields), session.sessionVersion);
+                NextToken(fields);
+                NextToken(fields);
+                session.originAddr.assign(NextToken(fields));
                 break;
-                
+            }
+
             case 's': // Session name
-                session.sessionName = value;
+                if (!media) session.sessionName.assign(value);
                 break;
-                
+
             case 'c': { // Connection
-                // Format: IN IP4 239.69.1.1/32
-                std::regex connRegex(R"(IN IP4 ([0-9.]+))");
-                std::smatch match;
-                if (std::regex_search(value, match, connRegex)) {
-                    session.connectionAddr = match[1];
+                std::string_view addr;
+                uint8_t ttl = 0;
+                if (!ParseConnection(value, addr, ttl)) break;
+                if (media) {
+                    media->connectionAddr.assign(addr);
+                    media->ttl = ttl;
+                } else {
+                    sessionConnection = addr;
+                    sessionTtl = ttl;
                 }
                 break;
             }
-                
+
             case 'm': { // Media
-                // Format: audio 5004 RTP/AVP 96
-                std::regex mediaRegex(R"(audio (\d+) RTP/AVP (\d+))");
-                std::smatch match;
-                if (std::regex_search(value, match, mediaRegex)) {
-                    session.port = static_cast<uint16_t>(std::stoi(match[1]));
-                    session.payloadType = static_cast<uint8_t>(std::stoi(match[2]));
+                if (mediaCount == session.media.size()) {
+                    session.media.emplace_back();
+                } else {
+                    ResetMedia(session.media[mediaCount]);
                 }
+                media = &session.media[mediaCount++];
+                ParseMediaLine(value, *media);
                 break;
             }
-                
+
             case 'a': { // Attribute
-                if (value.find("rtpmap:") == 0) {
-                    // Format: rtpmap:96 L24/48000/8
-                    session.rtpmap = value.substr(7); // Skip "rtpmap:"
-                    
-                    std::regex rtpmapRegex(R"(L24/(\d+)/(\d+))");
-                    std::smatch match;
-                    if (std::regex_search(value, match, rtpmapRegex)) {
-                        session.sampleRate = std::stoul(match[1]);
-                        session.channels = static_cast<uint8_t>(std::stoul(match[2]));
-                    }
-                } else if (value.find("ptime:") == 0) {
-                    // Format: ptime:0.250
-                    const double ptimeSec = std::stod(value.substr(6));
-                    session.packetTimeUs = static_cast<uint32_t>(ptimeSec * 1000000);
-                } else if (value.find("ts-refclk:") == 0) {
-                    session.ptpRefClock = value.substr(10);
-                } else if (value.find("mediaclk:") == 0) {
-                    session.mediaClk = value.substr(9);
+                std::string_view attrValue = value;
+                const std::string_view name = NextField(attrValue, ':');
+                if (name == "ts-refclk") {
+                    if (media) ApplyRefClock(attrValue, *media);
+                    else if (sessionRefClock.empty()) sessionRefClock = attrValue;
+                } else if (name == "mediaclk") {
+                    if (media) ApplyMediaClock(attrValue, *media);
+                    else if (sessionMediaClk.empty()) sessionMediaClk = attrValue;
+                } else if (name == "source-filter") {
+                    if (media) ApplySourceFilter(attrValue, *media);
+                    else if (sessionSourceFilter.empty()) sessionSourceFilter = attrValue;
+                } else if (!media) {
+                    break;  // The rest are media attributes
+                } else if (name == "rtpmap") {
+                    ParseRtpmap(attrValue, *media);
+                } else if (name == "ptime") {
+                    ParseMilliseconds(Trim(attrValue), media->packetTimeUs);
+                } else if (name == "mid") {
+                    media->mid.assign(Trim(attrValue));
                 }
                 break;
             }
         }
     }
-    
+    session.media.resize(mediaCount);
+
+    SDPMedia* audio = nullptr;
+    for (SDPMedia& m : session.media) {
+        if (m.connectionAddr.empty()) {
+            m.connectionAddr.assign(sessionConnection);
+            m.ttl = sessionTtl;
+        }
+        if (m.ptpRefClock.empty() && !sessionRefClock.empty()) {
+            ApplyRefClock(sessionRefClock, m);
+        }
+        if (m.mediaClk.empty() && !sessionMediaClk.empty()) {
+            ApplyMediaClock(sessionMediaClk, m);
+        }
+        if (m.sourceFilter.sourceAddrs.empty() && !sessionSourceFilter.empty()) {
+            ApplySourceFilter(sessionSourceFilter, m);
+        }
+        if (!audio && m.mediaType == "audio") {
+            audio = &m;
+        }
+    }
+
+    if (audio) {
+        session.connectionAddr.assign(audio->connectionAddr);
+        session.port = audio->port;
+        session.payloadType = audio->payloadType;
+        if (!audio->encoding.empty()) {
+            FormatRtpmap(*audio, session.rtpmap);
+        }
+        session.sampleRate = audio->sampleRate;
+        session.channels = audio->channels;
+        session.packetTimeUs = audio->packetTimeUs;
+        session.ptpRefClock.assign(audio->ptpRefClock);
+        session.mediaClk.assign(audio->mediaClk);
+    } else {
+        session.connectionAddr.assign(sessionConnection);
+    }
+
+    return sawVersion && mediaCount > 0;
+}
+
+SDPSession SDPParser::Parse(std::string_view sdp) {
+    SDPSession session;
+    Parse(sdp, session);
     return session;
 }
 
+std::string SDPParser::FormatPacketTime(uint32_t packetTimeUs) {
+    std::string text = std::to_string(packetTimeUs / 1000);
+    const uint32_t fraction = packetTimeUs % 1000;
+    if (fraction != 0) {
+        const std::string digits = std::to_string(1000 + fraction);    // "1125" -> ".125"
+        text += '.';
+        text.append(digits, 1, digits.find_last_not_of('0'));
+    }
+    return text;
+}
+
 std::string SDPParser::Generate(const SDPSession& session) {
     std::ostringstream sdp;
     
@@ -98,8 +397,7 @@ std::string SDPParser::Generate(const SDPSession& session) {
     sdp << "a=rtpmap:" << static_cast<int>(session.payloadType) << " " 
         << session.rtpmap << "\r\n";
     
-    const double ptimeSec = session.packetTimeUs / 1000000.0;
-    sdp << "a=ptime:" << ptimeSec << "\r\n";
+    sdp << "a=ptime:" << FormatPacketTime(session.packetTimeUs) << "\r\n";
     
     if (!session.mediaClk.empty()) {
         sdp << "a=mediaclk:" << session.mediaClk << "\r\n";
@@ -114,32 +412,70 @@ std::string SDPParser::Generate(const SDPSession& session) {
     return sdp.str();
 }
 
-std::map<std::string, std::string> SDPParser::ParseAttributes(const std::string& sdp) {
-    std::map<std::string, std::string> attributes;
-    
-    std::istringstream stream(sdp);
-    std::string line;
-    
-    while (std::getline(stream, line)) {
-        if (!line.empty() && line.back() == '\r') {
-            line.pop_back();
+bool SDPParser::ParsePTPDomain(std::string_view refClock, uint8_t& domain) {
+    const RefClockView view = SplitRefClock(refClock);
+    if (!view.valid) {
+        return false;
+    }
+    domain = view.ptpDomain;
+    return true;
+}
+
+bool SDPParser::ParseRefClock(std::string_view value, SDPRefClock& refClock) {
+    const RefClockView view = SplitRefClock(value);
+    refClock.source.assign(view.source);
+    refClock.ptpVersion.assign(view.ptpVersion);
+    refClock.ptpGrandmaster.assign(view.ptpGrandmaster);
+    refClock.ptpDomain = view.ptpDomain;
+    refClock.valid = view.valid;
+    return !view.source.empty();
+}
+
+bool SDPParser::ParseMediaClock(std::string_view value, SDPMediaClock& mediaClock) {
+    // direct=<offset> [rate=<num>/<den>], or sender
+    mediaClock = SDPMediaClock{};
+    std::string_view direct = NextToken(value);
+    if (NextField(direct, '=') != "direct") {
+        return false;
+    }
+    if (!ParseNumber(direct, mediaClock.offset)) {
+        return false;
+    }
+    mediaClock.direct = true;
+    for (std::string_view param = NextToken(value); !param.empty(); param = NextToken(value)) {
+        if (NextField(param, '=') == "rate") {
+            ParseNumber(NextField(param, '/'), mediaClock.rateNum);
+            ParseNumber(param, mediaClock.rateDen);
         }
-        
-        if (line.size() >= 2 && line[0] == 'a' && line[1] == '=') {
-            const std::string attr = line.substr(2);
-            const size_t colonPos = attr.find(':');
-            
-            if (colonPos != std::string::npos) {
-                const std::string key = attr.substr(0, colonPos);
-                const std::string value = attr.substr(colonPos + 1);
-                attributes[key] = value;
-            } else {
-                attributes[attr] = "";
-            }
+    }
+    return true;
+}
+
+bool SDPParser::ParseSourceFilter(std::string_view value, SDPSourceFilter& filter) {
+    // <incl|excl> IN <IP4|IP6|*> <dest> <source> ...
+    const std::string_view mode = NextToken(value);
+    const std::string_view netType = NextToken(value);
+    const std::string_view addrType = NextToken(value);
+    const std::string_view dest = NextToken(value);
+    if ((mode != "incl" && mode != "excl") || netType != "IN" ||
+        (addrType != "IP4" && addrType != "IP6" && addrType != "*") || dest.empty()) {
+        filter.sourceAddrs.clear();
+        return false;
+    }
+
+    filter.include = mode == "incl";
+    filter.destAddr.assign(dest);
+    size_t count = 0;
+    for (std::string_view source = NextToken(value); !source.empty(); source = NextToken(value)) {
+        if (count == filter.sourceAddrs.size()) {
+            filter.sourceAddrs.emplace_back(source);
+        } else {
+            filter.sourceAddrs[count].assign(source);
         }
+        count++;
     }
-    
-    return attributes;
+    filter.sourceAddrs.resize(count);
+    return count > 0;
 }
 
 } // namespace AES67
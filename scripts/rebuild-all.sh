@@ -60,6 +60,7 @@ rm -rf \
     "$PROJECT_ROOT/engine/build" \
     "$PROJECT_ROOT/tools/build" \
     "$PROJECT_ROOT/tests/unit/build" \
+    "$PROJECT_ROOT/tests/bench/build" \
     "$PROJECT_ROOT/ui/Aes67VSC/build"
 echo "✓ Clean slate ready"
 echo ""
@@ -0,0 +1,222 @@
+// bench_discovery_snapshot.cpp - Cost of reading discovered streams under concurrent readers
+// SPDX-License-Identifier: MIT
+//
+// Usage: bench_discovery_snapshot [streams] [max-readers] [seconds-per-case]
+//
+// One "poll" is what aes67-monitor does for /status: visit every discovered
+// stream's name, address and port. The "mutex + copy" cases replay the old
+// API (names vector under the lock, then one locked SDPSession copy per
+// stream); the snapshot cases take one SnapshotPublisher::Load() and walk
+// it. A writer changes one stream and republishes either at the discovery
+// thread's 10 Hz or flat out.
+
+#include "SAPDiscoveryCache.h"
+#include "SnapshotPublisher.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace AES67;
+
+namespace {
+
+struct Result {
+    double nsPerPoll = 0.0;
+    uint64_t polls = 0;
+};
+
+std::string MakeSDP(uint32_t id, uint32_t version) {
+    return "v=0\r\n"
+           "o=- " + std::to_string(id) + " " + std::to_string(version) + " IN IP4 10.0.0.5\r\n"
+           "s=Stream " + std::to_string(id) + "\r\n"
+           "c=IN IP4 239.69." + std::to_string(id / 250) + "." + std::to_string(id % 250) + "/32\r\n"
+           "t=0 0\r\n"
+           "a=ts-refclk:ptp=IEEE1588-2008:39-A7-94-FF-FE-07-CB-D0:0\r\n"
+           "a=mediaclk:direct=0\r\n"
+           "m=audio 5004 RTP/AVP 96\r\n"
+           "a=rtpmap:96 L24/48000/8\r\n"
+           "a=ptime:1\r\n";
+}
+
+std::vector<uint8_t> MakePacket(uint32_t id, uint32_t version) {
+    const std::string sdp = MakeSDP(id, version);
+    std::string packet = {0x20, 0, static_cast<char>((id + 1) >> 8), static_cast<char>((id + 1) & 0xFF), 10, 0, 0, 5};
+    packet += sdp;
+    return std::vector<uint8_t>(packet.begin(), packet.end());
+}
+
+void Feed(SAPDiscoveryCache& cache, uint32_t id, uint32_t version) {
+    const std::vector<uint8_t> bytes = MakePacket(id, version);
+    SAPPacket packet;
+    if (ParseSAPPacket(bytes.data(), bytes.size(), packet)) {
+        cache.OnPacket(packet, 0);
+    }
+}
+
+// The old discovery state: name -> session behind one mutex
+struct MutexDiscovery {
+    std::vector<std::string> Names() {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::vector<std::string> names;
+        names.reserve(streams.size());
+        for (const auto& pair : streams) {
+            names.push_back(pair.first);
+        }
+        return names;
+    }
+    bool Get(const std::string& name, SDPSession& out) {
+        std::lock_guard<std::mutex> lock(mutex);
+        const auto it = streams.find(name);
+        if (it == streams.end()) return false;
+        out = it->second;
+        return true;
+    }
+    void Update(const std::string& name, const SDPSession& session) {
+        std::lock_guard<std::mutex> lock(mutex);
+        streams[name] = session;
+    }
+    std::mutex mutex;
+    std::map<std::string, SDPSession> streams;
+};
+
+template <typename Poll>
+Result RunReaders(uint32_t readers, double seconds, Poll poll) {
+    std::atomic<bool> running{true};
+    std::vector<Result> results(readers);
+    std::vector<std::thread> threads;
+    std::atomic<size_t> sink{0};
+
+    for (uint32_t r = 0; r < readers; ++r) {
+        threads.emplace_back([&, r] {
+            Result& res = results[r];
+            size_t bytes = 0;
+            const auto start = std::chrono::steady_clock::now();
+            while (running.load(std::memory_order_relaxed)) {
+                for (int i = 0; i < 16; ++i) {
+                    bytes += poll();
+                }
+                res.polls += 16;
+            }
+            const auto elapsed = std::chrono::steady_clock::now() - start;
+            res.nsPerPoll = std::chrono::duration<double, std::nano>(elapsed).count() / res.polls;
+            sink += bytes;
+        });
+    }
+
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    running = false;
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    Result total;
+    for (const auto& res : results) {
+        total.nsPerPoll += res.nsPerPoll / readers;
+        total.polls += res.polls;
+    }
+    return total;
+}
+
+template <typename Update>
+void RunWriter(std::atomic<bool>& running, uint64_t intervalNs, Update update) {
+    for (uint32_t version = 2; running.load(std::memory_order_relaxed); ++version) {
+        update(version);
+        if (intervalNs) {
+            std::this_thread::sleep_for(std::chrono::nanoseconds(intervalNs));
+        }
+    }
+}
+
+void Print(uint32_t readers, const char* name, const Result& r) {
+    std::printf("  %2u readers  %-22s %10.1f ns/poll  %12llu polls\n", readers, name, r.nsPerPoll,
+                static_cast<unsigned long long>(r.polls));
+}
+
+void RunCase(uint32_t streams, uint32_t readers, double seconds, uint64_t writerIntervalNs) {
+    // Old API: names, then a locked copy per stream
+    {
+        SAPDiscoveryCache cache;
+        for (uint32_t id = 0; id < streams; ++id) Feed(cache, id, 1);
+        MutexDiscovery discovery;
+        cache.ForEach([&](const DiscoveredSession& s) { discovery.Update(s.name, s.session); });
+
+        std::atomic<bool> running{true};
+        std::thread writer([&] {
+            RunWriter(running, writerIntervalNs, [&](uint32_t version) {
+                Feed(cache, version % streams, version);
+                const DiscoveredSession* s = cache.FindBySdpOrigin("- " + std::to_string(version % streams) + " IN IP4 10.0.0.5");
+                if (s) discovery.Update(s->name, s->session);
+            });
+        });
+        const Result r = RunReaders(readers, seconds, [&] {
+            size_t bytes = 0;
+            SDPSession session;
+            for (const auto& name : discovery.Names()) {
+                if (discovery.Get(name, session)) {
+                    bytes += name.size() + session.connectionAddr.size() + session.port;
+                }
+            }
+            return bytes;
+        });
+        running = false;
+        writer.join();
+        Print(readers, "mutex + copy", r);
+    }
+
+    // Snapshot: one lock-free load, then read in place
+    {
+        SAPDiscoveryCache cache;
+        for (uint32_t id = 0; id < streams; ++id) Feed(cache, id, 1);
+        SnapshotPublisher<DiscoverySnapshot> publisher(cache.Snapshot());
+
+        std::atomic<bool> running{true};
+        std::thread writer([&] {
+            RunWriter(running, writerIntervalNs, [&](uint32_t version) {
+                Feed(cache, version % streams, version);
+                publisher.Publish(cache.Snapshot());
+            });
+        });
+        const Result r = RunReaders(readers, seconds, [&] {
+            size_t bytes = 0;
+            const auto snapshot = publisher.Load();
+            for (const auto& stream : snapshot->sessions) {
+                bytes += stream->name.size() + stream->session.connectionAddr.size() + stream->session.port;
+            }
+            return bytes;
+        });
+        running = false;
+        writer.join();
+        Print(readers, "snapshot", r);
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const uint32_t hw = std::max(2u, std::thread::hardware_concurrency());
+    const uint32_t streams = argc > 1 ? static_cast<uint32_t>(std::atoi(argv[1])) : 64;
+    const uint32_t maxReaders = argc > 2 ? static_cast<uint32_t>(std::atoi(argv[2])) : hw - 1;
+    const double seconds = argc > 3 ? std::atof(argv[3]) : 1.0;
+    constexpr uint64_t kPublishIntervalNs = 100000000ULL;    // Discovery thread: 10 Hz at most
+
+    std::printf("Discovered-stream poll cost, %u streams, %.1f s per case\n", streams, seconds);
+
+    std::printf("\nWriter republishing at 10 Hz:\n");
+    for (uint32_t readers = 1; readers <= maxReaders; readers *= 2) {
+        RunCase(streams, readers, seconds, kPublishIntervalNs);
+    }
+
+    std::printf("\nWriter republishing continuously:\n");
+    for (uint32_t readers = 1; readers <= maxReaders; readers *= 2) {
+        RunCase(streams, readers, seconds, 0);
+    }
+
+    return 0;
+}
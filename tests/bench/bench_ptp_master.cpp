@@ -0,0 +1,277 @@
+// bench_ptp_master.cpp - PTP master load test with simulated slaves over loopback
+// SPDX-License-Identifier: MIT
+//
+// Usage: bench_ptp_master [delay-req-per-sec-per-slave] [seconds-per-step] [--negotiate]
+//
+// Runs a PTPClient as grandmaster on loopback and drives it with 1, 16, 64
+// and 256 simulated slaves at 127.0.0.2 upwards. Each slave sends hybrid
+// (unicast) Delay_Req to the master and times the Delay_Resp; the report
+// gives response latency percentiles and throughput per step. With
+// --negotiate every slave also requests unicast Sync at 8 Hz and the
+// delivered Sync rate is reported.
+//
+// Needs root for ports 319/320 and two sockets per slave (raise ulimit -n).
+// macOS routes only 127.0.0.1 by default: add the aliases first, e.g.
+//   for i in $(seq 2 257); do sudo ifconfig lo0 alias 127.0.0.$i; done
+
+#include "PTPClient.h"
+#include "PTPUnicast.h"
+#include "HostClock.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace AES67;
+
+namespace {
+
+#if defined(__APPLE__)
+constexpr const char* kLoopback = "lo0";
+#else
+constexpr const char* kLoopback = "lo";
+#endif
+constexpr uint16_t kEventPort = 319;
+constexpr uint16_t kGeneralPort = 320;
+constexpr size_t kSequenceWindow = 1024;    // Outstanding Delay_Req per slave
+constexpr int8_t kNegotiatedLogSync = -3;
+
+struct SimSlave {
+    int eventSock = -1;
+    int generalSock = -1;
+    sockaddr_in master{};
+    uint16_t sequenceId = 0;
+    std::atomic<uint64_t> sentNs[kSequenceWindow];
+    uint64_t syncs = 0;
+};
+
+int BindSocket(in_addr_t address, uint16_t port) {
+    const int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sock < 0) {
+        return -1;
+    }
+    const int reuse = 1;
+    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = address;
+    if (bind(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+void WriteHeader(uint8_t* buffer, PTPMessageType type, uint16_t length, uint16_t sequenceId,
+                 uint32_t slaveIndex) {
+    std::memset(buffer, 0, length);
+    buffer[0] = static_cast<uint8_t>(type);
+    buffer[1] = 2;
+    buffer[2] = static_cast<uint8_t>(length >> 8);
+    buffer[3] = static_cast<uint8_t>(length);
+    buffer[6] = 0x04;   // unicastFlag
+    buffer[20] = 0x02;  // Clock identity from the slave index
+    buffer[25] = static_cast<uint8_t>(slaveIndex >> 16);
+    buffer[26] = static_cast<uint8_t>(slaveIndex >> 8);
+    buffer[27] = static_cast<uint8_t>(slaveIndex);
+    buffer[29] = 1;
+    buffer[30] = static_cast<uint8_t>(sequenceId >> 8);
+    buffer[31] = static_cast<uint8_t>(sequenceId);
+    buffer[33] = 0x7F;
+}
+
+void RequestUnicastSync(SimSlave& slave, uint32_t index) {
+    uint8_t msg[kPTPSignalingHeaderLength + kPTPUnicastTLVMaxLength];
+    PTPUnicastMessage request;
+    request.messageType = PTPMessageType::Sync;
+    request.logInterval = kNegotiatedLogSync;
+    request.durationSec = 60;
+    const size_t length = kPTPSignalingHeaderLength + kPTPUnicastTLVMaxLength;
+    WriteHeader(msg, PTPMessageType::Signaling, static_cast<uint16_t>(length), 0, index);
+    std::memset(msg + 34, 0xFF, 10);    // Any clock, any port
+    const size_t tlvLength = WritePTPUnicastTLV(msg + kPTPSignalingHeaderLength, request);
+    const size_t total = kPTPSignalingHeaderLength + tlvLength;
+    msg[2] = static_cast<uint8_t>(total >> 8);
+    msg[3] = static_cast<uint8_t>(total);
+
+    sockaddr_in dest = slave.master;
+    dest.sin_port = htons(kGeneralPort);
+    sendto(slave.generalSock, msg, total, 0, reinterpret_cast<sockaddr*>(&dest), sizeof(dest));
+}
+
+double Percentile(const std::vector<uint32_t>& sorted, double p) {
+    if (sorted.empty()) {
+        return 0.0;
+    }
+    const size_t index = std::min(sorted.size() - 1, static_cast<size_t>(p * static_cast<double>(sorted.size())));
+    return sorted[index] / 1000.0;
+}
+
+bool RunStep(size_t slaveCount, double ratePerSlave, double seconds, bool negotiate) {
+    PTPClient master;
+    master.SetSyncInterval(-3);
+    if (!master.Start(kLoopback, PTPClient::Mode::Master)) {
+        std::fprintf(stderr, "failed to start the master (root needed for ports 319/320)\n");
+        return false;
+    }
+
+    std::vector<SimSlave> slaves(slaveCount);
+    std::vector<pollfd> fds;
+    bool ok = true;
+    for (size_t i = 0; i < slaveCount && ok; ++i) {
+        SimSlave& s = slaves[i];
+        const in_addr_t address = htonl(INADDR_LOOPBACK + 1 + static_cast<in_addr_t>(i));
+        s.eventSock = BindSocket(address, kEventPort);
+        s.generalSock = BindSocket(address, kGeneralPort);
+        s.master.sin_family = AF_INET;
+        s.master.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        for (auto& sent : s.sentNs) {
+            sent.store(0, std::memory_order_relaxed);
+        }
+        ok = s.eventSock >= 0 && s.generalSock >= 0;
+        fds.push_back({s.generalSock, POLLIN, 0});
+        fds.push_back({s.eventSock, POLLIN, 0});
+    }
+    if (!ok) {
+        std::fprintf(stderr, "failed to bind slave sockets (loopback aliases, ulimit -n?)\n");
+    }
+
+    std::vector<uint32_t> latencies;
+    latencies.reserve(static_cast<size_t>(slaveCount * ratePerSlave * seconds) + 1024);
+    std::atomic<bool> receiving{true};
+    uint64_t unmatched = 0;
+
+    // One receiver for all slaves; fds[2i] / fds[2i+1] belong to slave i
+    std::thread receiver([&] {
+        uint8_t buffer[256];
+        while (receiving.load(std::memory_order_relaxed)) {
+            if (poll(fds.data(), static_cast<nfds_t>(fds.size()), 20) <= 0) {
+                continue;
+            }
+            for (size_t f = 0; f < fds.size(); ++f) {
+                if (!(fds[f].revents & POLLIN)) {
+                    continue;
+                }
+                SimSlave& s = slaves[f / 2];
+                ssize_t n;
+                while ((n = recv(fds[f].fd, buffer, sizeof(buffer), MSG_DONTWAIT)) > 0) {
+                    const uint64_t nowNs = HostClock::NowNs();
+                    const uint8_t type = buffer[0] & 0x0F;
+                    if (type == static_cast<uint8_t>(PTPMessageType::Sync)) {
+                        s.syncs++;
+                    } else if (type == static_cast<uint8_t>(PTPMessageType::Delay_Resp) && n >= 54) {
+                        const uint16_t seq = static_cast<uint16_t>(buffer[30] << 8 | buffer[31]);
+                        const uint64_t sent = s.sentNs[seq % kSequenceWindow].exchange(0);
+                        if (sent != 0) {
+                            latencies.push_back(static_cast<uint32_t>(std::min<uint64_t>(nowNs - sent, UINT32_MAX)));
+                        } else {
+                            unmatched++;
+                        }
+                    }
+                }
+            }
+        }
+    });
+
+    if (ok && negotiate) {
+        for (size_t i = 0; i < slaveCount; ++i) {
+            RequestUnicastSync(slaves[i], static_cast<uint32_t>(i));
+        }
+    }
+
+    // Delay_Req round robin over the slaves at the aggregate rate
+    uint64_t sent = 0;
+    const double aggregate = static_cast<double>(slaveCount) * ratePerSlave;
+    const uint64_t periodNs = static_cast<uint64_t>(1e9 / aggregate);
+    const uint64_t totalRequests = static_cast<uint64_t>(aggregate * seconds);
+    const auto start = std::chrono::steady_clock::now();
+    const uint64_t startNs = HostClock::NowNs();
+    for (uint64_t k = 0; ok && k < totalRequests; ++k) {
+        std::this_thread::sleep_until(start + std::chrono::nanoseconds(k * periodNs));
+        SimSlave& s = slaves[k % slaveCount];
+        uint8_t msg[44];
+        const uint16_t seq = s.sequenceId++;
+        WriteHeader(msg, PTPMessageType::Delay_Req, sizeof(msg), seq, static_cast<uint32_t>(k % slaveCount));
+        sockaddr_in dest = s.master;
+        dest.sin_port = htons(kEventPort);
+        s.sentNs[seq % kSequenceWindow].store(HostClock::NowNs());
+        if (sendto(s.eventSock, msg, sizeof(msg), 0, reinterpret_cast<sockaddr*>(&dest), sizeof(dest)) == sizeof(msg)) {
+            sent++;
+        }
+    }
+    const double elapsed = static_cast<double>(HostClock::NowNs() - startNs) / 1e9;
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    receiving = false;
+    receiver.join();
+    const double receiveElapsed = static_cast<double>(HostClock::NowNs() - startNs) / 1e9;
+    const size_t seenByMaster = master.GetSlaveCount();
+    master.Stop();
+
+    uint64_t syncs = 0;
+    for (SimSlave& s : slaves) {
+        syncs += s.syncs;
+        close(s.eventSock);
+        close(s.generalSock);
+    }
+    if (!ok) {
+        return false;
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    std::printf("%6zu %8.0f %8.0f %7.2f%% %7.1f %7.1f %7.1f %7.1f %8.1f %6zu",
+                slaveCount, sent / elapsed, latencies.size() / elapsed,
+                sent ? 100.0 * (1.0 - static_cast<double>(latencies.size()) / sent) : 0.0,
+                Percentile(latencies, 0.50), Percentile(latencies, 0.90),
+                Percentile(latencies, 0.99), Percentile(latencies, 0.999),
+                latencies.empty() ? 0.0 : latencies.back() / 1000.0, seenByMaster);
+    if (negotiate) {
+        // Expected: 2^-logSyncInterval per slave and second
+        const double expected = static_cast<double>(1 << -kNegotiatedLogSync);
+        std::printf(" %9.2f/%.0f", syncs / receiveElapsed / static_cast<double>(slaveCount), expected);
+    }
+    std::printf("%s\n", unmatched ? " (unmatched responses)" : "");
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    double rate = 16.0;
+    double seconds = 5.0;
+    bool negotiate = false;
+    int positional = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--negotiate") == 0) {
+            negotiate = true;
+        } else if (positional++ == 0) {
+            rate = std::atof(argv[i]);
+        } else {
+            seconds = std::atof(argv[i]);
+        }
+    }
+    if (rate <= 0.0 || seconds <= 0.0) {
+        std::fprintf(stderr, "usage: %s [delay-req-per-sec-per-slave] [seconds-per-step] [--negotiate]\n", argv[0]);
+        return 1;
+    }
+
+    std::printf("PTP master load: %.0f Delay_Req/s per slave, %.0f s per step%s\n\n",
+                rate, seconds, negotiate ? ", unicast Sync negotiated" : "");
+    std::printf("%6s %8s %8s %8s %7s %7s %7s %7s %8s %6s%s\n",
+                "slaves", "req/s", "resp/s", "lost", "p50us", "p90us", "p99us", "p99.9us", "max us", "table",
+                negotiate ? "  sync/s/slave" : "");
+    for (size_t slaves : {1, 16, 64, 256}) {
+        if (!RunStep(slaves, rate, seconds, negotiate)) {
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,161 @@
+// bench_ptp_time.cpp - Cost of reading PTP time while the servo updates the mapping
+// SPDX-License-Identifier: MIT
+//
+// Usage: bench_ptp_time [readers] [seconds-per-case]
+//
+// The "seqlock" cases run exactly what PTPClient::GetPTPTimeNs() does once
+// locked: one HostClock read plus an AffineTimeMap conversion. A writer thread
+// republishes the coefficients either at a servo-like 16 Hz or flat out.
+
+#include "AffineTimeMap.h"
+#include "HostClock.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <time.h>
+#include <vector>
+
+using namespace AES67;
+
+namespace {
+
+struct Result {
+    double nsPerCall = 0.0;
+    uint64_t calls = 0;
+    uint64_t backwards = 0;     // Reader saw PTP time go backwards (1 ns rounding across a republish)
+};
+
+// Old-style mapping for comparison: coefficients behind a mutex
+struct MutexTimeMap {
+    void Publish(const AffineTimeMap::Coefficients& c) {
+        std::lock_guard<std::mutex> lock(mutex);
+        coeffs = c;
+    }
+    uint64_t HostToPTP(uint64_t hostNs) {
+        std::lock_guard<std::mutex> lock(mutex);
+        return AffineTimeMap::HostToPTP(coeffs, hostNs);
+    }
+    std::mutex mutex;
+    AffineTimeMap::Coefficients coeffs;
+};
+
+uint64_t RealtimeNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+// Slew the mapping by ±1 ppm around the host clock, continuous at every anchor
+template <typename Map>
+void RunWriter(Map& map, std::atomic<bool>& running, uint64_t intervalNs) {
+    AffineTimeMap::Coefficients c{1.0, HostClock::NowNs(), 1000000000000ULL};
+    map.Publish(c);
+    for (uint64_t i = 0; running.load(std::memory_order_relaxed); ++i) {
+        const uint64_t now = HostClock::NowNs();
+        c.anchorPTP = AffineTimeMap::HostToPTP(c, now);
+        c.anchorHost = now;
+        c.slope = (i & 1) ? 1.000001 : 0.999999;
+        map.Publish(c);
+        if (intervalNs) {
+            std::this_thread::sleep_for(std::chrono::nanoseconds(intervalNs));
+        }
+    }
+}
+
+template <typename Fn>
+Result RunReaders(uint32_t readers, double seconds, Fn read) {
+    std::atomic<bool> running{true};
+    std::vector<Result> results(readers);
+    std::vector<std::thread> threads;
+
+    for (uint32_t r = 0; r < readers; ++r) {
+        threads.emplace_back([&, r] {
+            Result& res = results[r];
+            uint64_t last = 0;
+            const auto start = std::chrono::steady_clock::now();
+            while (running.load(std::memory_order_relaxed)) {
+                for (int i = 0; i < 1024; ++i) {
+                    const uint64_t t = read();
+                    if (t < last) {
+                        res.backwards++;
+                    }
+                    last = t;
+                }
+                res.calls += 1024;
+            }
+            const auto elapsed = std::chrono::steady_clock::now() - start;
+            res.nsPerCall = std::chrono::duration<double, std::nano>(elapsed).count() / res.calls;
+        });
+    }
+
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    running = false;
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    Result total;
+    for (const auto& res : results) {
+        total.nsPerCall += res.nsPerCall / readers;
+        total.calls += res.calls;
+        total.backwards += res.backwards;
+    }
+    return total;
+}
+
+void Print(const char* name, const Result& r) {
+    std::printf("  %-34s %8.1f ns/call  %12llu calls  %llu backwards\n", name, r.nsPerCall,
+                static_cast<unsigned long long>(r.calls),
+                static_cast<unsigned long long>(r.backwards));
+}
+
+template <typename Map>
+Result RunMapped(Map& map, uint32_t readers, double seconds, uint64_t writerIntervalNs) {
+    std::atomic<bool> running{true};
+    std::thread writer([&] { RunWriter(map, running, writerIntervalNs); });
+    const Result r = RunReaders(readers, seconds, [&] { return map.HostToPTP(HostClock::NowNs()); });
+    running = false;
+    writer.join();
+    return r;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const uint32_t hw = std::max(2u, std::thread::hardware_concurrency());
+    const uint32_t readers = argc > 1 ? static_cast<uint32_t>(std::atoi(argv[1])) : hw - 1;
+    const double seconds = argc > 2 ? std::atof(argv[2]) : 1.0;
+    constexpr uint64_t kServoIntervalNs = 62500000ULL;   // 16 Sync/s
+
+    std::printf("PTP time read cost, %u reader thread(s), %.1f s per case\n\n", readers, seconds);
+
+    std::printf("Clock sources:\n");
+    Print("clock_gettime(CLOCK_REALTIME)", RunReaders(readers, seconds, RealtimeNs));
+    Print("HostClock::NowNs()", RunReaders(readers, seconds, HostClock::NowNs));
+
+    std::printf("\nGetPTPTimeNs() path, servo at 16 Hz:\n");
+    {
+        AffineTimeMap map;
+        Print("seqlock AffineTimeMap", RunMapped(map, readers, seconds, kServoIntervalNs));
+    }
+    {
+        MutexTimeMap map;
+        Print("mutex-protected map", RunMapped(map, readers, seconds, kServoIntervalNs));
+    }
+
+    std::printf("\nGetPTPTimeNs() path, writer publishing continuously:\n");
+    {
+        AffineTimeMap map;
+        Print("seqlock AffineTimeMap", RunMapped(map, readers, seconds, 0));
+    }
+    {
+        MutexTimeMap map;
+        Print("mutex-protected map", RunMapped(map, readers, seconds, 0));
+    }
+
+    return 0;
+}
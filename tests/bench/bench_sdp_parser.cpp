@@ -0,0 +1,274 @@
+// bench_sdp_parser.cpp - SDP parse throughput and allocations per announcement
+// SPDX-License-Identifier: MIT
+//
+// Usage: bench_sdp_parser [seconds-per-case]
+//
+// Parses a corpus of AES67, Dante, Ravenna and ST 2110-30 descriptions as
+// seen in SAP announcements, round-robin. "warm session" is what the SAP
+// listener does: parse each packet into the same SDPSession; "same stream"
+// repeats one description, as re-announcements do. "new session"
+// returns a fresh struct per parse. "regex parser" is the previous
+// std::regex/istringstream implementation, kept here for comparison.
+// Allocations are counted by replacing the global operator new.
+
+#include "SDPParser.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace AES67;
+
+namespace {
+
+std::atomic<uint64_t> g_allocations{0};
+
+} // namespace
+
+// Out of line so the compiler does not pair the inlined free with new
+[[gnu::noinline]] void* operator new(size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+[[gnu::noinline]] void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+[[gnu::noinline]] void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+namespace {
+
+const char* const kCorpus[] = {
+    // AES67 (this engine's SAPAnnouncer)
+    "v=0\r\n"
+    "o=aes67-vsc 3928736891 3928736891 IN IP4 192.168.1.10\r\n"
+    "s=AES67 VSC 1-8\r\n"
+    "i=8-channel L24 audio stream\r\n"
+    "c=IN IP4 239.69.1.1/32\r\n"
+    "t=0 0\r\n"
+    "a=recvonly\r\n"
+    "m=audio 5004 RTP/AVP 96\r\n"
+    "a=rtpmap:96 L24/48000/8\r\n"
+    "a=ptime:1\r\n"
+    "a=ts-refclk:ptp=IEEE1588-2008:00-1D-C1-FF-FE-12-34-56:0\r\n"
+    "a=mediaclk:direct=0\r\n",
+
+    // Dante in AES67 mode
+    "v=0\r\n"
+    "o=- 1311738121 1311738121 IN IP4 192.168.1.20\r\n"
+    "s=AOIP44-serial-1614 : 2\r\n"
+    "c=IN IP4 239.69.161.92/32\r\n"
+    "t=0 0\r\n"
+    "a=keywds:Dante\r\n"
+    "m=audio 5004 RTP/AVP 97\r\n"
+    "i=2 channels: TxChan 0, TxChan 1\r\n"
+    "a=recvonly\r\n"
+    "a=rtpmap:97 L24/48000/2\r\n"
+    "a=ptime:1\r\n"
+    "a=ts-refclk:ptp=IEEE1588-2008:00-1D-C1-FF-FE-0E-12-34:0\r\n"
+    "a=mediaclk:direct=750129188\r\n",
+
+    // Ravenna
+    "v=0\r\n"
+    "o=- 1423986 1423994 IN IP4 192.168.1.150\r\n"
+    "s=ANUBIS_610120_Stream1\r\n"
+    "c=IN IP4 239.1.150.100/15\r\n"
+    "t=0 0\r\n"
+    "a=clock-domain:PTPv2 0\r\n"
+    "m=audio 5004 RTP/AVP 98\r\n"
+    "c=IN IP4 239.1.150.100/15\r\n"
+    "a=rtpmap:98 L24/48000/2\r\n"
+    "a=sync-time:0\r\n"
+    "a=framecount:48\r\n"
+    "a=source-filter: incl IN IP4 239.1.150.100 192.168.1.150\r\n"
+    "a=recvonly\r\n"
+    "a=ptime:1\r\n"
+    "a=ts-refclk:ptp=IEEE1588-2008:00-1D-C1-FF-FE-51-9E-F7:0\r\n"
+    "a=mediaclk:direct=0\r\n",
+
+    // ST 2110-30 with ST 2022-7 redundancy
+    "v=0\r\n"
+    "o=- 1578311104 1578311109 IN IP4 10.10.1.21\r\n"
+    "s=Studio A Desk Out 1-16\r\n"
+    "t=0 0\r\n"
+    "a=group:DUP primary secondary\r\n"
+    "m=audio 5004 RTP/AVP 97\r\n"
+    "c=IN IP4 239.10.1.21/64\r\n"
+    "a=source-filter: incl IN IP4 239.10.1.21 10.10.1.21\r\n"
+    "a=rtpmap:97 L24/48000/16\r\n"
+    "a=ptime:0.125\r\n"
+    "a=maxptime:0.125\r\n"
+    "a=ts-refclk:ptp=IEEE1588-2008:08-00-11-FF-FE-22-B1-04:127\r\n"
+    "a=mediaclk:direct=0\r\n"
+    "a=mid:primary\r\n"
+    "m=audio 5004 RTP/AVP 97\r\n"
+    "c=IN IP4 239.20.1.21/64\r\n"
+    "a=source-filter: incl IN IP4 239.20.1.21 10.20.1.21\r\n"
+    "a=rtpmap:97 L24/48000/16\r\n"
+    "a=ptime:0.125\r\n"
+    "a=maxptime:0.125\r\n"
+    "a=ts-refclk:ptp=IEEE1588-2008:08-00-11-FF-FE-22-B1-04:127\r\n"
+    "a=mediaclk:direct=0\r\n"
+    "a=mid:secondary\r\n",
+
+    // Merging/Horus-style, 64 channels at 96 kHz
+    "v=0\n"
+    "o=- 7 9 IN IP4 172.16.0.40\n"
+    "s=HORUS_64ch_Out\n"
+    "c=IN IP4 239.16.0.40/32\n"
+    "t=0 0\n"
+    "a=ts-refclk:ptp=IEEE1588-2008:00-0E-C6-FF-FE-81-77-33:0\n"
+    "a=mediaclk:direct=2863311530\n"
+    "m=audio 5004 RTP/AVP 96\n"
+    "a=rtpmap:96 L24/96000/64\n"
+    "a=ptime:0.250\n"
+    "a=recvonly\n",
+};
+
+constexpr size_t kCorpusSize = sizeof(kCorpus) / sizeof(kCorpus[0]);
+
+// The parser as it was before the single-pass rewrite
+SDPSession RegexParse(const std::string& sdp) {
+    SDPSession session;
+    std::istringstream stream(sdp);
+    std::string line;
+    while (std::getline(stream, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (line.size() < 2 || line[1] != '=') {
+            continue;
+        }
+        const char type = line[0];
+        const std::string value = line.substr(2);
+        switch (type) {
+            case 'o':
+                session.origin = value;
+                break;
+            case 's':
+                session.sessionName = value;
+                break;
+            case 'c': {
+                std::regex connRegex(R"(IN IP4 ([0-9.]+))");
+                std::smatch match;
+                if (std::regex_search(value, match, connRegex)) {
+                    session.connectionAddr = match[1];
+                }
+                break;
+            }
+            case 'm': {
+                std::regex mediaRegex(R"(audio (\d+) RTP/AVP (\d+))");
+                std::smatch match;
+                if (std::regex_search(value, match, mediaRegex)) {
+                    session.port = static_cast<uint16_t>(std::stoi(match[1]));
+                    session.payloadType = static_cast<uint8_t>(std::stoi(match[2]));
+                }
+                break;
+            }
+            case 'a': {
+                if (value.find("rtpmap:") == 0) {
+                    session.rtpmap = value.substr(7);
+                    std::regex rtpmapRegex(R"(L24/(\d+)/(\d+))");
+                    std::smatch match;
+                    if (std::regex_search(value, match, rtpmapRegex)) {
+                        session.sampleRate = std::stoul(match[1]);
+                        session.channels = static_cast<uint8_t>(std::stoul(match[2]));
+                    }
+                } else if (value.find("ptime:") == 0) {
+                    session.packetTimeUs = static_cast<uint32_t>(std::stod(value.substr(6)) * 1000000);
+                } else if (value.find("ts-refclk:") == 0) {
+                    session.ptpRefClock = value.substr(10);
+                } else if (value.find("mediaclk:") == 0) {
+                    session.mediaClk = value.substr(9);
+                }
+                break;
+            }
+        }
+    }
+    return session;
+}
+
+struct Result {
+    double nsPerParse = 0.0;
+    double mbPerSec = 0.0;
+    double allocsPerParse = 0.0;
+};
+
+template <typename Fn>
+Result Run(const std::vector<std::string>& corpus, double seconds, Fn parse) {
+    uint64_t parses = 0;
+    uint64_t bytes = 0;
+    uint64_t sink = 0;
+    const uint64_t allocsBefore = g_allocations.load();
+    const auto start = std::chrono::steady_clock::now();
+    const auto end = start + std::chrono::duration<double>(seconds);
+    while (std::chrono::steady_clock::now() < end) {
+        for (int i = 0; i < 256; ++i) {
+            const std::string& sdp = corpus[parses % corpus.size()];
+            sink += parse(sdp);
+            bytes += sdp.size();
+            parses++;
+        }
+    }
+    const double elapsedNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    const uint64_t allocs = g_allocations.load() - allocsBefore;
+    if (sink == 42) std::printf(" ");   // Keep the results alive
+
+    Result r;
+    r.nsPerParse = elapsedNs / parses;
+    r.mbPerSec = bytes / elapsedNs * 1000.0;
+    r.allocsPerParse = static_cast<double>(allocs) / parses;
+    return r;
+}
+
+void Print(const char* name, const Result& r) {
+    std::printf("  %-22s %9.0f ns/parse  %8.1f MB/s  %6.1f allocs/parse\n", name, r.nsPerParse, r.mbPerSec,
+                r.allocsPerParse);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const double seconds = argc > 1 ? std::atof(argv[1]) : 1.0;
+
+    std::vector<std::string> corpus(kCorpus, kCorpus + kCorpusSize);
+    size_t totalBytes = 0;
+    for (const auto& sdp : corpus) {
+        totalBytes += sdp.size();
+    }
+    std::printf("SDP parse throughput, %zu descriptions (%zu bytes average), %.1f s per case\n\n", corpus.size(),
+                totalBytes / corpus.size(), seconds);
+
+    SDPSession warm;
+    Print("warm session", Run(corpus, seconds, [&](const std::string& sdp) {
+        SDPParser::Parse(sdp, warm);
+        return warm.port + warm.media.size();
+    }));
+    // Re-announcements of one stream: the session's storage already fits
+    const std::vector<std::string> repeated(1, corpus[3]);
+    Print("warm, same stream", Run(repeated, seconds, [&](const std::string& sdp) {
+        SDPParser::Parse(sdp, warm);
+        return warm.port + warm.media.size();
+    }));
+    Print("new session", Run(corpus, seconds, [](const std::string& sdp) {
+        const SDPSession session = SDPParser::Parse(sdp);
+        return session.port + session.media.size();
+    }));
+    Print("regex parser", Run(corpus, seconds, [](const std::string& sdp) {
+        const SDPSession session = RegexParse(sdp);
+        return static_cast<size_t>(session.port);
+    }));
+
+    return 0;
+}
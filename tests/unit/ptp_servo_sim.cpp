@@ -0,0 +1,185 @@
+// ptp_servo_sim.cpp - Offline PTP slave simulation in virtual time
+// SPDX-License-Identifier: MIT
+
+#include "ptp_servo_sim.h"
+#include "AffineTimeMap.h"
+#include "PTPFilter.h"
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <random>
+
+namespace AES67 {
+namespace {
+
+constexpr uint64_t kMasterEpochNs = 1700000000000000000ULL;  // Master (PTP) time at t = 0
+constexpr uint64_t kHostBootNs = 3600000000000ULL;           // Host clock at t = 0
+constexpr double kDelayReqTurnaroundNs = 50000.0;            // Sync processed -> Delay_Req sent
+
+// Host oscillator: integrates its frequency error over virtual time
+class HostOscillator {
+public:
+    HostOscillator(double frequencyPpm) : frequency_(frequencyPpm * 1e-6) {}
+
+    // Advance the segment start to trueNs, drawing new wander for the interval
+    void Advance(double trueNs, double wanderPerSqrtSec, std::mt19937_64& rng) {
+        elapsedNs_ += (trueNs - segmentStartNs_) * (1.0 + frequency_);
+        if (wanderPerSqrtSec > 0.0) {
+            std::normal_distribution<double> step(0.0, wanderPerSqrtSec * 1e-9 *
+                                                       std::sqrt((trueNs - segmentStartNs_) / 1e9));
+            frequency_ += step(rng);
+        }
+        segmentStartNs_ = trueNs;
+    }
+
+    // Host time at a true time inside the current segment
+    uint64_t HostAt(double trueNs) const {
+        const double elapsed = elapsedNs_ + (trueNs - segmentStartNs_) * (1.0 + frequency_);
+        return kHostBootNs + static_cast<uint64_t>(std::llround(elapsed));
+    }
+
+private:
+    double frequency_;
+    double segmentStartNs_ = 0.0;
+    double elapsedNs_ = 0.0;
+};
+
+} // namespace
+
+double ComputeMTIE(const std::vector<double>& timeErrorNs, size_t first, size_t windowSamples) {
+    // Sliding max - min with monotonic index queues
+    std::deque<size_t> maxQ, minQ;
+    double mtie = 0.0;
+    for (size_t i = first; i < timeErrorNs.size(); ++i) {
+        while (!maxQ.empty() && timeErrorNs[maxQ.back()] <= timeErrorNs[i]) maxQ.pop_back();
+        while (!minQ.empty() && timeErrorNs[minQ.back()] >= timeErrorNs[i]) minQ.pop_back();
+        maxQ.push_back(i);
+        minQ.push_back(i);
+        if (maxQ.front() + windowSamples <= i) maxQ.pop_front();
+        if (minQ.front() + windowSamples <= i) minQ.pop_front();
+        if (i + 1 >= first + windowSamples) {
+            mtie = std::max(mtie, timeErrorNs[maxQ.front()] - timeErrorNs[minQ.front()]);
+        }
+    }
+    return mtie;
+}
+
+PTPSimResult RunPTPServoSim(const PTPSimScenario& scenario, PTPServoType type,
+                            const PTPServoConfig& config) {
+    std::mt19937_64 rng(scenario.seed);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    std::exponential_distribution<double> queueing(scenario.pdvMeanNs > 0.0 ? 1.0 / scenario.pdvMeanNs : 1.0);
+
+    auto stampNoise = [&] {
+        return static_cast<int64_t>((uniform(rng) * 2.0 - 1.0) * scenario.timestampNoiseNs);
+    };
+    auto oneWayDelay = [&](double baseNs) {
+        double delay = baseNs;
+        if (scenario.pdvProbability > 0.0 && uniform(rng) < scenario.pdvProbability) {
+            delay += queueing(rng);
+        }
+        return delay;
+    };
+    auto lost = [&] { return scenario.lossProbability > 0.0 && uniform(rng) < scenario.lossProbability; };
+
+    const double forwardNs = scenario.pathDelayNs + scenario.asymmetryNs / 2.0;
+    const double reverseNs = scenario.pathDelayNs - scenario.asymmetryNs / 2.0;
+    const double syncNs = scenario.syncIntervalSec * 1e9;
+    const uint64_t delayReqIntervalNs = static_cast<uint64_t>(scenario.delayReqIntervalSec * 1e9);
+
+    HostOscillator host(scenario.frequencyPpm);
+    auto servo = CreatePTPServo(type, config);
+    PTPMeasurementFilter filter;
+    AffineTimeMap::Coefficients coeffs;     // Identity until the first step, as PTPClient starts
+    bool servoStarted = false;
+    bool locked = false;
+    uint32_t lockCount = 0;
+    uint64_t nextDelayReqNs = 0;
+
+    PTPSimResult result;
+    const size_t syncCount = static_cast<size_t>(scenario.durationSec / scenario.syncIntervalSec);
+    result.timeErrorNs.reserve(syncCount);
+
+    for (size_t n = 0; n < syncCount; ++n) {
+        const double syncTrueNs = static_cast<double>(n) * syncNs;
+        host.Advance(syncTrueNs, scenario.wanderPpbPerSqrtSec, rng);
+
+        // Sync (and its Follow_Up): t1 at the master, t2 on the host clock
+        if (!lost() && !lost()) {
+            const int64_t t1 = static_cast<int64_t>(kMasterEpochNs + static_cast<uint64_t>(syncTrueNs)) + stampNoise();
+            const double arrivalNs = syncTrueNs + oneWayDelay(forwardNs);
+            const int64_t t2 = static_cast<int64_t>(host.HostAt(arrivalNs)) + stampNoise();
+
+            // Same steps as PTPClient::ProcessSyncMeasurement / ServoUpdate
+            if (filter.HasPathDelay()) {
+                const int64_t masterAtT2 = t1 + filter.GetMeanPathDelayNs();
+                const int64_t offset = static_cast<int64_t>(AffineTimeMap::HostToPTP(coeffs, static_cast<uint64_t>(t2))) - masterAtT2;
+                if (!servoStarted || filter.AcceptOffset(offset)) {
+                    servoStarted = true;
+                    const PTPServoAction action = servo->Sample(offset, static_cast<uint64_t>(t2), coeffs);
+                    if (action == PTPServoAction::Stepped) {
+                        result.steps++;
+                        lockCount = 0;
+                        if (locked) {
+                            locked = false;
+                            result.unlocks++;
+                        }
+                    } else if (action == PTPServoAction::Slewed) {
+                        const double error = std::abs(static_cast<double>(offset));
+                        lockCount = error < kPTPLockThresholdNs ? lockCount + 1 : 0;
+                        if (!locked && lockCount >= kPTPLockSamples) {
+                            locked = true;
+                            if (!result.locked) {
+                                result.locked = true;
+                                result.lockTimeSec = arrivalNs / 1e9;
+                            }
+                        } else if (locked && error > kPTPUnlockThresholdNs) {
+                            locked = false;
+                            result.unlocks++;
+                        }
+                    }
+                }
+            }
+
+            // Delay_Req on every Sync until a path delay exists, then per interval
+            const uint64_t nowHost = static_cast<uint64_t>(t2);
+            if (!filter.HasPathDelay() || nowHost >= nextDelayReqNs) {
+                nextDelayReqNs = nowHost + delayReqIntervalNs;
+                const double departNs = arrivalNs + kDelayReqTurnaroundNs;
+                if (!lost() && !lost()) {
+                    PTPExchange exchange;
+                    exchange.t1 = t1;
+                    exchange.t2 = t2;
+                    exchange.t3 = static_cast<int64_t>(host.HostAt(departNs)) + stampNoise();
+                    exchange.t4 = static_cast<int64_t>(kMasterEpochNs + static_cast<uint64_t>(departNs + oneWayDelay(reverseNs))) + stampNoise();
+                    filter.AddPathDelay(exchange.MeanPathDelay());
+                }
+            }
+        }
+
+        // Time error of the published mapping against true master time
+        const uint64_t mapped = AffineTimeMap::HostToPTP(coeffs, host.HostAt(syncTrueNs));
+        const uint64_t truth = kMasterEpochNs + static_cast<uint64_t>(syncTrueNs);
+        result.timeErrorNs.push_back(static_cast<double>(static_cast<int64_t>(mapped - truth)));
+    }
+
+    // Steady-state statistics
+    const size_t first = std::min(result.timeErrorNs.size(),
+                                  static_cast<size_t>(scenario.settleSec / scenario.syncIntervalSec));
+    const size_t count = result.timeErrorNs.size() - first;
+    if (count > 0) {
+        double sum = 0.0, sumSq = 0.0;
+        for (size_t i = first; i < result.timeErrorNs.size(); ++i) {
+            sum += result.timeErrorNs[i];
+            sumSq += result.timeErrorNs[i] * result.timeErrorNs[i];
+        }
+        result.meanNs = sum / count;
+        result.rmsNs = std::sqrt(sumSq / count);
+    }
+    const size_t perSecond = static_cast<size_t>(std::llround(1.0 / scenario.syncIntervalSec));
+    result.mtie1sNs = ComputeMTIE(result.timeErrorNs, first, perSecond);
+    result.mtie10sNs = ComputeMTIE(result.timeErrorNs, first, 10 * perSecond);
+    return result;
+}
+
+} // namespace AES67
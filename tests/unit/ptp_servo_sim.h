@@ -0,0 +1,50 @@
+// ptp_servo_sim.h - Offline PTP slave simulation in virtual time
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "PTPServo.h"
+#include <cstdint>
+#include <vector>
+
+namespace AES67 {
+
+// Network and oscillator model for one simulated master/slave pair
+struct PTPSimScenario {
+    double frequencyPpm = 20.0;             // Host oscillator error vs master
+    double wanderPpbPerSqrtSec = 0.0;       // Frequency random walk
+    double pathDelayNs = 5000.0;            // Mean one-way delay
+    double asymmetryNs = 0.0;               // Forward minus reverse delay
+    double pdvProbability = 0.0;            // Chance a packet queues behind traffic
+    double pdvMeanNs = 0.0;                 // Mean (exponential) queueing delay
+    double timestampNoiseNs = 20.0;         // Uniform ± stamping jitter, both ends
+    double lossProbability = 0.0;           // Per message
+    double syncIntervalSec = 0.125;
+    double delayReqIntervalSec = 1.0;
+    double durationSec = 300.0;
+    double settleSec = 60.0;                // Statistics from here on
+    uint64_t seed = 1;
+};
+
+struct PTPSimResult {
+    bool locked = false;
+    double lockTimeSec = -1.0;              // First lock, as PTPClient reports it
+    uint32_t unlocks = 0;                   // After first lock
+    uint32_t steps = 0;
+    double meanNs = 0.0;                    // Steady-state time error
+    double rmsNs = 0.0;
+    double mtie1sNs = 0.0;                  // Maximum time interval error, 1 s window
+    double mtie10sNs = 0.0;                 // ...and 10 s window
+    std::vector<double> timeErrorNs;        // Per Sync, after the servo update
+};
+
+// Runs the slave pipeline PTPClient uses (measurement filter, servo,
+// affine map, lock hysteresis) against synthetic Sync/Delay_Req exchanges.
+// Deterministic for a given seed.
+PTPSimResult RunPTPServoSim(const PTPSimScenario& scenario, PTPServoType type,
+                            const PTPServoConfig& config = {});
+
+// Maximum peak-to-peak time error over any window of windowSamples samples
+double ComputeMTIE(const std::vector<double>& timeErrorNs, size_t first, size_t windowSamples);
+
+} // namespace AES67
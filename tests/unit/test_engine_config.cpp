@@ -0,0 +1,206 @@
+// test_engine_config.cpp - engine.json / qos.json loading tests
+// SPDX-License-Identifier: MIT
+
+#include "EngineConfig.h"
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <string>
+#include <unistd.h>
+
+extern void RegisterTest(const std::string& name, std::function<bool()> test);
+
+using namespace AES67;
+
+namespace {
+
+const char* kQoSJson = R"({
+  "profiles": {
+    "low-latency": {
+      "description": "Mac to Mac",
+      "io_buffer_frames": 32,
+      "packet_time_us": 250,
+      "jitter_buffer_packets_min": 2,
+      "jitter_buffer_packets_max": 4,
+      "ptp_domain": 0,
+      "ptp_sync_interval_log2": 0,
+      "rtp_dscp": "EF",
+      "ptp_dscp": 56
+    },
+    "broadcast": {
+      "packet_time_us": 1000,
+      "jitter_buffer_packets_min": 4,
+      "jitter_buffer_packets_max": 8,
+      "ptp_sync_interval_log2": -1,
+      "tx_safety_offset_frames": 200,
+      "rtp_dscp": "AF41"
+    }
+  },
+  "dscp_presets": { "EF": 46, "AF41": 34 },
+  "network": {
+    "udp_recv_buffer_size": 2097152,
+    "udp_send_buffer_size": 1048576,
+    "enable_timestamping": true,
+    "multicast_ttl": 16,
+    "multicast_loop": false
+  },
+  "sap": { "enabled": false, "interval_seconds": 10, "address": "239.255.255.255", "port": 9875 }
+})";
+
+bool WriteFile(const std::string& path, const std::string& text) {
+    FILE* file = std::fopen(path.c_str(), "w");
+    if (!file) return false;
+    const bool ok = std::fwrite(text.data(), 1, text.size(), file) == text.size();
+    return std::fclose(file) == 0 && ok;
+}
+
+} // namespace
+
+// Test profiles, DSCP preset names and the network/sap sections
+bool test_config_qos_profiles() {
+    EngineFileConfig config;
+    std::string error;
+    if (!ParseQoSConfig(kQoSJson, config, error) || config.profiles.size() != 2) return false;
+
+    const QoSProfile* low = config.FindProfile("low-latency");
+    const QoSProfile* broadcast = config.FindProfile("broadcast");
+    if (!low || !broadcast || config.FindProfile("interop")) return false;
+    if (low->description != "Mac to Mac" || low->ioBufferFrames != 32 || low->packetTimeUs != 250 ||
+        low->jitterBufferPacketsMin != 2 || low->jitterBufferPacketsMax != 4 ||
+        low->ptpLogSyncInterval != 0 || low->rtpDscp != 46 || low->ptpDscp != 56) return false;
+
+    // Keys left out keep the built-in values
+    if (broadcast->ioBufferFrames != QoSProfile{}.ioBufferFrames || broadcast->rtpDscp != 34 ||
+        broadcast->ptpDscp != 0 || broadcast->ptpLogSyncInterval != -1) return false;
+
+    return config.network.udpRecvBufferSize == 2097152 && config.network.udpSendBufferSize == 1048576 &&
+           config.network.multicastTtl == 16 && !config.network.multicastLoop &&
+           !config.sapEnabled && config.sapIntervalSeconds == 10;
+}
+
+// Test engine.json inputs become RX subscriptions, disabled ones skipped
+bool test_config_engine_inputs() {
+    const char* json = R"({
+      "interface": "en1",
+      "qos_profile": "broadcast",
+      "inputs": [
+        { "id": 0, "enabled": true, "multicast_address": "239.69.83.1", "port": 5004,
+          "channels": 8, "sample_rate": 48000, "format": "L24", "name": "Live Output" },
+        { "id": 3, "multicast_address": "239.69.83.4", "port": 5008, "channels": 2,
+          "format": "L16", "payload_type": 98, "packet_time_us": 125 },
+        { "id": 5, "enabled": false, "multicast_address": "239.69.83.6", "port": 5004 }
+      ],
+      "outputs": [],
+      "ptp": { "enabled": true, "domain": 3 }
+    })";
+    EngineFileConfig config;
+    std::string error;
+    if (!ParseEngineConfig(json, config, error)) return false;
+    if (config.interface != "en1" || config.qosProfile != "broadcast" ||
+        !config.havePtpDomain || config.ptpDomain != 3 || config.inputs.size() != 2) return false;
+
+    const auto& [slot0, live] = config.inputs[0];
+    const auto& [slot3, stereo] = config.inputs[1];
+    return slot0 == 0 && live.address == "239.69.83.1" && live.port == 5004 && live.channels == 8 &&
+           live.bytesPerSample == 3 && live.sessionName == "Live Output" &&
+           slot3 == 3 && stereo.port == 5008 && stereo.channels == 2 && stereo.bytesPerSample == 2 &&
+           stereo.payloadType == 98 && stereo.packetTimeUs == 125;
+}
+
+// Test malformed documents and values the engine cannot run are refused
+bool test_config_rejects_bad_values() {
+    const char* bad[] = {
+        R"({"profiles": {"x": {"packet_time_us": 250,}}})",                          // Trailing comma
+        R"({"profiles": {"x": {"packet_time_us": 300}}})",                           // 14.4 frames
+        R"({"profiles": {"x": {"packet_time_us": 4000}}})",                          // 192 frames
+        R"({"profiles": {"x": {"jitter_buffer_packets_min": 4, "jitter_buffer_packets_max": 4}}})",
+        R"({"profiles": {"x": {"rtp_dscp": "CS9"}}, "dscp_presets": {"EF": 46}})",   // Unknown preset
+        R"({"profiles": {"x": {"ptp_dscp": 64}}})",
+        R"({"profiles": {"x": {"io_buffer_frames": "64"}}})",                        // Wrong type
+        R"({"profiles": {"x": {"io_buffer_frames": 8192}}})",
+        R"({"profiles": {"x": {"tx_safety_offset_frames": 9000}}})",
+        R"({"network": {"multicast_ttl": 0}})",
+        R"([1, 2])",
+    };
+    for (const char* json : bad) {
+        EngineFileConfig config;
+        std::string error;
+        if (ParseQoSConfig(json, config, error) || error.empty()) return false;
+    }
+
+    const char* badEngine[] = {
+        R"({"inputs": [{"id": 8, "multicast_address": "239.1.1.1", "port": 5004}]})",
+        R"({"inputs": [{"id": 0, "multicast_address": "239.1.1.1", "port": 5004, "format": "L32"}]})",
+        R"({"inputs": [{"id": 0, "multicast_address": "239.1.1.1", "port": 5004, "sample_rate": 96000}]})",
+        R"({"inputs": [{"id": 0, "port": 5004}]})",
+        R"({"interface": "en0")",
+    };
+    for (const char* json : badEngine) {
+        EngineFileConfig config;
+        std::string error;
+        if (ParseEngineConfig(json, config, error) || error.empty()) return false;
+    }
+    return true;
+}
+
+// Test engine.json finds the qos.json next to it and the profile it names
+bool test_config_load_files() {
+    char dir[] = "/tmp/aes67_config_XXXXXX";
+    if (!mkdtemp(dir)) return false;
+    const std::string enginePath = std::string(dir) + "/engine.json";
+    const std::string qosPath = std::string(dir) + "/qos.json";
+
+    bool ok = WriteFile(qosPath, kQoSJson) &&
+              WriteFile(enginePath, R"({"interface": "lo0", "qos_profile": "broadcast"})");
+    EngineFileConfig config;
+    std::string error;
+    ok = ok && LoadEngineConfig(enginePath, config, error) && config.interface == "lo0" &&
+         config.profiles.size() == 2 && config.FindProfile(config.qosProfile);
+
+    // A profile qos.json does not have is an error, not a silent default
+    ok = ok && WriteFile(enginePath, R"({"qos_profile": "studio"})");
+    EngineFileConfig missing;
+    ok = ok && !LoadEngineConfig(enginePath, missing, error) && error.find("studio") != std::string::npos;
+
+    // Without qos.json and without asking for a profile, defaults stand
+    std::remove(qosPath.c_str());
+    ok = ok && WriteFile(enginePath, R"({"interface": "lo0"})");
+    EngineFileConfig plain;
+    ok = ok && LoadEngineConfig(enginePath, plain, error) && plain.profiles.empty();
+
+    std::remove(enginePath.c_str());
+    rmdir(dir);
+    return ok;
+}
+
+// Test the TX stamping offset defaults to the I/O buffer plus one packet
+// and that Validate() bounds what a caller builds by hand
+bool test_config_tx_safety_offset() {
+    EngineFileConfig config;
+    std::string error;
+    if (!ParseQoSConfig(kQoSJson, config, error)) return false;
+    const QoSProfile* low = config.FindProfile("low-latency");
+    const QoSProfile* broadcast = config.FindProfile("broadcast");
+    if (!low || !broadcast) return false;
+    if (low->txSafetyOffsetFrames != 0 || low->TxSafetyOffsetFrames() != 32 + 12) return false;
+    if (broadcast->TxSafetyOffsetFrames() != 200) return false;
+    if (QoSProfile{}.TxSafetyOffsetFrames() != 64 + 12) return false;
+
+    QoSProfile huge;
+    huge.ioBufferFrames = 8192;
+    if (huge.Validate(error)) return false;
+    QoSProfile deep;
+    deep.jitterBufferPacketsMax = 65;
+    return !deep.Validate(error) && QoSProfile{}.Validate(error);
+}
+
+// Register all engine config tests
+static struct EngineConfigTestRegistrar {
+    EngineConfigTestRegistrar() {
+        RegisterTest("EngineConfig: QoS profiles and presets", test_config_qos_profiles);
+        RegisterTest("EngineConfig: Engine inputs", test_config_engine_inputs);
+        RegisterTest("EngineConfig: Rejects bad values", test_config_rejects_bad_values);
+        RegisterTest("EngineConfig: Loads qos.json next to engine.json", test_config_load_files);
+        RegisterTest("EngineConfig: TX safety offset", test_config_tx_safety_offset);
+    }
+} engineConfigTestRegistrar;
@@ -0,0 +1,192 @@
+// test_jitter_buffer.cpp - Jitter buffer depth controller and playout tests
+// SPDX-License-Identifier: MIT
+
+#include "JitterBuffer.h"
+#include <functional>
+#include <cmath>
+#include <string>
+
+extern void RegisterTest(const std::string& name, std::function<bool()> test);
+
+using namespace AES67;
+
+namespace {
+
+constexpr uint32_t kFrames = 12;            // 250 µs @ 48 kHz
+constexpr uint64_t kPacketNs = 250000;
+
+// Feed packets with a deterministic jitter pattern, pulling audio as we go
+void RunStream(JitterBuffer& jb, uint32_t packets, uint64_t jitterSpanNs, uint32_t& rtp, uint64_t& now) {
+    int32_t samples[kFrames * 8] = {};
+    int32_t out[kFrames * 8];
+    uint32_t lcg = 12345;
+    for (uint32_t p = 0; p < packets; ++p) {
+        lcg = lcg * 1664525u + 1013904223u;
+        const uint64_t jitter = jitterSpanNs ? (lcg >> 8) % jitterSpanNs : 0;
+        jb.Insert(rtp, now + jitter, samples, kFrames);
+        rtp += kFrames;
+        now += kPacketNs;
+
+        // Pull one packet's worth like the device I/O cycle, trailing by the target delay
+        jb.Read(rtp - jb.GetTargetDelayFrames(), out, kFrames);
+    }
+}
+
+} // namespace
+
+// Test a clean link releases the target to the minimum depth
+bool test_jitter_clean_link_minimum() {
+    JitterBuffer jb(2, 8, 48000);
+    uint32_t rtp = 1000;
+    uint64_t now = 1000000000ULL;
+
+    RunStream(jb, 200000, 0, rtp, now); // 50 s
+
+    return jb.GetTargetDepth() == 2 && jb.GetJitterNs() < 1000.0;
+}
+
+// Test a jittery link widens the target quickly
+bool test_jitter_widens_on_degradation() {
+    JitterBuffer jb(2, 16, 48000);
+    uint32_t rtp = 1000;
+    uint64_t now = 1000000000ULL;
+
+    RunStream(jb, 200000, 0, rtp, now);
+    const uint32_t cleanTarget = jb.GetTargetDepth();
+
+    // 1.5 ms of arrival jitter for half a second
+    RunStream(jb, 2000, 1500000, rtp, now);
+
+    return jb.GetTargetDepth() > cleanTarget &&
+           jb.GetDelayQuantileNs() >= 1000000 &&
+           jb.GetJitterNs() > 10000.0;
+}
+
+// Test a packet arriving after its slot was played is counted late
+bool test_jitter_late_packet() {
+    JitterBuffer jb(1, 4, 48000);
+    int32_t samples[kFrames * 8] = {};
+
+    int32_t out[2 * kFrames * 8];
+
+    jb.Insert(1000, 0, samples, kFrames);
+    jb.Insert(1012, kPacketNs, samples, kFrames);
+
+    if (jb.Read(1000, out, 2 * kFrames) != 2 * kFrames) return false;
+
+    // Reordered straggler for an already-played slot
+    jb.Insert(1006, 11 * kPacketNs, samples, kFrames);
+
+    return jb.GetLateCount() == 1 && jb.GetDepth() == 0;
+}
+
+// Test underruns count once per gap, not once per poll
+bool test_jitter_underrun_counting() {
+    JitterBuffer jb(1, 4, 48000);
+    int32_t samples[kFrames * 8] = {};
+    int32_t out[kFrames * 8];
+
+    // Reading an idle stream is not an underrun
+    for (uint32_t i = 0; i < 10; ++i) {
+        jb.Read(i * kFrames, out, kFrames);
+    }
+    if (jb.GetUnderrunCount() != 0) return false;
+
+    jb.Insert(1000, 0, samples, kFrames);
+    if (jb.Read(1000, out, kFrames) != kFrames) return false;
+
+    // Stream stalls: many reads, one underrun
+    for (uint32_t i = 1; i < 30; ++i) {
+        jb.Read(1000 + i * kFrames, out, kFrames);
+    }
+
+    return jb.GetUnderrunCount() == 1;
+}
+
+// Test reads straddle packet boundaries and conceal a lost packet
+bool test_jitter_read_conceal() {
+    JitterBuffer jb(1, 8, 48000);
+    int32_t samples[kFrames * 8];
+    for (uint32_t i = 0; i < kFrames * 8; ++i) {
+        samples[i] = 1000 << 8;
+    }
+
+    // Packet at 1012 is lost
+    jb.Insert(1000, 0, samples, kFrames);
+    jb.Insert(1024, 2 * kPacketNs, samples, kFrames);
+
+    // 5 frames, then a read spanning the end of the first packet and the gap
+    int32_t out[32 * 8];
+    if (jb.Read(1000, out, 5) != 5) return false;
+    if (jb.Read(1005, out, 19) != 7) return false;
+
+    // Real frames copied, then a fade starting from the last good frame
+    if (out[6 * 8] != (1000 << 8)) return false;
+    if (out[7 * 8] <= 0 || out[7 * 8] > (1000 << 8)) return false;
+    if (out[18 * 8] >= out[7 * 8]) return false;
+
+    // Next packet plays normally after the gap
+    return jb.Read(1024, out, kFrames) == kFrames && out[0] == (1000 << 8);
+}
+
+// Test new depth limits move the target without dropping queued audio
+bool test_jitter_depth_limits() {
+    JitterBuffer jb(2, 8, 48000);
+    uint32_t rtp = 1000;
+    uint64_t now = 1000000000ULL;
+
+    RunStream(jb, 200000, 0, rtp, now);
+    if (jb.GetTargetDepth() != 2) return false;
+
+    // Deeper profile: the target rises to the new minimum and stays there
+    const uint32_t depth = jb.GetDepth();
+    jb.SetDepthLimits(4, 8);
+    if (jb.GetTargetDepth() != 4 || jb.GetDepth() != depth) return false;
+    RunStream(jb, 40000, 0, rtp, now);
+    if (jb.GetTargetDepth() != 4) return false;
+
+    // Shallower profile: the target drops under the new ceiling at once
+    jb.SetDepthLimits(1, 2);
+    return jb.GetTargetDepth() == 1;
+}
+
+// Test metering peeks the newest frames without moving the reader
+bool test_jitter_peek_newest() {
+    JitterBuffer jb(2, 8, 48000);
+    int32_t out[200 * 8];
+    if (jb.PeekNewest(out, 64) != 0 || out[0] != 0) return false;
+
+    int32_t samples[kFrames * 8];
+    for (uint32_t p = 0; p < 10; ++p) {
+        for (uint32_t i = 0; i < kFrames * 8; ++i) {
+            samples[i] = static_cast<int32_t>(p + 1) << 8;
+        }
+        jb.Insert(1000 + p * kFrames, p * kPacketNs, samples, kFrames);
+    }
+
+    // Last 24 frames are the last two packets; more than was received pads with zeros
+    if (jb.PeekNewest(out, 24) != 24 || out[0] != (9 << 8) || out[23 * 8 + 7] != (10 << 8)) return false;
+    if (jb.PeekNewest(out, 64) != 64) return false;
+    const uint32_t depth = jb.GetDepth();
+    if (jb.PeekNewest(out, 200) != 10 * kFrames || out[0] != 0 || out[199 * 8] != (10 << 8)) return false;
+
+    // Nothing consumed, no underrun counted; played audio can still be peeked
+    if (jb.GetDepth() != depth || jb.GetUnderrunCount() != 0) return false;
+    if (jb.Read(1000, out, 10 * kFrames) != 10 * kFrames) return false;
+    if (jb.PeekNewest(out, kFrames) != kFrames || out[0] != (10 << 8)) return false;
+    jb.Reset();
+    return jb.PeekNewest(out, kFrames) == 0;
+}
+
+// Register all jitter buffer tests
+static struct JitterBufferTestRegistrar {
+    JitterBufferTestRegistrar() {
+        RegisterTest("JitterBuffer: Clean link minimum depth", test_jitter_clean_link_minimum);
+        RegisterTest("JitterBuffer: Widens on degradation", test_jitter_widens_on_degradation);
+        RegisterTest("JitterBuffer: Late packet detection", test_jitter_late_packet);
+        RegisterTest("JitterBuffer: Underrun counting", test_jitter_underrun_counting);
+        RegisterTest("JitterBuffer: Read across gap with concealment", test_jitter_read_conceal);
+        RegisterTest("JitterBuffer: Depth limits changed while running", test_jitter_depth_limits);
+        RegisterTest("JitterBuffer: Peek newest for metering", test_jitter_peek_newest);
+    }
+} jitterBufferTestRegistrar;
@@ -0,0 +1,220 @@
+// test_network_engine.cpp - Engine timing paths driven with synthetic times
+// SPDX-License-Identifier: MIT
+
+#include "NetworkEngine.h"
+#include "HostClock.h"
+#include "JitterBuffer.h"
+#include "RxSubscription.h"
+#include "SDPParser.h"
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <vector>
+
+extern void RegisterTest(const std::string& name, std::function<bool()> test);
+
+namespace AES67 {
+
+// Private entry points the tests need
+struct NetworkEngineTestAccess {
+    static uint32_t AlignTx(NetworkEngine& engine, uint32_t streamIdx, uint32_t safetyOffsetFrames, uint64_t ptpNowNs) {
+        return engine.AlignTxTimestamp(streamIdx, safetyOffsetFrames, ptpNowNs);
+    }
+    static JitterBuffer& Jitter(NetworkEngine& engine, uint32_t streamIdx) {
+        return *engine.rxJitterBuffers_[streamIdx];
+    }
+};
+
+} // namespace AES67
+
+using namespace AES67;
+
+namespace {
+
+constexpr uint64_t kHostNs = 5000000000ULL;     // Synthetic I/O cycle host time
+constexpr uint64_t kSampleTime = 100000;        // Device sample time at that cycle
+
+uint64_t MediaSamples(uint64_t ptpNs) {
+    return (ptpNs / 1000000000ULL) * 48000 + ((ptpNs % 1000000000ULL) * 48000) / 1000000000ULL;
+}
+
+int64_t FramesToNs(int64_t frames) {
+    return frames * 1000000000LL / 48000;
+}
+
+} // namespace
+
+// Test TX packets are stamped at device sample time + safety offset and the
+// output latency is measured from the ring head, including a device that
+// has already written past the anchored cycle
+bool test_engine_tx_stamping() {
+    NetworkEngine engine(nullptr);
+    AudioRingBuffer& ring = *engine.GetOutputRingBuffer(0);
+    const uint64_t hostTicks = HostClock::NsToTicks(kHostNs);
+    const uint64_t ptpNs = engine.HostTimeToPTP(hostTicks);
+    const uint32_t media = static_cast<uint32_t>(MediaSamples(ptpNs));
+
+    // No I/O cycle published yet: the packetizer free-runs
+    const uint32_t freeRun = NetworkEngineTestAccess::AlignTx(engine, 0, 64, ptpNs);
+    if (NetworkEngineTestAccess::AlignTx(engine, 0, 64, ptpNs) != freeRun) return false;
+
+    // 64 frames were waiting in the ring when the cycle started: the head is
+    // 64 frames behind the cycle's media time
+    std::vector<int32_t> frames(8 * 256, 0);
+    ring.Write(frames.data(), 64 * 8);
+    engine.NotifyIOCycle(hostTicks, kSampleTime);
+    if (NetworkEngineTestAccess::AlignTx(engine, 0, 64, ptpNs + 2000000) != media) return false;
+    if (engine.GetOutputLatencyNs(0) != FramesToNs(96 + 64)) return false;     // 2 ms later = 96 frames
+    if (NetworkEngineTestAccess::AlignTx(engine, 0, 100, ptpNs) != media + 36) return false;
+
+    // One frame of host time rounding does not move the stamp
+    engine.NotifyIOCycle(hostTicks, kSampleTime - 1);
+    if (NetworkEngineTestAccess::AlignTx(engine, 0, 100, ptpNs) != media + 36) return false;
+    engine.NotifyIOCycle(hostTicks, kSampleTime);
+
+    // The device wrote 32 more frames after the anchor and TX already sent
+    // everything: the head is 32 frames past the anchored write position
+    ring.Write(frames.data(), 32 * 8);
+    if (ring.Read(frames.data(), 96 * 8) != 96 * 8) return false;
+    if (NetworkEngineTestAccess::AlignTx(engine, 0, 64, ptpNs) != media + 32 + 64) return false;
+    return engine.GetOutputLatencyNs(0) == FramesToNs(-32);
+}
+
+// Test two streams with different arrival jitter play the same media time:
+// the common delay is the deeper stream's target and both report the same
+// alignment error, including a read one frame off the free-running cursor
+bool test_engine_rx_playout_alignment() {
+    NetworkEngine engine(nullptr);
+    constexpr uint64_t kReadNs = 1000000000000ULL;      // 1000 s: media time 48,000,000
+    constexpr uint32_t kPackets = 200;
+    constexpr uint32_t kPacketFrames = 12;              // 250 µs
+    const uint32_t mediaNow = static_cast<uint32_t>(MediaSamples(kReadNs));
+    const uint32_t first = mediaNow - kPackets * kPacketFrames;
+
+    // Each sample holds its frame's RTP timestamp. Stream 0 arrives evenly,
+    // stream 1 alternates 2 ms late, which deepens its target to the ceiling.
+    std::vector<int32_t> samples(8 * kPacketFrames);
+    for (uint32_t p = 0; p < kPackets; ++p) {
+        const uint32_t timestamp = first + p * kPacketFrames;
+        for (uint32_t f = 0; f < kPacketFrames; ++f) {
+            std::fill_n(&samples[f * 8], 8, static_cast<int32_t>(timestamp + f));
+        }
+        const uint64_t arrival = kReadNs - 60000000ULL + p * 250000ULL;
+        NetworkEngineTestAccess::Jitter(engine, 0).Insert(timestamp, arrival + 1000000, samples.data(), kPacketFrames);
+        NetworkEngineTestAccess::Jitter(engine, 1).Insert(timestamp, arrival + (p % 2) * 2000000, samples.data(),
+                                                          kPacketFrames);
+    }
+    const uint32_t shallow = NetworkEngineTestAccess::Jitter(engine, 0).GetTargetDelayFrames();
+    const uint32_t deep = NetworkEngineTestAccess::Jitter(engine, 1).GetTargetDelayFrames();
+    if (shallow == 0 || deep <= shallow) return false;
+
+    // Same read time: both play "now - deep" and sit exactly on the delay
+    std::vector<int32_t> out0(8 * 32), out1(8 * 32);
+    if (engine.ReadInputFrames(0, kReadNs, out0.data(), 32) != 32) return false;
+    if (engine.ReadInputFrames(1, kReadNs, out1.data(), 32) != 32) return false;
+    if (out0[0] != static_cast<int32_t>(mediaNow - deep) || out1 != out0) return false;
+    if (engine.GetPlayoutDelayNs() != FramesToNs(deep)) return false;
+    if (engine.GetAlignmentErrorNs(0) != 0 || engine.GetAlignmentErrorNs(1) != 0) return false;
+    if (engine.GetInputLatencyNs(0) != FramesToNs(deep) || engine.GetInputLatencyNs(1) != FramesToNs(deep)) return false;
+
+    // Next read lands 33 frames later: within tolerance, so the cursors keep
+    // running and both streams are one frame behind the delay
+    const uint64_t nextNs = kReadNs + 687500;           // 33 frames
+    if (engine.ReadInputFrames(0, nextNs, out0.data(), 32) == 0) return false;
+    if (engine.ReadInputFrames(1, nextNs, out1.data(), 32) == 0) return false;
+    if (out0[0] != static_cast<int32_t>(mediaNow - deep + 32) || out1 != out0) return false;
+    if (engine.GetPlayoutDelayNs() != FramesToNs(deep) ||
+        engine.GetAlignmentErrorNs(0) != FramesToNs(1) || engine.GetAlignmentErrorNs(1) != FramesToNs(1)) return false;
+
+    // Resampled, stream 1 plays on the sender's timeline: nothing to report
+    // against our media clock, and stream 0 is unaffected
+    engine.SetStreamResampling(1, true);
+    const uint64_t thirdNs = nextNs + 666667;           // 32 frames
+    engine.ReadInputFrames(0, thirdNs, out0.data(), 32);
+    engine.ReadInputFrames(1, thirdNs, out1.data(), 32);
+    return engine.GetInputLatencyNs(1) == 0 && engine.GetAlignmentErrorNs(1) == 0 &&
+           engine.GetAlignmentErrorNs(0) == FramesToNs(1);
+}
+
+// Test a slot's clock follows each new subscription: a ts-refclk on a tracked
+// domain selects it, and re-subscribing without one, from an untracked
+// domain or unsubscribing goes back to the main domain, or to the domain
+// set with SetStreamPTPDomain()
+bool test_engine_subscription_clock() {
+    NetworkEngine engine(nullptr);
+    if (!engine.AddPTPDomain(1)) return false;
+    const std::string sdp =
+        "v=0\r\n"
+        "o=- 7 1 IN IP4 10.0.0.5\r\n"
+        "s=Domain One\r\n"
+        "t=0 0\r\n"
+        "a=ts-refclk:ptp=IEEE1588-2008:39-A7-94-FF-FE-07-CB-D0:1\r\n"
+        "m=audio 5004 RTP/AVP 96\r\n"
+        "c=IN IP4 239.69.7.1/32\r\n"
+        "a=rtpmap:96 L24/48000/2\r\n";
+    auto subscribe = [&](const std::string& text) {
+        RxSubscription subscription;
+        return RxSubscriptionFromSDP(SDPParser::Parse(text), subscription) && engine.Subscribe(2, subscription);
+    };
+
+    if (!subscribe(sdp) || engine.GetStreamPTPDomain(2) != 1) return false;
+    std::string plain = sdp;
+    plain.erase(plain.find("a=ts-refclk"), plain.find("m=audio") - plain.find("a=ts-refclk"));
+    if (!subscribe(plain) || engine.GetStreamPTPDomain(2) != 0) return false;
+
+    if (!subscribe(sdp) || engine.GetStreamPTPDomain(2) != 1) return false;
+    std::string untracked = sdp;
+    untracked.replace(untracked.find("CB-D0:1"), 7, "CB-D0:5");
+    if (!subscribe(untracked) || engine.GetStreamPTPDomain(2) != 0) return false;
+
+    if (!subscribe(sdp) || engine.GetStreamPTPDomain(2) != 1) return false;
+    engine.Unsubscribe(2);
+    if (engine.GetStreamPTPDomain(2) != 0) return false;
+
+    // Domain set explicitly before subscribing (aes67-subscribe --ptp-domain):
+    // it holds for subscriptions without a tracked ts-refclk, repeated or not
+    if (!engine.AddPTPDomain(2) || !engine.SetStreamPTPDomain(3, 2)) return false;
+    RxSubscription manual;
+    manual.address = "239.69.7.3";
+    if (!engine.Subscribe(3, manual) || engine.GetStreamPTPDomain(3) != 2) return false;
+    if (!engine.Subscribe(3, manual) || engine.GetStreamPTPDomain(3) != 2) return false;
+    manual.refClock = "ptp=IEEE1588-2008:39-A7-94-FF-FE-07-CB-D0:1";
+    if (!engine.Subscribe(3, manual) || engine.GetStreamPTPDomain(3) != 1) return false;
+    manual.refClock.clear();
+    if (!engine.Subscribe(3, manual) || engine.GetStreamPTPDomain(3) != 2) return false;
+    engine.Unsubscribe(3);
+    return engine.GetStreamPTPDomain(3) == 2;
+}
+
+// Test a profile needing larger output rings or jitter buffers than were
+// allocated at construction is refused, and one that fits is applied
+bool test_engine_qos_profile_capacity() {
+    NetworkEngine engine(nullptr);
+    QoSProfile bigRing;
+    bigRing.name = "big-ring";
+    bigRing.ioBufferFrames = 4096;
+    bigRing.packetTimeUs = 1000;
+    if (engine.ApplyQoSProfile(bigRing)) return false;
+
+    QoSProfile deepJitter;
+    deepJitter.name = "deep-jitter";
+    deepJitter.jitterBufferPacketsMax = QoSProfile{}.jitterBufferPacketsMax + 1;
+    if (engine.ApplyQoSProfile(deepJitter) || engine.GetQoSProfile().name != "") return false;
+
+    QoSProfile fits;
+    fits.name = "fits";
+    fits.ioBufferFrames = 128;
+    fits.jitterBufferPacketsMin = 2;
+    fits.jitterBufferPacketsMax = 4;
+    return engine.ApplyQoSProfile(fits) && engine.GetQoSProfile().name == "fits";
+}
+
+// Register all network engine tests
+static struct NetworkEngineTestRegistrar {
+    NetworkEngineTestRegistrar() {
+        RegisterTest("NetworkEngine: TX stamping and output latency", test_engine_tx_stamping);
+        RegisterTest("NetworkEngine: RX streams share one playout time", test_engine_rx_playout_alignment);
+        RegisterTest("NetworkEngine: Subscription selects the stream clock", test_engine_subscription_clock);
+        RegisterTest("NetworkEngine: QoS profile must fit the buffers", test_engine_qos_profile_capacity);
+    }
+} networkEngineTestRegistrar;
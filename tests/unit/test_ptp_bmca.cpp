@@ -0,0 +1,132 @@
+// test_ptp_bmca.cpp - PTP Best Master Clock Algorithm tests
+// SPDX-License-Identifier: MIT
+
+#include "PTPBMCA.h"
+#include <cstring>
+#include <functional>
+#include <string>
+
+extern void RegisterTest(const std::string& name, std::function<bool()> test);
+
+using namespace AES67;
+
+namespace {
+
+constexpr uint64_t kSecondNs = 1000000000ULL;
+
+PTPClockDataset Clock(uint8_t lastIdentityByte, uint8_t priority1 = 128, uint8_t clockClass = 248) {
+    PTPClockDataset ds;
+    ds.priority1 = priority1;
+    ds.clockClass = clockClass;
+    ds.grandmasterIdentity.id[7] = lastIdentityByte;
+    ds.senderIdentity.id[7] = lastIdentityByte;
+    ds.senderPort = 1;
+    return ds;
+}
+
+} // namespace
+
+// Test dataset comparison order: priority1, clockClass, then identity tie-break
+bool test_bmca_compare() {
+    const PTPClockDataset a = Clock(0x01);
+    const PTPClockDataset b = Clock(0x02);
+    if (ComparePTPDatasets(a, b) >= 0 || ComparePTPDatasets(b, a) <= 0) return false;
+
+    // priority1 outranks clockClass and identity
+    if (ComparePTPDatasets(Clock(0x02, 100, 255), Clock(0x01, 128, 6)) >= 0) return false;
+    // clockClass outranks identity
+    if (ComparePTPDatasets(Clock(0x02, 128, 6), Clock(0x01, 128, 248)) >= 0) return false;
+
+    // Same grandmaster via two paths: fewer steps wins
+    PTPClockDataset direct = Clock(0x05);
+    PTPClockDataset relayed = Clock(0x05);
+    relayed.stepsRemoved = 1;
+    relayed.senderIdentity.id[7] = 0x01;
+    return ComparePTPDatasets(direct, relayed) < 0 && ComparePTPDatasets(a, a) == 0;
+}
+
+// Test Announce parsing of the fields BMCA uses
+bool test_bmca_parse_announce() {
+    uint8_t msg[64]{};
+    msg[0] = 0x0B;              // Announce
+    msg[27] = 0x42;             // sourcePortIdentity clock id, last byte
+    msg[29] = 1;                // port 1
+    msg[33] = 0xFE;             // logMessageInterval -2
+    msg[47] = 90;
+    msg[48] = 6;
+    msg[49] = 0x21;
+    msg[50] = 0x4E;
+    msg[51] = 0x5D;
+    msg[52] = 77;
+    msg[60] = 0x99;             // grandmasterIdentity, last byte
+    msg[62] = 2;                // stepsRemoved
+
+    PTPClockDataset ds;
+    int8_t logInterval = 0;
+    if (!ParsePTPAnnounce(msg, sizeof(msg), ds, logInterval)) return false;
+    if (ParsePTPAnnounce(msg, 63, ds, logInterval)) return false;
+
+    return logInterval == -2 && ds.priority1 == 90 && ds.clockClass == 6 && ds.clockAccuracy == 0x21 &&
+           ds.offsetScaledLogVariance == 0x4E5D && ds.priority2 == 77 &&
+           ds.grandmasterIdentity.id[7] == 0x99 && ds.stepsRemoved == 2 &&
+           ds.senderIdentity.id[7] == 0x42 && ds.senderPort == 1;
+}
+
+// Test foreign masters qualify after two Announces and expire when silent
+bool test_bmca_foreign_masters() {
+    PTPForeignMasterTable table;
+    const PTPClockDataset m = Clock(0x10);
+
+    uint64_t now = 10 * kSecondNs;
+    table.Add(m, 0, now);
+    if (table.Best() != nullptr) return false;      // One Announce is not enough
+
+    now += kSecondNs;
+    table.Add(m, 0, now);
+    if (table.Best() == nullptr) return false;
+
+    // A better master appears and qualifies
+    const PTPClockDataset better = Clock(0x20, 64);
+    table.Add(better, 0, now);
+    table.Add(better, 0, now + kSecondNs);
+    const PTPClockDataset* best = table.Best();
+    if (best == nullptr || best->priority1 != 64) return false;
+
+    // The better master goes silent; after three intervals the first one wins again
+    now += kSecondNs;
+    for (int i = 0; i < 5; ++i, now += kSecondNs) {
+        table.Add(m, 0, now);
+        table.Expire(now);
+    }
+    best = table.Best();
+    if (best == nullptr || best->priority1 != 128 || table.Size() != 1) return false;
+
+    // Looped-back or relayed-too-far announces are not candidates
+    PTPClockDataset far = Clock(0x30);
+    far.stepsRemoved = 255;
+    table.Add(far, 0, now);
+    return table.Size() == 1;
+}
+
+// Test state decision for auto and slave-only ports
+bool test_bmca_decide_state() {
+    const PTPClockDataset local = Clock(0x50);
+    const PTPClockDataset better = Clock(0x60, 100);
+    const PTPClockDataset worse = Clock(0x40, 200);
+
+    return DecidePTPPortState(local, nullptr, false) == PTPPortState::Master &&
+           DecidePTPPortState(local, nullptr, true) == PTPPortState::Listening &&
+           DecidePTPPortState(local, &better, false) == PTPPortState::Slave &&
+           DecidePTPPortState(local, &worse, false) == PTPPortState::Master &&
+           DecidePTPPortState(local, &worse, true) == PTPPortState::Slave;
+}
+
+// Register all BMCA tests
+static struct PTPBMCATestRegistrar {
+    PTPBMCATestRegistrar() {
+        RegisterTest("PTPBMCA: Dataset comparison", test_bmca_compare);
+        RegisterTest("PTPBMCA: Announce parsing", test_bmca_parse_announce);
+        RegisterTest("PTPBMCA: Foreign master qualification", test_bmca_foreign_masters);
+        RegisterTest("PTPBMCA: Port state decision", test_bmca_decide_state);
+    }
+} ptpBMCATestRegistrar;
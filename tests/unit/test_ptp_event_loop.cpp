@@ -0,0 +1,94 @@
+// test_ptp_event_loop.cpp - PTP thread event loop tests
+// SPDX-License-Identifier: MIT
+
+#include "PTPEventLoop.h"
+#include "HostClock.h"
+#include <functional>
+#include <string>
+#include <thread>
+#include <sys/socket.h>
+#include <unistd.h>
+
+extern void RegisterTest(const std::string& name, std::function<bool()> test);
+
+using namespace AES67;
+
+// Test one-shot timers fire once, at or after their deadline, earliest first
+bool test_event_loop_timers() {
+    PTPEventLoop loop;
+    if (!loop.Open()) return false;
+    const int slow = loop.AddTimer();
+    const int fast = loop.AddTimer();
+    const int unused = loop.AddTimer();
+    if (slow < 0 || fast < 0 || unused < 0) return false;
+
+    const uint64_t start = HostClock::NowNs();
+    loop.ArmTimer(slow, start + 20000000);
+    loop.ArmTimer(fast, start + 5000000);
+
+    uint32_t fired = 0;
+    uint64_t fastAt = 0, slowAt = 0;
+    while (fired != ((1u << slow) | (1u << fast))) {
+        const PTPEventLoop::Ready ready = loop.Wait();
+        const uint64_t now = HostClock::NowNs();
+        if (ready.timers & (1u << unused)) return false;
+        if (ready.timers & fired) return false;         // One-shot
+        if (ready.timers & (1u << fast)) fastAt = now;
+        if (ready.timers & (1u << slow)) slowAt = now;
+        fired |= ready.timers;
+        if (now - start > 1000000000ULL) return false;
+    }
+
+    // Disarmed timers stay quiet
+    loop.ArmTimer(fast, HostClock::NowNs() + 1000000);
+    loop.DisarmTimer(fast);
+    loop.ArmTimer(slow, HostClock::NowNs() + 10000000);
+    const PTPEventLoop::Ready ready = loop.Wait();
+
+    return fastAt >= start + 5000000 && slowAt >= start + 20000000 && fastAt < slowAt &&
+           ready.timers == (1u << slow);
+}
+
+// Test socket readiness and a wake-up from another thread
+bool test_event_loop_sockets_and_wake() {
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_DGRAM, 0, fds) != 0) return false;
+
+    PTPEventLoop loop;
+    bool ok = loop.Open();
+    const int idle = loop.AddSocket(fds[1]);
+    const int readable = loop.AddSocket(fds[0]);
+    ok = ok && idle >= 0 && readable >= 0;
+
+    if (ok) {
+        const uint8_t byte = 1;
+        ok = write(fds[1], &byte, 1) == 1 && loop.Wait().sockets == (1u << readable);
+        uint8_t drain;
+        ok = ok && read(fds[0], &drain, 1) == 1;
+    }
+
+    if (ok) {
+        // Nothing armed or readable: only Wake() ends the wait
+        std::thread waker([&loop] {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            loop.Wake();
+        });
+        const uint64_t start = HostClock::NowNs();
+        const PTPEventLoop::Ready ready = loop.Wait();
+        waker.join();
+        ok = ready.sockets == 0 && ready.timers == 0 && HostClock::NowNs() - start >= 5000000;
+    }
+
+    loop.Close();
+    close(fds[0]);
+    close(fds[1]);
+    return ok;
+}
+
+// Register all event loop tests
+static struct PTPEventLoopTestRegistrar {
+    PTPEventLoopTestRegistrar() {
+        RegisterTest("PTPEventLoop: One-shot timers in deadline order", test_event_loop_timers);
+        RegisterTest("PTPEventLoop: Socket readiness and wake", test_event_loop_sockets_and_wake);
+    }
+} ptpEventLoopTestRegistrar;
@@ -0,0 +1,87 @@
+// test_ptp_filter.cpp - PTP delay/offset measurement filter tests
+// SPDX-License-Identifier: MIT
+
+#include "PTPFilter.h"
+#include <functional>
+#include <cmath>
+#include <string>
+
+extern void RegisterTest(const std::string& name, std::function<bool()> test);
+
+using namespace AES67;
+
+// Test mean path delay from the four E2E timestamps
+bool test_ptp_exchange_delay() {
+    // Slave 1 ms ahead of master, 50 µs each way
+    PTPExchange exchange;
+    exchange.t1 = 10000000;
+    exchange.t2 = exchange.t1 + 50000 + 1000000;
+    exchange.t3 = exchange.t2 + 200000;
+    exchange.t4 = exchange.t3 - 1000000 + 50000;
+
+    const int64_t delay = exchange.MeanPathDelay();
+    const int64_t offset = (exchange.t2 - exchange.t1) - delay;
+
+    return delay == 50000 && offset == 1000000;
+}
+
+// Test a queued packet does not disturb the path delay
+bool test_ptp_pdelay_link_delay() {
+    // 30 µs link; responder clock 5 ms off, 80 µs turnaround
+    PTPPdelayExchange twoStep;
+    twoStep.t1 = 20000000;
+    twoStep.t2 = twoStep.t1 + 30000 + 5000000;
+    twoStep.t3 = twoStep.t2 + 80000;
+    twoStep.t4 = twoStep.t3 - 5000000 + 30000;
+
+    // One-step responder: turnaround in correctionField, no timestamps
+    PTPPdelayExchange oneStep;
+    oneStep.t1 = twoStep.t1;
+    oneStep.t4 = twoStep.t1 + 30000 + 80000 + 30000;
+    oneStep.correction = 80000;
+
+    return twoStep.MeanLinkDelay() == 30000 && oneStep.MeanLinkDelay() == 30000;
+}
+
+bool test_ptp_filter_rejects_outlier() {
+    PTPMeasurementFilter filter;
+
+    for (int i = 0; i < 32; ++i) {
+        filter.AddPathDelay(50000 + (i % 3) * 500);
+    }
+    const int64_t before = filter.GetMeanPathDelayNs();
+
+    // 400 µs switch queueing spike
+    const bool accepted = filter.AddPathDelay(450000);
+
+    return !accepted && filter.GetRejectedCount() == 1 &&
+           filter.GetMeanPathDelayNs() == before &&
+           std::abs(before - 50500) < 1000;
+}
+
+// Test a persistent offset change is accepted after a few samples
+bool test_ptp_filter_accepts_step() {
+    PTPMeasurementFilter filter;
+
+    for (int i = 0; i < 32; ++i) {
+        filter.AcceptOffset((i % 2) ? 300 : -300);
+    }
+
+    // Master stepped by 2 ms: first samples rejected, then taken as real
+    int accepted = 0;
+    for (int i = 0; i < 4; ++i) {
+        accepted += filter.AcceptOffset(2000000) ? 1 : 0;
+    }
+
+    return accepted == 1 && filter.GetRejectedCount() == 3;
+}
+
+// Register all PTP filter tests
+static struct PTPFilterTestRegistrar {
+    PTPFilterTestRegistrar() {
+        RegisterTest("PTP Filter: Exchange path delay", test_ptp_exchange_delay);
+        RegisterTest("PTP Filter: Pdelay link delay", test_ptp_pdelay_link_delay);
+        RegisterTest("PTP Filter: Rejects delay outlier", test_ptp_filter_rejects_outlier);
+        RegisterTest("PTP Filter: Accepts persistent step", test_ptp_filter_accepts_step);
+    }
+} ptpFilterTestRegistrar;
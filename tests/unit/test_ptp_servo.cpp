@@ -0,0 +1,156 @@
+// test_ptp_servo.cpp - PTP clock servo tests
+// SPDX-License-Identifier: MIT
+
+#include "PTPServo.h"
+#include <cmath>
+#include <functional>
+#include <string>
+
+extern void RegisterTest(const std::string& name, std::function<bool()> test);
+
+using namespace AES67;
+
+namespace {
+
+constexpr uint64_t kSyncNs = 125000000;         // 8 Sync/s
+constexpr uint64_t kMasterEpochNs = 1700000000000000000ULL;
+
+// Master clock running frequencyPpb fast relative to the host
+struct Master {
+    double frequencyPpb;
+    int64_t phaseNs = 0;
+    uint64_t TimeAt(uint64_t hostNs) const {
+        return kMasterEpochNs + hostNs +
+               static_cast<int64_t>(static_cast<double>(hostNs) * frequencyPpb / 1e9) + phaseNs;
+    }
+};
+
+// Feed one measurement, with optional noise, as the PTP client would
+PTPServoAction Feed(PTPServo& servo, AffineTimeMap::Coefficients& coeffs,
+                    const Master& master, uint64_t hostNs, int64_t noiseNs = 0) {
+    const int64_t offset = static_cast<int64_t>(AffineTimeMap::HostToPTP(coeffs, hostNs) - master.TimeAt(hostNs));
+    return servo.Sample(offset + noiseNs, hostNs, coeffs);
+}
+
+int64_t ErrorAt(const AffineTimeMap::Coefficients& coeffs, const Master& master, uint64_t hostNs) {
+    return static_cast<int64_t>(AffineTimeMap::HostToPTP(coeffs, hostNs) - master.TimeAt(hostNs));
+}
+
+} // namespace
+
+// Test both servos converge on a 50 ppm frequency offset
+bool test_servo_converges() {
+    for (PTPServoType type : {PTPServoType::PI, PTPServoType::LeastSquares}) {
+        auto servo = CreatePTPServo(type);
+        AffineTimeMap::Coefficients coeffs;
+        const Master master{50000.0};
+
+        uint64_t host = 1000000000ULL;
+        for (int i = 0; i < 400; ++i, host += kSyncNs) {
+            Feed(*servo, coeffs, master, host);
+        }
+
+        if (std::llabs(ErrorAt(coeffs, master, host)) > 1000) return false;
+        if (std::abs((coeffs.slope - 1.0) * 1e9 - 50000.0) > 50.0) return false;
+    }
+    return true;
+}
+
+// Test the least-squares servo ignores a single delayed sample
+bool test_servo_lsq_rejects_outlier() {
+    auto servo = CreatePTPServo(PTPServoType::LeastSquares);
+    AffineTimeMap::Coefficients coeffs;
+    const Master master{-20000.0};
+
+    uint64_t host = 1000000000ULL;
+    uint32_t lcg = 1;
+    for (int i = 0; i < 64; ++i, host += kSyncNs) {
+        lcg = lcg * 1664525u + 1013904223u;
+        Feed(*servo, coeffs, master, host, static_cast<int64_t>(lcg >> 24) - 128);
+    }
+
+    const AffineTimeMap::Coefficients before = coeffs;
+    if (Feed(*servo, coeffs, master, host, 80000) != PTPServoAction::Ignored) return false;
+
+    return coeffs.slope == before.slope && coeffs.anchorPTP == before.anchorPTP;
+}
+
+// Test step-then-slew: a large error after start-up is slewed, not stepped
+bool test_servo_step_then_slew() {
+    PTPServoConfig config;
+    config.stepOnlyAtStart = true;
+
+    for (PTPServoType type : {PTPServoType::PI, PTPServoType::LeastSquares}) {
+        auto servo = CreatePTPServo(type, config);
+        AffineTimeMap::Coefficients coeffs;
+        Master master{10000.0};
+
+        uint64_t host = 1000000000ULL;
+        if (Feed(*servo, coeffs, master, host) != PTPServoAction::Stepped) return false;
+        for (int i = 0; i < 100; ++i) {
+            host += kSyncNs;
+            Feed(*servo, coeffs, master, host);
+        }
+
+        // Master jumps 5 ms; only slews are allowed now (repeated, so not an outlier)
+        master.phaseNs = 5000000;
+        for (int i = 0; i < 8; ++i) {
+            host += kSyncNs;
+            if (Feed(*servo, coeffs, master, host) == PTPServoAction::Stepped) return false;
+        }
+
+        // And the default configuration steps on the same jump
+        auto stepping = CreatePTPServo(type);
+        AffineTimeMap::Coefficients c2;
+        Master m2{10000.0};
+        uint64_t h2 = 1000000000ULL;
+        for (int i = 0; i < 100; ++i, h2 += kSyncNs) {
+            Feed(*stepping, c2, m2, h2);
+        }
+        m2.phaseNs = 5000000;
+        bool stepped = false;
+        for (int i = 0; i < 8 && !stepped; ++i, h2 += kSyncNs) {
+            stepped = Feed(*stepping, c2, m2, h2) == PTPServoAction::Stepped;
+        }
+        if (!stepped) return false;
+    }
+    return true;
+}
+
+// Test a continuous restart (new master) slews onto the new timeline at the kept rate
+bool test_servo_continuous_restart() {
+    for (PTPServoType type : {PTPServoType::PI, PTPServoType::LeastSquares}) {
+        auto servo = CreatePTPServo(type);
+        AffineTimeMap::Coefficients coeffs;
+        Master master{30000.0};
+
+        uint64_t host = 1000000000ULL;
+        for (int i = 0; i < 200; ++i, host += kSyncNs) {
+            Feed(*servo, coeffs, master, host);
+        }
+
+        // New grandmaster 2 us away: no step, rate stays near the old estimate
+        servo->ResetContinuous();
+        master.phaseNs = 2000;
+        const double slopeBefore = coeffs.slope;
+        for (int i = 0; i < 16; ++i, host += kSyncNs) {
+            if (Feed(*servo, coeffs, master, host) == PTPServoAction::Stepped) return false;
+            if (std::abs(coeffs.slope - slopeBefore) > 20e-6) return false;
+        }
+        for (int i = 0; i < 200; ++i, host += kSyncNs) {
+            Feed(*servo, coeffs, master, host);
+        }
+        if (std::llabs(ErrorAt(coeffs, master, host)) > 1000) return false;
+    }
+    return true;
+}
+
+// Register all PTP servo tests
+static struct PTPServoTestRegistrar {
+    PTPServoTestRegistrar() {
+        RegisterTest("PTPServo: PI and least-squares converge", test_servo_converges);
+        RegisterTest("PTPServo: Least-squares rejects outlier", test_servo_lsq_rejects_outlier);
+        RegisterTest("PTPServo: Step-then-slew start-up", test_servo_step_then_slew);
+        RegisterTest("PTPServo: Continuous restart on master change", test_servo_continuous_restart);
+    }
+} ptpServoTestRegistrar;
@@ -0,0 +1,118 @@
+// test_ptp_servo_sim.cpp - PTP servo regression tests in simulated networks
+// SPDX-License-Identifier: MIT
+
+#include "ptp_servo_sim.h"
+#include <cmath>
+#include <functional>
+#include <string>
+
+extern void RegisterTest(const std::string& name, std::function<bool()> test);
+
+using namespace AES67;
+
+namespace {
+
+constexpr PTPServoType kServos[] = {PTPServoType::PI, PTPServoType::LeastSquares};
+
+PTPSimScenario ShortRun() {
+    PTPSimScenario s;
+    s.durationSec = 120.0;
+    s.settleSec = 30.0;
+    return s;
+}
+
+} // namespace
+
+// Test MTIE is the worst peak-to-peak error over any window
+bool test_sim_mtie() {
+    const std::vector<double> te = {0, 1, 5, 2, 2, -3, 0, 0};
+    return ComputeMTIE(te, 0, 2) == 5.0 &&      // -3 after 2
+           ComputeMTIE(te, 0, 3) == 5.0 &&
+           ComputeMTIE(te, 0, 8) == 8.0 &&
+           ComputeMTIE(te, 6, 2) == 0.0;
+}
+
+// Test identical seeds give identical runs
+bool test_sim_deterministic() {
+    PTPSimScenario s = ShortRun();
+    s.pdvProbability = 0.1;
+    s.pdvMeanNs = 10000.0;
+    s.lossProbability = 0.02;
+    s.wanderPpbPerSqrtSec = 2.0;
+
+    const PTPSimResult a = RunPTPServoSim(s, PTPServoType::LeastSquares);
+    const PTPSimResult b = RunPTPServoSim(s, PTPServoType::LeastSquares);
+    s.seed = 2;
+    const PTPSimResult c = RunPTPServoSim(s, PTPServoType::LeastSquares);
+
+    return a.timeErrorNs == b.timeErrorNs && a.timeErrorNs != c.timeErrorNs;
+}
+
+// Test hardware-grade timestamps on a quiet LAN: fast lock, tight tracking
+bool test_sim_quiet_lan() {
+    PTPSimScenario s = ShortRun();
+    s.frequencyPpm = 40.0;
+    s.timestampNoiseNs = 8.0;
+
+    for (PTPServoType type : kServos) {
+        const PTPSimResult r = RunPTPServoSim(s, type);
+        if (!r.locked || r.lockTimeSec > 3.0 || r.unlocks != 0) return false;
+        if (r.rmsNs > 20.0 || r.mtie1sNs > 100.0) return false;
+    }
+    return true;
+}
+
+// Test oscillator wander is tracked without unlocking
+bool test_sim_wander() {
+    PTPSimScenario s = ShortRun();
+    s.frequencyPpm = -35.0;
+    s.wanderPpbPerSqrtSec = 5.0;
+    s.timestampNoiseNs = 100.0;
+
+    for (PTPServoType type : kServos) {
+        const PTPSimResult r = RunPTPServoSim(s, type);
+        if (!r.locked || r.unlocks != 0 || r.rmsNs > 250.0 || r.mtie10sNs > 1500.0) return false;
+    }
+    return true;
+}
+
+// Test queueing delay and loss: least-squares holds lock and beats PI
+bool test_sim_pdv_and_loss() {
+    PTPSimScenario s = ShortRun();
+    s.wanderPpbPerSqrtSec = 1.0;
+    s.pdvProbability = 0.2;
+    s.pdvMeanNs = 20000.0;
+    s.timestampNoiseNs = 100.0;
+    s.lossProbability = 0.05;
+
+    const PTPSimResult pi = RunPTPServoSim(s, PTPServoType::PI);
+    const PTPSimResult lsq = RunPTPServoSim(s, PTPServoType::LeastSquares);
+
+    return lsq.locked && lsq.unlocks == 0 && lsq.lockTimeSec < 10.0 &&
+           lsq.mtie10sNs < 30000.0 && lsq.mtie10sNs < pi.mtie10sNs;
+}
+
+// Test path asymmetry shows up as a constant offset of half the asymmetry
+bool test_sim_asymmetry() {
+    PTPSimScenario s = ShortRun();
+    s.asymmetryNs = 2000.0;
+    s.timestampNoiseNs = 20.0;
+
+    for (PTPServoType type : kServos) {
+        const PTPSimResult r = RunPTPServoSim(s, type);
+        if (!r.locked || std::abs(r.meanNs + 1000.0) > 50.0) return false;
+    }
+    return true;
+}
+
+// Register all servo simulation tests
+static struct PTPServoSimTestRegistrar {
+    PTPServoSimTestRegistrar() {
+        RegisterTest("PTPServoSim: MTIE computation", test_sim_mtie);
+        RegisterTest("PTPServoSim: Deterministic per seed", test_sim_deterministic);
+        RegisterTest("PTPServoSim: Quiet LAN lock and tracking", test_sim_quiet_lan);
+        RegisterTest("PTPServoSim: Oscillator wander", test_sim_wander);
+        RegisterTest("PTPServoSim: PDV and loss", test_sim_pdv_and_loss);
+        RegisterTest("PTPServoSim: Path asymmetry offset", test_sim_asymmetry);
+    }
+} ptpServoSimTestRegistrar;
@@ -0,0 +1,191 @@
+// test_ptp_stats.cpp - PTP statistics collector and deviation tests
+// SPDX-License-Identifier: MIT
+
+#include "PTPStats.h"
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+extern void RegisterTest(const std::string& name, std::function<bool()> test);
+
+using namespace AES67;
+
+namespace {
+
+bool Near(double value, double expected, double relTol) {
+    return std::fabs(value - expected) <= relTol * std::fabs(expected);
+}
+
+// Every field derived from n, so a torn copy is detectable
+PTPStatsSample MakeSample(uint64_t n) {
+    PTPStatsSample sample;
+    sample.hostNs = 1000000000ULL + n * 125000000ULL;
+    sample.offsetNs = static_cast<int64_t>(n % 1000) - 500;
+    sample.pathDelayNs = static_cast<int64_t>(n) * 3;
+    sample.syncIntervalNs = n == 0 ? 0 : 125000000;
+    sample.frequencyPpb = static_cast<double>(n) * 0.5;
+    sample.accepted = n % 10 != 0;
+    return sample;
+}
+
+bool Consistent(const PTPStatsSample& s) {
+    const uint64_t n = (s.hostNs - 1000000000ULL) / 125000000ULL;
+    const PTPStatsSample expected = MakeSample(n);
+    return s.offsetNs == expected.offsetNs && s.pathDelayNs == expected.pathDelayNs &&
+           s.syncIntervalNs == expected.syncIntervalNs && s.frequencyPpb == expected.frequencyPpb &&
+           s.accepted == expected.accepted;
+}
+
+} // namespace
+
+// Test ADEV/TDEV against closed forms for linear, quadratic and white phase
+bool test_deviations_closed_form() {
+    const double tau0 = 0.125;
+    const size_t count = 4096;
+    std::vector<double> phase(count);
+
+    // Constant frequency offset: the second differences vanish
+    for (size_t i = 0; i < count; ++i) {
+        phase[i] = 250.0 + 40.0 * static_cast<double>(i);
+    }
+    std::vector<PTPDeviation> devs = ComputePTPDeviations(phase.data(), count, tau0);
+    if (devs.empty()) return false;
+    for (const PTPDeviation& d : devs) {
+        if (d.adev > 1e-15 || d.tdevNs > 1e-6) return false;
+    }
+
+    // Linear frequency drift x = a t^2: ADEV = sqrt(2) a tau, TDEV = a tau^2 sqrt(2/3)
+    const double a = 3.0;   // ns/s^2
+    for (size_t i = 0; i < count; ++i) {
+        const double t = static_cast<double>(i) * tau0;
+        phase[i] = a * t * t;
+    }
+    devs = ComputePTPDeviations(phase.data(), count, tau0);
+    // m = 1 .. 1024 (3m + 1 <= 4096)
+    if (devs.size() != 11 || !Near(devs.back().tauSec, 1024 * tau0, 1e-12)) return false;
+    for (const PTPDeviation& d : devs) {
+        if (!Near(d.adev, std::sqrt(2.0) * a * d.tauSec * 1e-9, 1e-6)) return false;
+        if (!Near(d.tdevNs, a * d.tauSec * d.tauSec * std::sqrt(2.0 / 3.0), 1e-6)) return false;
+    }
+
+    // White phase noise: TDEV = sigma / sqrt(m), ADEV = sqrt(3) sigma / tau
+    const double sigma = 100.0;
+    std::mt19937 rng(11);
+    std::normal_distribution<double> noise(0.0, sigma);
+    for (size_t i = 0; i < count; ++i) {
+        phase[i] = noise(rng);
+    }
+    devs = ComputePTPDeviations(phase.data(), count, tau0);
+    for (size_t k = 0; k < 5; ++k) {    // Short taus have enough averaging for 10%
+        const double m = std::round(devs[k].tauSec / tau0);
+        if (!Near(devs[k].tdevNs, sigma / std::sqrt(m), 0.1)) return false;
+        if (!Near(devs[k].adev, std::sqrt(3.0) * sigma / devs[k].tauSec * 1e-9, 0.1)) return false;
+    }
+
+    // Too few samples or no spacing: nothing
+    return ComputePTPDeviations(phase.data(), 3, tau0).empty() &&
+           ComputePTPDeviations(phase.data(), 4, tau0).size() == 1 &&
+           ComputePTPDeviations(phase.data(), count, 0.0).empty();
+}
+
+// Test ring wraparound, windows, series summaries and histogram bins
+bool test_stats_snapshot_window() {
+    PTPStats stats(50);
+    if (stats.Capacity() != 64) return false;
+    if (stats.Snapshot().offsetNs.count != 0) return false;
+
+    for (uint64_t n = 0; n < 200; ++n) {
+        stats.Record(MakeSample(n));
+    }
+
+    // Only the last 64 samples survive: n = 136 .. 199
+    std::vector<PTPStatsSample> samples;
+    stats.CopySamples(samples);
+    if (samples.size() != 64 || samples.front().pathDelayNs != 136 * 3 || samples.back().pathDelayNs != 199 * 3) return false;
+
+    PTPStatsSnapshot all = stats.Snapshot();
+    // n % 10 == 0 rejected: 140, 150, ... 190
+    if (all.totalSamples != 200 || all.rejectedSamples != 6 || all.offsetNs.count != 58) return false;
+    if (all.pathDelayNs.count != 64 || all.pathDelayNs.min != 136 * 3 || all.pathDelayNs.max != 199 * 3) return false;
+    if (all.offsetNs.min != 136 - 500 || all.offsetNs.max != 199 - 500) return false;
+    if (!Near(all.frequencyPpb.mean, (136 + 199) / 2.0 * 0.5, 1e-12)) return false;
+    if (all.syncIntervalNs.stddev != 0.0 || !Near(all.tau0Sec, 0.125, 1e-12)) return false;
+    if (all.deviations.empty()) return false;
+
+    size_t histogramTotal = 0;
+    for (uint32_t c : all.offsetNs.histogram.counts) {
+        histogramTotal += c;
+    }
+    // Offsets -364 .. -301 all fall in [-512, -256)
+    const size_t bin = PTPHistogram::BinOf(-301);
+    if (histogramTotal != 58 || all.offsetNs.histogram.counts[bin] != 58 ||
+        PTPHistogram::BinLowerBound(bin) != -256) return false;
+
+    // One second at 8/s: the newest sample and the 8 before it
+    PTPStatsSnapshot recent = stats.Snapshot(1.0);
+    if (recent.pathDelayNs.count != 9 || recent.windowStartNs != MakeSample(191).hostNs ||
+        recent.windowEndNs != MakeSample(199).hostNs) return false;
+
+    stats.Reset();
+    return stats.Snapshot().offsetNs.count == 0 && stats.Snapshot().totalSamples == 0;
+}
+
+// Test histogram bin edges are symmetric and saturate
+bool test_histogram_bins() {
+    return PTPHistogram::BinOf(0) == PTPHistogram::kZeroBin &&
+           PTPHistogram::BinOf(1) == PTPHistogram::kZeroBin + 1 &&
+           PTPHistogram::BinOf(-1) == PTPHistogram::kZeroBin - 1 &&
+           PTPHistogram::BinOf(3) == PTPHistogram::kZeroBin + 2 &&
+           PTPHistogram::BinOf(4) == PTPHistogram::kZeroBin + 3 &&
+           PTPHistogram::BinOf(-4) == PTPHistogram::kZeroBin - 3 &&
+           PTPHistogram::BinOf(INT64_MAX) == PTPHistogram::kBins - 1 &&
+           PTPHistogram::BinOf(INT64_MIN) == 0 &&
+           PTPHistogram::BinLowerBound(PTPHistogram::kZeroBin + 3) == 4 &&
+           PTPHistogram::BinLowerBound(PTPHistogram::kZeroBin - 1) == -1;
+}
+
+// Test a reader never sees a torn sample while the writer laps the ring
+bool test_stats_concurrent_reader() {
+    PTPStats stats(64);
+    std::atomic<bool> done{false};
+    std::thread writer([&] {
+        for (uint64_t n = 0; n < 2000000; ++n) {
+            stats.Record(MakeSample(n));
+        }
+        done = true;
+    });
+
+    bool ok = true;
+    size_t copies = 0;
+    std::vector<PTPStatsSample> samples;
+    while (ok && (!done || copies == 0)) {
+        stats.CopySamples(samples);
+        copies++;
+        uint64_t previous = 0;
+        for (const PTPStatsSample& s : samples) {
+            ok = ok && Consistent(s) && s.hostNs > previous;
+            previous = s.hostNs;
+        }
+        ok = ok && samples.size() <= stats.Capacity();
+    }
+    writer.join();
+
+    stats.CopySamples(samples);
+    return ok && samples.size() == 64 && Consistent(samples.back()) &&
+           samples.back().hostNs == MakeSample(1999999).hostNs;
+}
+
+// Register all statistics tests
+static struct PTPStatsTestRegistrar {
+    PTPStatsTestRegistrar() {
+        RegisterTest("PTPStats: Deviations match closed forms", test_deviations_closed_form);
+        RegisterTest("PTPStats: Snapshot window and summaries", test_stats_snapshot_window);
+        RegisterTest("PTPStats: Histogram bins", test_histogram_bins);
+        RegisterTest("PTPStats: Concurrent reader sees whole samples", test_stats_concurrent_reader);
+    }
+} ptpStatsTestRegistrar;
@@ -2,9 +2,12 @@
 // SPDX-License-Identifier: MIT
 
 #include "PTPClient.h"
+#include "AffineTimeMap.h"
+#include <atomic>
 #include <functional>
 #include <chrono>
 #include <cmath>
+#include <thread>
 
 extern void RegisterTest(const std::string& name, std::function<bool()> test);
 
@@ -133,6 +136,44 @@ bool test_ptp_conversion_consistency() {
     return (ptp1 == ptp2) && (ptp2 == ptp3);
 }
 
+// Test readers never see a torn affine mapping while the servo republishes
+bool test_ptp_affine_map_concurrent() {
+    AffineTimeMap map;
+    std::atomic<bool> running{true};
+    std::atomic<bool> torn{false};
+
+    // Every published set satisfies anchorPTP == 2 * anchorHost and slope == 1 + anchorHost * 1e-9
+    std::thread writer([&] {
+        for (uint64_t i = 1; running.load(std::memory_order_relaxed); ++i) {
+            map.Publish({1.0 + static_cast<double>(i) * 1e-9, i, 2 * i});
+        }
+    });
+
+    std::thread reader([&] {
+        for (uint32_t n = 0; n < 1000000; ++n) {
+            const AffineTimeMap::Coefficients c = map.Load();
+            if (c.anchorHost == 0) continue;
+            if (c.anchorPTP != 2 * c.anchorHost ||
+                c.slope != 1.0 + static_cast<double>(c.anchorHost) * 1e-9) {
+                torn = true;
+                break;
+            }
+        }
+        running = false;
+    });
+
+    reader.join();
+    writer.join();
+
+    // Mapping itself: anchor plus slope-scaled delta, inverse round-trips
+    AffineTimeMap::Coefficients c{1.0001, 1000000000ULL, 5000000000ULL};
+    map.Publish(c);
+    const uint64_t ptp = map.HostToPTP(2000000000ULL);
+    const int64_t back = static_cast<int64_t>(map.PTPToHost(ptp)) - 2000000000LL;
+
+    return !torn && ptp == 5000000000ULL + 1000100000ULL && std::abs(back) <= 1;
+}
+
 // Register all PTP time tests
 static struct PTPTimeTestRegistrar {
     PTPTimeTestRegistrar() {
@@ -145,5 +186,6 @@ static struct PTPTimeTestRegistrar {
         RegisterTest("PTP Time: Nanosecond precision", test_ptp_precision);
         RegisterTest("PTP Time: Affine linearity", test_ptp_affine_linearity);
         RegisterTest("PTP Time: Conversion consistency", test_ptp_conversion_consistency);
+        RegisterTest("PTP Time: Affine map concurrent publish", test_ptp_affine_map_concurrent);
     }
 } ptpTimeTestRegistrar;
@@ -0,0 +1,187 @@
+// test_ptp_unicast.cpp - PTP unicast negotiation, slave table and send batch tests
+// SPDX-License-Identifier: MIT
+
+#include "PTPUnicast.h"
+#include <cstring>
+#include <functional>
+#include <map>
+#include <random>
+#include <string>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+extern void RegisterTest(const std::string& name, std::function<bool()> test);
+
+using namespace AES67;
+
+namespace {
+
+PTPPortIdentity MakeIdentity(uint32_t n) {
+    PTPPortIdentity identity;
+    identity.clock.id[0] = 0x02;
+    identity.clock.id[4] = static_cast<uint8_t>(n >> 16);
+    identity.clock.id[6] = static_cast<uint8_t>(n >> 8);
+    identity.clock.id[7] = static_cast<uint8_t>(n);
+    identity.port = 1;
+    return identity;
+}
+
+} // namespace
+
+// Test negotiation TLVs survive a write/parse round trip and unknown TLVs are skipped
+bool test_unicast_tlv_round_trip() {
+    uint8_t msg[kPTPSignalingHeaderLength + 64] = {};
+    msg[0] = static_cast<uint8_t>(PTPMessageType::Signaling);
+
+    PTPUnicastMessage request;
+    request.tlv = PTPUnicastTLV::Request;
+    request.messageType = PTPMessageType::Sync;
+    request.logInterval = -7;
+    request.durationSec = 0x00012345;
+
+    PTPUnicastMessage grant;
+    grant.tlv = PTPUnicastTLV::Grant;
+    grant.messageType = PTPMessageType::Delay_Resp;
+    grant.logInterval = 2;
+    grant.durationSec = 300;
+    grant.renewal = true;
+
+    PTPUnicastMessage cancel;
+    cancel.tlv = PTPUnicastTLV::Cancel;
+    cancel.messageType = PTPMessageType::Announce;
+
+    size_t length = kPTPSignalingHeaderLength;
+    length += WritePTPUnicastTLV(msg + length, request);
+    // An unrelated TLV (type 0x8000, 4 bytes) between the negotiation TLVs
+    const uint8_t other[] = {0x80, 0x00, 0x00, 0x04, 1, 2, 3, 4};
+    std::memcpy(msg + length, other, sizeof(other));
+    length += sizeof(other);
+    length += WritePTPUnicastTLV(msg + length, grant);
+    length += WritePTPUnicastTLV(msg + length, cancel);
+    msg[2] = static_cast<uint8_t>(length >> 8);
+    msg[3] = static_cast<uint8_t>(length);
+
+    PTPUnicastMessage parsed[4];
+    if (ParsePTPUnicastTLVs(msg, length, parsed, 4) != 3) return false;
+    if (parsed[0].tlv != PTPUnicastTLV::Request || parsed[0].messageType != PTPMessageType::Sync ||
+        parsed[0].logInterval != -7 || parsed[0].durationSec != 0x00012345) return false;
+    if (parsed[1].tlv != PTPUnicastTLV::Grant || parsed[1].messageType != PTPMessageType::Delay_Resp ||
+        parsed[1].logInterval != 2 || parsed[1].durationSec != 300 || !parsed[1].renewal) return false;
+    if (parsed[2].tlv != PTPUnicastTLV::Cancel || parsed[2].messageType != PTPMessageType::Announce) return false;
+
+    // Truncated to the messageLength field: the last TLV is cut off
+    msg[3] = static_cast<uint8_t>(length - 2);
+    if (ParsePTPUnicastTLVs(msg, length, parsed, 4) != 2) return false;
+
+    // Output capacity is respected
+    msg[3] = static_cast<uint8_t>(length);
+    return ParsePTPUnicastTLVs(msg, length, parsed, 1) == 1;
+}
+
+// Test the slave table against a reference map under random insert/erase/expire
+bool test_slave_table_matches_reference() {
+    PTPSlaveTable table(64);
+    std::map<uint32_t, uint64_t> reference;     // Id -> lastSeenNs
+    std::mt19937 rng(7);
+
+    for (int op = 0; op < 20000; ++op) {
+        const uint32_t id = rng() % 96;
+        const PTPPortIdentity identity = MakeIdentity(id);
+        if (rng() % 3 != 0) {
+            PTPSlaveEntry* entry = table.Insert(identity);
+            const bool full = reference.size() == 64 && !reference.count(id);
+            if (full != (entry == nullptr)) return false;
+            if (entry) {
+                entry->lastSeenNs = static_cast<uint64_t>(op);
+                reference[id] = static_cast<uint64_t>(op);
+            }
+        } else {
+            if (table.Erase(identity) != (reference.erase(id) == 1)) return false;
+        }
+
+        if (op % 2500 == 2499) {
+            // Drop everything idle for more than 100 operations
+            const uint64_t now = static_cast<uint64_t>(op);
+            size_t expected = 0;
+            for (auto it = reference.begin(); it != reference.end();) {
+                if (now - it->second > 100) {
+                    it = reference.erase(it);
+                    expected++;
+                } else {
+                    ++it;
+                }
+            }
+            if (table.Expire(now, 100) != expected) return false;
+        }
+
+        if (table.Size() != reference.size()) return false;
+    }
+
+    // Every surviving entry is still reachable after all the backward shifts
+    for (uint32_t id = 0; id < 96; ++id) {
+        const PTPSlaveEntry* entry = table.Find(MakeIdentity(id));
+        const auto it = reference.find(id);
+        if ((entry != nullptr) != (it != reference.end())) return false;
+        if (entry && entry->lastSeenNs != it->second) return false;
+    }
+
+    // Slaves holding a grant are not expired, however idle
+    table.Clear();
+    PTPSlaveEntry* granted = table.Insert(MakeIdentity(1));
+    table.Insert(MakeIdentity(2));
+    granted->GrantFor(PTPMessageType::Sync)->expiresNs = 1000000;
+    return table.Expire(500000, 10) == 1 && table.Size() == 1 && table.Find(MakeIdentity(1)) &&
+           table.Capacity() == 64 && !granted->GrantFor(PTPMessageType::Follow_Up);
+}
+
+// Test batched datagrams arrive intact, including across an automatic flush
+bool test_send_batch_delivers() {
+    const int rx = socket(AF_INET, SOCK_DGRAM, 0);
+    const int tx = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addrLen = sizeof(addr);
+    const int rcvbuf = 1 << 20;
+    setsockopt(rx, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    bool ok = rx >= 0 && tx >= 0 &&
+              bind(rx, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0 &&
+              getsockname(rx, reinterpret_cast<sockaddr*>(&addr), &addrLen) == 0;
+
+    const size_t count = PTPSendBatch::kMaxMessages + 10;
+    PTPSendBatch batch;
+    batch.SetSocket(tx);
+    for (size_t i = 0; ok && i < count; ++i) {
+        uint8_t* buffer = batch.Add(addr, 8 + i % 16);
+        ok = buffer != nullptr;
+        if (ok) {
+            std::memset(buffer, static_cast<int>(i), 8 + i % 16);
+        }
+    }
+    ok = ok && batch.Add(addr, PTPSendBatch::kMaxMessageLength + 1) == nullptr;
+    ok = ok && batch.GetFlushCount() == 1 && batch.Pending() == 10;
+    batch.Flush();
+    batch.Flush();  // Nothing pending: no send
+    ok = ok && batch.GetSentCount() == count && batch.GetFlushCount() == 2;
+
+    for (size_t i = 0; ok && i < count; ++i) {
+        uint8_t buffer[64];
+        const ssize_t n = recv(rx, buffer, sizeof(buffer), MSG_DONTWAIT);
+        ok = n == static_cast<ssize_t>(8 + i % 16) && buffer[0] == static_cast<uint8_t>(i) &&
+             buffer[n - 1] == static_cast<uint8_t>(i);
+    }
+
+    close(rx);
+    close(tx);
+    return ok;
+}
+
+// Register all unicast tests
+static struct PTPUnicastTestRegistrar {
+    PTPUnicastTestRegistrar() {
+        RegisterTest("PTPUnicast: Negotiation TLV round trip", test_unicast_tlv_round_trip);
+        RegisterTest("PTPUnicast: Slave table matches reference map", test_slave_table_matches_reference);
+        RegisterTest("PTPUnicast: Send batch delivers in order", test_send_batch_delivers);
+    }
+} ptpUnicastTestRegistrar;
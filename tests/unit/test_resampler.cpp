@@ -0,0 +1,144 @@
+// test_resampler.cpp - Drift-correcting resampler tests
+// SPDX-License-Identifier: MIT
+
+#include "AsyncResampler.h"
+#include <functional>
+#include <cmath>
+#include <string>
+#include <vector>
+
+extern void RegisterTest(const std::string& name, std::function<bool()> test);
+
+using namespace AES67;
+
+// Test unity ratio passes a constant signal through unchanged
+bool test_resampler_dc_passthrough() {
+    AsyncResampler resampler(2, 12);
+
+    int32_t input[24];
+    int32_t output[2 * 32];
+    for (int i = 0; i < 24; ++i) {
+        input[i] = 1000000 << 8;
+    }
+
+    uint32_t total = 0;
+    for (int packet = 0; packet < 20; ++packet) {
+        const uint32_t frames = resampler.Process(input, 12, output, 32);
+        total += frames;
+
+        // Skip filter warm-up
+        if (packet < 2) continue;
+
+        for (uint32_t i = 0; i < frames * 2; ++i) {
+            if (std::abs((output[i] >> 8) - 1000000) > 1) return false;
+        }
+    }
+
+    // One output per input frame, minus the filter delay line
+    return total == 20 * 12 - (AsyncResampler::kTaps - 1);
+}
+
+// Test ratio > 1.0 consumes input faster than it produces output
+bool test_resampler_ratio() {
+    AsyncResampler resampler(8, 12);
+    resampler.SetRatio(1.001);
+
+    std::vector<int32_t> input(12 * 8, 0);
+    std::vector<int32_t> output(32 * 8);
+
+    uint64_t produced = 0;
+    const uint32_t packets = 4000; // 1 second @ 250µs
+    for (uint32_t p = 0; p < packets; ++p) {
+        produced += resampler.Process(input.data(), 12, output.data(), 32);
+    }
+
+    const double expected = (packets * 12.0) / 1.001;
+    return std::abs(static_cast<double>(produced) - expected) < AsyncResampler::kTaps + 1;
+}
+
+// Test a 1 kHz sine survives resampling without large error
+bool test_resampler_sine_fidelity() {
+    AsyncResampler resampler(1, 48);
+    resampler.SetRatio(1.0005);
+
+    const double step = 2.0 * 3.14159265358979323846 * 1000.0 / 48000.0;
+    const double amplitude = 4000000.0;
+
+    std::vector<int32_t> input(48);
+    std::vector<int32_t> output(64);
+    double inputPhase = 0.0;
+    double outputPos = 0.0; // Input-frame position of next output
+    double maxError = 0.0;
+
+    for (int block = 0; block < 200; ++block) {
+        for (int i = 0; i < 48; ++i) {
+            input[i] = static_cast<int32_t>(std::lrint(amplitude * std::sin(inputPhase))) * 256;
+            inputPhase += step;
+        }
+
+        const uint32_t frames = resampler.Process(input.data(), 48, output.data(), 64);
+        for (uint32_t i = 0; i < frames; ++i) {
+            // Output n interpolates input at n * ratio + filter delay
+            const double t = outputPos + AsyncResampler::kTaps / 2.0 - 1.0;
+            const double expected = amplitude * std::sin(step * t);
+            if (block > 4) {
+                maxError = std::max(maxError, std::abs((output[i] >> 8) - expected));
+            }
+            outputPos += 1.0005;
+        }
+    }
+
+    // Better than -60 dB relative to the signal
+    return maxError < amplitude * 0.001;
+}
+
+// Test drift controller estimates a sender running 100 ppm fast
+bool test_drift_rate_estimate() {
+    DriftController drift(48000);
+
+    const double senderRate = 1.0001;
+    const uint64_t packetNs = 250000;
+    uint32_t rtp = 12345;
+    double rtpAccum = 0.0;
+
+    // 120 s of packets with ±100 µs arrival jitter
+    for (uint64_t p = 0; p < 480000; ++p) {
+        const uint64_t jitter = (p * 7919) % 200000;
+        drift.OnPacket(rtp, 1000000000ULL + p * packetNs + jitter);
+
+        rtpAccum += 12.0 * senderRate;
+        const uint32_t whole = static_cast<uint32_t>(rtpAccum);
+        rtp += whole;
+        rtpAccum -= whole;
+    }
+
+    return std::abs(drift.GetRateEstimate() - senderRate) < 5e-6;
+}
+
+// Test fill error steers the ratio in the right direction
+bool test_drift_fill_steering() {
+    DriftController drift(48000);
+
+    double ratioHigh = 1.0;
+    double ratioLow = 1.0;
+    for (int i = 0; i < 1000; ++i) {
+        ratioHigh = drift.Update(200.0, 100.0);
+    }
+    drift.Reset();
+    for (int i = 0; i < 1000; ++i) {
+        ratioLow = drift.Update(20.0, 100.0);
+    }
+
+    return ratioHigh > 1.0 && ratioLow < 1.0;
+}
+
+// Register all resampler tests
+static struct ResamplerTestRegistrar {
+    ResamplerTestRegistrar() {
+        RegisterTest("Resampler: DC passthrough", test_resampler_dc_passthrough);
+        RegisterTest("Resampler: Ratio consumption", test_resampler_ratio);
+        RegisterTest("Resampler: Sine fidelity", test_resampler_sine_fidelity);
+        RegisterTest("Resampler: Drift rate estimate", test_drift_rate_estimate);
+        RegisterTest("Resampler: Fill steering", test_drift_fill_steering);
+    }
+} resamplerTestRegistrar;
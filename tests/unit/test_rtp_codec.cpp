@@ -2,6 +2,7 @@
 // SPDX-License-Identifier: MIT
 
 #include "../../engine/include/RTPPacketizer.h"
+#include <cstring>
 #include <iostream>
 #include <functional>
 #include <string>
@@ -169,6 +170,77 @@ bool test_rtp_silence() {
     return true;
 }
 
+// Test a reconfigured depacketizer: other payload type, L16, 8-wide output
+bool test_rtp_reconfigure() {
+    RTPPacketizer packetizer(0x12345678, 2, 48000);
+    RTPDepacketizer depacketizer(8, 48000);
+    depacketizer.SetOutputChannels(8);
+    depacketizer.Configure(2, 96, 3);
+    
+    int32_t samples[8] = {0x11111100, -0x22222200, 0x33333300, -0x44444400,
+                          0x55555500, -0x66666600, 0x77777700, -0x08080800};
+    auto packet = packetizer.CreatePacket(samples, 4);
+    
+    int32_t decoded[4 * 8];
+    std::memset(decoded, 0x7F, sizeof(decoded));
+    if (depacketizer.ParsePacket(packet.data(), packet.size(), decoded) != 4) return false;
+    for (int frame = 0; frame < 4; ++frame) {
+        if (decoded[frame * 8] != samples[frame * 2] || decoded[frame * 8 + 1] != samples[frame * 2 + 1]) return false;
+        for (int ch = 2; ch < 8; ++ch) {
+            if (decoded[frame * 8 + ch] != 0) return false;
+        }
+    }
+    
+    // Too many frames for the caller's buffer
+    if (depacketizer.ParsePacket(packet.data(), packet.size(), decoded, 3) != 0) return false;
+    
+    // Payload type 97 is not ours until configured
+    packet[1] = (packet[1] & 0x80) | 97;
+    if (depacketizer.ParsePacket(packet.data(), packet.size(), decoded) != 0) return false;
+    
+    // L16 mono, payload type 97: big-endian 16 bits into the top of the word
+    depacketizer.Configure(1, 97, 2);
+    uint8_t l16[18] = {};
+    std::memcpy(l16, packet.data(), 12);
+    const uint8_t l16Payload[6] = {0x12, 0x34, 0x80, 0x00, 0xFF, 0xFF};
+    std::memcpy(l16 + 12, l16Payload, sizeof(l16Payload));
+    if (depacketizer.ParsePacket(l16, sizeof(l16), decoded) != 3) return false;
+    return decoded[0] == 0x12340000 && decoded[8] == INT32_MIN && decoded[16] == -0x10000 && decoded[9] == 0;
+}
+
+// Test a stray sender on the same group is dropped until ours goes quiet
+bool test_rtp_ssrc_lock() {
+    RTPPacketizer ours(0x11111111, 2, 48000);
+    RTPPacketizer stray(0x22222222, 2, 48000);
+    RTPDepacketizer depacketizer(2, 48000);
+    
+    int32_t samples[2 * 4] = {};
+    int32_t decoded[2 * 4];
+    for (int i = 0; i < 10; ++i) {
+        auto packet = ours.CreatePacket(samples, 4);
+        if (depacketizer.ParsePacket(packet.data(), packet.size(), decoded) != 4) return false;
+        packet = stray.CreatePacket(samples, 4);
+        if (depacketizer.ParsePacket(packet.data(), packet.size(), decoded) != 0) return false;
+    }
+    if (depacketizer.GetSSRC() != 0x11111111 || depacketizer.GetForeignPacketCount() != 10) return false;
+    auto last = ours.CreatePacket(samples, 4);
+    if (depacketizer.ParsePacket(last.data(), last.size(), decoded) != 4) return false;
+    
+    // Ours stopped: the new SSRC takes over after kSSRCTakeoverPackets in a row
+    uint32_t accepted = 0;
+    for (uint32_t i = 0; i < RTPDepacketizer::kSSRCTakeoverPackets; ++i) {
+        auto packet = stray.CreatePacket(samples, 4);
+        if (depacketizer.ParsePacket(packet.data(), packet.size(), decoded) == 4) accepted++;
+    }
+    if (accepted != 1 || depacketizer.GetSSRC() != 0x22222222) return false;
+    
+    // Configure forgets the lock
+    depacketizer.Configure(2, kRTPPayloadType_L24);
+    auto packet = ours.CreatePacket(samples, 4);
+    return depacketizer.ParsePacket(packet.data(), packet.size(), decoded) == 4 &&
+           depacketizer.GetSSRC() == 0x11111111;
+}
+
 // Register all RTP codec tests
 static struct RTPCodecTestRegistrar {
     RTPCodecTestRegistrar() {
@@ -179,5 +251,7 @@ static struct RTPCodecTestRegistrar {
         RegisterTest("RTP: Packet loss detection", test_rtp_packet_loss);
         RegisterTest("RTP: Payload type L24", test_rtp_payload_type);
         RegisterTest("RTP: Silence encoding", test_rtp_silence);
+        RegisterTest("RTP: Reconfigured depacketizer", test_rtp_reconfigure);
+        RegisterTest("RTP: Depacketizer locks to one SSRC", test_rtp_ssrc_lock);
     }
 } rtpCodecTestRegistrar;
@@ -0,0 +1,126 @@
+// test_rtp_receiver.cpp - RX demultiplexing table and shared socket tests
+// SPDX-License-Identifier: MIT
+
+#include "RTPReceiver.h"
+#include "RTPPacketizer.h"
+#include <arpa/inet.h>
+#include <functional>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+
+extern void RegisterTest(const std::string& name, std::function<bool()> test);
+
+using namespace AES67;
+
+namespace {
+
+uint32_t Addr(const char* text) {
+    in_addr addr{};
+    inet_pton(AF_INET, text, &addr);
+    return addr.s_addr;
+}
+
+// A UDP port nobody on loopback is using right now
+uint16_t FreePort() {
+    const int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addrLen = sizeof(addr);
+    bind(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+    getsockname(sock, reinterpret_cast<sockaddr*>(&addr), &addrLen);
+    close(sock);
+    return ntohs(addr.sin_port);
+}
+
+} // namespace
+
+// Test lookups by group and port, with one-SSRC entries ahead of any-SSRC ones
+bool test_demux_table() {
+    RxDemuxTable table;
+    for (uint8_t slot = 0; slot < 8; ++slot) {
+        const std::string group = "239.69.2." + std::to_string(slot + 1);
+        if (!table.Insert(Addr(group.c_str()), 5004, 0, true, slot)) return false;
+    }
+    if (table.Size() != 8 || table.Find(Addr("239.69.2.5"), 5004, 0xABCD) != 4) return false;
+    if (table.Find(Addr("239.69.2.5"), 5006, 0xABCD) != -1 || table.Find(Addr("239.69.2.9"), 5004, 1) != -1) return false;
+
+    // Same group and port again: taken, unless for one SSRC
+    if (table.Insert(Addr("239.69.2.1"), 5004, 0, true, 7)) return false;
+    table.Clear();
+    if (table.Find(Addr("239.69.2.1"), 5004, 0) != -1) return false;
+    table.Insert(Addr("239.69.2.1"), 5004, 0, true, 0);
+    if (!table.Insert(Addr("239.69.2.1"), 5004, 0x1111, false, 1)) return false;
+    if (!table.Insert(Addr("239.69.2.1"), 5004, 0, false, 2)) return false;    // SSRC 0 is an SSRC
+    if (table.Insert(Addr("239.69.2.1"), 5004, 0x1111, false, 3)) return false;
+    return table.Find(Addr("239.69.2.1"), 5004, 0x1111) == 1 && table.Find(Addr("239.69.2.1"), 5004, 0) == 2 &&
+           table.Find(Addr("239.69.2.1"), 5004, 0x2222) == 0;
+}
+
+// Test one socket carries several slots on a port, split by SSRC, drops
+// truncated datagrams, and a retune keeps that socket
+bool test_receiver_shared_socket() {
+    const uint16_t port = FreePort();
+    RxSubscription any;
+    any.address = "127.0.0.1";
+    any.port = port;
+    RxSubscription pinned = any;
+    pinned.pinSsrc = true;
+    pinned.ssrc = 0x2222;
+
+    RTPReceiver receiver;
+    std::array<const RxSubscription*, 8> subscriptions{};
+    subscriptions[1] = &any;
+    subscriptions[5] = &pinned;
+    receiver.Apply(subscriptions, in_addr{htonl(INADDR_LOOPBACK)});
+    if (receiver.GetSocketCount() != 1) return false;
+
+    const int tx = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in dest{};
+    dest.sin_family = AF_INET;
+    dest.sin_port = htons(port);
+    dest.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    auto send = [&](uint32_t ssrc) {
+        RTPPacketizer packetizer(ssrc, 2, 48000);
+        int32_t samples[2 * 6] = {};
+        const auto packet = packetizer.CreatePacket(samples, 6);
+        sendto(tx, packet.data(), packet.size(), 0, reinterpret_cast<sockaddr*>(&dest), sizeof(dest));
+    };
+
+    uint8_t buffer[1500];
+    RxPacketInfo info;
+    bool ok = true;
+    send(0x1111);
+    send(0x2222);
+    ok = ok && receiver.Receive(buffer, sizeof(buffer), 1000, info) == 12 + 2 * 6 * 3 && info.slot == 1 &&
+         info.sourceAddr == htonl(INADDR_LOOPBACK);
+    ok = ok && receiver.Receive(buffer, sizeof(buffer), 1000, info) > 0 && info.slot == 5;
+
+    // A datagram larger than the buffer is dropped and counted, not returned cut
+    send(0x1111);
+    ok = ok && receiver.Receive(buffer, 24, 1000, info) == 0 && receiver.GetTruncatedCount() == 1 &&
+         receiver.GetUnmatchedCount() == 0;
+
+    // Slot 5 gone: its SSRC now falls to slot 1 on the same socket
+    subscriptions[5] = nullptr;
+    receiver.Apply(subscriptions, in_addr{htonl(INADDR_LOOPBACK)});
+    send(0x2222);
+    ok = ok && receiver.GetSocketCount() == 1 && receiver.Receive(buffer, sizeof(buffer), 1000, info) > 0 && info.slot == 1;
+
+    // Nothing subscribed: no sockets, nothing received
+    subscriptions[1] = nullptr;
+    receiver.Apply(subscriptions, in_addr{htonl(INADDR_LOOPBACK)});
+    ok = ok && receiver.GetSocketCount() == 0 && receiver.Receive(buffer, sizeof(buffer), 10, info) == 0;
+
+    close(tx);
+    return ok;
+}
+
+// Register all RTP receiver tests
+static struct RTPReceiverTestRegistrar {
+    RTPReceiverTestRegistrar() {
+        RegisterTest("RTPReceiver: Demux table", test_demux_table);
+        RegisterTest("RTPReceiver: Shared socket split by SSRC", test_receiver_shared_socket);
+    }
+} rtpReceiverTestRegistrar;
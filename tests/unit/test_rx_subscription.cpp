@@ -0,0 +1,139 @@
+// test_rx_subscription.cpp - RX subscription from SDP and auto-subscribe rule tests
+// SPDX-License-Identifier: MIT
+
+#include "RxSubscription.h"
+#include <arpa/inet.h>
+#include <functional>
+#include <string>
+
+extern void RegisterTest(const std::string& name, std::function<bool()> test);
+
+using namespace AES67;
+
+namespace {
+
+DiscoveredSession MakeSession(const std::string& sdp, const std::string& originAddr) {
+    DiscoveredSession session;
+    SDPParser::Parse(sdp, session.session);
+    session.name = session.session.sessionName;
+    session.originAddr = originAddr;
+    return session;
+}
+
+} // namespace
+
+// Test the first audio section becomes the subscription
+bool test_subscription_from_sdp() {
+    const std::string sdp =
+        "v=0\r\n"
+        "o=- 1 1 IN IP4 10.0.0.5\r\n"
+        "s=Stage Left\r\n"
+        "t=0 0\r\n"
+        "a=ts-refclk:ptp=IEEE1588-2008:39-A7-94-FF-FE-07-CB-D0:3\r\n"
+        "m=video 5000 RTP/AVP 100\r\n"
+        "c=IN IP4 239.9.9.9/32\r\n"
+        "m=audio 5010 RTP/AVP 98\r\n"
+        "c=IN IP4 239.1.2.3/32\r\n"
+        "a=rtpmap:98 L16/48000/2\r\n"
+        "a=ptime:0.125\r\n";
+    RxSubscription subscription;
+    if (!RxSubscriptionFromSDP(SDPParser::Parse(sdp), subscription)) return false;
+    if (subscription.address != "239.1.2.3" || subscription.port != 5010 || subscription.channels != 2) return false;
+    if (subscription.payloadType != 98 || subscription.bytesPerSample != 2 || subscription.packetTimeUs != 125) return false;
+    if (subscription.sessionName != "Stage Left" || subscription.refClock.find(":3") == std::string::npos) return false;
+
+    // Not something a slot can play: 44.1 kHz, too many channels, no address
+    RxSubscription rejected;
+    std::string other = sdp;
+    other.replace(other.find("L16/48000/2"), 11, "L24/44100/2");
+    if (RxSubscriptionFromSDP(SDPParser::Parse(other), rejected)) return false;
+    other = sdp;
+    other.replace(other.find("L16/48000/2"), 11, "L24/48000/16");
+    if (RxSubscriptionFromSDP(SDPParser::Parse(other), rejected)) return false;
+    other = sdp;
+    other.erase(other.find("c=IN IP4 239.1.2.3/32\r\n"), 23);
+    return !RxSubscriptionFromSDP(SDPParser::Parse(other), rejected);
+}
+
+// Test source-filter senders reach the subscription and the packet check
+bool test_subscription_source_filter() {
+    const std::string sdp =
+        "v=0\r\n"
+        "o=- 1 1 IN IP4 10.0.0.5\r\n"
+        "s=Stage Left\r\n"
+        "t=0 0\r\n"
+        "m=audio 5004 RTP/AVP 96\r\n"
+        "c=IN IP4 239.69.4.1/32\r\n"
+        "a=source-filter: incl IN IP4 239.69.4.1 10.0.0.5 10.0.0.6\r\n"
+        "a=rtpmap:96 L24/48000/8\r\n";
+    RxSubscription subscription;
+    if (!RxSubscriptionFromSDP(SDPParser::Parse(sdp), subscription)) return false;
+    if (subscription.sources.size() != 2 || subscription.sources[1] != "10.0.0.6" || subscription.excludeSources) return false;
+    
+    RxSourceFilter filter;
+    if (!filter.Set(subscription)) return false;
+    in_addr addr{};
+    inet_pton(AF_INET, "10.0.0.6", &addr);
+    if (!filter.Accepts(addr.s_addr)) return false;
+    inet_pton(AF_INET, "10.0.0.7", &addr);
+    if (filter.Accepts(addr.s_addr)) return false;
+    
+    // excl: everyone but the listed senders
+    std::string other = sdp;
+    other.replace(other.find("incl"), 4, "excl");
+    if (!RxSubscriptionFromSDP(SDPParser::Parse(other), subscription) || !subscription.excludeSources) return false;
+    filter.Set(subscription);
+    if (!filter.Accepts(addr.s_addr)) return false;
+    inet_pton(AF_INET, "10.0.0.5", &addr);
+    if (filter.Accepts(addr.s_addr)) return false;
+    
+    // A filter for another group does not apply; a new source set needs a new socket
+    RxSubscription unfiltered;
+    other = sdp;
+    other.replace(other.find("239.69.4.1 10"), 10, "239.69.4.2");
+    if (!RxSubscriptionFromSDP(SDPParser::Parse(other), unfiltered) || !unfiltered.sources.empty()) return false;
+    if (unfiltered.SameSocket(subscription)) return false;
+    filter.Set(unfiltered);
+    return filter.Accepts(addr.s_addr);
+}
+
+// Test rule patterns: all non-empty ones must match
+bool test_auto_subscribe_rules() {
+    const DiscoveredSession session = MakeSession(
+        "v=0\r\n"
+        "o=- 1 1 IN IP4 10.0.0.5\r\n"
+        "s=Stage Left\r\n"
+        "c=IN IP4 239.69.4.1/32\r\n"
+        "m=audio 5004 RTP/AVP 96\r\n"
+        "a=rtpmap:96 L24/48000/8\r\n"
+        "m=audio 5004 RTP/AVP 96\r\n"
+        "c=IN IP4 239.70.4.1/32\r\n"
+        "a=rtpmap:96 L24/48000/8\r\n", "10.0.0.5");
+
+    AutoSubscribeRule any;
+    if (!MatchesAutoSubscribeRule(any, session)) return false;
+
+    AutoSubscribeRule rule;
+    rule.namePattern = "Stage*";
+    rule.groupPattern = "239.70.*";         // Second section's group
+    rule.originPattern = "10.0.0.?";
+    if (!MatchesAutoSubscribeRule(rule, session)) return false;
+
+    rule.originPattern = "10.0.1.*";
+    if (MatchesAutoSubscribeRule(rule, session)) return false;
+    rule.originPattern.clear();
+    rule.groupPattern = "239.71.*";
+    if (MatchesAutoSubscribeRule(rule, session)) return false;
+    rule.groupPattern.clear();
+    rule.namePattern = "Stage Right";
+    return !MatchesAutoSubscribeRule(rule, session);
+}
+
+// Register all RX subscription tests
+static struct RxSubscriptionTestRegistrar {
+    RxSubscriptionTestRegistrar() {
+        RegisterTest("RxSubscription: From SDP", test_subscription_from_sdp);
+        RegisterTest("RxSubscription: Source filter", test_subscription_source_filter);
+        RegisterTest("RxSubscription: Auto-subscribe rules", test_auto_subscribe_rules);
+    }
+} rxSubscriptionTestRegistrar;
@@ -0,0 +1,102 @@
+// test_sap_announcer.cpp - SAP announcements received over loopback
+// SPDX-License-Identifier: MIT
+
+#include "SAPAnnouncer.h"
+#include "SAPDiscoveryCache.h"
+#include <arpa/inet.h>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+extern void RegisterTest(const std::string& name, std::function<bool()> test);
+
+using namespace AES67;
+
+namespace {
+
+constexpr uint8_t kDeletionBit = 0x04;      // SAP T flag
+
+// Next datagram on sock as a parsed SAP packet; raw keeps the bytes it points into
+bool ReceiveSAP(int sock, std::vector<uint8_t>& raw, SAPPacket& packet) {
+    raw.resize(2048);
+    const ssize_t bytes = recv(sock, raw.data(), raw.size(), 0);
+    if (bytes <= 0) return false;
+    raw.resize(static_cast<size_t>(bytes));
+    return ParseSAPPacket(raw.data(), raw.size(), packet);
+}
+
+// Index of the stream whose SDP the packet carries, -1 if none
+int MatchStream(const SAPPacket& packet, const std::vector<StreamDescription>& streams) {
+    for (size_t i = 0; i < streams.size(); ++i) {
+        if (packet.payload == SAPAnnouncer::GenerateSDP(streams[i])) return static_cast<int>(i);
+    }
+    return -1;
+}
+
+} // namespace
+
+// Test a full announcement cycle and the deletions sent on Stop(), as a
+// receiver on 127.0.0.1 sees them
+bool test_sap_announcer_loopback() {
+    const int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sock < 0) return false;
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addrLen = sizeof(addr);
+    timeval timeout{2, 0};
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    if (bind(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+        getsockname(sock, reinterpret_cast<sockaddr*>(&addr), &addrLen) != 0) {
+        close(sock);
+        return false;
+    }
+
+    std::vector<StreamDescription> streams;
+    for (uint32_t i = 0; i < 5; ++i) {
+        streams.push_back({i, "Loopback " + std::to_string(i), "239.69.1." + std::to_string(i + 1),
+                           5004, 8, 48000, 1000});
+    }
+    SAPAnnouncer announcer;
+    announcer.SetInterval(30);
+    bool ok = announcer.SetDestination("127.0.0.1", ntohs(addr.sin_port)) && announcer.Start(streams);
+
+    // One cycle: every stream announced exactly once, with the SDP it serialises to
+    std::vector<uint16_t> msgIds(streams.size(), 0);
+    std::vector<uint8_t> raw;
+    SAPPacket packet;
+    for (size_t n = 0; ok && n < streams.size(); ++n) {
+        ok = ReceiveSAP(sock, raw, packet) && !packet.deletion && (raw[0] & kDeletionBit) == 0;
+        const int stream = ok ? MatchStream(packet, streams) : -1;
+        ok = stream >= 0 && msgIds[stream] == 0 && packet.msgIdHash != 0;
+        if (ok) msgIds[stream] = packet.msgIdHash;
+    }
+
+    // Stop(): all deletions in one batch, same hash and SDP, T bit set
+    const uint64_t batches = announcer.GetBatchCount();
+    announcer.Stop();
+    ok = ok && announcer.GetBatchCount() == batches + 1;
+    std::vector<bool> deleted(streams.size(), false);
+    for (size_t n = 0; ok && n < streams.size(); ++n) {
+        ok = ReceiveSAP(sock, raw, packet) && packet.deletion && (raw[0] & kDeletionBit) != 0;
+        const int stream = ok ? MatchStream(packet, streams) : -1;
+        ok = stream >= 0 && !deleted[stream] && packet.msgIdHash == msgIds[stream];
+        if (ok) deleted[stream] = true;
+    }
+
+    // Nothing else went out: no second cycle and no repeated deletions
+    uint8_t extra[16];
+    ok = ok && recv(sock, extra, sizeof(extra), MSG_DONTWAIT) < 0;
+    close(sock);
+    return ok;
+}
+
+// Register all SAP announcer tests
+static struct SAPAnnouncerTestRegistrar {
+    SAPAnnouncerTestRegistrar() {
+        RegisterTest("SAPAnnouncer: Loopback announce and delete", test_sap_announcer_loopback);
+    }
+} sapAnnouncerTestRegistrar;
@@ -0,0 +1,266 @@
+// test_sap_discovery.cpp - SAP packet parsing and discovery cache tests
+// SPDX-License-Identifier: MIT
+
+#include "SAPDiscoveryCache.h"
+#include "SnapshotPublisher.h"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+extern void RegisterTest(const std::string& name, std::function<bool()> test);
+
+using namespace AES67;
+
+namespace {
+
+constexpr uint64_t kSecond = 1000000000ULL;
+
+std::string MakeSDP(uint32_t id, uint32_t version, const std::string& name, const std::string& group) {
+    return "v=0\r\n"
+           "o=- " + std::to_string(id) + " " + std::to_string(version) + " IN IP4 10.0.0.5\r\n"
+           "s=" + name + "\r\n"
+           "c=IN IP4 " + group + "/32\r\n"
+           "t=0 0\r\n"
+           "m=audio 5004 RTP/AVP 96\r\n"
+           "a=rtpmap:96 L24/48000/2\r\n";
+}
+
+// SAPv1 header, IPv4 origin 10.0.0.<host>, optional payload type
+std::vector<uint8_t> MakePacket(const std::string& sdp, uint16_t msgId, uint8_t host = 5,
+                                bool deletion = false, bool payloadType = true) {
+    std::string packet = {
+        static_cast<char>(0x20 | (deletion ? 0x04 : 0)), 0,
+        static_cast<char>(msgId >> 8), static_cast<char>(msgId & 0xFF),
+        10, 0, 0, static_cast<char>(host)};
+    if (payloadType) {
+        packet.append("application/sdp", 16);                       // Includes the NUL
+    }
+    packet += sdp;
+    return std::vector<uint8_t>(packet.begin(), packet.end());
+}
+
+SAPDiscoveryCache::Change Feed(SAPDiscoveryCache& cache, const std::vector<uint8_t>& bytes, uint64_t nowNs) {
+    SAPPacket packet;
+    if (!ParseSAPPacket(bytes.data(), bytes.size(), packet)) return SAPDiscoveryCache::Change::None;
+    return cache.OnPacket(packet, nowNs);
+}
+
+} // namespace
+
+// Test header fields, IPv6 origins, auth data and the optional payload type
+bool test_sap_packet_parse() {
+    const std::string sdp = MakeSDP(1, 1, "A", "239.1.1.1");
+    SAPPacket packet;
+    std::vector<uint8_t> bytes = MakePacket(sdp, 0xBEEF, 7, true);
+    if (!ParseSAPPacket(bytes.data(), bytes.size(), packet)) return false;
+    if (!packet.deletion || packet.msgIdHash != 0xBEEF || packet.originLength != 4 ||
+        packet.origin[3] != 7 || packet.payload != sdp) return false;
+
+    bytes = MakePacket(sdp, 1, 5, false, false);
+    if (!ParseSAPPacket(bytes.data(), bytes.size(), packet) || packet.deletion || packet.payload != sdp) return false;
+
+    // IPv6 origin and one word of authentication data
+    std::vector<uint8_t> v6 = {0x30, 1, 0x12, 0x34};
+    for (uint8_t i = 0; i < 16; ++i) v6.push_back(i);
+    v6.insert(v6.end(), {0xAA, 0xBB, 0xCC, 0xDD});
+    v6.insert(v6.end(), sdp.begin(), sdp.end());
+    if (!ParseSAPPacket(v6.data(), v6.size(), packet)) return false;
+    if (packet.originLength != 16 || packet.origin[15] != 15 || packet.payload != sdp) return false;
+
+    // Wrong version, encrypted, compressed, other payload types, truncation
+    bytes = MakePacket(sdp, 1);
+    std::vector<uint8_t> bad = bytes;
+    bad[0] = 0x40;
+    if (ParseSAPPacket(bad.data(), bad.size(), packet)) return false;
+    bad[0] = 0x22;
+    if (ParseSAPPacket(bad.data(), bad.size(), packet)) return false;
+    bad[0] = 0x21;
+    if (ParseSAPPacket(bad.data(), bad.size(), packet)) return false;
+    bad = bytes;
+    bad[8] = 'x';
+    if (ParseSAPPacket(bad.data(), bad.size(), packet)) return false;
+    bad = bytes;
+    bad[1] = 200;                   // Auth data runs past the end
+    if (ParseSAPPacket(bad.data(), bad.size(), packet)) return false;
+    for (size_t length = 0; length <= 8; ++length) {
+        if (ParseSAPPacket(bytes.data(), length, packet)) return false;
+    }
+    return true;
+}
+
+// Test repeats refresh without parsing, and a changed payload re-parses
+bool test_cache_skips_unchanged() {
+    SAPDiscoveryCache cache;
+    const std::vector<uint8_t> first = MakePacket(MakeSDP(1, 1, "Stage", "239.1.1.1"), 0x1111);
+    if (Feed(cache, first, 0) != SAPDiscoveryCache::Change::Added) return false;
+    for (uint64_t i = 1; i <= 10; ++i) {
+        if (Feed(cache, first, i * 30 * kSecond) != SAPDiscoveryCache::Change::None) return false;
+    }
+    const DiscoveredSession* stream = cache.FindByName("Stage");
+    if (!stream || cache.GetParseCount() != 1 || stream->announcements != 11) return false;
+    if (stream->intervalNs != 30 * kSecond || stream->originAddr != "10.0.0.5") return false;
+
+    // Same msg id, different payload (a sloppy sender): parsed and updated
+    const std::vector<uint8_t> changed = MakePacket(MakeSDP(1, 1, "Stage", "239.1.1.2"), 0x1111);
+    if (Feed(cache, changed, 330 * kSecond) != SAPDiscoveryCache::Change::Updated) return false;
+    if (cache.GetParseCount() != 2 || cache.Size() != 1) return false;
+    if (!cache.FindByMulticast("239.1.1.1").empty() || cache.FindByMulticast("239.1.1.2").size() != 1) return false;
+
+    // A new version under a new msg id replaces the old entry
+    const std::vector<uint8_t> version2 = MakePacket(MakeSDP(1, 2, "Stage B", "239.1.1.3"), 0x2222);
+    if (Feed(cache, version2, 360 * kSecond) != SAPDiscoveryCache::Change::Updated) return false;
+    stream = cache.FindBySdpOrigin("- 1 IN IP4 10.0.0.5");
+    if (cache.Size() != 1 || !stream || stream->name != "Stage B" || cache.FindByName("Stage")) return false;
+    if (stream->firstSeenNs != 0 || stream->key.msgIdHash != 0x2222) return false;
+
+    // Late copies of the old version re-key it back rather than duplicating
+    Feed(cache, first, 361 * kSecond);
+    return cache.Size() == 1 && cache.FindByName("Stage") && !cache.FindByName("Stage B");
+}
+
+// Test deletions by msg id and, without one, by SDP origin
+bool test_cache_deletion() {
+    SAPDiscoveryCache cache;
+    Feed(cache, MakePacket(MakeSDP(1, 1, "A", "239.1.1.1"), 0x1111), 0);
+    Feed(cache, MakePacket(MakeSDP(2, 1, "B", "239.1.1.1"), 0, 6), 0);
+    if (cache.Size() != 2 || cache.FindByMulticast("239.1.1.1").size() != 2) return false;
+
+    // Deletions may carry only the o= line
+    if (Feed(cache, MakePacket("o=- 1 1 IN IP4 10.0.0.5\r\n", 0x1111, 5, true), kSecond) !=
+        SAPDiscoveryCache::Change::Removed) return false;
+    if (Feed(cache, MakePacket("o=- 2 1 IN IP4 10.0.0.5\r\n", 0, 6, true), kSecond) !=
+        SAPDiscoveryCache::Change::Removed) return false;
+    if (cache.Size() != 0 || cache.FindByName("A") || !cache.FindByMulticast("239.1.1.1").empty()) return false;
+
+    // Unknown deletions are ignored; a re-announcement is new again
+    if (Feed(cache, MakePacket("o=- 3 1 IN IP4 10.0.0.5\r\n", 0x3333, 5, true), kSecond) !=
+        SAPDiscoveryCache::Change::None) return false;
+    return Feed(cache, MakePacket(MakeSDP(1, 1, "A", "239.1.1.1"), 0x1111), 2 * kSecond) ==
+           SAPDiscoveryCache::Change::Added && cache.Size() == 1;
+}
+
+// Test expiry after max(minimum timeout, ten announcement periods)
+bool test_cache_expiry() {
+    SAPDiscoveryCache cache;
+    cache.SetMinimumTimeout(100 * kSecond);
+    const std::vector<uint8_t> fast = MakePacket(MakeSDP(1, 1, "Fast", "239.1.1.1"), 1);
+    const std::vector<uint8_t> slow = MakePacket(MakeSDP(2, 1, "Slow", "239.1.1.2"), 2);
+    for (uint64_t t = 0; t <= 60; t += 5) Feed(cache, fast, t * kSecond);     // Every 5 s
+    for (uint64_t t = 0; t <= 60; t += 30) Feed(cache, slow, t * kSecond);    // Every 30 s
+
+    // Fast is bounded by the minimum, slow by ten periods (300 s)
+    if (cache.Expire(150 * kSecond) != 0) return false;
+    if (cache.Expire(170 * kSecond) != 1 || cache.FindByName("Fast") || !cache.FindByName("Slow")) return false;
+    if (cache.Expire(350 * kSecond) != 0) return false;
+    if (cache.Expire(370 * kSecond) != 1 || cache.Size() != 0) return false;
+
+    // Freed slots are reused
+    Feed(cache, fast, 400 * kSecond);
+    size_t visited = 0;
+    cache.ForEach([&](const DiscoveredSession&) { visited++; });
+    return visited == 1 && cache.FindByOriginAddr("10.0.0.5").size() == 1;
+}
+
+// Test ten thousand sessions: one parse each, exact indexes after churn
+bool test_cache_many_sessions() {
+    constexpr uint32_t kSessions = 10000;
+    SAPDiscoveryCache cache;
+    std::vector<std::vector<uint8_t>> packets;
+    packets.reserve(kSessions);
+    for (uint32_t i = 0; i < kSessions; ++i) {
+        const std::string group = "239.2." + std::to_string(i / 250) + "." + std::to_string(i % 250);
+        packets.push_back(MakePacket(MakeSDP(i, 1, "S" + std::to_string(i), group),
+                                     static_cast<uint16_t>(i + 1), static_cast<uint8_t>(i % 200)));
+    }
+    for (uint64_t round = 0; round < 3; ++round) {
+        for (const auto& packet : packets) Feed(cache, packet, round * 30 * kSecond);
+    }
+    if (cache.Size() != kSessions || cache.GetParseCount() != kSessions) return false;
+
+    // Delete every other session
+    for (uint32_t i = 0; i < kSessions; i += 2) {
+        const std::string origin = "o=- " + std::to_string(i) + " 1 IN IP4 10.0.0.5\r\n";
+        Feed(cache, MakePacket(origin, static_cast<uint16_t>(i + 1), static_cast<uint8_t>(i % 200), true), 0);
+    }
+    if (cache.Size() != kSessions / 2 || cache.FindByOriginAddr("10.0.0.1").size() != 50) return false;
+    for (uint32_t i = 0; i < kSessions; i += 97) {
+        const std::string group = "239.2." + std::to_string(i / 250) + "." + std::to_string(i % 250);
+        if (cache.FindByMulticast(group).size() != (i % 2 ? 1u : 0u)) return false;
+        if ((cache.FindByName("S" + std::to_string(i)) != nullptr) != (i % 2 == 1)) return false;
+    }
+    return true;
+}
+
+// Test snapshots are sorted, immutable and share unchanged sessions
+bool test_cache_snapshot() {
+    SAPDiscoveryCache cache;
+    Feed(cache, MakePacket(MakeSDP(1, 1, "B", "239.1.1.1"), 1), 0);
+    Feed(cache, MakePacket(MakeSDP(2, 1, "A", "239.1.1.2"), 2), 0);
+    const auto first = cache.Snapshot();
+    if (first->sessions.size() != 2 || first->sessions[0]->name != "A" || first->generation != cache.GetGeneration()) return false;
+
+    // Refreshes do not change the generation
+    const uint64_t generation = cache.GetGeneration();
+    Feed(cache, MakePacket(MakeSDP(1, 1, "B", "239.1.1.1"), 1), kSecond);
+    if (cache.GetGeneration() != generation) return false;
+
+    // Only the changed session is copied; the old snapshot is untouched
+    Feed(cache, MakePacket(MakeSDP(1, 2, "B", "239.1.1.9"), 3), 2 * kSecond);
+    const auto second = cache.Snapshot();
+    if (second->generation == first->generation || second->sessions[0] != first->sessions[0]) return false;
+    if (second->sessions[1] == first->sessions[1] || first->Find("B")->session.connectionAddr != "239.1.1.1") return false;
+    return second->Find("B")->session.connectionAddr == "239.1.1.9" && !second->Find("C");
+}
+
+// Test readers always see a whole snapshot while a writer republishes
+bool test_snapshot_publisher_concurrent() {
+    struct State {
+        std::vector<uint64_t> values = std::vector<uint64_t>(64, 0);
+    };
+    SnapshotPublisher<State> publisher;
+    std::atomic<bool> stop{false};
+    std::atomic<bool> torn{false};
+    std::atomic<uint64_t> reads{0};
+
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 4; ++r) {
+        readers.emplace_back([&] {
+            uint64_t last = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                const auto state = publisher.Load();
+                for (uint64_t v : state->values) {
+                    if (v != state->values[0]) torn = true;
+                }
+                if (state->values[0] < last) torn = true;   // Never goes back
+                last = state->values[0];
+                reads++;
+            }
+        });
+    }
+    for (uint64_t version = 1; version <= 2000; ++version) {
+        auto next = std::make_shared<State>();
+        next->values.assign(64, version);
+        publisher.Publish(std::move(next));
+    }
+    // Make sure the readers actually ran
+    while (reads.load() < 1000) std::this_thread::yield();
+    stop = true;
+    for (auto& reader : readers) reader.join();
+    return !torn && publisher.Load()->values[0] == 2000;
+}
+
+// Register all SAP discovery tests
+static struct SAPDiscoveryTestRegistrar {
+    SAPDiscoveryTestRegistrar() {
+        RegisterTest("SAPDiscovery: Packet parsing", test_sap_packet_parse);
+        RegisterTest("SAPDiscovery: Unchanged announcements skip parsing", test_cache_skips_unchanged);
+        RegisterTest("SAPDiscovery: Deletion messages", test_cache_deletion);
+        RegisterTest("SAPDiscovery: Stale sessions expire", test_cache_expiry);
+        RegisterTest("SAPDiscovery: Ten thousand sessions", test_cache_many_sessions);
+        RegisterTest("SAPDiscovery: Snapshots share unchanged sessions", test_cache_snapshot);
+        RegisterTest("SnapshotPublisher: Concurrent readers see whole snapshots", test_snapshot_publisher_concurrent);
+    }
+} sapDiscoveryTestRegistrar;
@@ -0,0 +1,126 @@
+// test_sap_schedule.cpp - SAP timer wheel and announcement interval tests
+// SPDX-License-Identifier: MIT
+
+#include "SAPAnnouncer.h"
+#include "SAPTimerWheel.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+extern void RegisterTest(const std::string& name, std::function<bool()> test);
+
+using namespace AES67;
+
+// Test every timer fires on its tick, including deadlines several laps out
+bool test_wheel_fires_on_due_tick() {
+    SAPTimerWheel wheel(64);
+    const uint64_t start = 1000;
+    wheel.Reset(300, start);
+    for (uint32_t id = 0; id < 300; ++id) {
+        wheel.Schedule(id, start + 1 + (id * 37) % 700);   // Up to ~11 laps
+    }
+    if (wheel.Size() != 300) return false;
+
+    std::vector<uint64_t> firedAt(300, 0);
+    for (uint64_t tick = start + 1; tick <= start + 701; ++tick) {
+        // The next deadline is this tick whenever something fires on it
+        const uint64_t next = wheel.NextDue();
+        bool any = false;
+        wheel.Advance(tick, [&](uint32_t id) {
+            firedAt[id] = tick;
+            any = true;
+        });
+        if (any && next != tick) return false;
+        if (!any && next == tick) return false;
+    }
+    for (uint32_t id = 0; id < 300; ++id) {
+        if (firedAt[id] != start + 1 + (id * 37) % 700) return false;
+    }
+    return wheel.Size() == 0 && wheel.NextDue() == SAPTimerWheel::kNever;
+}
+
+// Test cancel, re-schedule, overdue deadlines and a jump past a whole lap
+bool test_wheel_cancel_and_overdue() {
+    SAPTimerWheel wheel(16);
+    wheel.Reset(4, 100);
+    wheel.Schedule(0, 105);
+    wheel.Schedule(1, 105);
+    wheel.Schedule(2, 150);
+    wheel.Cancel(1);
+    wheel.Schedule(0, 110);         // Moves
+    wheel.Schedule(3, 90);          // Already due
+    if (wheel.Size() != 3 || wheel.IsScheduled(1) || wheel.DueTick(0) != 110) return false;
+    if (wheel.NextDue() != 90) return false;
+
+    std::vector<uint32_t> fired;
+    wheel.Advance(101, [&](uint32_t id) { fired.push_back(id); });
+    if (fired != std::vector<uint32_t>{3}) return false;
+
+    // A jump of more than one lap fires everything due, once
+    fired.clear();
+    wheel.Advance(500, [&](uint32_t id) { fired.push_back(id); });
+    std::sort(fired.begin(), fired.end());
+    if (fired != std::vector<uint32_t>{0, 2} || wheel.Size() != 0) return false;
+
+    // The callback may put the fired timer back
+    wheel.Schedule(1, 510);
+    size_t count = 0;
+    wheel.Advance(520, [&](uint32_t id) {
+        count++;
+        wheel.Schedule(id, 520 + 40);
+    });
+    return count == 1 && wheel.IsScheduled(1) && wheel.NextDue() == 560;
+}
+
+// Test thousands of periodic timers stay on schedule when advanced in steps
+bool test_wheel_many_periodic() {
+    constexpr uint32_t kTimers = 5000;
+    constexpr uint64_t kPeriod = 3000;  // Longer than the wheel
+    SAPTimerWheel wheel(1024);
+    wheel.Reset(kTimers, 0);
+    std::mt19937 rng(3);
+    std::vector<uint64_t> due(kTimers);
+    for (uint32_t id = 0; id < kTimers; ++id) {
+        due[id] = 1 + rng() % kPeriod;
+        wheel.Schedule(id, due[id]);
+    }
+
+    std::vector<uint32_t> fires(kTimers, 0);
+    bool ok = true;
+    for (uint64_t now = 7; now <= 10 * kPeriod; now += 7) {
+        wheel.Advance(now, [&](uint32_t id) {
+            ok = ok && due[id] <= now && due[id] + 7 > now;
+            fires[id]++;
+            due[id] += kPeriod;
+            wheel.Schedule(id, due[id]);
+        });
+    }
+    for (uint32_t f : fires) {
+        ok = ok && (f == 9 || f == 10);
+    }
+    return ok && wheel.Size() == kTimers;
+}
+
+// Test the RFC 2974 interval scales with the announced bytes
+bool test_sap_interval_scaling() {
+    // Eight 420-byte announcements at 4000 bits/s: 6.7 s, so the minimum
+    if (SAPAnnouncer::ComputeIntervalSeconds(8 * 420, 4000, 30) != 30.0) return false;
+    // A thousand 500-byte announcements: 1000 s
+    if (std::fabs(SAPAnnouncer::ComputeIntervalSeconds(1000 * 500, 4000, 30) - 1000.0) > 1e-9) return false;
+    // No limit: always the minimum
+    return SAPAnnouncer::ComputeIntervalSeconds(1000000, 0, 300) == 300.0;
+}
+
+// Register all SAP scheduling tests
+static struct SAPScheduleTestRegistrar {
+    SAPScheduleTestRegistrar() {
+        RegisterTest("SAPTimerWheel: Fires on the due tick", test_wheel_fires_on_due_tick);
+        RegisterTest("SAPTimerWheel: Cancel and overdue deadlines", test_wheel_cancel_and_overdue);
+        RegisterTest("SAPTimerWheel: Thousands of periodic timers", test_wheel_many_periodic);
+        RegisterTest("SAPAnnouncer: Interval scales with bandwidth", test_sap_interval_scaling);
+    }
+} sapScheduleTestRegistrar;
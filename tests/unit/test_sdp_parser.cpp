@@ -0,0 +1,250 @@
+// test_sdp_parser.cpp - SDP parser tests
+// SPDX-License-Identifier: MIT
+
+#include "SAPAnnouncer.h"
+#include "SDPParser.h"
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <string>
+
+extern void RegisterTest(const std::string& name, std::function<bool()> test);
+
+using namespace AES67;
+
+// Test the PTP domain of RFC 7273 ts-refclk values
+bool test_ptp_domain_from_refclk() {
+    uint8_t domain = 99;
+    if (!SDPParser::ParsePTPDomain("ptp=IEEE1588-2008:39-A7-94-FF-FE-07-CB-D0:127", domain) || domain != 127) return false;
+    if (!SDPParser::ParsePTPDomain("ptp=IEEE1588-2019:39-A7-94-FF-FE-07-CB-D0:0", domain) || domain != 0) return false;
+
+    // No domain, or no grandmaster at all: the default domain
+    domain = 99;
+    if (!SDPParser::ParsePTPDomain("ptp=IEEE1588-2008:39-A7-94-FF-FE-07-CB-D0", domain) || domain != 0) return false;
+    domain = 99;
+    if (!SDPParser::ParsePTPDomain("ptp=IEEE1588-2008:traceable", domain) || domain != 0) return false;
+    domain = 99;
+    if (!SDPParser::ParsePTPDomain("ptp=IEEE802.1AS-2011", domain) || domain != 0) return false;
+
+    // Not a numbered PTP domain
+    return !SDPParser::ParsePTPDomain("localmac=CA-FE-01-CA-FE-02", domain) &&
+           !SDPParser::ParsePTPDomain("ptp=IEEE1588-2002:39-A7-94-FF-FE-07-CB-D0:_DFLT", domain) &&
+           !SDPParser::ParsePTPDomain("ptp=IEEE1588-2008:39-A7-94-FF-FE-07-CB-D0:256", domain) &&
+           !SDPParser::ParsePTPDomain("ptp=IEEE1588-2008:39-A7-94-FF-FE-07-CB-D0:", domain) &&
+           !SDPParser::ParsePTPDomain("ptp=IEEE1588-2008:39-A7-94-FF-FE-07-CB-D0:-1", domain);
+}
+
+// Test ts-refclk is carried through Parse
+bool test_parse_refclk_domain() {
+    const std::string sdp =
+        "v=0\r\n"
+        "o=- 1 1 IN IP4 10.0.0.5\r\n"
+        "s=Island\r\n"
+        "c=IN IP4 239.69.1.1/32\r\n"
+        "m=audio 5004 RTP/AVP 96\r\n"
+        "a=rtpmap:96 L24/48000/8\r\n"
+        "a=ts-refclk:ptp=IEEE1588-2008:39-A7-94-FF-FE-07-CB-D0:127\r\n";
+    const SDPSession session = SDPParser::Parse(sdp);
+    uint8_t domain = 0;
+    return SDPParser::ParsePTPDomain(session.ptpRefClock, domain) && domain == 127;
+}
+
+namespace {
+
+const char* kRavennaSDP =
+    "v=0\r\n"
+    "o=- 1423986 1423994 IN IP4 192.168.1.150\r\n"
+    "s=ANUBIS_610120_Stream1\r\n"
+    "c=IN IP4 239.1.150.100/15\r\n"
+    "t=0 0\r\n"
+    "a=clock-domain:PTPv2 0\r\n"
+    "m=audio 5004 RTP/AVP 98\r\n"
+    "c=IN IP4 239.1.150.101/31\r\n"
+    "a=rtpmap:98 L24/48000/2\r\n"
+    "a=sync-time:0\r\n"
+    "a=framecount:6\r\n"
+    "a=source-filter: incl IN IP4 239.1.150.101 192.168.1.150\r\n"
+    "a=recvonly\r\n"
+    "a=ptime:0.125\r\n"
+    "a=ts-refclk:ptp=IEEE1588-2008:00-1D-C1-FF-FE-51-9E-F7:0\r\n"
+    "a=mediaclk:direct=963214424\r\n";
+
+// ST 2022-7: two sections, clocks given once at session level
+const char* kRedundantSDP =
+    "v=0\n"
+    "o=- 7 12 IN IP4 10.0.0.5\n"
+    "s=Island 2022-7\n"
+    "t=0 0\n"
+    "a=group:DUP primary secondary\n"
+    "a=ts-refclk:ptp=IEEE1588-2008:39-A7-94-FF-FE-07-CB-D0:127\n"
+    "a=mediaclk:direct=0 rate=48000/1\n"
+    "m=audio 5004 RTP/AVP 97\n"
+    "c=IN IP4 239.10.0.1/64\n"
+    "a=source-filter: incl IN IP4 239.10.0.1 10.0.0.5 10.0.0.6\n"
+    "a=rtpmap:96 L16/44100/2\n"
+    "a=rtpmap:97 L24/96000/8\n"
+    "a=ptime:1\n"
+    "a=mid:primary\n"
+    "m=audio 5006 RTP/AVP 97\n"
+    "c=IN IP4 239.20.0.1/64\n"
+    "a=rtpmap:97 L24/96000/8\n"
+    "a=ptime:1\n"
+    "a=ts-refclk:localmac=CA-FE-01-CA-FE-02\n"
+    "a=ts-refclk:ptp=IEEE1588-2019:39-A7-94-FF-FE-07-CB-D1:96\n"
+    "a=mid:secondary\n";
+
+} // namespace
+
+// Test a Ravenna description: media c= over session c=, source filter, clocks
+bool test_parse_ravenna() {
+    SDPSession session;
+    if (!SDPParser::Parse(kRavennaSDP, session) || session.media.size() != 1) return false;
+    const SDPMedia& m = session.media[0];
+    if (session.sessionName != "ANUBIS_610120_Stream1" || session.sessionId != 1423986 ||
+        session.sessionVersion != 1423994 || session.originAddr != "192.168.1.150") return false;
+    if (m.mediaType != "audio" || m.port != 5004 || m.payloadType != 98 || m.encoding != "L24" ||
+        m.sampleRate != 48000 || m.channels != 2 || m.packetTimeUs != 125) return false;
+    if (m.connectionAddr != "239.1.150.101" || m.ttl != 31) return false;
+    if (!m.sourceFilter.include || m.sourceFilter.destAddr != "239.1.150.101" ||
+        m.sourceFilter.sourceAddrs.size() != 1 || m.sourceFilter.sourceAddrs[0] != "192.168.1.150") return false;
+    if (!m.refClock.valid || m.refClock.ptpVersion != "IEEE1588-2008" ||
+        m.refClock.ptpGrandmaster != "00-1D-C1-FF-FE-51-9E-F7" || m.refClock.ptpDomain != 0) return false;
+    if (!m.mediaClock.direct || m.mediaClock.offset != 963214424 || m.mediaClock.rateNum != 0) return false;
+
+    // The flat fields describe the first audio section
+    return session.connectionAddr == "239.1.150.101" && session.port == 5004 && session.payloadType == 98 &&
+           session.rtpmap == "L24/48000/2" && session.sampleRate == 48000 && session.channels == 2 &&
+           session.packetTimeUs == 125 && session.mediaClk == "direct=963214424" &&
+           session.ptpRefClock == "ptp=IEEE1588-2008:00-1D-C1-FF-FE-51-9E-F7:0";
+}
+
+// Test several m= sections inheriting session-level attributes
+bool test_parse_multiple_media() {
+    const SDPSession session = SDPParser::Parse(kRedundantSDP);
+    if (session.media.size() != 2) return false;
+    const SDPMedia& primary = session.media[0];
+    const SDPMedia& secondary = session.media[1];
+
+    // rtpmap of another payload type is not this section's format
+    if (primary.mid != "primary" || primary.encoding != "L24" || primary.sampleRate != 96000 ||
+        primary.channels != 8 || primary.packetTimeUs != 1000 || primary.ttl != 64) return false;
+    if (primary.refClock.ptpDomain != 127 || !primary.refClock.valid) return false;
+    if (!primary.mediaClock.direct || primary.mediaClock.offset != 0 ||
+        primary.mediaClock.rateNum != 48000 || primary.mediaClock.rateDen != 1) return false;
+    if (primary.sourceFilter.sourceAddrs.size() != 2 || primary.sourceFilter.sourceAddrs[1] != "10.0.0.6") return false;
+
+    // Own ts-refclk: the PTP one is preferred over localmac; no filter of its own
+    return secondary.mid == "secondary" && secondary.port == 5006 && secondary.connectionAddr == "239.20.0.1" &&
+           secondary.refClock.valid && secondary.refClock.ptpDomain == 96 &&
+           secondary.refClock.ptpVersion == "IEEE1588-2019" && secondary.mediaClock.rateNum == 48000 &&
+           secondary.sourceFilter.sourceAddrs.empty() && session.connectionAddr == "239.10.0.1";
+}
+
+// Test a warm session is fully refilled, nothing of the previous text left
+bool test_parse_reuses_session() {
+    SDPSession session;
+    if (!SDPParser::Parse(kRedundantSDP, session)) return false;
+    if (!SDPParser::Parse(kRavennaSDP, session) || session.media.size() != 1) return false;
+    const SDPMedia& m = session.media[0];
+    if (!m.mid.empty() || m.mediaClock.rateNum != 0 || m.sourceFilter.sourceAddrs.size() != 1) return false;
+
+    const std::string bare = "v=0\r\no=- 1 1 IN IP4 10.0.0.9\r\ns=Bare\r\nm=audio 6000 RTP/AVP 10\r\n";
+    return SDPParser::Parse(bare, session) && session.media.size() == 1 && session.connectionAddr.empty() &&
+           session.media[0].ptpRefClock.empty() && !session.media[0].refClock.valid &&
+           session.media[0].sourceFilter.sourceAddrs.empty() && session.rtpmap.empty() &&
+           session.sampleRate == 0 && session.packetTimeUs == 0 && session.sessionName == "Bare";
+}
+
+// Test malformed and truncated input is rejected or skipped without throwing
+bool test_parse_malformed() {
+    SDPSession session;
+    if (SDPParser::Parse("", session) || SDPParser::Parse("hello\nworld", session)) return false;
+    if (SDPParser::Parse("v=0\r\ns=No media\r\n", session)) return false;
+
+    const std::string broken =
+        "v=0\n"
+        "o=- 99999999999999999999999 x IN IP4\n"
+        "c=IN IP4\n"
+        "m=audio 70000 RTP/AVP 300\n"
+        "a=rtpmap:0 L24/48000/2\n"
+        "a=rtpmap:\n"
+        "a=ptime:1.5ms\n"
+        "a=ptime:-1\n"
+        "a=source-filter: incl IN IP4 239.1.1.1\n"
+        "a=mediaclk:direct=-5\n"
+        "a=ts-refclk:ptp=IEEE1588-2008:gm:1000\n"
+        "=\n"
+        "a\n";
+    if (!SDPParser::Parse(broken, session) || session.media.size() != 1) return false;
+    const SDPMedia& m = session.media[0];
+    if (m.port != 0 || m.payloadType != 0 || m.encoding != "L24" || m.packetTimeUs != 0 || session.sessionId != 0 ||
+        !m.sourceFilter.sourceAddrs.empty() || m.mediaClock.direct || m.refClock.valid) return false;
+
+    // Every truncation and random corruption of a valid description
+    const std::string good = kRedundantSDP;
+    for (size_t len = 0; len <= good.size(); ++len) {
+        SDPParser::Parse(std::string_view(good).substr(0, len), session);
+    }
+    std::mt19937 rng(7);
+    std::string noisy;
+    for (int i = 0; i < 2000; ++i) {
+        noisy = good;
+        for (int k = 0; k < 8; ++k) {
+            noisy[rng() % noisy.size()] = static_cast<char>(rng() % 256);
+        }
+        SDPParser::Parse(noisy, session);
+    }
+    return true;
+}
+
+// Test RFC 7273 mediaclk forms
+bool test_parse_media_clock() {
+    SDPMediaClock clock;
+    if (!SDPParser::ParseMediaClock("direct=4294967295", clock) || clock.offset != 4294967295u) return false;
+    if (!SDPParser::ParseMediaClock("direct=10 rate=1001/1000", clock) || clock.rateNum != 1001 || clock.rateDen != 1000) return false;
+    return !SDPParser::ParseMediaClock("sender", clock) && !clock.direct &&
+           !SDPParser::ParseMediaClock("direct=4294967296", clock) &&
+           !SDPParser::ParseMediaClock("direct=", clock);
+}
+
+// Test our own descriptions parse back: a=ptime is written in milliseconds,
+// by the generic generator and by the SAP announcer
+bool test_generate_round_trip() {
+    if (SDPParser::FormatPacketTime(1000) != "1" || SDPParser::FormatPacketTime(125) != "0.125" ||
+        SDPParser::FormatPacketTime(250) != "0.25" || SDPParser::FormatPacketTime(4000) != "4") return false;
+
+    for (const uint32_t packetTimeUs : {125u, 250u, 333u, 1000u, 4000u}) {
+        SDPSession session;
+        session.origin = "- 1 1 IN IP4 10.0.0.5";
+        session.sessionName = "Round Trip";
+        session.connectionAddr = "239.69.1.1";
+        session.port = 5004;
+        session.payloadType = 96;
+        session.rtpmap = "L24/48000/8";
+        session.packetTimeUs = packetTimeUs;
+        session.ptpRefClock = "ptp=IEEE1588-2008:39-A7-94-FF-FE-07-CB-D0:0";
+        const SDPSession parsed = SDPParser::Parse(SDPParser::Generate(session));
+        if (parsed.packetTimeUs != packetTimeUs || parsed.sessionName != session.sessionName ||
+            parsed.connectionAddr != session.connectionAddr || parsed.port != 5004 ||
+            parsed.channels != 8 || parsed.sampleRate != 48000 || parsed.ptpRefClock != session.ptpRefClock) return false;
+
+        const StreamDescription stream{0, "Announced", "239.69.1.2", 5004, 8, 48000, packetTimeUs};
+        const SDPSession announced = SDPParser::Parse(SAPAnnouncer::GenerateSDP(stream));
+        if (announced.packetTimeUs != packetTimeUs || announced.channels != 8) return false;
+    }
+    return true;
+}
+
+// Register all SDP parser tests
+static struct SDPParserTestRegistrar {
+    SDPParserTestRegistrar() {
+        RegisterTest("SDPParser: PTP domain from ts-refclk", test_ptp_domain_from_refclk);
+        RegisterTest("SDPParser: Parse keeps ts-refclk", test_parse_refclk_domain);
+        RegisterTest("SDPParser: Ravenna description", test_parse_ravenna);
+        RegisterTest("SDPParser: Multiple media sections", test_parse_multiple_media);
+        RegisterTest("SDPParser: Reused session is refilled", test_parse_reuses_session);
+        RegisterTest("SDPParser: Malformed input", test_parse_malformed);
+        RegisterTest("SDPParser: Media clock", test_parse_media_clock);
+        RegisterTest("SDPParser: Generate round trip", test_generate_round_trip);
+    }
+} sdpParserTestRegistrar;
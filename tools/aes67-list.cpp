@@ -40,26 +40,24 @@ int main(int argc, char* argv[]) {
     std::this_thread::sleep_for(std::chrono::seconds(listenTime));
     
     // Get discovered streams
-    auto streamNames = static_cast<NetworkEngine*>(engine)->GetDiscoveredStreamNames();
+    const auto snapshot = static_cast<NetworkEngine*>(engine)->GetDiscoverySnapshot();
     
-    if (streamNames.empty()) {
+    if (snapshot->sessions.empty()) {
         std::cout << "No AES67 streams discovered.\n";
     } else {
-        std::cout << "Discovered " << streamNames.size() << " stream(s):\n\n";
+        std::cout << "Discovered " << snapshot->sessions.size() << " stream(s):\n\n";
         
-        for (const auto& name : streamNames) {
-            SDPSession session;
-            if (static_cast<NetworkEngine*>(engine)->GetDiscoveredStream(name, session)) {
-                std::cout << "Stream: " << name << "\n";
-                std::cout << "  Address: " << session.connectionAddr << ":" << session.port << "\n";
-                std::cout << "  Channels: " << static_cast<int>(session.channels) << "\n";
-                std::cout << "  Sample Rate: " << session.sampleRate << " Hz\n";
-                std::cout << "  Packet Time: " << session.packetTimeUs << " µs\n";
-                if (!session.ptpRefClock.empty()) {
-                    std::cout << "  PTP Clock: " << session.ptpRefClock << "\n";
-                }
-                std::cout << "\n";
+        for (const auto& stream : snapshot->sessions) {
+            const SDPSession& session = stream->session;
+            std::cout << "Stream: " << stream->name << "\n";
+            std::cout << "  Address: " << session.connectionAddr << ":" << session.port << "\n";
+            std::cout << "  Channels: " << static_cast<int>(session.channels) << "\n";
+            std::cout << "  Sample Rate: " << session.sampleRate << " Hz\n";
+            std::cout << "  Packet Time: " << session.packetTimeUs << " µs\n";
+            if (!session.ptpRefClock.empty()) {
+                std::cout << "  PTP Clock: " << session.ptpRefClock << "\n";
             }
+            std::cout << "\n";
         }
     }
     
@@ -2,7 +2,6 @@
 // SPDX-License-Identifier: MIT
 
 #include "NetworkEngine.h"
-#include "AES67_RingBuffer.h"
 #include <iostream>
 #include <csignal>
 #include <cstring>
@@ -66,28 +65,22 @@ std::string GenerateStatusJSON(NetworkEngine& engine, uint32_t numChannels) {
     json << "  \"rateScalar\": " << engine.GetRateScalar() << ",\n";
     json << "  \"channels\": [\n";
     
-    // Get audio levels for each channel
-    AudioRingBuffer* ringBuffer = engine.GetInputRingBuffer(0);
-    if (ringBuffer) {
-        size_t availableSamples = ringBuffer->ReadAvailable();
+    // Get audio levels for each channel from the newest 512 frames received.
+    // Peeked, not read: metering must not consume audio or move the playout.
+    {
+        const size_t framesToRead = 512;
+        std::vector<int32_t> interleaved(framesToRead * kChannelsPerStream);
+        const uint32_t framesReceived = engine.PeekInputFrames(0, interleaved.data(), framesToRead);
         if (callCount % 10 == 0) {
-            std::cerr << "GenerateStatusJSON: Ring buffer has " << availableSamples 
-                      << " samples available\n";
-        }
-
-        size_t framesAvailable = availableSamples / numChannels;
-        const size_t framesToRead = std::min(framesAvailable, size_t(512));
-        std::vector<int32_t> interleaved(framesToRead * numChannels);
-        
-        if (framesToRead > 0) {
-            ringBuffer->Read(interleaved.data(), framesToRead * numChannels);
+            std::cerr << "GenerateStatusJSON: Received " << framesReceived 
+                      << " of " << framesToRead << " frames\n";
         }
         
         for (uint32_t ch = 0; ch < numChannels; ++ch) {
-            // Extract this channel's samples from interleaved data
+            // Extract this channel's samples from interleaved data (stream 0 carries 8)
             std::vector<int32_t> channelSamples(framesToRead);
-            for (size_t i = 0; i < framesToRead; ++i) {
-                channelSamples[i] = interleaved[i * numChannels + ch];
+            for (size_t i = 0; i < framesToRead && ch < kChannelsPerStream; ++i) {
+                channelSamples[i] = interleaved[i * kChannelsPerStream + ch];
             }
             
             float level = CalculateRMS(channelSamples.data(), framesToRead);
@@ -99,31 +92,21 @@ std::string GenerateStatusJSON(NetworkEngine& engine, uint32_t numChannels) {
             if (ch < numChannels - 1) json << ",";
             json << "\n";
         }
-    } else {
-        // No ring buffer available
-        for (uint32_t ch = 0; ch < numChannels; ++ch) {
-            json << "    {\"channel\": " << ch 
-                 << ", \"level\": -96.0"
-                 << ", \"peak\": -96.0}";
-            if (ch < numChannels - 1) json << ",";
-            json << "\n";
-        }
     }
     
     json << "  ],\n";
     
     // Add discovered streams
     json << "  \"streams\": [\n";
-    auto streamNames = engine.GetDiscoveredStreamNames();
-    for (size_t i = 0; i < streamNames.size(); ++i) {
-        SDPSession session;
-        if (engine.GetDiscoveredStream(streamNames[i], session)) {
-            json << "    {\"name\": \"" << streamNames[i] << "\", "
-                 << "\"address\": \"" << session.connectionAddr << "\", "
-                 << "\"port\": " << session.port << "}";
-            if (i < streamNames.size() - 1) json << ",";
-            json << "\n";
-        }
+    // One lock-free snapshot per poll: no per-stream lookups or copies
+    const auto snapshot = engine.GetDiscoverySnapshot();
+    for (size_t i = 0; i < snapshot->sessions.size(); ++i) {
+        const DiscoveredSession& stream = *snapshot->sessions[i];
+        json << "    {\"name\": \"" << stream.name << "\", "
+             << "\"address\": \"" << stream.session.connectionAddr << "\", "
+             << "\"port\": " << stream.session.port << "}";
+        if (i < snapshot->sessions.size() - 1) json << ",";
+        json << "\n";
     }
     json << "  ]\n";
     
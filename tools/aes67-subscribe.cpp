@@ -29,6 +29,16 @@ void PrintUsage(const char* progName) {
               << "  -c, --channels <num>    Number of channels (default: 8)\n"
               << "  -d, --duration <sec>    Run for specified seconds (default: infinite)\n"
               << "  -s, --stats             Print detailed statistics every second\n"
+              << "  -S, --ptp-slave         Never become PTP grandmaster (slave-only)\n"
+              << "  -M, --ptp-master        Always act as grandmaster (no BMCA)\n"
+              << "      --ptp-priority1 <n> BMCA priority1, lower wins (default: 128)\n"
+              << "      --ptp-sync-rate <hz> Sync rate as grandmaster, 1-128 Hz power of two (default: 8)\n"
+              << "      --ptp-hybrid        Send Delay_Req unicast to the master\n"
+              << "      --ptp-p2p           Peer-to-peer delay (Pdelay) for P2P transparent clocks\n"
+              << "      --ptp-unicast <ip>  Negotiate unicast Sync/Announce/Delay_Resp from this master\n"
+              << "      --ptp-domain <n>    Stream's PTP domain when not 0 (followed on the same sockets)\n"
+              << "      --servo <pi|lsq>    PTP slave servo (default: lsq)\n"
+              << "      --slew-only         Step the clock only at start-up, then slew\n"
               << "  -v, --verbose           Verbose output\n"
               << "  -h, --help              Show this help message\n\n"
               << "Examples:\n"
@@ -46,7 +56,17 @@ void PrintStats(const NetworkEngine& engine, int streamIdx, bool verbose) {
     
     // PTP status
     std::cout << "PTP Status:\n";
+    std::cout << "  Role:        " << PTPPortStateName(engine.GetPTPPortState()) << "\n";
+    if (engine.GetPTPPortState() == PTPPortState::Master) {
+        std::cout << "  Slaves:      " << engine.GetPTPSlaveCount() << "\n";
+    }
     std::cout << "  Locked:      " << (engine.IsPTPLocked() ? "Yes" : "No") << "\n";
+    const uint8_t streamDomain = engine.GetStreamPTPDomain(streamIdx);
+    if (streamDomain != 0) {
+        std::cout << "  Domain " << static_cast<int>(streamDomain) << ":   "
+                  << PTPPortStateName(engine.GetPTPDomainState(streamDomain))
+                  << (engine.IsPTPDomainLocked(streamDomain) ? ", locked" : ", not locked") << "\n";
+    }
     if (engine.IsPTPLocked()) {
         std::cout << "  Offset:      " << std::fixed << std::setprecision(2) 
                   << engine.GetPTPOffset() / 1000.0 << " µs\n";
@@ -61,12 +81,35 @@ void PrintStats(const NetworkEngine& engine, int streamIdx, bool verbose) {
     // TODO: Add packet count, loss rate, jitter metrics
     
     if (verbose) {
-        // Ring buffer status
-        // Note: GetInputRingBuffer is non-const, can't use in const function
-        // This would need to be refactored for proper const-correctness
-        std::cout << "\nRing Buffer:\n";
-        std::cout << "  Status:      Available\n";
-        // TODO: Add const version of GetInputRingBuffer or make stats non-const
+        // Input latency (media time -> read by the consumer)
+        std::cout << "\nPlayout:\n";
+        if (engine.IsStreamResampling(streamIdx)) {
+            // Sender's own clock: no latency or alignment against ours
+            std::cout << "  Latency:     n/a (resampled, rate " << std::fixed << std::setprecision(6)
+                      << engine.GetStreamRateEstimate(streamIdx) << ")\n";
+        } else {
+            std::cout << "  Latency:     " << engine.GetInputLatencyNs(streamIdx) / 1000 << " µs\n";
+            std::cout << "  Alignment:   " << engine.GetAlignmentErrorNs(streamIdx) / 1000 << " µs"
+                      << " (common delay " << engine.GetPlayoutDelayNs() / 1000 << " µs)\n";
+        }
+
+        // Clock quality over the last minute
+        const PTPStatsSnapshot ptp = engine.GetPTPStats(60.0);
+        if (ptp.offsetNs.count > 0) {
+            std::cout << "\nPTP Quality (60 s, " << ptp.offsetNs.count << " samples, "
+                      << ptp.rejectedSamples << " rejected):\n";
+            std::cout << std::fixed << std::setprecision(0);
+            std::cout << "  Offset:      p50 " << ptp.offsetNs.p50 << " ns, p99 " << ptp.offsetNs.p99
+                      << " ns, stddev " << ptp.offsetNs.stddev << " ns\n";
+            std::cout << "  Path Delay:  " << ptp.pathDelayNs.mean << " ns\n";
+            std::cout << "  Sync Jitter: " << ptp.syncIntervalNs.stddev / 1000.0 << " µs stddev\n";
+            std::cout << "  Frequency:   " << std::setprecision(1) << ptp.frequencyPpb.mean << " ppb\n";
+            for (const PTPDeviation& dev : ptp.deviations) {
+                std::cout << "  tau " << std::setw(7) << std::setprecision(3) << dev.tauSec << " s: ADEV "
+                          << std::scientific << std::setprecision(2) << dev.adev << std::fixed
+                          << ", TDEV " << std::setprecision(1) << dev.tdevNs << " ns\n";
+            }
+        }
     }
     
     std::cout << std::endl;
@@ -80,6 +123,15 @@ int main(int argc, char* argv[]) {
     int channels = 8;
     int duration = 0;  // 0 = run forever
     bool showStats = false;
+    PTPClient::Mode ptpMode = PTPClient::Mode::Auto;
+    int ptpPriority1 = 128;
+    int8_t ptpLogSyncInterval = -3;
+    bool ptpHybrid = false;
+    PTPClient::DelayMechanism ptpDelayMechanism = PTPClient::DelayMechanism::E2E;
+    std::string ptpUnicastMaster;
+    int streamDomain = 0;
+    PTPServoType servo = PTPServoType::LeastSquares;
+    PTPServoConfig servoConfig;
     bool verbose = false;
     
     // Parse command line
@@ -118,6 +170,81 @@ int main(int argc, char* argv[]) {
         else if (arg == "-s" || arg == "--stats") {
             showStats = true;
         }
+        else if (arg == "-S" || arg == "--ptp-slave") {
+            ptpMode = PTPClient::Mode::Slave;
+        }
+        else if (arg == "-M" || arg == "--ptp-master") {
+            ptpMode = PTPClient::Mode::Master;
+        }
+        else if (arg == "--ptp-priority1") {
+            if (++i >= argc) {
+                std::cerr << "Error: " << arg << " requires an argument" << std::endl;
+                return 1;
+            }
+            ptpPriority1 = std::atoi(argv[i]);
+            if (ptpPriority1 < 0 || ptpPriority1 > 255) {
+                std::cerr << "Error: priority1 must be 0-255" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--ptp-sync-rate") {
+            if (++i >= argc) {
+                std::cerr << "Error: " << arg << " requires an argument" << std::endl;
+                return 1;
+            }
+            const int rate = std::atoi(argv[i]);
+            int8_t logInterval = 0;
+            while (logInterval > -7 && (1 << -logInterval) < rate) {
+                logInterval--;
+            }
+            if (rate < 1 || (1 << -logInterval) != rate) {
+                std::cerr << "Error: sync rate must be 1, 2, 4, ... 128 Hz" << std::endl;
+                return 1;
+            }
+            ptpLogSyncInterval = logInterval;
+        }
+        else if (arg == "--ptp-hybrid") {
+            ptpHybrid = true;
+        }
+        else if (arg == "--ptp-p2p") {
+            ptpDelayMechanism = PTPClient::DelayMechanism::P2P;
+        }
+        else if (arg == "--ptp-unicast") {
+            if (++i >= argc) {
+                std::cerr << "Error: " << arg << " requires an argument" << std::endl;
+                return 1;
+            }
+            ptpUnicastMaster = argv[i];
+        }
+        else if (arg == "--ptp-domain") {
+            if (++i >= argc) {
+                std::cerr << "Error: " << arg << " requires an argument" << std::endl;
+                return 1;
+            }
+            streamDomain = std::atoi(argv[i]);
+            if (streamDomain < 0 || streamDomain > 255) {
+                std::cerr << "Error: PTP domain must be 0-255" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--servo") {
+            if (++i >= argc) {
+                std::cerr << "Error: " << arg << " requires an argument" << std::endl;
+                return 1;
+            }
+            const std::string name = argv[i];
+            if (name == "pi") {
+                servo = PTPServoType::PI;
+            } else if (name == "lsq") {
+                servo = PTPServoType::LeastSquares;
+            } else {
+                std::cerr << "Error: servo must be pi or lsq" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--slew-only") {
+            servoConfig.stepOnlyAtStart = true;
+        }
         else if (arg == "-v" || arg == "--verbose") {
             verbose = true;
         }
@@ -168,6 +295,21 @@ int main(int argc, char* argv[]) {
     // Create network engine (use default config)
     NetworkEngine engine("../configs/engine.json");
     engine.SetNetworkInterface(interface);
+    engine.SetPTPMode(ptpMode);
+    engine.SetPTPPriority(static_cast<uint8_t>(ptpPriority1));
+    engine.SetPTPSyncInterval(ptpLogSyncInterval);
+    engine.SetPTPHybrid(ptpHybrid);
+    engine.SetPTPDelayMechanism(ptpDelayMechanism);
+    engine.SetPTPUnicastMaster(ptpUnicastMaster);
+    engine.SetPTPServo(servo, servoConfig);
+    
+    // Subscribed stream (index 0) runs on its own domain's clock
+    const int streamIdx = 0;
+    if (streamDomain != 0 && (!engine.AddPTPDomain(static_cast<uint8_t>(streamDomain)) ||
+                              !engine.SetStreamPTPDomain(streamIdx, static_cast<uint8_t>(streamDomain)))) {
+        std::cerr << "Error: cannot follow PTP domain " << streamDomain << std::endl;
+        return 1;
+    }
     
     // Start engine
     std::cout << "Starting network engine..." << std::endl;
@@ -194,11 +336,17 @@ int main(int argc, char* argv[]) {
     }
     
     // Subscribe to stream (use stream 0 for manual subscription)
-    const int streamIdx = 0;
     std::cout << "\nSubscribing to stream on " << multicastAddr << ":" << port << "..." << std::endl;
     
-    // TODO: Add SubscribeToStream(streamIdx, multicastAddr, port, channels) to NetworkEngine
-    // For now, this is a placeholder - the actual subscription would happen here
+    RxSubscription subscription;
+    subscription.address = multicastAddr;
+    subscription.port = port;
+    subscription.channels = static_cast<uint8_t>(channels);
+    if (!engine.Subscribe(streamIdx, subscription)) {
+        std::cerr << "Error: Failed to subscribe to " << multicastAddr << ":" << port << std::endl;
+        engine.Stop();
+        return 1;
+    }
     std::cout << "Subscription activated (stream index: " << streamIdx << ")" << std::endl;
     
     // Monitor loop